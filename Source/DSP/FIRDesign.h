@@ -0,0 +1,155 @@
+/*
+  ==============================================================================
+
+    FIRDesign.h
+    FIR correction filters designed from a sampled magnitude curve
+
+    Used for headphone correction from raw AutoEq frequency-response data:
+    the curve (dB vs Hz) is sampled onto an FFT grid and turned into either a
+    minimum-phase filter (real-cepstrum method, no added latency) or a
+    linear-phase filter (symmetric, latency of half the length).
+
+    All functions allocate and are meant for a background thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+
+//==============================================================================
+struct FIRDesign
+{
+    enum class Phase
+    {
+        Minimum,
+        Linear
+    };
+
+    /** Filter length used for a given sample rate (about 45 ms, power of two). */
+    static int getLengthForSampleRate (double sampleRate)
+    {
+        return juce::nextPowerOfTwo (juce::roundToInt (sampleRate * 0.045));
+    }
+
+    /** Latency introduced by a filter of this length and phase type. */
+    static int getLatencySamples (int length, Phase phase)
+    {
+        return phase == Phase::Linear ? length / 2 : 0;
+    }
+
+    /** Linearly interpolates a dB curve on a log-frequency axis, holding the end values. */
+    static float interpolateCurveDb (const std::vector<float>& frequencies,
+                                     const std::vector<float>& gainsDb, float frequency)
+    {
+        if (frequencies.empty())
+            return 0.0f;
+
+        if (frequency <= frequencies.front())
+            return gainsDb.front();
+
+        if (frequency >= frequencies.back())
+            return gainsDb.back();
+
+        auto upper = std::upper_bound (frequencies.begin(), frequencies.end(), frequency);
+        auto i = static_cast<size_t> (std::distance (frequencies.begin(), upper));
+
+        const float f0 = frequencies[i - 1], f1 = frequencies[i];
+        const float t = std::log (frequency / f0) / std::log (f1 / f0);
+        return gainsDb[i - 1] + t * (gainsDb[i] - gainsDb[i - 1]);
+    }
+
+    /** Designs an FIR of the given length whose magnitude follows the curve plus a fixed gain. */
+    static std::vector<float> designFromCurve (const std::vector<float>& frequencies,
+                                               const std::vector<float>& gainsDb,
+                                               float extraGainDb, double sampleRate,
+                                               int length, Phase phase)
+    {
+        // Design on a grid twice as long as the filter to keep time-aliasing
+        // of the cepstrum / zero-phase response out of the kept samples
+        const int order = juce::roundToInt (std::log2 ((double) length)) + 1;
+        const int fftSize = 1 << order;
+        juce::dsp::FFT fft (order);
+
+        std::vector<std::complex<float>> spectrum ((size_t) fftSize), work ((size_t) fftSize);
+
+        // Log-magnitude on the FFT grid (Hermitian symmetric, real)
+        for (int k = 0; k <= fftSize / 2; ++k)
+        {
+            const auto freq = static_cast<float> (juce::jmax (1.0, k * sampleRate / fftSize));
+            const float dB = juce::jlimit (-30.0f, 30.0f, interpolateCurveDb (frequencies, gainsDb, freq) + extraGainDb);
+            const float logMag = dB * (std::log (10.0f) / 20.0f);
+
+            spectrum[(size_t) k] = logMag;
+            if (k > 0 && k < fftSize / 2)
+                spectrum[(size_t) (fftSize - k)] = logMag;
+        }
+
+        std::vector<float> impulse ((size_t) length);
+
+        if (phase == Phase::Minimum)
+        {
+            // Real cepstrum, folded onto positive quefrencies, back to a min-phase spectrum
+            inverse (fft, spectrum, work);
+
+            for (int n = 1; n < fftSize / 2; ++n)
+            {
+                work[(size_t) n] *= 2.0f;
+                work[(size_t) (fftSize - n)] = 0.0f;
+            }
+
+            fft.perform (work.data(), spectrum.data(), false);
+
+            for (auto& bin : spectrum)
+                bin = std::exp (bin);
+
+            inverse (fft, spectrum, work);
+
+            for (int n = 0; n < length; ++n)
+                impulse[(size_t) n] = work[(size_t) n].real();
+
+            // Fade out the last 10% to hide truncation
+            const int fadeLength = juce::jmax (1, length / 10);
+            for (int n = 0; n < fadeLength; ++n)
+            {
+                const auto w = 0.5f * (1.0f + std::cos (juce::MathConstants<float>::pi * (n + 1) / fadeLength));
+                impulse[(size_t) (length - fadeLength + n)] *= w;
+            }
+        }
+        else
+        {
+            // Zero-phase response, centred in the filter and Hann-windowed
+            for (auto& bin : spectrum)
+                bin = std::exp (bin.real());
+
+            inverse (fft, spectrum, work);
+
+            for (int n = 0; n < length; ++n)
+            {
+                const int source = (n - length / 2 + fftSize) % fftSize;
+                const auto w = 0.5f * (1.0f - std::cos (juce::MathConstants<float>::twoPi * n / length));
+                impulse[(size_t) n] = work[(size_t) source].real() * w;
+            }
+        }
+
+        return impulse;
+    }
+
+private:
+    // Inverse via the forward transform, so the result doesn't depend on the
+    // FFT engine's inverse scaling convention
+    static void inverse (const juce::dsp::FFT& fft, std::vector<std::complex<float>>& input,
+                         std::vector<std::complex<float>>& output)
+    {
+        for (auto& bin : input)
+            bin = std::conj (bin);
+
+        fft.perform (input.data(), output.data(), false);
+
+        const float scale = 1.0f / static_cast<float> (output.size());
+        for (auto& sample : output)
+            sample = std::conj (sample) * scale;
+    }
+};
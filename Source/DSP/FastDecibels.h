@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    FastDecibels.h
+    Polynomial dB <-> gain conversions for the audio and UI threads
+
+    Drop-in replacements for juce::Decibels::gainToDecibels() and
+    decibelsToGain(), built on a log2 and exp2 that take the exponent
+    from the float's bits and approximate only the mantissa:
+
+      log2: mantissa reduced to [sqrt(1/2), sqrt(2)) and expanded as
+            2 / ln2 * atanh ((m - 1) / (m + 1))
+      exp2: rounded to the nearest integer, 2^f for |f| <= 1/2 fitted
+            with a relative-error-weighted polynomial
+
+    Two accuracy tiers, with errors measured against double precision from
+    -140 to +140 dB:
+
+      Precise   log2 to t^9, exp2 degree 5: within 2e-5 dB, as close as the
+                float std::log10 / std::pow (the default, for the audio path)
+      Fast      log2 to t^3, exp2 degree 3: within 0.001 dB (meters, UI)
+
+    Every function is branch-free, so the batch versions are plain loops
+    that the compiler turns into SIMD.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+struct FastDecibels
+{
+    enum class Accuracy
+    {
+        Precise,
+        Fast
+    };
+
+    static constexpr float dbPerLog2 = 6.02059991f;     // 20 * log10 (2)
+    static constexpr float log2PerDb = 0.166096405f;    // log2 (10) / 20
+
+    /** log2 (x) for normal x > 0. */
+    template <Accuracy accuracy = Accuracy::Precise>
+    static inline float log2 (float x) noexcept
+    {
+        uint32_t bits;
+        std::memcpy (&bits, &x, sizeof (bits));
+
+        auto exponent = static_cast<float> (static_cast<int> (bits >> 23) - 127);
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+
+        float m;
+        std::memcpy (&m, &bits, sizeof (m));
+
+        const bool high = m > 1.41421356f;
+        m = high ? m * 0.5f : m;
+        exponent += high ? 1.0f : 0.0f;
+
+        const float t = (m - 1.0f) / (m + 1.0f);
+        const float t2 = t * t;
+
+        if constexpr (accuracy == Accuracy::Fast)
+            return exponent + t * (2.88539008f + t2 * 0.961796694f);
+        else
+            return exponent + t * (2.88539008f + t2 * (0.961796694f + t2 * (0.577078016f
+                                               + t2 * (0.412198583f + t2 * 0.320598898f))));
+    }
+
+    /** 2^x, clamped to the normal float range. */
+    template <Accuracy accuracy = Accuracy::Precise>
+    static inline float exp2 (float x) noexcept
+    {
+        x = juce::jlimit (-126.0f, 127.0f, x);
+
+        // Round to nearest by pushing the fraction out of the mantissa
+        const float n = (x + 12582912.0f) - 12582912.0f;
+        const float f = x - n;
+
+        float p;
+
+        if constexpr (accuracy == Accuracy::Fast)
+            p = 0.99992894f + f * (0.693276242f + f * (0.242604051f + f * 0.0550886838f));
+        else
+            p = 1.00000007f + f * (0.693146949f + f * (0.240221218f + f * (0.0555074262f
+                                                + f * (0.00967545975f + f * 0.00132669704f))));
+
+        const auto scaleBits = static_cast<uint32_t> (static_cast<int> (n) + 127) << 23;
+        float scale;
+        std::memcpy (&scale, &scaleBits, sizeof (scale));
+
+        return p * scale;
+    }
+
+    /** As juce::Decibels::gainToDecibels(): minusInfinityDb for gains of 0 or below. */
+    template <Accuracy accuracy = Accuracy::Precise>
+    static inline float gainToDecibels (float gain, float minusInfinityDb = -100.0f) noexcept
+    {
+        const float db = dbPerLog2 * log2<accuracy> (juce::jmax (gain, std::numeric_limits<float>::min()));
+        return gain > 0.0f ? juce::jmax (db, minusInfinityDb) : minusInfinityDb;
+    }
+
+    /** As juce::Decibels::decibelsToGain(): 0 at or below minusInfinityDb. */
+    template <Accuracy accuracy = Accuracy::Precise>
+    static inline float decibelsToGain (float decibels, float minusInfinityDb = -100.0f) noexcept
+    {
+        const float gain = exp2<accuracy> (decibels * log2PerDb);
+        return decibels > minusInfinityDb ? gain : 0.0f;
+    }
+
+    //==============================================================================
+    /** gainToDecibels() over a block; source and dest may be the same. */
+    template <Accuracy accuracy = Accuracy::Precise>
+    static void gainToDecibels (const float* gains, float* decibels, int numValues,
+                                float minusInfinityDb = -100.0f) noexcept
+    {
+        for (int i = 0; i < numValues; ++i)
+            decibels[i] = gainToDecibels<accuracy> (gains[i], minusInfinityDb);
+    }
+
+    /** decibelsToGain() over a block; source and dest may be the same. */
+    template <Accuracy accuracy = Accuracy::Precise>
+    static void decibelsToGain (const float* decibels, float* gains, int numValues,
+                                float minusInfinityDb = -100.0f) noexcept
+    {
+        for (int i = 0; i < numValues; ++i)
+            gains[i] = decibelsToGain<accuracy> (decibels[i], minusInfinityDb);
+    }
+};
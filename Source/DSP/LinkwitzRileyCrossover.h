@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    LinkwitzRileyCrossover.h
+    4th-order Linkwitz-Riley band splitter with cached coefficients
+
+    Same TPT state-variable structure as juce::dsp::LinkwitzRileyFilter, but
+    one splitter produces both the lowpass and highpass outputs (the first
+    SVF stage is shared), and the coefficients are plain values that can be
+    designed once per sample rate and copied in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+struct LinkwitzRileyCoefficients
+{
+    float g  = 0.0f;   // tan (pi * fc / fs)
+    float r2 = juce::MathConstants<float>::sqrt2;
+    float h  = 1.0f;   // 1 / (1 + r2 * g + g * g)
+
+    static LinkwitzRileyCoefficients design (double sampleRate, float cutoffFrequency)
+    {
+        LinkwitzRileyCoefficients c;
+        c.g = static_cast<float> (std::tan (juce::MathConstants<double>::pi * cutoffFrequency / sampleRate));
+        c.h = static_cast<float> (1.0 / (1.0 + c.r2 * c.g + c.g * c.g));
+        return c;
+    }
+};
+
+//==============================================================================
+// One crossover point for one channel: input -> (lowpass, highpass)
+struct LinkwitzRileySplitter
+{
+    float s1 = 0.0f, s2 = 0.0f;     // Shared first Butterworth stage
+    float lp1 = 0.0f, lp2 = 0.0f;   // Second stage, lowpass path
+    float hp1 = 0.0f, hp2 = 0.0f;   // Second stage, highpass path
+
+    void reset() noexcept { s1 = s2 = lp1 = lp2 = hp1 = hp2 = 0.0f; }
+
+    inline void process (const LinkwitzRileyCoefficients& c, float input,
+                         float& outputLow, float& outputHigh) noexcept
+    {
+        const float k = c.r2 + c.g;
+
+        const float yH = (input - k * s1 - s2) * c.h;
+        const float yB = c.g * yH + s1;
+        s1 = c.g * yH + yB;
+        const float yL = c.g * yB + s2;
+        s2 = c.g * yB + yL;
+
+        // Lowpass path: second stage on the first stage's lowpass output
+        const float lH = (yL - k * lp1 - lp2) * c.h;
+        const float lB = c.g * lH + lp1;
+        lp1 = c.g * lH + lB;
+        const float lL = c.g * lB + lp2;
+        lp2 = c.g * lB + lL;
+
+        // Highpass path: second stage on the first stage's highpass output
+        const float hH = (yH - k * hp1 - hp2) * c.h;
+        const float hB = c.g * hH + hp1;
+        hp1 = c.g * hH + hB;
+        const float hL = c.g * hB + hp2;
+        hp2 = c.g * hB + hL;
+
+        outputLow = lL;
+        outputHigh = hH;
+    }
+};
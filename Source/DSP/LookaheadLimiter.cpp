@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    LookaheadLimiter.cpp
+    Stereo-linked lookahead true-peak limiter for the output
+
+  ==============================================================================
+*/
+
+#include "LookaheadLimiter.h"
+
+//==============================================================================
+void LookaheadLimiter::prepare (double sampleRate)
+{
+    lookahead = getLookaheadSamples (sampleRate);
+    latency = lookahead + TruePeakDetector::delay;
+    windowLength = lookahead + 1;
+
+    // Room for a window of gains plus the one leaving it, a window of peaks plus the newest,
+    // and the delayed audio
+    const int size = juce::nextPowerOfTwo (juce::jmax (windowLength, latency) + 1);
+    mask = size - 1;
+
+    for (auto& line : delayLines)
+        line.assign (static_cast<size_t> (size), 0.0f);
+
+    gainHistory.assign (static_cast<size_t> (size), 1.0f);
+    dequePeaks.assign (static_cast<size_t> (size), 0.0f);
+    dequeTimes.assign (static_cast<size_t> (size), 0);
+
+    detector.prepare (detectorBlockSize);
+    truePeaks.assign (static_cast<size_t> (detectorBlockSize), 0.0f);
+
+    releaseCoeff = static_cast<float> (std::exp (-1.0 / (releaseMs * 0.001 * sampleRate)));
+
+    reset();
+}
+
+void LookaheadLimiter::reset() noexcept
+{
+    for (auto& line : delayLines)
+        std::fill (line.begin(), line.end(), 0.0f);
+
+    detector.reset();
+
+    std::fill (gainHistory.begin(), gainHistory.end(), 1.0f);
+    writePosition = 0;
+
+    dequeFront = dequeSize = 0;
+    time = 0;
+
+    heldGain = 1.0f;
+    gainSum = static_cast<double> (windowLength);
+    minGain = 1.0f;
+}
+
+void LookaheadLimiter::process (float* left, float* right, int numSamples) noexcept
+{
+    if (delayLines[0].empty())
+        return;
+
+    float* delayLeft = delayLines[0].data();
+    float* delayRight = delayLines[1].data();
+    const auto windowSpan = static_cast<uint32_t> (lookahead);
+    const float averageScale = 1.0f / static_cast<float> (windowLength);
+    float lowestGain = 1.0f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // True peaks a detector block at a time, before its samples are overwritten; each
+        // describes the audio the detector's delay back, which the delay line adds
+        const int offset = i % detectorBlockSize;
+
+        if (offset == 0)
+            detector.process (left + i, right + i, juce::jmin (detectorBlockSize, numSamples - i),
+                              truePeaks.data(), nullptr);
+
+        const float peak = truePeaks[static_cast<size_t> (offset)];
+
+        // Peaks no louder than a newer one can never be the window's maximum again
+        while (dequeSize > 0 && dequePeaks[static_cast<size_t> ((dequeFront + dequeSize - 1) & mask)] <= peak)
+            --dequeSize;
+
+        const auto back = static_cast<size_t> ((dequeFront + dequeSize) & mask);
+        dequePeaks[back] = peak;
+        dequeTimes[back] = time;
+        ++dequeSize;
+
+        // At most one peak leaves the window per sample
+        if (time - dequeTimes[static_cast<size_t> (dequeFront)] > windowSpan)
+        {
+            dequeFront = (dequeFront + 1) & mask;
+            --dequeSize;
+        }
+
+        const float windowPeak = dequePeaks[static_cast<size_t> (dequeFront)];
+        const float requiredGain = windowPeak > ceiling ? ceiling / windowPeak : 1.0f;
+
+        // Instant attack (the lookahead smooths it), exponential release
+        heldGain = requiredGain < heldGain ? requiredGain
+                                           : requiredGain + releaseCoeff * (heldGain - requiredGain);
+
+        // Moving average over the window: the gain from windowLength samples ago drops out
+        const auto position = static_cast<size_t> (writePosition);
+        const auto leaving = static_cast<size_t> ((writePosition - windowLength) & mask);
+        gainSum += static_cast<double> (heldGain) - static_cast<double> (gainHistory[leaving]);
+        gainHistory[position] = heldGain;
+
+        const float gain = juce::jmin (1.0f, static_cast<float> (gainSum) * averageScale);
+        lowestGain = juce::jmin (lowestGain, gain);
+
+        // The delayed sample out, this one in
+        const auto oldest = static_cast<size_t> ((writePosition - latency) & mask);
+        const float inputLeft = left[i];
+        const float inputRight = right[i];
+        left[i] = delayLeft[oldest] * gain;
+        right[i] = delayRight[oldest] * gain;
+        delayLeft[position] = inputLeft;
+        delayRight[position] = inputRight;
+
+        writePosition = (writePosition + 1) & mask;
+        ++time;
+    }
+
+    minGain = lowestGain;
+}
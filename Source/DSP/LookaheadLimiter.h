@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    LookaheadLimiter.h
+    Stereo-linked lookahead true-peak limiter for the output
+
+    The signal is delayed by the lookahead, and the gain for each delayed
+    sample is worked out from everything it is about to be mixed with:
+
+      1. The true peak of both ears (TruePeakDetector, so the overs between
+         samples count too) over the lookahead window (lookahead + 1
+         samples), kept with a monotonic deque: each sample is pushed and
+         popped at most once, so the window maximum costs O(1) per sample
+      2. The gain that holds that peak to the ceiling, which drops at once
+         and recovers with the release time
+      3. A moving average of that gain over the same window
+
+    Every gain averaged for a delayed sample was computed from a window that
+    contained it, so the output never exceeds the ceiling, and the gain
+    reaches each peak as a smooth ramp rather than a step. The audio is
+    delayed by the detector's delay as well, which lines it up with its
+    true peaks.
+
+    prepare() allocates; process() never allocates or locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TruePeakDetector.h"
+
+//==============================================================================
+class LookaheadLimiter
+{
+public:
+    static constexpr double lookaheadMs = 1.5;
+    static constexpr double releaseMs = 60.0;
+
+    LookaheadLimiter() = default;
+
+    /** Lookahead at sampleRate; the latency adds TruePeakDetector::delay. */
+    static int getLookaheadSamples (double sampleRate) noexcept
+    {
+        return juce::jmax (1, juce::roundToInt (sampleRate * lookaheadMs / 1000.0));
+    }
+
+    /** Sizes the delay lines and windows for sampleRate. Allocates. */
+    void prepare (double sampleRate);
+
+    /** Clears the delay lines and returns the gain to unity. */
+    void reset() noexcept;
+
+    /** Linear peak the output is held to. */
+    void setCeiling (float newCeiling) noexcept { ceiling = newCeiling; }
+
+    int getLatencySamples() const noexcept { return latency; }
+
+    /** Limits a stereo block in place; the output lags the input by getLatencySamples(). */
+    void process (float* left, float* right, int numSamples) noexcept;
+
+    /** Lowest gain applied in the last block (1 = no limiting). */
+    float getMinGain() const noexcept { return minGain; }
+
+private:
+    static constexpr int detectorBlockSize = 256;
+
+    int lookahead = 0;
+    int latency = 0;            // lookahead + the true-peak detector's delay
+    int windowLength = 0;       // lookahead + 1
+    int mask = 0;               // Ring buffers are a power of two long
+    float ceiling = 1.0f;
+    float releaseCoeff = 0.0f;
+
+    std::array<std::vector<float>, 2> delayLines;
+    std::vector<float> gainHistory;         // The last windowLength held gains, for the average
+    int writePosition = 0;
+
+    // Window maximum: peaks decreasing from front to back, with the sample they arrived at
+    std::vector<float> dequePeaks;
+    std::vector<uint32_t> dequeTimes;
+    int dequeFront = 0, dequeSize = 0;
+    uint32_t time = 0;
+
+    float heldGain = 1.0f;
+    double gainSum = 0.0;                   // Sum of gainHistory
+    float minGain = 1.0f;
+
+    TruePeakDetector detector;
+    std::vector<float> truePeaks;           // One detector block's linked true peaks
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LookaheadLimiter)
+};
@@ -0,0 +1,329 @@
+/*
+  ==============================================================================
+
+    LoudnessRestorer.cpp
+    Real-time specific-loudness restoration (Moore & Glasberg style)
+
+  ==============================================================================
+*/
+
+#include "LoudnessRestorer.h"
+
+namespace
+{
+    // ERB-number scale (Glasberg & Moore 1990)
+    float hzToCam (float frequency) noexcept  { return 21.4f * std::log10 (4.37f * frequency / 1000.0f + 1.0f); }
+    float camToHz (float cam) noexcept        { return (std::pow (10.0f, cam / 21.4f) - 1.0f) * 1000.0f / 4.37f; }
+    float getERB (float frequency) noexcept   { return 24.7f * (4.37f * frequency / 1000.0f + 1.0f); }
+
+    constexpr float firstBandCam = 2.0f;        // 55 Hz
+    constexpr float highestBandHz = 15000.0f;
+
+    // An outer hair cell loss accounts for most of a mild loss, up to this much;
+    // the rest is an inner hair cell loss (after Moore & Glasberg 2004)
+    constexpr float outerHairCellShare = 0.8f;
+    constexpr float maxOuterHairCellLossDb = 55.0f;
+
+    // Where the roex spreading function falls below -30 dB, in units of fc / p
+    constexpr float spreadingLimit = 9.23f;
+}
+
+//==============================================================================
+float LoudnessRestorer::getBandFrequency (int index) noexcept
+{
+    return camToHz (firstBandCam + static_cast<float> (index));
+}
+
+int LoudnessRestorer::getNumBands (double sampleRate) noexcept
+{
+    const auto top = juce::jmin (highestBandHz, static_cast<float> (sampleRate * 0.45));
+    int count = 0;
+
+    while (count < maxBands && getBandFrequency (count) <= top)
+        ++count;
+
+    return count;
+}
+
+double LoudnessRestorer::getNormalA (float frequency) noexcept
+{
+    // Threshold excitation: 3.73 dB from 500 Hz up, rising 7.5 dB per octave below it
+    const float thresholdDb = 3.73f + 7.5f * juce::jmax (0.0f, std::log2 (500.0f / frequency));
+    return 2.0 * std::pow (10.0, thresholdDb / 10.0);
+}
+
+void LoudnessRestorer::fitEar (double sampleRate, const float* frequencies, const float* lossesDb, int numPoints,
+                               EarFitting& ear)
+{
+    jassert (numPoints > 0);
+
+    for (int band = 0; band < getNumBands (sampleRate); ++band)
+    {
+        const float frequency = getBandFrequency (band);
+
+        // The audiogram interpolated in log frequency, held flat beyond its ends
+        float lossDb = lossesDb[0];
+
+        if (frequency >= frequencies[numPoints - 1])
+        {
+            lossDb = lossesDb[numPoints - 1];
+        }
+        else if (frequency > frequencies[0])
+        {
+            int i = 0;
+
+            while (frequency > frequencies[i + 1])
+                ++i;
+
+            const float t = std::log2 (frequency / frequencies[i]) / std::log2 (frequencies[i + 1] / frequencies[i]);
+            lossDb = lossesDb[i] + t * (lossesDb[i + 1] - lossesDb[i]);
+        }
+
+        lossDb = juce::jmax (0.0f, lossDb);
+        const float outerLossDb = juce::jmin (outerHairCellShare * lossDb, maxOuterHairCellLossDb);
+        const float innerLossDb = lossDb - outerLossDb;
+
+        const auto b = static_cast<size_t> (band);
+        ear.impairedA[b] = getNormalA (frequency) * std::pow (10.0, outerLossDb / 10.0);
+        ear.impairedAPowAlpha[b] = std::pow (ear.impairedA[b], static_cast<double> (alpha));
+        ear.innerGain[b] = std::pow (10.0, -innerLossDb / 10.0);
+    }
+}
+
+//==============================================================================
+void LoudnessRestorer::prepare (double sampleRate, const float* crossoverFrequencies, int numCrossovers,
+                                float fullScaleDbSpl)
+{
+    jassert (numCrossovers < maxOutputBands);
+
+    currentSampleRate = sampleRate;
+    numBands = getNumBands (sampleRate);
+    numOutputBands = numCrossovers + 1;
+
+    // ~21 ms frames at any rate, 50% overlap
+    const int order = juce::jlimit (9, 13, juce::roundToInt (std::log2 (sampleRate * 0.021)));
+    fftSize = 1 << order;
+    hopSize = fftSize / 2;
+    fft = std::make_unique<juce::dsp::FFT> (order);
+
+    window.resize (static_cast<size_t> (fftSize));
+
+    for (int n = 0; n < fftSize; ++n)
+        window[static_cast<size_t> (n)] = 0.5f - 0.5f * std::cos (juce::MathConstants<float>::twoPi * static_cast<float> (n)
+                                                                   / static_cast<float> (fftSize));
+
+    for (auto& channel : history)
+        channel.assign (static_cast<size_t> (fftSize), 0.0f);
+
+    frame.assign (static_cast<size_t> (fftSize), {});
+    spectrum.assign (static_cast<size_t> (fftSize), {});
+
+    const int numBins = fftSize / 2 + 1;
+
+    for (auto& power : powerSpectra)
+        power.assign (static_cast<size_t> (numBins), 0.0f);
+
+    // Bin power to intensity re 0 dB SPL: a full-scale sine (power 1/2) is fullScaleDbSpl.
+    // A Hann-windowed sine's one-sided bins sum to 3 N^2 / 16 times its power, and
+    // separating the packed ears leaves each spectrum doubled (a factor of 4 in power).
+    const float size = static_cast<float> (fftSize);
+    const float powerScale = 16.0f / (3.0f * size * size) * 0.25f
+                               * 2.0f * std::pow (10.0f, fullScaleDbSpl / 10.0f);
+
+    // Level-independent roex(p) spreading per band, p = 4 fc / ERB(fc), truncated at -30 dB
+    const float binHz = static_cast<float> (sampleRate) / size;
+    weights.clear();
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        const float centre = getBandFrequency (band);
+        const float p = 4.0f * centre / getERB (centre);
+        const float reach = spreadingLimit * centre / p;
+
+        const int first = juce::jmax (1, static_cast<int> (std::ceil ((centre - reach) / binHz)));
+        const int last = juce::jmin (numBins - 1, static_cast<int> (std::floor ((centre + reach) / binHz)));
+
+        const auto b = static_cast<size_t> (band);
+        firstBin[b] = first;
+        weightOffset[b] = static_cast<int> (weights.size());
+
+        for (int bin = first; bin <= last; ++bin)
+        {
+            const float g = std::abs (static_cast<float> (bin) * binHz - centre) / centre;
+            weights.push_back (powerScale * (1.0f + p * g) * std::exp (-p * g));
+        }
+
+        numWeights[b] = static_cast<int> (weights.size()) - weightOffset[b];
+
+        normalA[b] = getNormalA (centre);
+        normalAPowAlpha[b] = std::pow (normalA[b], static_cast<double> (alpha));
+
+        int output = 0;
+
+        while (output < numCrossovers && centre >= crossoverFrequencies[output])
+            ++output;
+
+        outputBand[b] = output;
+    }
+
+    reset();
+}
+
+void LoudnessRestorer::reset() noexcept
+{
+    for (auto& channel : history)
+        std::fill (channel.begin(), channel.end(), 0.0f);
+
+    writePosition = 0;
+    samplesSinceFrame = 0;
+    stage = Stage::idle;
+
+    for (auto& ear : gainsDb)
+        ear.fill (0.0f);
+}
+
+void LoudnessRestorer::process (const float* left, const float* right, int numSamples, const Fitting& fitting) noexcept
+{
+    if (fft == nullptr)
+        return;
+
+    // Only the last frame's worth of a long block can reach the analysis
+    const int mask = fftSize - 1;
+
+    for (int i = juce::jmax (0, numSamples - fftSize); i < numSamples; ++i)
+    {
+        history[0][static_cast<size_t> (writePosition)] = left[i];
+        history[1][static_cast<size_t> (writePosition)] = right[i];
+        writePosition = (writePosition + 1) & mask;
+    }
+
+    samplesSinceFrame += numSamples;
+
+    // One frame per hop at most: a long block smooths over the whole of its duration instead
+    if (samplesSinceFrame >= hopSize)
+    {
+        while (stage != Stage::idle)
+            runStage (fitting);
+
+        captureFrame (samplesSinceFrame);
+        samplesSinceFrame = 0;
+    }
+    else if (stage != Stage::idle)
+    {
+        runStage (fitting);
+    }
+}
+
+void LoudnessRestorer::captureFrame (int elapsedSamples) noexcept
+{
+    const int mask = fftSize - 1;
+
+    // Both ears in one transform, oldest sample first
+    for (int n = 0; n < fftSize; ++n)
+    {
+        const auto index = static_cast<size_t> ((writePosition + n) & mask);
+        frame[static_cast<size_t> (n)] = window[static_cast<size_t> (n)] * std::complex<float> (history[0][index], history[1][index]);
+    }
+
+    frameElapsedSamples = elapsedSamples;
+    stage = Stage::transform;
+}
+
+void LoudnessRestorer::runStage (const Fitting& fitting) noexcept
+{
+    switch (stage)
+    {
+        case Stage::transform:
+            fft->perform (frame.data(), spectrum.data(), false);
+            stage = Stage::separate;
+            break;
+
+        case Stage::separate:
+        {
+            // Left = (Z[k] + conj Z[N - k]) / 2, right = (Z[k] - conj Z[N - k]) / 2i; the halves are in powerScale
+            const int mask = fftSize - 1;
+
+            for (int k = 0; k <= fftSize / 2; ++k)
+            {
+                const auto z = spectrum[static_cast<size_t> (k)];
+                const auto mirrored = std::conj (spectrum[static_cast<size_t> ((fftSize - k) & mask)]);
+                powerSpectra[0][static_cast<size_t> (k)] = std::norm (z + mirrored);
+                powerSpectra[1][static_cast<size_t> (k)] = std::norm (z - mirrored);
+            }
+
+            stage = Stage::leftEar;
+            break;
+        }
+
+        case Stage::leftEar:
+            analyseEar (0, fitting);
+            stage = Stage::rightEar;
+            break;
+
+        case Stage::rightEar:
+            analyseEar (1, fitting);
+            stage = Stage::idle;
+            break;
+
+        case Stage::idle:
+            break;
+    }
+}
+
+void LoudnessRestorer::analyseEar (int ear, const Fitting& fitting) noexcept
+{
+    const double elapsedSeconds = frameElapsedSamples / currentSampleRate;
+    const auto attackCoeff = static_cast<float> (std::exp (-elapsedSeconds / (fitting.attackMs * 0.001)));
+    const auto releaseCoeff = static_cast<float> (std::exp (-elapsedSeconds / (fitting.releaseMs * 0.001)));
+
+    const auto& fit = fitting.ears[static_cast<size_t> (ear)];
+    const float* power = powerSpectra[static_cast<size_t> (ear)].data();
+
+    std::array<double, maxOutputBands> weightedGainDb {}, loudnessSum {};
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        const auto b = static_cast<size_t> (band);
+        const float* w = weights.data() + weightOffset[b];
+        const float* p = power + firstBin[b];
+
+        float excitation = 0.0f;
+
+        for (int i = 0; i < numWeights[b]; ++i)
+            excitation += w[i] * p[i];
+
+        // Below a normal ear's threshold the band adds no loudness to restore
+        const double e = excitation;
+
+        if (e < 0.5 * normalA[b])
+            continue;
+
+        // Normal specific loudness, and the excitation that gives the impaired ear the same
+        const double loudness = std::pow (e + normalA[b], static_cast<double> (alpha)) - normalAPowAlpha[b];
+        const double x = loudness + fit.impairedAPowAlpha[b];
+        const double x2 = x * x;
+        const double impairedExcitation = x2 * x2 * x - fit.impairedA[b];
+
+        const double gain = impairedExcitation / (fit.innerGain[b] * e);
+        const double gainDb = juce::jlimit (0.0, static_cast<double> (maxGainDb), 10.0 * std::log10 (juce::jmax (gain, 1.0e-6)));
+
+        const auto output = static_cast<size_t> (outputBand[b]);
+        weightedGainDb[output] += loudness * gainDb;
+        loudnessSum[output] += loudness;
+    }
+
+    auto& gains = gainsDb[static_cast<size_t> (ear)];
+
+    for (int output = 0; output < numOutputBands; ++output)
+    {
+        const auto o = static_cast<size_t> (output);
+
+        // A silent band holds its gain
+        if (loudnessSum[o] <= 0.0)
+            continue;
+
+        const auto target = static_cast<float> (weightedGainDb[o] / loudnessSum[o]);
+        const float coeff = target < gains[o] ? attackCoeff : releaseCoeff;
+        gains[o] = target + coeff * (gains[o] - target);
+    }
+}
@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    LoudnessRestorer.h
+    Real-time specific-loudness restoration (Moore & Glasberg style)
+
+    Estimates each ear's excitation pattern on a 1-ERB grid from a short
+    FFT of the running signal, and finds the gain per ERB band that gives
+    the impaired ear the specific loudness a normal ear would hear:
+
+      N' = (E + A)^alpha - A^alpha                (alpha = 0.2, constant C dropped)
+
+    A normal ear's A is twice its threshold excitation. A loss is split
+    into an outer hair cell part, which raises A (so loudness recruits
+    towards normal at high levels), and an inner hair cell part, which
+    attenuates the excitation. Solving for the gain is closed form, since
+    1 / alpha = 5.
+
+    The ERB bands' gains are combined into the processor's bands, weighted
+    by their normal specific loudness, and smoothed with attack / release
+    times across frames; silent frames leave the gains where they were.
+
+    Both ears share one complex FFT (left + i * right, as in the
+    PartitionedConvolver). Frames are ~21 ms with 50% overlap. A frame's
+    analysis is pipelined over the calls that follow its hop - capture,
+    transform, separate the ears, then each ear's loudness - one stage per
+    process() call, so small blocks share the work instead of one of them
+    taking all of it; the gains follow a few blocks later. A frame still in
+    the pipeline when the next is due is finished first. prepare()
+    allocates everything; process() never allocates.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+
+//==============================================================================
+class LoudnessRestorer
+{
+public:
+    static constexpr int maxBands = 40;         // ERB bands (1 ERB apart, from 55 Hz up to 15 kHz)
+    static constexpr int maxOutputBands = 8;    // The processor's bands
+    static constexpr float alpha = 0.2f;
+    static constexpr float maxGainDb = 40.0f;
+
+    // An ear's loss at each ERB band, as used by the loudness model
+    struct EarFitting
+    {
+        std::array<double, maxBands> impairedA {};          // A raised by the outer hair cell loss
+        std::array<double, maxBands> impairedAPowAlpha {};  // impairedA^alpha
+        std::array<double, maxBands> innerGain {};          // Power lost to the inner hair cell loss (<= 1)
+    };
+
+    // Compiled off the audio thread with the WDRC table
+    struct Fitting
+    {
+        std::array<EarFitting, 2> ears;
+        float attackMs = 10.0f;         // Gain falling (the signal got louder)
+        float releaseMs = 300.0f;       // Gain rising
+    };
+
+    LoudnessRestorer() = default;
+
+    /** Fits one ear from its audiogram (lossesDb at frequencies, ascending), on the ERB
+        grid used at sampleRate. Any thread.
+    */
+    static void fitEar (double sampleRate, const float* frequencies, const float* lossesDb, int numPoints,
+                        EarFitting& ear);
+
+    /** Lays out the ERB bands and spreading functions for sampleRate, and maps them onto
+        the processor's bands (split at crossoverFrequencies). fullScaleDbSpl calibrates
+        the excitation. Allocates.
+    */
+    void prepare (double sampleRate, const float* crossoverFrequencies, int numCrossovers, float fullScaleDbSpl);
+
+    /** Clears the signal history and returns the gains to 0 dB. */
+    void reset() noexcept;
+
+    /** Adds a block of both ears' signals, captures the latest frame once a hop has passed,
+        and runs the next stage of a captured frame's analysis. */
+    void process (const float* left, const float* right, int numSamples, const Fitting& fitting) noexcept;
+
+    /** Smoothed gain (dB, 0 to maxGainDb) for one of the processor's bands; ear 0 = left. */
+    float getGainDb (int ear, int band) const noexcept { return gainsDb[static_cast<size_t> (ear)][static_cast<size_t> (band)]; }
+
+    int getNumBands() const noexcept { return numBands; }
+
+    /** Centre frequency of ERB band index at any rate (the grid is fixed; the rate only limits its top). */
+    static float getBandFrequency (int index) noexcept;
+
+    /** Number of ERB bands used at sampleRate. */
+    static int getNumBands (double sampleRate) noexcept;
+
+private:
+    /** A for a normal ear at frequency: twice its threshold excitation (re 0 dB SPL). */
+    static double getNormalA (float frequency) noexcept;
+
+    // A captured frame's analysis, one stage per process() call
+    enum class Stage
+    {
+        idle,
+        transform,
+        separate,
+        leftEar,
+        rightEar
+    };
+
+    void captureFrame (int elapsedSamples) noexcept;
+    void runStage (const Fitting& fitting) noexcept;
+    void analyseEar (int ear, const Fitting& fitting) noexcept;
+
+    Stage stage = Stage::idle;
+    int frameElapsedSamples = 0;    // Since the previous frame, for the gain smoothing
+
+    double currentSampleRate = 44100.0;
+    int fftSize = 0;
+    int hopSize = 0;
+    int numBands = 0;
+    int numOutputBands = 0;
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> window;
+    std::array<std::vector<float>, 2> history;      // fftSize per ear, circular
+    int writePosition = 0;
+    int samplesSinceFrame = 0;
+
+    std::vector<std::complex<float>> frame, spectrum;
+    std::array<std::vector<float>, 2> powerSpectra; // Per bin; the weights scale it to intensity
+
+    // Spreading functions: band b weights bins firstBin[b] .. firstBin[b] + numWeights[b] - 1,
+    // stored back to back in weights
+    std::array<int, maxBands> firstBin {}, numWeights {}, weightOffset {};
+    std::vector<float> weights;
+
+    std::array<double, maxBands> normalA {};            // See getNormalA()
+    std::array<double, maxBands> normalAPowAlpha {};
+    std::array<int, maxBands> outputBand {};            // The processor's band each ERB band falls in
+
+    std::array<std::array<float, maxOutputBands>, 2> gainsDb {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoudnessRestorer)
+};
@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    PartitionedConvolver.cpp
+    Uniformly partitioned overlap-save FFT convolution for long FIR filters
+
+  ==============================================================================
+*/
+
+#include "PartitionedConvolver.h"
+
+//==============================================================================
+void PartitionedConvolver::setImpulseResponse (const float* impulse, int length, int newPartitionSize)
+{
+    jassert (juce::isPowerOfTwo (newPartitionSize));
+
+    partitionSize = newPartitionSize;
+    fftSize = partitionSize * 2;
+    numPartitions = (length + partitionSize - 1) / partitionSize;
+
+    const int order = juce::roundToInt (std::log2 ((double) fftSize));
+    fft = std::make_unique<juce::dsp::FFT> (order);
+
+    const auto binsTotal = static_cast<size_t> (numPartitions * fftSize);
+    kernelSpectra.assign (binsTotal, {});
+    delayLine.assign (binsTotal, {});
+    inputFrame.assign ((size_t) fftSize, {});
+    accumulator.assign ((size_t) fftSize, {});
+    tailAccumulator.assign ((size_t) fftSize, {});
+    timeDomain.assign ((size_t) fftSize, {});
+    outputBlock.assign ((size_t) partitionSize, {});
+
+    // Each partition zero-padded to the FFT size; the inverse transform's
+    // 1 / N is folded in here so the audio thread doesn't have to apply it
+    const float scale = 1.0f / static_cast<float> (fftSize);
+    std::vector<std::complex<float>> frame ((size_t) fftSize);
+
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        std::fill (frame.begin(), frame.end(), std::complex<float>());
+
+        for (int n = 0; n < partitionSize && p * partitionSize + n < length; ++n)
+            frame[(size_t) n] = impulse[p * partitionSize + n] * scale;
+
+        fft->perform (frame.data(), kernelSpectra.data() + (size_t) (p * fftSize), false);
+    }
+
+    position = 0;
+    delayLineIndex = 0;
+    nextTailPartition = 1;
+    tailSchedule = 0;
+}
+
+void PartitionedConvolver::clear()
+{
+    numPartitions = 0;
+    position = 0;
+}
+
+void PartitionedConvolver::reset()
+{
+    std::fill (delayLine.begin(), delayLine.end(), std::complex<float>());
+    std::fill (inputFrame.begin(), inputFrame.end(), std::complex<float>());
+    std::fill (outputBlock.begin(), outputBlock.end(), std::complex<float>());
+    std::fill (tailAccumulator.begin(), tailAccumulator.end(), std::complex<float>());
+    position = 0;
+    delayLineIndex = 0;
+    nextTailPartition = 1;
+    tailSchedule = 0;
+}
+
+//==============================================================================
+void PartitionedConvolver::multiplyAccumulate (float* acc, const float* x, const float* h, size_t numFloats) noexcept
+{
+    // Written out by hand so the compiler doesn't emit the NaN-safe complex multiply
+    for (size_t bin = 0; bin < numFloats; bin += 2)
+    {
+        acc[bin]     += x[bin] * h[bin]     - x[bin + 1] * h[bin + 1];
+        acc[bin + 1] += x[bin] * h[bin + 1] + x[bin + 1] * h[bin];
+    }
+}
+
+void PartitionedConvolver::accumulateTailPartition() noexcept
+{
+    if (nextTailPartition >= numPartitions)
+        return;
+
+    // Kernel partition p meets the input spectrum p partitions older than the one coming
+    const auto n = static_cast<size_t> (fftSize);
+    const int slot = (delayLineIndex - nextTailPartition + numPartitions) % numPartitions;
+
+    multiplyAccumulate (reinterpret_cast<float*> (tailAccumulator.data()),
+                        reinterpret_cast<const float*> (delayLine.data() + (size_t) slot * n),
+                        reinterpret_cast<const float*> (kernelSpectra.data() + (size_t) nextTailPartition * n),
+                        2 * n);
+    ++nextTailPartition;
+}
+
+void PartitionedConvolver::processPartition() noexcept
+{
+    const auto n = static_cast<size_t> (fftSize);
+
+    // Normally already done by the schedule in processSample()
+    while (nextTailPartition < numPartitions)
+        accumulateTailPartition();
+
+    // Spectrum of [previous partition, current partition] into the frequency-domain delay line
+    auto* newest = delayLine.data() + (size_t) delayLineIndex * n;
+    fft->perform (inputFrame.data(), newest, false);
+    std::copy (inputFrame.begin() + partitionSize, inputFrame.end(), inputFrame.begin());
+
+    // The older partitions' share, plus the newest input with the first kernel partition
+    std::copy (tailAccumulator.begin(), tailAccumulator.end(), accumulator.begin());
+    std::fill (tailAccumulator.begin(), tailAccumulator.end(), std::complex<float>());
+    nextTailPartition = 1;
+
+    auto* acc = reinterpret_cast<float*> (accumulator.data());
+    multiplyAccumulate (acc, reinterpret_cast<const float*> (newest), reinterpret_cast<const float*> (kernelSpectra.data()), 2 * n);
+
+    // Inverse transform as conj (FFT (conj (X))); the 1 / N is already in the kernel
+    for (size_t bin = 0; bin < 2 * n; bin += 2)
+        acc[bin + 1] = -acc[bin + 1];
+
+    fft->perform (accumulator.data(), timeDomain.data(), false);
+
+    // Overlap-save: the second half of the frame is the valid linear convolution
+    for (int i = 0; i < partitionSize; ++i)
+        outputBlock[(size_t) i] = std::conj (timeDomain[(size_t) (partitionSize + i)]);
+
+    delayLineIndex = (delayLineIndex + 1) % numPartitions;
+}
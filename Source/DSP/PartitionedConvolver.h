@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    PartitionedConvolver.h
+    Uniformly partitioned overlap-save FFT convolution for long FIR filters
+
+    Both channels share one impulse response, so they are packed into a
+    single complex signal (left + i * right): one complex FFT per partition
+    convolves the pair, because a real kernel keeps the real and imaginary
+    parts apart. Latency is one partition.
+
+    Only the newest partition has to wait for its input. The products of
+    the older input spectra with the rest of the kernel are accumulated a
+    few partitions at a time while the current partition fills, so the
+    partition boundary is left with two FFTs and one multiply-accumulate
+    instead of the whole convolution.
+
+    setImpulseResponse() allocates and must be called off the audio thread;
+    processSample() never allocates.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+
+//==============================================================================
+class PartitionedConvolver
+{
+public:
+    PartitionedConvolver() = default;
+
+    /** Partitions and transforms an impulse response. Resets the convolution state. */
+    void setImpulseResponse (const float* impulse, int length, int partitionSize);
+
+    /** Removes the impulse response (processSample() becomes a pass-through). */
+    void clear();
+
+    /** Clears the delay line and overlap buffers. */
+    void reset();
+
+    bool isLoaded() const noexcept { return numPartitions > 0; }
+    int getLatencySamples() const noexcept { return isLoaded() ? partitionSize : 0; }
+
+    /** Convolves one stereo sample; the output is delayed by one partition. */
+    inline void processSample (float& left, float& right) noexcept
+    {
+        if (numPartitions == 0)
+            return;
+
+        inputFrame[(size_t) (partitionSize + position)] = { left, right };
+
+        const auto out = outputBlock[(size_t) position];
+        left = out.real();
+        right = out.imag();
+
+        // Spread the older partitions evenly: numPartitions - 1 of them per partitionSize samples
+        tailSchedule += numPartitions - 1;
+
+        while (tailSchedule >= partitionSize)
+        {
+            tailSchedule -= partitionSize;
+            accumulateTailPartition();
+        }
+
+        if (++position == partitionSize)
+        {
+            processPartition();
+            position = 0;
+        }
+    }
+
+private:
+    void processPartition() noexcept;
+    void accumulateTailPartition() noexcept;
+    static void multiplyAccumulate (float* acc, const float* x, const float* h, size_t numFloats) noexcept;
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    int partitionSize = 0;
+    int fftSize = 0;
+    int numPartitions = 0;
+    int position = 0;
+    int delayLineIndex = 0;             // Slot the next partition's spectrum goes into
+    int nextTailPartition = 1;          // Next kernel partition to accumulate for the coming boundary
+    int tailSchedule = 0;
+
+    std::vector<std::complex<float>> kernelSpectra;     // numPartitions x fftSize, pre-scaled by 1 / fftSize
+    std::vector<std::complex<float>> delayLine;         // numPartitions x fftSize input spectra
+    std::vector<std::complex<float>> inputFrame;        // previous + current partition
+    std::vector<std::complex<float>> accumulator;
+    std::vector<std::complex<float>> tailAccumulator;   // Older partitions' share of the next output
+    std::vector<std::complex<float>> timeDomain;
+    std::vector<std::complex<float>> outputBlock;       // partitionSize
+
+    JUCE_DECLARE_NON_COPYABLE (PartitionedConvolver)
+};
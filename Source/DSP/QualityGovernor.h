@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    QualityGovernor.h
+    Steps processing quality down under sustained CPU load, and back up
+
+    Fed each callback's utilisation of its real-time budget (from the
+    CallbackMonitor), it keeps a smoothed utilisation and moves through
+    progressively cheaper tiers:
+
+      0  full quality
+      1  control-rate gains         WDRC gain law evaluated every 16 samples
+      2  merged bands               adjacent band pairs share a detector and gain
+      3  fewer headphone sections   headphone EQ cascade reduced to 5 sections
+      4  linked detection           one detector per band for both ears
+
+    Each tier keeps the ones below it. It steps down when the smoothed
+    utilisation stays above stepDownUtilisation for stepDownSeconds, and
+    back up when it stays below stepUpUtilisation for stepUpSeconds; the
+    gap between the two, and the longer wait going up, keep it from
+    oscillating. The processor crossfades every change.
+
+    update() and reset() are for the audio thread only; getTier() can be
+    read from anywhere (the editor shows it).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class QualityGovernor
+{
+public:
+    enum Tier
+    {
+        fullQuality = 0,
+        controlRateGains,
+        mergedBands,
+        fewerHeadphoneSections,
+        linkedDetection,
+        numTiers
+    };
+
+    // Utilisation is elapsed / budget (1 = the whole callback budget)
+    static constexpr double stepDownUtilisation = 0.7;
+    static constexpr double stepUpUtilisation = 0.35;
+    static constexpr double stepDownSeconds = 0.5;
+    static constexpr double stepUpSeconds = 5.0;
+    static constexpr double smoothingSeconds = 0.25;
+
+    QualityGovernor() = default;
+
+    //==========================================================================
+    /** Audio thread: adds one callback's utilisation, covering callbackSeconds of audio. Returns the tier. */
+    int update (double utilisation, double callbackSeconds) noexcept
+    {
+        if (callbackSeconds <= 0.0)
+            return tier.load (std::memory_order_relaxed);
+
+        // One-pole smoothing in time rather than per callback, so block size doesn't matter
+        const auto coeff = std::exp (-callbackSeconds / smoothingSeconds);
+        smoothedUtilisation = smoothedUtilisation * coeff + utilisation * (1.0 - coeff);
+
+        auto current = tier.load (std::memory_order_relaxed);
+
+        overSeconds = smoothedUtilisation > stepDownUtilisation ? overSeconds + callbackSeconds : 0.0;
+        underSeconds = smoothedUtilisation < stepUpUtilisation ? underSeconds + callbackSeconds : 0.0;
+
+        if (overSeconds >= stepDownSeconds && current < numTiers - 1)
+            setTier (current + 1);
+        else if (underSeconds >= stepUpSeconds && current > fullQuality)
+            setTier (current - 1);
+
+        return tier.load (std::memory_order_relaxed);
+    }
+
+    /** Audio thread: back to full quality, e.g. for offline rendering or when the governor is switched off. */
+    void reset() noexcept
+    {
+        smoothedUtilisation = 0.0;
+        overSeconds = underSeconds = 0.0;
+        tier.store (fullQuality, std::memory_order_relaxed);
+    }
+
+    /** Any thread: the current tier. */
+    int getTier() const noexcept { return tier.load (std::memory_order_relaxed); }
+
+    static const char* getTierName (int tierIndex)
+    {
+        switch (tierIndex)
+        {
+            case fullQuality:               return "full quality";
+            case controlRateGains:          return "control-rate gains";
+            case mergedBands:               return "merged bands";
+            case fewerHeadphoneSections:    return "fewer headphone sections";
+            case linkedDetection:           return "linked detection";
+            default:                        break;
+        }
+
+        return "";
+    }
+
+private:
+    void setTier (int newTier) noexcept
+    {
+        tier.store (newTier, std::memory_order_relaxed);
+
+        // The new tier has to prove itself from scratch
+        overSeconds = underSeconds = 0.0;
+    }
+
+    std::atomic<int> tier { fullQuality };
+    double smoothedUtilisation = 0.0;
+    double overSeconds = 0.0, underSeconds = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QualityGovernor)
+};
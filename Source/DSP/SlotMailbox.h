@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    SlotMailbox.h
+    Lock-free hand-over of preallocated processing objects to the audio thread
+
+    The owner keeps a fixed array of numSlots objects (filter sets, convolver
+    engines, ...). A producer designs into a free slot and posts it; the audio
+    thread promotes the pending slot to active, keeps the previous one alive
+    as "fading" for a crossfade, then releases it.
+
+    Four slots are enough: at most one is active, one is fading out and one
+    is pending, so a producer can always find a free one to design into. The
+    three roles are packed into one atomic word so both sides see a
+    consistent snapshot; producers only ever set "pending", and the audio
+    thread only moves pending -> active -> fading -> free. Producers must be
+    serialised by the owner (one thread, or a lock the audio thread never
+    takes).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class SlotMailbox
+{
+public:
+    static constexpr int numSlots = 4;
+    static constexpr juce::uint32 noSlot = 0xff;
+
+    struct Snapshot
+    {
+        juce::uint32 active = 0;
+        juce::uint32 fading = noSlot;
+        juce::uint32 pending = noSlot;
+    };
+
+    //==========================================================================
+    /** Makes slot the only one in use. Only while the audio thread is stopped. */
+    void reset (int slot)
+    {
+        state.store (pack ((juce::uint32) slot, noSlot, noSlot), std::memory_order_release);
+    }
+
+    /** Producer: returns a slot the audio thread is not using.
+
+        The audio thread only ever releases slots, so a slot that is free in
+        this snapshot stays free until the producer posts it.
+    */
+    int findFreeSlot() const
+    {
+        const auto s = state.load (std::memory_order_acquire);
+
+        for (juce::uint32 i = 0; i < (juce::uint32) numSlots; ++i)
+            if (i != active (s) && i != fading (s) && i != pending (s))
+                return (int) i;
+
+        jassertfalse;  // Unreachable: at most three slots are ever in use
+        return -1;
+    }
+
+    /** Producer: posts a designed slot. An unconsumed pending slot simply becomes free again. */
+    void post (int slot)
+    {
+        auto s = state.load (std::memory_order_relaxed);
+        while (! state.compare_exchange_weak (s, pack (active (s), fading (s), (juce::uint32) slot),
+                                              std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    //==========================================================================
+    /** Audio thread: the current roles. */
+    Snapshot getSnapshot() const noexcept
+    {
+        const auto s = state.load (std::memory_order_acquire);
+        return { active (s), fading (s), pending (s) };
+    }
+
+    /** Audio thread: promotes the pending slot to active once any previous
+        crossfade has finished; the old active slot starts fading. Returns
+        true if a new slot was taken.
+    */
+    bool takePending() noexcept
+    {
+        auto s = state.load (std::memory_order_acquire);
+
+        if (fading (s) != noSlot || pending (s) == noSlot)
+            return false;
+
+        return state.compare_exchange_strong (s, pack (pending (s), active (s), noSlot),
+                                              std::memory_order_acq_rel, std::memory_order_acquire);
+    }
+
+    /** Audio thread: hands the fading slot back to the producers. */
+    void releaseFading() noexcept
+    {
+        auto s = state.load (std::memory_order_acquire);
+        while (! state.compare_exchange_weak (s, pack (active (s), noSlot, pending (s)),
+                                              std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+        }
+    }
+
+private:
+    static constexpr juce::uint32 pack (juce::uint32 a, juce::uint32 f, juce::uint32 p)
+    {
+        return a | (f << 8) | (p << 16);
+    }
+
+    static constexpr juce::uint32 active (juce::uint32 s)  { return s & 0xff; }
+    static constexpr juce::uint32 fading (juce::uint32 s)  { return (s >> 8) & 0xff; }
+    static constexpr juce::uint32 pending (juce::uint32 s) { return (s >> 16) & 0xff; }
+
+    std::atomic<juce::uint32> state { pack (0, noSlot, noSlot) };
+};
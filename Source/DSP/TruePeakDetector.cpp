@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    TruePeakDetector.cpp
+    4x polyphase true-peak measurement (ITU-R BS.1770 style)
+
+  ==============================================================================
+*/
+
+#include "TruePeakDetector.h"
+
+namespace
+{
+    // Kaiser window over the 12-sample span of the filter
+    constexpr double kaiserBeta = 6.0;
+
+    double besselI0 (double x) noexcept
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x * 0.5 / k) * (x * 0.5 / k);
+            sum += term;
+        }
+
+        return sum;
+    }
+}
+
+//==============================================================================
+void TruePeakDetector::designPhase (int phase, float* taps) noexcept
+{
+    const double halfSpan = 0.5 * tapsPerPhase;
+    const double fraction = static_cast<double> (phase) / oversampling;
+    double sum = 0.0;
+
+    std::array<double, tapsPerPhase> design {};
+
+    for (int k = 0; k < tapsPerPhase; ++k)
+    {
+        // Distance from tap k's input to the point being interpolated
+        const double t = k - delay + fraction;
+        const double sinc = std::abs (t) < 1.0e-9 ? 1.0 : std::sin (juce::MathConstants<double>::pi * t)
+                                                             / (juce::MathConstants<double>::pi * t);
+        const double ratio = t / halfSpan;
+        const double window = besselI0 (kaiserBeta * std::sqrt (juce::jmax (0.0, 1.0 - ratio * ratio))) / besselI0 (kaiserBeta);
+
+        design[static_cast<size_t> (k)] = sinc * window;
+        sum += sinc * window;
+    }
+
+    // Unity gain at DC for every phase
+    for (int k = 0; k < tapsPerPhase; ++k)
+        taps[k] = static_cast<float> (design[static_cast<size_t> (k)] / sum);
+}
+
+void TruePeakDetector::prepare (int maximumBlockSize)
+{
+    for (int phase = 1; phase < oversampling; ++phase)
+        designPhase (phase, phases[static_cast<size_t> (phase - 1)].data());
+
+    blockSize = juce::jmax (1, maximumBlockSize);
+
+    frames.assign (static_cast<size_t> (historyLength + numChannels * blockSize), 0.0f);
+    interpolated.assign (static_cast<size_t> (numChannels * blockSize), 0.0f);
+    intervalPeaks.assign (static_cast<size_t> (numChannels * (blockSize + 1)), 0.0f);
+
+    reset();
+}
+
+void TruePeakDetector::reset() noexcept
+{
+    std::fill (frames.begin(), frames.end(), 0.0f);
+    std::fill (intervalPeaks.begin(), intervalPeaks.end(), 0.0f);
+}
+
+void TruePeakDetector::process (const float* left, const float* right, int numSamples,
+                                float* samplePeaks, float* channelPeaks) noexcept
+{
+    if (channelPeaks != nullptr)
+        channelPeaks[0] = channelPeaks[1] = 0.0f;
+
+    if (frames.empty())
+        return;
+
+    for (int start = 0; start < numSamples; start += blockSize)
+    {
+        const int count = juce::jmin (blockSize, numSamples - start);
+        processChunk (left + start, right + start, count,
+                      samplePeaks != nullptr ? samplePeaks + start : nullptr, channelPeaks);
+    }
+}
+
+void TruePeakDetector::processChunk (const float* left, const float* right, int numSamples,
+                                     float* samplePeaks, float* channelPeaks) noexcept
+{
+    const int count = numChannels * numSamples;
+    float* input = frames.data() + historyLength;
+    float* output = interpolated.data();
+    float* intervals = intervalPeaks.data() + numChannels;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        input[numChannels * i] = left[i];
+        input[numChannels * i + 1] = right[i];
+    }
+
+    juce::FloatVectorOperations::clear (intervals, count);
+
+    // Each phase tap by tap over the interleaved block: one vector operation serves both channels
+    for (const auto& taps : phases)
+    {
+        juce::FloatVectorOperations::copyWithMultiply (output, input, taps[0], count);
+
+        for (int k = 1; k < tapsPerPhase; ++k)
+            juce::FloatVectorOperations::addWithMultiply (output, input - numChannels * k,
+                                                          taps[static_cast<size_t> (k)], count);
+
+        juce::FloatVectorOperations::abs (output, output, count);
+        juce::FloatVectorOperations::max (intervals, intervals, output, count);
+    }
+
+    // A sample's true peak: itself (phase 0) and the intervals either side of it
+    juce::FloatVectorOperations::abs (output, input - numChannels * delay, count);
+    juce::FloatVectorOperations::max (output, output, intervals - numChannels, count);
+    juce::FloatVectorOperations::max (output, output, intervals, count);
+
+    if (samplePeaks != nullptr)
+        for (int i = 0; i < numSamples; ++i)
+            samplePeaks[i] = std::max (output[numChannels * i], output[numChannels * i + 1]);
+
+    if (channelPeaks != nullptr)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            channelPeaks[0] = std::max (channelPeaks[0], output[numChannels * i]);
+            channelPeaks[1] = std::max (channelPeaks[1], output[numChannels * i + 1]);
+        }
+    }
+
+    // Keep the newest inputs and the last interval for the next block
+    std::copy (frames.begin() + count, frames.begin() + count + historyLength, frames.begin());
+    std::copy (intervals + count - numChannels, intervals + count, intervalPeaks.begin());
+}
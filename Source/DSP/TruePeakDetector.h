@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    TruePeakDetector.h
+    4x polyphase true-peak measurement (ITU-R BS.1770 style)
+
+    A sample peak misses the overs a DAC makes between samples, up to ~3 dB
+    for a tone near a quarter of the rate. This reconstructs the signal at
+    4x with a 48-tap windowed-sinc interpolator split into four 12-tap
+    phases, computing only the ones it needs:
+
+      - Phase 0 lands on the input samples, and the sinc is zero at every
+        other integer, so it is the input itself and costs nothing
+      - Phases 1-3 are the three points between each pair of samples
+
+    That is 36 multiply-adds per sample and channel, against 192 for
+    zero-stuffing to 4x and running the full filter at the high rate.
+
+    Both channels are interleaved into one buffer and every tap is a single
+    loop over it, so the compiler vectorises across channels and samples
+    together. Each sample's true peak is the largest of it and the
+    interpolated points on either side, so it comes out delay samples late.
+
+    prepare() allocates; process() never allocates or locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class TruePeakDetector
+{
+public:
+    static constexpr int oversampling = 4;
+    static constexpr int tapsPerPhase = 12;
+    static constexpr int delay = tapsPerPhase / 2;     // Samples from an input to its true peak
+
+    TruePeakDetector() = default;
+
+    /** Taps for the point phase / oversampling of a sample past the input delay samples
+        back, newest input first; phase 0 is that input alone. */
+    static void designPhase (int phase, float* taps) noexcept;
+
+    /** Sizes the work buffers; longer blocks are measured in pieces. Allocates. */
+    void prepare (int maximumBlockSize);
+
+    /** Clears the history. */
+    void reset() noexcept;
+
+    /** Measures a stereo block.
+        samplePeaks (numSamples long, or nullptr) gets the louder channel's true peak
+        around each sample delay samples back; channelPeaks (two, or nullptr) gets each
+        channel's largest over the block.
+    */
+    void process (const float* left, const float* right, int numSamples,
+                  float* samplePeaks, float* channelPeaks) noexcept;
+
+private:
+    static constexpr int numChannels = 2;
+    static constexpr int historyLength = numChannels * (tapsPerPhase - 1);
+
+    void processChunk (const float* left, const float* right, int numSamples,
+                       float* samplePeaks, float* channelPeaks) noexcept;
+
+    std::array<std::array<float, tapsPerPhase>, oversampling - 1> phases {};
+    int blockSize = 0;
+
+    std::vector<float> frames;          // History, then the block, both channels interleaved
+    std::vector<float> interpolated;    // One phase of the block
+    std::vector<float> intervalPeaks;   // The last interval of the previous block, then this block's
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TruePeakDetector)
+};
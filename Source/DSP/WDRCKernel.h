@@ -0,0 +1,200 @@
+/*
+  ==============================================================================
+
+    WDRCKernel.h
+    One band's WDRC loop: level detector, gain law and gain smoothing
+
+    Runs numLanes compressors on one band at once, with lane-major state:
+    the plugin uses one lane per ear (two when the ears share a linked
+    detector), EarFixRender's listener bank one lane per listener. Every
+    per-sample step is a loop over the lanes that the compiler turns into
+    SIMD. Where the detector's input comes from, the gain law (the band's
+    level -> gain curve) and where the gains go are callbacks, inlined into
+    the loop:
+
+      getLevels (i, levels)                 detector input of each lane at sample i
+      getMeanSquares (start, length, ms)    each lane's detector energy over a sub-block
+      gainLaw (lane, inputDb)               a lane's linear gain for an envelope level (dBFS)
+      apply (i, gains)                      each lane's gain for sample i (1 when inactive)
+
+    Two detectors: the peak follower, every sample, and the RMS detector,
+    which measures energy over energyInterval sub-blocks and updates once
+    per sub-block, with the per-sample time constants compounded.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FastDecibels.h"
+
+//==============================================================================
+struct WDRCKernel
+{
+    static constexpr int energyInterval = 16;       // Samples per RMS detector sub-block
+
+    /** One band's state and settings for numLanes compressors. */
+    template <int numLanes>
+    struct Lanes
+    {
+        alignas (32) float envelope[numLanes] {};           // Detector level, linear
+        alignas (32) float smoothedGain[numLanes] {};       // Linear
+        alignas (32) float attackCoeff[numLanes] {};
+        alignas (32) float releaseCoeff[numLanes] {};
+        alignas (32) float gainSmoothCoeff[numLanes] {};
+
+        bool tracking[numLanes] {};     // The detector follows its input (otherwise it holds)
+        bool active[numLanes] {};       // The gain applies (otherwise unity, and the smoothed gain holds)
+    };
+
+    //==========================================================================
+    /** The peak follower. With gainInterval 1 the gain law follows each sample's envelope;
+        longer intervals (control-rate gains) evaluate it from the envelope at the start of
+        each, while the detector and the smoothing still run every sample.
+    */
+    template <int numLanes, typename GetLevels, typename GainLaw, typename Apply>
+    static void processPeak (Lanes<numLanes>& lanes, int numSamples, int gainInterval,
+                             GetLevels&& getLevels, GainLaw&& gainLaw, Apply&& apply) noexcept
+    {
+        // Local copies, so the lane loops stay in registers
+        alignas (32) float env[numLanes], smoothed[numLanes], levels[numLanes], targets[numLanes], gains[numLanes];
+        std::copy (std::begin (lanes.envelope), std::end (lanes.envelope), env);
+        std::copy (std::begin (lanes.smoothedGain), std::end (lanes.smoothedGain), smoothed);
+
+        gainInterval = juce::jmax (1, gainInterval);
+
+        for (int start = 0; start < numSamples; start += gainInterval)
+        {
+            const int end = juce::jmin (numSamples, start + gainInterval);
+
+            if (gainInterval > 1)
+                evaluateGainLaw (env, gainLaw, targets);
+
+            for (int i = start; i < end; ++i)
+            {
+                getLevels (i, levels);
+
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    const float coeff = levels[l] > env[l] ? lanes.attackCoeff[l] : lanes.releaseCoeff[l];
+                    const float followed = env[l] * coeff + levels[l] * (1.0f - coeff);
+                    env[l] = lanes.tracking[l] ? followed : env[l];
+                }
+
+                if (gainInterval == 1)
+                    evaluateGainLaw (env, gainLaw, targets);
+
+                smoothGains (lanes, targets, smoothed, gains);
+                apply (i, static_cast<const float*> (gains));
+            }
+        }
+
+        std::copy (env, env + numLanes, lanes.envelope);
+        std::copy (smoothed, smoothed + numLanes, lanes.smoothedGain);
+    }
+
+    /** The RMS detector: per sub-block, the gain law from the envelope at its start, the
+        energy measured (before apply() sees the sub-block, so the detector may read the
+        samples it changes) and the envelope updated once from it.
+    */
+    template <int numLanes, typename GetMeanSquares, typename GainLaw, typename Apply>
+    static void processEnergy (Lanes<numLanes>& lanes, int numSamples,
+                               GetMeanSquares&& getMeanSquares, GainLaw&& gainLaw, Apply&& apply) noexcept
+    {
+        alignas (32) float env[numLanes], smoothed[numLanes], meanSquares[numLanes], targets[numLanes], gains[numLanes];
+        alignas (32) float attackCoeff[numLanes], releaseCoeff[numLanes];
+        std::copy (std::begin (lanes.envelope), std::end (lanes.envelope), env);
+        std::copy (std::begin (lanes.smoothedGain), std::end (lanes.smoothedGain), smoothed);
+
+        for (int l = 0; l < numLanes; ++l)
+        {
+            attackCoeff[l] = compound (lanes.attackCoeff[l], energyInterval);
+            releaseCoeff[l] = compound (lanes.releaseCoeff[l], energyInterval);
+        }
+
+        for (int start = 0; start < numSamples; start += energyInterval)
+        {
+            const int length = juce::jmin (energyInterval, numSamples - start);
+            const bool whole = length == energyInterval;
+
+            evaluateGainLaw (env, gainLaw, targets);
+            getMeanSquares (start, length, meanSquares);
+
+            for (int i = start; i < start + length; ++i)
+            {
+                smoothGains (lanes, targets, smoothed, gains);
+                apply (i, static_cast<const float*> (gains));
+            }
+
+            for (int l = 0; l < numLanes; ++l)
+            {
+                const float updated = updateEnergyEnvelope (env[l], meanSquares[l],
+                                                            whole ? attackCoeff[l] : compound (lanes.attackCoeff[l], length),
+                                                            whole ? releaseCoeff[l] : compound (lanes.releaseCoeff[l], length));
+                env[l] = lanes.tracking[l] ? updated : env[l];
+            }
+        }
+
+        std::copy (env, env + numLanes, lanes.envelope);
+        std::copy (smoothed, smoothed + numLanes, lanes.smoothedGain);
+    }
+
+    //==========================================================================
+    static float getMeanSquare (const float* samples, int numSamples) noexcept
+    {
+        // One partial sum per lane, which the compiler keeps in a vector register
+        constexpr int numSums = 8;
+        float sums[numSums] = {};
+        int i = 0;
+
+        for (; i + numSums <= numSamples; i += numSums)
+            for (int lane = 0; lane < numSums; ++lane)
+                sums[lane] += samples[i + lane] * samples[i + lane];
+
+        float sum = 0.0f;
+
+        for (int lane = 0; lane < numSums; ++lane)
+            sum += sums[lane];
+
+        for (; i < numSamples; ++i)
+            sum += samples[i] * samples[i];
+
+        return sum / static_cast<float> (juce::jmax (1, numSamples));
+    }
+
+    /** One RMS detector step from a sub-block's mean square, with the attack / release
+        coefficients compounded over its length.
+    */
+    static float updateEnergyEnvelope (float envelope, float meanSquare, float attackCoeff, float releaseCoeff) noexcept
+    {
+        // Smoothed as power, scaled so that a sine reads its peak, as with the peak detector
+        const float power = envelope * envelope;
+        const float input = 2.0f * meanSquare;
+        const float coeff = input > power ? attackCoeff : releaseCoeff;
+        return std::sqrt (input + coeff * (power - input));
+    }
+
+    /** A per-sample time constant over length samples. */
+    static float compound (float coeff, int length) noexcept { return std::pow (coeff, static_cast<float> (length)); }
+
+private:
+    template <int numLanes, typename GainLaw>
+    static void evaluateGainLaw (const float (&env)[numLanes], GainLaw& gainLaw, float (&targets)[numLanes]) noexcept
+    {
+        for (int l = 0; l < numLanes; ++l)
+            targets[l] = gainLaw (l, FastDecibels::gainToDecibels (env[l] + 1e-6f));
+    }
+
+    template <int numLanes>
+    static void smoothGains (const Lanes<numLanes>& lanes, const float (&targets)[numLanes],
+                             float (&smoothed)[numLanes], float (&gains)[numLanes]) noexcept
+    {
+        for (int l = 0; l < numLanes; ++l)
+        {
+            const float next = smoothed[l] * lanes.gainSmoothCoeff[l] + targets[l] * (1.0f - lanes.gainSmoothCoeff[l]);
+            smoothed[l] = lanes.active[l] ? next : smoothed[l];
+            gains[l] = lanes.active[l] ? smoothed[l] : 1.0f;
+        }
+    }
+};
@@ -0,0 +1,541 @@
+/*
+  ==============================================================================
+
+    ZeroLatencyConvolver.cpp
+    Zero-latency non-uniform partitioned convolution for long stereo IRs
+
+  ==============================================================================
+*/
+
+#include "ZeroLatencyConvolver.h"
+
+#if JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ extern "C"
+ {
+     __declspec (dllimport) void* __stdcall CreateSemaphoreW (struct _SECURITY_ATTRIBUTES*, long, long, const wchar_t*);
+     __declspec (dllimport) int __stdcall ReleaseSemaphore (void*, long, long*);
+     __declspec (dllimport) unsigned long __stdcall WaitForSingleObject (void*, unsigned long);
+     __declspec (dllimport) int __stdcall CloseHandle (void*);
+ }
+#else
+ #include <cerrno>
+ #include <semaphore.h>
+#endif
+
+namespace
+{
+    // Segment layout: block size, first and last IR sample covered, deferred.
+    // Each deferred segment starts at twice its block size, which leaves one
+    // block of slack for the worker.
+    struct SegmentLayout
+    {
+        int blockSize;
+        int start;
+        int end;
+        bool deferred;
+    };
+
+    constexpr std::array<SegmentLayout, 3> segmentLayout {{
+        { 128,   ZeroLatencyConvolver::headLength, 2048,  false },
+        { 1024,  2048,  16384, true },
+        { 8192,  16384, ZeroLatencyConvolver::maxImpulseLength, true },
+    }};
+
+    // Splits the spectrum Z of (left + i * right) into the spectra of left and right, bins 0..N/2
+    inline void splitPackedSpectrum (const std::complex<float>* z, int fftSize,
+                                     std::complex<float>* left, std::complex<float>* right) noexcept
+    {
+        for (int k = 0; k <= fftSize / 2; ++k)
+        {
+            const auto a = z[k];
+            const auto b = std::conj (z[(fftSize - k) & (fftSize - 1)]);
+
+            left[k]  = 0.5f * (a + b);
+            right[k] = { 0.5f * (a.imag() - b.imag()), -0.5f * (a.real() - b.real()) };
+        }
+    }
+}
+
+//==============================================================================
+ZeroLatencyConvolver::~ZeroLatencyConvolver()
+{
+    for (auto& segment : segments)
+        segment.cancelAndWait();
+}
+
+void ZeroLatencyConvolver::setImpulseResponses (const float* left, int leftLength, const float* right, int rightLength)
+{
+    for (auto& segment : segments)
+        segment.cancelAndWait();
+
+    leftLength = juce::jlimit (0, maxImpulseLength, left != nullptr ? leftLength : 0);
+    rightLength = juce::jlimit (0, maxImpulseLength, right != nullptr ? rightLength : 0);
+    const int length = juce::jmax (leftLength, rightLength);
+
+    // Head: reversed taps, zero-padded to headLength
+    headLeft.assign ((size_t) headLength, 0.0f);
+    headRight.assign ((size_t) headLength, 0.0f);
+
+    for (int i = 0; i < headLength; ++i)
+    {
+        if (i < leftLength)  headLeft[(size_t) (headLength - 1 - i)] = left[i];
+        if (i < rightLength) headRight[(size_t) (headLength - 1 - i)] = right[i];
+    }
+
+    historyLeft.assign ((size_t) (2 * headLength), 0.0f);
+    historyRight.assign ((size_t) (2 * headLength), 0.0f);
+
+    numSegments = 0;
+    int largestBlock = headLength;
+    int latestOutput = 0;
+
+    for (const auto& layout : segmentLayout)
+    {
+        if (length <= layout.start)
+            break;
+
+        auto& segment = segments[(size_t) numSegments++];
+        segment.deferred = layout.deferred;
+        segment.prepare (layout.blockSize, layout.start, left, leftLength, right, rightLength,
+                         juce::jmin (length, layout.end) - layout.start);
+
+        largestBlock = juce::jmax (largestBlock, layout.blockSize);
+        latestOutput = juce::jmax (latestOutput, layout.start + layout.blockSize);
+    }
+
+    inputRingLeft.assign ((size_t) largestBlock, 0.0f);
+    inputRingRight.assign ((size_t) largestBlock, 0.0f);
+    inputMask = largestBlock - 1;
+
+    const int outputSize = juce::nextPowerOfTwo (latestOutput + 1);
+    outputRingLeft.assign ((size_t) outputSize, 0.0f);
+    outputRingRight.assign ((size_t) outputSize, 0.0f);
+    outputMask = outputSize - 1;
+
+    historyPosition = 0;
+    time = 0;
+    loaded = length > 0;
+}
+
+void ZeroLatencyConvolver::clear()
+{
+    for (auto& segment : segments)
+        segment.cancelAndWait();
+
+    numSegments = 0;
+    loaded = false;
+}
+
+void ZeroLatencyConvolver::reset()
+{
+    for (int i = 0; i < numSegments; ++i)
+    {
+        segments[(size_t) i].cancelAndWait();
+        segments[(size_t) i].clearState();
+    }
+
+    std::fill (historyLeft.begin(), historyLeft.end(), 0.0f);
+    std::fill (historyRight.begin(), historyRight.end(), 0.0f);
+    std::fill (inputRingLeft.begin(), inputRingLeft.end(), 0.0f);
+    std::fill (inputRingRight.begin(), inputRingRight.end(), 0.0f);
+    std::fill (outputRingLeft.begin(), outputRingLeft.end(), 0.0f);
+    std::fill (outputRingRight.begin(), outputRingRight.end(), 0.0f);
+    historyPosition = 0;
+    time = 0;
+}
+
+//==============================================================================
+void ZeroLatencyConvolver::process (float* left, float* right, int numSamples) noexcept
+{
+    if (!loaded)
+        return;
+
+    // All block sizes are multiples of the head length and start at time 0,
+    // so segment boundaries can only fall on head-length boundaries
+    constexpr int boundaryMask = headLength - 1;
+    const bool stereo = right != nullptr;
+    int i = 0;
+
+    while (i < numSamples)
+    {
+        const int chunk = juce::jmin (numSamples - i, headLength - (int) (time & boundaryMask));
+
+        for (int n = 0; n < chunk; ++n, ++i)
+        {
+            const float xl = left[i];
+            const float xr = stereo ? right[i] : 0.0f;
+
+            const auto in = (size_t) ((time + n) & inputMask);
+            inputRingLeft[in] = xl;
+            inputRingRight[in] = xr;
+
+            const auto h = (size_t) historyPosition;
+            historyLeft[h] = historyLeft[h + headLength] = xl;
+            historyRight[h] = historyRight[h + headLength] = xr;
+
+            // Oldest to newest input is history[h + 1 .. h + headLength]; taps are reversed to match
+            const float* windowLeft = historyLeft.data() + h + 1;
+            const float* windowRight = historyRight.data() + h + 1;
+            float yl[4] = {}, yr[4] = {};
+
+            for (int k = 0; k < headLength; k += 4)
+            {
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    yl[lane] += headLeft[(size_t) (k + lane)] * windowLeft[k + lane];
+                    yr[lane] += headRight[(size_t) (k + lane)] * windowRight[k + lane];
+                }
+            }
+
+            const auto out = (size_t) ((time + n) & outputMask);
+            left[i] = (yl[0] + yl[1]) + (yl[2] + yl[3]) + outputRingLeft[out];
+            outputRingLeft[out] = 0.0f;
+
+            if (stereo)
+                right[i] = (yr[0] + yr[1]) + (yr[2] + yr[3]) + outputRingRight[out];
+
+            outputRingRight[out] = 0.0f;
+
+            historyPosition = (historyPosition + 1) & boundaryMask;
+        }
+
+        time += chunk;
+
+        if ((time & boundaryMask) == 0)
+            onBlockBoundary();
+    }
+}
+
+void ZeroLatencyConvolver::onBlockBoundary() noexcept
+{
+    for (int s = 0; s < numSegments; ++s)
+    {
+        auto& segment = segments[(size_t) s];
+        const int blockSize = segment.blockSize;
+
+        if ((time & (blockSize - 1)) != 0)
+            continue;
+
+        // The previous deferred block is due one block after it was queued
+        if (segment.deferred)
+        {
+            const int state = segment.state.load (std::memory_order_acquire);
+
+            if (segment.overran)
+            {
+                // Still on the worker: leave its buffers alone and skip this block too
+                if (state == Segment::running)
+                    continue;
+
+                // Finished too late to be heard: drop it
+                segment.overran = false;
+                segment.state.store (Segment::idle, std::memory_order_relaxed);
+            }
+            else if (state != Segment::idle && ! finishTask (segment))
+            {
+                segment.overran = true;
+                continue;
+            }
+        }
+
+        // Latest block into the second half of the segment's input frame
+        for (int n = 0; n < blockSize; ++n)
+        {
+            const auto in = (size_t) ((time - blockSize + n) & inputMask);
+            segment.inputLeft[(size_t) (blockSize + n)] = inputRingLeft[in];
+            segment.inputRight[(size_t) (blockSize + n)] = inputRingRight[in];
+        }
+
+        segment.outputTime = time - blockSize + segment.offset;
+
+        if (segment.deferred)
+        {
+            segment.state.store (Segment::pending, std::memory_order_release);
+
+            if (worker != nullptr && worker->enqueue (&segment))
+                continue;
+
+            segment.state.store (Segment::running, std::memory_order_relaxed);
+        }
+
+        segment.compute();
+        addToOutput (segment);
+        segment.state.store (Segment::idle, std::memory_order_relaxed);
+    }
+}
+
+bool ZeroLatencyConvolver::finishTask (Segment& segment) noexcept
+{
+    // Not started yet: take it over. Already running: it is normally nearly done, so wait
+    // for it, but only for so long
+    int expected = Segment::pending;
+
+    if (segment.state.compare_exchange_strong (expected, Segment::running, std::memory_order_acquire))
+    {
+        segment.compute();
+    }
+    else if (segment.state.load (std::memory_order_acquire) != Segment::done)
+    {
+        const auto deadline = juce::Time::getHighResolutionTicks()
+                                + juce::Time::secondsToHighResolutionTicks (maxWaitMs * 0.001);
+
+        while (segment.state.load (std::memory_order_acquire) != Segment::done)
+            if (juce::Time::getHighResolutionTicks() > deadline)
+                return false;
+    }
+
+    addToOutput (segment);
+    segment.state.store (Segment::idle, std::memory_order_relaxed);
+    return true;
+}
+
+void ZeroLatencyConvolver::addToOutput (const Segment& segment) noexcept
+{
+    for (int n = 0; n < segment.blockSize; ++n)
+    {
+        const auto out = (size_t) ((segment.outputTime + n) & outputMask);
+        outputRingLeft[out] += segment.outputLeft[(size_t) n];
+        outputRingRight[out] += segment.outputRight[(size_t) n];
+    }
+}
+
+//==============================================================================
+void ZeroLatencyConvolver::Segment::prepare (int newBlockSize, int newOffset, const float* left, int leftLength,
+                                             const float* right, int rightLength, int length)
+{
+    blockSize = newBlockSize;
+    offset = newOffset;
+    numPartitions = (length + blockSize - 1) / blockSize;
+
+    const int fftSize = 2 * blockSize;
+    fft = std::make_unique<juce::dsp::FFT> (juce::roundToInt (std::log2 ((double) fftSize)));
+
+    const auto bins = (size_t) (blockSize + 1);
+    kernelLeft.assign (bins * (size_t) numPartitions, {});
+    kernelRight.assign (bins * (size_t) numPartitions, {});
+    delayLeft.assign (bins * (size_t) numPartitions, {});
+    delayRight.assign (bins * (size_t) numPartitions, {});
+    accumLeft.assign (bins, {});
+    accumRight.assign (bins, {});
+    frame.assign ((size_t) fftSize, {});
+    spectrum.assign ((size_t) fftSize, {});
+    inputLeft.assign ((size_t) fftSize, 0.0f);
+    inputRight.assign ((size_t) fftSize, 0.0f);
+    outputLeft.assign ((size_t) blockSize, 0.0f);
+    outputRight.assign ((size_t) blockSize, 0.0f);
+
+    // Kernel partitions, zero-padded; the inverse transform's 1 / N is folded in
+    const float scale = 1.0f / (float) fftSize;
+
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        std::fill (frame.begin(), frame.end(), std::complex<float>());
+
+        for (int n = 0; n < blockSize && n < length - p * blockSize; ++n)
+        {
+            const int tap = offset + p * blockSize + n;
+            frame[(size_t) n] = { tap < leftLength ? left[tap] * scale : 0.0f,
+                                  tap < rightLength ? right[tap] * scale : 0.0f };
+        }
+
+        fft->perform (frame.data(), spectrum.data(), false);
+        splitPackedSpectrum (spectrum.data(), fftSize,
+                             kernelLeft.data() + bins * (size_t) p, kernelRight.data() + bins * (size_t) p);
+    }
+
+    delayIndex = 0;
+    overran = false;
+    state.store (idle);
+}
+
+void ZeroLatencyConvolver::Segment::clearState()
+{
+    std::fill (delayLeft.begin(), delayLeft.end(), std::complex<float>());
+    std::fill (delayRight.begin(), delayRight.end(), std::complex<float>());
+    std::fill (inputLeft.begin(), inputLeft.end(), 0.0f);
+    std::fill (inputRight.begin(), inputRight.end(), 0.0f);
+    delayIndex = 0;
+    overran = false;
+}
+
+void ZeroLatencyConvolver::Segment::cancelAndWait()
+{
+    int expected = pending;
+    state.compare_exchange_strong (expected, idle);
+
+    while (state.load (std::memory_order_acquire) == running)
+        juce::Thread::yield();
+
+    state.store (idle);
+}
+
+void ZeroLatencyConvolver::Segment::compute() noexcept
+{
+    const int fftSize = 2 * blockSize;
+    const auto bins = (size_t) (blockSize + 1);
+
+    // Packed spectrum of [previous block, current block] into the delay line
+    for (int n = 0; n < fftSize; ++n)
+        frame[(size_t) n] = { inputLeft[(size_t) n], inputRight[(size_t) n] };
+
+    fft->perform (frame.data(), spectrum.data(), false);
+    splitPackedSpectrum (spectrum.data(), fftSize,
+                         delayLeft.data() + bins * (size_t) delayIndex, delayRight.data() + bins * (size_t) delayIndex);
+
+    std::copy (inputLeft.begin() + blockSize, inputLeft.end(), inputLeft.begin());
+    std::copy (inputRight.begin() + blockSize, inputRight.end(), inputRight.begin());
+
+    // Multiply-accumulate, written out to avoid the NaN-safe complex multiply
+    auto* accL = reinterpret_cast<float*> (accumLeft.data());
+    auto* accR = reinterpret_cast<float*> (accumRight.data());
+    std::fill (accL, accL + 2 * bins, 0.0f);
+    std::fill (accR, accR + 2 * bins, 0.0f);
+
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        const auto slot = bins * (size_t) ((delayIndex - p + numPartitions) % numPartitions);
+        const auto* xl = reinterpret_cast<const float*> (delayLeft.data() + slot);
+        const auto* xr = reinterpret_cast<const float*> (delayRight.data() + slot);
+        const auto* hl = reinterpret_cast<const float*> (kernelLeft.data() + bins * (size_t) p);
+        const auto* hr = reinterpret_cast<const float*> (kernelRight.data() + bins * (size_t) p);
+
+        for (size_t b = 0; b < 2 * bins; b += 2)
+        {
+            accL[b]     += xl[b] * hl[b]     - xl[b + 1] * hl[b + 1];
+            accL[b + 1] += xl[b] * hl[b + 1] + xl[b + 1] * hl[b];
+            accR[b]     += xr[b] * hr[b]     - xr[b + 1] * hr[b + 1];
+            accR[b + 1] += xr[b] * hr[b + 1] + xr[b + 1] * hr[b];
+        }
+    }
+
+    // Repack as Y_left + i * Y_right over the full (Hermitian-extended) spectrum,
+    // conjugated so the forward FFT computes the inverse transform
+    for (int k = 0; k <= blockSize; ++k)
+    {
+        const auto w = accumLeft[(size_t) k] + std::complex<float> (0.0f, 1.0f) * accumRight[(size_t) k];
+        frame[(size_t) k] = std::conj (w);
+
+        if (k > 0 && k < blockSize)
+        {
+            const auto mirrored = std::conj (accumLeft[(size_t) k])
+                                + std::complex<float> (0.0f, 1.0f) * std::conj (accumRight[(size_t) k]);
+            frame[(size_t) (fftSize - k)] = std::conj (mirrored);
+        }
+    }
+
+    fft->perform (frame.data(), spectrum.data(), false);
+
+    // Overlap-save: keep the second half; conj of the result gives left (real) and right (imag)
+    for (int n = 0; n < blockSize; ++n)
+    {
+        const auto y = spectrum[(size_t) (blockSize + n)];
+        outputLeft[(size_t) n] = y.real();
+        outputRight[(size_t) n] = -y.imag();
+    }
+
+    delayIndex = (delayIndex + 1) % numPartitions;
+}
+
+//==============================================================================
+ConvolutionWorker::ConvolutionWorker()
+    : juce::Thread ("Convolution worker")
+{
+    startThread (juce::Thread::Priority::high);
+}
+
+ConvolutionWorker::~ConvolutionWorker()
+{
+    signalThreadShouldExit();
+    workAvailable.post();
+    stopThread (1000);
+}
+
+bool ConvolutionWorker::enqueue (ZeroLatencyConvolver::Segment* segment) noexcept
+{
+    if (fifo.getFreeSpace() == 0)
+        return false;
+
+    fifo.write (1).forEach ([this, segment] (int index) { queue[(size_t) index] = segment; });
+
+    // Queued before checking, so a worker about to sleep either sees the segment or gets woken.
+    // A post it did not need only costs it one extra look at the queue
+    if (sleeping.exchange (false))
+        workAvailable.post();
+
+    return true;
+}
+
+void ConvolutionWorker::run()
+{
+    using Segment = ZeroLatencyConvolver::Segment;
+
+    while (! threadShouldExit())
+    {
+        fifo.read (fifo.getNumReady()).forEach ([this] (int index)
+        {
+            // Skip anything the audio thread already stole or that was cancelled
+            auto* segment = queue[(size_t) index];
+            int expected = Segment::pending;
+
+            if (segment->state.compare_exchange_strong (expected, Segment::running, std::memory_order_acquire))
+            {
+                segment->compute();
+                segment->state.store (Segment::done, std::memory_order_release);
+            }
+        });
+
+        // Announce the sleep before the last look at the queue, so nothing enqueued in between is missed
+        sleeping.store (true);
+
+        if (fifo.getNumReady() == 0 && ! threadShouldExit())
+            workAvailable.wait();
+
+        sleeping.store (false);
+    }
+}
+
+//==============================================================================
+#if JUCE_MAC || JUCE_IOS
+
+ConvolutionWorker::WakeSemaphore::WakeSemaphore()   : handle (dispatch_semaphore_create (0)) {}
+ConvolutionWorker::WakeSemaphore::~WakeSemaphore()  { dispatch_release (static_cast<dispatch_semaphore_t> (handle)); }
+
+void ConvolutionWorker::WakeSemaphore::post() noexcept  { dispatch_semaphore_signal (static_cast<dispatch_semaphore_t> (handle)); }
+void ConvolutionWorker::WakeSemaphore::wait() noexcept  { dispatch_semaphore_wait (static_cast<dispatch_semaphore_t> (handle), DISPATCH_TIME_FOREVER); }
+
+#elif JUCE_WINDOWS
+
+ConvolutionWorker::WakeSemaphore::WakeSemaphore()   : handle (CreateSemaphoreW (nullptr, 0, 0x7fffffff, nullptr)) {}
+ConvolutionWorker::WakeSemaphore::~WakeSemaphore()  { CloseHandle (handle); }
+
+void ConvolutionWorker::WakeSemaphore::post() noexcept  { ReleaseSemaphore (handle, 1, nullptr); }
+void ConvolutionWorker::WakeSemaphore::wait() noexcept  { WaitForSingleObject (handle, 0xffffffff); }
+
+#else
+
+ConvolutionWorker::WakeSemaphore::WakeSemaphore()
+    : handle (new sem_t)
+{
+    sem_init (static_cast<sem_t*> (handle), 0, 0);
+}
+
+ConvolutionWorker::WakeSemaphore::~WakeSemaphore()
+{
+    sem_destroy (static_cast<sem_t*> (handle));
+    delete static_cast<sem_t*> (handle);
+}
+
+void ConvolutionWorker::WakeSemaphore::post() noexcept
+{
+    sem_post (static_cast<sem_t*> (handle));
+}
+
+void ConvolutionWorker::WakeSemaphore::wait() noexcept
+{
+    // Retried if a signal interrupts it
+    while (sem_wait (static_cast<sem_t*> (handle)) != 0 && errno == EINTR) {}
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    ZeroLatencyConvolver.h
+    Zero-latency non-uniform partitioned convolution for long stereo IRs
+
+    Each channel has its own impulse response. The IR is split into:
+
+      - a direct-form head (the first headLength taps), computed per sample,
+      - segments of uniformly partitioned overlap-save FFT convolution whose
+        block size grows along the IR.
+
+    A segment with block size B that starts at IR offset o gets its input
+    block B samples late and may deliver its output o - B samples after
+    that, so:
+
+      - the first segment (o == B) is computed on the audio thread the moment
+        its block is complete,
+      - later segments (o >= 2B) are deferred to a ConvolutionWorker and only
+        collected one block later. If the worker has not started by then, the
+        audio thread steals the task and computes it itself. If the worker is
+        still computing it, the audio thread waits at most maxWaitMs and then
+        skips that segment's block rather than stall the callback.
+
+    Both channels share each FFT: they are packed as left + i * right, split
+    into their own spectra, multiplied with their own kernels and packed
+    again for a single inverse transform.
+
+    setImpulseResponses() allocates; call it off the audio thread and only
+    while process() is not running on this instance. process() never
+    allocates or locks; waking the worker posts a semaphore, which does not
+    lock either.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+
+class ConvolutionWorker;
+
+//==============================================================================
+class ZeroLatencyConvolver
+{
+public:
+    ZeroLatencyConvolver() = default;
+    ~ZeroLatencyConvolver();
+
+    static constexpr int headLength = 128;
+
+    /** Longest the audio thread waits for the worker to finish a segment it has started. */
+    static constexpr double maxWaitMs = 0.5;
+
+    /** Longest IR accepted, in samples; longer ones are truncated. */
+    static constexpr int maxImpulseLength = 1 << 19;
+
+    /** Sets the worker that computes the deferred segments (nullptr = all on the audio thread). */
+    void setWorker (ConvolutionWorker* newWorker) { worker = newWorker; }
+
+    /** Partitions and transforms both IRs; either may be empty. Resets the state. */
+    void setImpulseResponses (const float* left, int leftLength, const float* right, int rightLength);
+
+    /** Drops the IRs; process() becomes a pass-through. */
+    void clear();
+
+    /** Clears all delay lines and waits for outstanding background work. */
+    void reset();
+
+    bool isLoaded() const noexcept { return loaded; }
+
+    /** Convolves in place. right may be nullptr for mono (left IR only). */
+    void process (float* left, float* right, int numSamples) noexcept;
+
+private:
+    friend class ConvolutionWorker;
+
+    //==========================================================================
+    // One uniformly partitioned run of the IR
+    struct Segment
+    {
+        enum State { idle, pending, running, done };
+
+        int blockSize = 0;
+        int offset = 0;
+        int numPartitions = 0;
+        bool deferred = false;
+
+        std::unique_ptr<juce::dsp::FFT> fft;
+        std::vector<std::complex<float>> kernelLeft, kernelRight;   // numPartitions x (blockSize + 1), scaled by 1 / fftSize
+        std::vector<std::complex<float>> delayLeft, delayRight;     // input spectra, same layout
+        std::vector<std::complex<float>> accumLeft, accumRight;     // blockSize + 1
+        std::vector<std::complex<float>> frame, spectrum;           // fftSize
+        std::vector<float> inputLeft, inputRight;                   // previous + current block
+        std::vector<float> outputLeft, outputRight;                 // blockSize
+        int delayIndex = 0;
+        juce::int64 outputTime = 0;
+
+        std::atomic<int> state { idle };
+        bool overran = false;       // Audio thread: gave up waiting; the block is dropped once done
+
+        void prepare (int newBlockSize, int newOffset, const float* left, int leftLength,
+                      const float* right, int rightLength, int length);
+        void clearState();
+        void compute() noexcept;
+
+        /** Makes sure no worker is (or will be) computing this segment. Not for the audio thread. */
+        void cancelAndWait();
+    };
+
+    static constexpr int maxSegments = 3;
+
+    /** Collects a deferred segment's block; false if the worker didn't finish it within maxWaitMs. */
+    bool finishTask (Segment& segment) noexcept;
+    void addToOutput (const Segment& segment) noexcept;
+    void onBlockBoundary() noexcept;
+
+    std::array<Segment, maxSegments> segments;
+    int numSegments = 0;
+    bool loaded = false;
+    ConvolutionWorker* worker = nullptr;
+
+    // Direct-form head; history is doubled so the dot product is contiguous
+    std::vector<float> headLeft, headRight;             // reversed taps
+    std::vector<float> historyLeft, historyRight;       // 2 x headLength
+    int historyPosition = 0;
+
+    // Recent input, long enough for the largest segment block
+    std::vector<float> inputRingLeft, inputRingRight;
+    int inputMask = 0;
+
+    // Segment outputs are accumulated here at their due time and consumed sample by sample
+    std::vector<float> outputRingLeft, outputRingRight;
+    int outputMask = 0;
+
+    juce::int64 time = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (ZeroLatencyConvolver)
+};
+
+//==============================================================================
+/**
+    Background thread for the deferred segments of any number of
+    ZeroLatencyConvolvers. The audio thread enqueues through a lock-free FIFO
+    and, when the worker has run out of work and gone to sleep, wakes it by
+    posting a semaphore. Unlike a WaitableEvent (a mutex and a condition
+    variable) the post never locks: it is an atomic increment, plus a kernel
+    wake-up when the worker is actually waiting. With nothing queued (no IR
+    loaded, or playback stopped) the worker sleeps without polling.
+*/
+class ConvolutionWorker : private juce::Thread
+{
+public:
+    ConvolutionWorker();
+    ~ConvolutionWorker() override;
+
+    /** Audio thread: queues a pending segment. Returns false if the queue is full. */
+    bool enqueue (ZeroLatencyConvolver::Segment* segment) noexcept;
+
+private:
+    void run() override;
+
+    static constexpr int queueSize = 256;
+    juce::AbstractFifo fifo { queueSize };
+    std::array<ZeroLatencyConvolver::Segment*, queueSize> queue {};
+
+    /** Counting semaphore whose post() is safe on the audio thread: a Mach semaphore
+        on Apple platforms, a kernel semaphore on Windows and a futex-based POSIX one
+        elsewhere.
+    */
+    class WakeSemaphore
+    {
+    public:
+        WakeSemaphore();
+        ~WakeSemaphore();
+
+        void post() noexcept;
+        void wait() noexcept;
+
+    private:
+        void* handle = nullptr;
+
+        JUCE_DECLARE_NON_COPYABLE (WakeSemaphore)
+    };
+
+    WakeSemaphore workAvailable;
+    std::atomic<bool> sleeping { false };
+
+    JUCE_DECLARE_NON_COPYABLE (ConvolutionWorker)
+};
@@ -0,0 +1,387 @@
+/*
+  ==============================================================================
+
+    CallbackMonitor.h
+    Wall-clock deadline monitoring of the audio callback
+
+    Always compiled in: it costs two clock reads per callback. Each
+    processBlock() is timed against its real-time budget (numSamples /
+    sampleRate) and the ratio - the callback's utilisation - goes into a
+    histogram (5% bins up to 200%), a count of callbacks at or above each
+    near-miss threshold, an overrun count (100% or more, where the host is
+    likely to drop out) and a list of the worst callbacks, each with the
+    time it happened and the engine configuration that was active.
+
+    When a client reports crackles this shows whether the plugin itself
+    ran out of time, and under which settings. The editor shows it with
+    Cmd/Ctrl+Shift+D, and it's part of the processor's diagnostics dump.
+
+    Only the audio thread writes the counters (relaxed atomics, no
+    read-modify-write, as in StageTimings); the worst-callback list is
+    guarded by a spin lock the audio thread only ever try-locks, so a
+    reader copying it can at worst cost one entry. Offline renders aren't
+    monitored: they have no deadline.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class CallbackMonitor
+{
+public:
+    /** The engine settings a callback ran with. Filled in by the processor. */
+    struct EngineConfiguration
+    {
+        double sampleRate = 0.0;
+        int blockSize = 0;                  // This callback's number of samples
+        int preparedBlockSize = 0;          // The maximum given to prepareToPlay()
+        int latencySamples = 0;
+        const char* model = "";             // String literals only: copied on the audio thread
+        const char* headphoneEQ = "off";
+        const char* quality = "";           // The quality governor's tier
+        bool userIR = false;
+        bool leftEnabled = true, rightEnabled = true;
+        bool bypassed = false;
+        bool nonRealtime = false;           // Offline render: not recorded
+    };
+
+    struct Callback
+    {
+        double utilisation = 0.0;           // Elapsed / budget (1 = 100%)
+        double elapsedUs = 0.0, budgetUs = 0.0;
+        juce::int64 timeMs = 0;             // juce::Time::currentTimeMillis() when it finished
+        EngineConfiguration configuration;
+    };
+
+    struct Statistics
+    {
+        juce::int64 count = 0;
+        double meanUtilisation = 0.0, p50Utilisation = 0.0, p99Utilisation = 0.0, maxUtilisation = 0.0;
+        juce::int64 overruns = 0;
+    };
+
+    static constexpr int maxThresholds = 4;
+    static constexpr int numWorst = 8;
+
+    // 5% bins from 0 to 200%; the last bin takes everything above
+    static constexpr int numBins = 41;
+    static constexpr double binWidth = 0.05;
+
+    CallbackMonitor()
+    {
+        setNearMissThresholds ({ 0.5f, 0.7f, 0.9f });
+        clear();
+    }
+
+    //==========================================================================
+    /** Any thread: the utilisations (1 = 100% of the budget) to count near-misses at.
+        Up to maxThresholds, ascending. Clears the counters.
+    */
+    void setNearMissThresholds (const juce::Array<float>& newThresholds)
+    {
+        auto sorted = newThresholds;
+        sorted.sort();
+
+        const int num = juce::jmin (maxThresholds, sorted.size());
+
+        for (int i = 0; i < num; ++i)
+            thresholds[static_cast<size_t> (i)].store (sorted[i], std::memory_order_relaxed);
+
+        numThresholds.store (num, std::memory_order_release);
+        requestReset();
+    }
+
+    juce::Array<float> getNearMissThresholds() const
+    {
+        juce::Array<float> result;
+
+        for (int i = 0; i < numThresholds.load (std::memory_order_acquire); ++i)
+            result.add (thresholds[static_cast<size_t> (i)].load (std::memory_order_relaxed));
+
+        return result;
+    }
+
+    //==========================================================================
+    /** Audio thread: adds one callback, timed in hi-res ticks from startTicks to now. */
+    void record (juce::int64 startTicks, const EngineConfiguration& configuration) noexcept
+    {
+        const auto endTicks = juce::Time::getHighResolutionTicks();
+
+        if (resetRequested.load (std::memory_order_acquire))
+            carryOutReset();
+
+        if (configuration.nonRealtime || configuration.sampleRate <= 0.0 || configuration.blockSize <= 0)
+            return;
+
+        const auto elapsedSeconds = static_cast<double> (endTicks - startTicks) * secondsPerTick;
+        const auto budgetSeconds = configuration.blockSize / configuration.sampleRate;
+        const auto utilisation = elapsedSeconds / budgetSeconds;
+        lastUtilisation = utilisation;
+
+        increment (count);
+        utilisationSum.store (utilisationSum.load (std::memory_order_relaxed) + utilisation, std::memory_order_relaxed);
+
+        if (utilisation > maxUtilisation.load (std::memory_order_relaxed))
+            maxUtilisation.store (utilisation, std::memory_order_relaxed);
+
+        increment (histogram[static_cast<size_t> (juce::jmin (numBins - 1, static_cast<int> (utilisation / binWidth)))]);
+
+        for (int i = 0; i < numThresholds.load (std::memory_order_relaxed); ++i)
+            if (utilisation >= thresholds[static_cast<size_t> (i)].load (std::memory_order_relaxed))
+                increment (nearMisses[static_cast<size_t> (i)]);
+
+        if (utilisation >= 1.0)
+            increment (overruns);
+
+        // Worst list: only touched when this callback makes it in
+        if (utilisation > lowestWorst)
+        {
+            const juce::SpinLock::ScopedTryLockType lock (worstLock);
+
+            if (lock.isLocked())
+            {
+                Callback callback;
+                callback.utilisation = utilisation;
+                callback.elapsedUs = elapsedSeconds * 1.0e6;
+                callback.budgetUs = budgetSeconds * 1.0e6;
+                callback.timeMs = juce::Time::currentTimeMillis();
+                callback.configuration = configuration;
+                insertWorst (callback);
+            }
+        }
+    }
+
+    /** Audio thread: the utilisation of the last recorded callback, or -1 if none was
+        recorded since the previous call. Feeds the quality governor.
+    */
+    double takeLastUtilisation() noexcept
+    {
+        return std::exchange (lastUtilisation, -1.0);
+    }
+
+    /** Any thread: clears everything before the audio thread's next callback. */
+    void requestReset() noexcept { resetRequested.store (true, std::memory_order_release); }
+
+    //==========================================================================
+    /** Any thread: the statistics so far. */
+    Statistics getStatistics() const
+    {
+        Statistics result;
+        result.count = static_cast<juce::int64> (count.load (std::memory_order_relaxed));
+
+        if (result.count == 0)
+            return result;
+
+        result.meanUtilisation = utilisationSum.load (std::memory_order_relaxed) / static_cast<double> (result.count);
+        result.maxUtilisation = maxUtilisation.load (std::memory_order_relaxed);
+        result.overruns = static_cast<juce::int64> (overruns.load (std::memory_order_relaxed));
+        result.p50Utilisation = getPercentile (0.5, result.count, result.maxUtilisation);
+        result.p99Utilisation = getPercentile (0.99, result.count, result.maxUtilisation);
+        return result;
+    }
+
+    /** Any thread: callbacks at or above near-miss threshold i. */
+    juce::int64 getNearMisses (int thresholdIndex) const
+    {
+        return static_cast<juce::int64> (nearMisses[static_cast<size_t> (thresholdIndex)].load (std::memory_order_relaxed));
+    }
+
+    /** Any thread: callbacks whose utilisation fell in histogram bin i. */
+    juce::int64 getBinCount (int bin) const
+    {
+        return static_cast<juce::int64> (histogram[static_cast<size_t> (bin)].load (std::memory_order_relaxed));
+    }
+
+    /** Message thread: the worst callbacks so far, worst first. */
+    std::vector<Callback> getWorstCallbacks() const
+    {
+        const juce::SpinLock::ScopedLockType lock (worstLock);
+        return { worst.begin(), worst.begin() + numWorstStored };
+    }
+
+    //==========================================================================
+    static juce::var toVar (const EngineConfiguration& configuration)
+    {
+        auto* object = new juce::DynamicObject();
+        object->setProperty ("sampleRate", configuration.sampleRate);
+        object->setProperty ("blockSize", configuration.blockSize);
+        object->setProperty ("preparedBlockSize", configuration.preparedBlockSize);
+        object->setProperty ("latencySamples", configuration.latencySamples);
+        object->setProperty ("model", juce::String (configuration.model));
+        object->setProperty ("headphoneEQ", juce::String (configuration.headphoneEQ));
+        object->setProperty ("quality", juce::String (configuration.quality));
+        object->setProperty ("userIR", configuration.userIR);
+        object->setProperty ("leftEnabled", configuration.leftEnabled);
+        object->setProperty ("rightEnabled", configuration.rightEnabled);
+        object->setProperty ("bypassed", configuration.bypassed);
+        return juce::var (object);
+    }
+
+    /** Statistics, near-misses, histogram and worst callbacks, for the diagnostics dump. */
+    juce::var toVar() const
+    {
+        const auto stats = getStatistics();
+
+        auto* root = new juce::DynamicObject();
+        root->setProperty ("count", stats.count);
+        root->setProperty ("meanUtilisation", stats.meanUtilisation);
+        root->setProperty ("p50Utilisation", stats.p50Utilisation);
+        root->setProperty ("p99Utilisation", stats.p99Utilisation);
+        root->setProperty ("maxUtilisation", stats.maxUtilisation);
+        root->setProperty ("overruns", stats.overruns);
+
+        juce::Array<juce::var> nearMissList;
+        const auto thresholdValues = getNearMissThresholds();
+
+        for (int i = 0; i < thresholdValues.size(); ++i)
+        {
+            auto* nearMiss = new juce::DynamicObject();
+            nearMiss->setProperty ("threshold", thresholdValues[i]);
+            nearMiss->setProperty ("count", getNearMisses (i));
+            nearMissList.add (juce::var (nearMiss));
+        }
+
+        root->setProperty ("nearMisses", nearMissList);
+
+        juce::Array<juce::var> bins;
+
+        for (int i = 0; i < numBins; ++i)
+            bins.add (getBinCount (i));
+
+        root->setProperty ("histogramBinWidth", binWidth);
+        root->setProperty ("histogram", bins);
+
+        juce::Array<juce::var> worstList;
+
+        for (auto& callback : getWorstCallbacks())
+        {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty ("utilisation", callback.utilisation);
+            entry->setProperty ("elapsedUs", callback.elapsedUs);
+            entry->setProperty ("budgetUs", callback.budgetUs);
+            entry->setProperty ("time", juce::Time (callback.timeMs).toISO8601 (true));
+            entry->setProperty ("configuration", toVar (callback.configuration));
+            worstList.add (juce::var (entry));
+        }
+
+        root->setProperty ("worst", worstList);
+        return juce::var (root);
+    }
+
+private:
+    //==========================================================================
+    template <typename Counter>
+    static void increment (Counter& counter) noexcept
+    {
+        counter.store (counter.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    double getPercentile (double fraction, juce::int64 total, double maximum) const
+    {
+        const auto rank = static_cast<juce::int64> (std::ceil (fraction * static_cast<double> (total)));
+        juce::int64 seen = 0;
+
+        for (int i = 0; i < numBins; ++i)
+        {
+            seen += getBinCount (i);
+
+            // The bin's centre, clamped to what was seen
+            if (seen >= rank)
+                return juce::jmin (maximum, (i + 0.5) * binWidth);
+        }
+
+        return maximum;
+    }
+
+    // Audio thread, holding worstLock
+    void insertWorst (const Callback& callback) noexcept
+    {
+        int position = numWorstStored;
+
+        while (position > 0 && worst[static_cast<size_t> (position - 1)].utilisation < callback.utilisation)
+            --position;
+
+        if (position >= numWorst)
+            return;
+
+        for (int i = juce::jmin (numWorstStored, numWorst - 1); i > position; --i)
+            worst[static_cast<size_t> (i)] = worst[static_cast<size_t> (i - 1)];
+
+        worst[static_cast<size_t> (position)] = callback;
+        numWorstStored = juce::jmin (numWorst, numWorstStored + 1);
+        lowestWorst = numWorstStored == numWorst ? worst[numWorst - 1].utilisation : 0.0;
+    }
+
+    // Audio thread; if a reader holds the worst list the reset waits for the next callback
+    void carryOutReset() noexcept
+    {
+        const juce::SpinLock::ScopedTryLockType lock (worstLock);
+
+        if (! lock.isLocked())
+            return;
+
+        resetRequested.store (false, std::memory_order_relaxed);
+        clear();
+    }
+
+    void clear() noexcept
+    {
+        count.store (0, std::memory_order_relaxed);
+        overruns.store (0, std::memory_order_relaxed);
+        utilisationSum.store (0.0, std::memory_order_relaxed);
+        maxUtilisation.store (0.0, std::memory_order_relaxed);
+
+        for (auto& bin : histogram)
+            bin.store (0, std::memory_order_relaxed);
+
+        for (auto& nearMiss : nearMisses)
+            nearMiss.store (0, std::memory_order_relaxed);
+
+        numWorstStored = 0;
+        lowestWorst = 0.0;
+    }
+
+    const double secondsPerTick = 1.0 / static_cast<double> (juce::Time::getHighResolutionTicksPerSecond());
+
+    std::atomic<juce::uint64> count { 0 }, overruns { 0 };
+    std::atomic<double> utilisationSum { 0.0 }, maxUtilisation { 0.0 };
+    std::array<std::atomic<juce::uint64>, numBins> histogram {};
+
+    std::array<std::atomic<float>, maxThresholds> thresholds {};
+    std::array<std::atomic<juce::uint64>, maxThresholds> nearMisses {};
+    std::atomic<int> numThresholds { 0 };
+
+    juce::SpinLock worstLock;
+    std::array<Callback, numWorst> worst;
+    int numWorstStored = 0;
+    double lowestWorst = 0.0;                       // Audio thread only
+    double lastUtilisation = -1.0;                  // Audio thread only
+
+    std::atomic<bool> resetRequested { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CallbackMonitor)
+};
+
+//==============================================================================
+/** Times the enclosing processBlock() into a CallbackMonitor. */
+class ScopedCallbackTimer
+{
+public:
+    ScopedCallbackTimer (CallbackMonitor& monitorToUse, const CallbackMonitor::EngineConfiguration& configurationToRecord) noexcept
+        : monitor (monitorToUse), configuration (configurationToRecord), start (juce::Time::getHighResolutionTicks())
+    {
+    }
+
+    ~ScopedCallbackTimer() noexcept { monitor.record (start, configuration); }
+
+private:
+    CallbackMonitor& monitor;
+    const CallbackMonitor::EngineConfiguration configuration;
+    const juce::int64 start;
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedCallbackTimer)
+};
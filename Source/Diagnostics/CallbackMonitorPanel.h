@@ -0,0 +1,208 @@
+/*
+  ==============================================================================
+
+    CallbackMonitorPanel.h
+    Hidden editor overlay showing the callback deadline statistics
+
+    The editor toggles it with Cmd/Ctrl+Shift+D (together with the stage
+    timings in EARFIX_STAGE_TIMING builds). It shows the utilisation
+    summary, near-miss and overrun counts, the utilisation histogram and
+    the worst callbacks; Reset clears them and Save writes the processor's
+    diagnostics dump.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CallbackMonitor.h"
+#include "../DSP/QualityGovernor.h"
+#include "../CustomLookAndFeel.h"
+
+//==============================================================================
+class CallbackMonitorPanel  : public juce::Component,
+                              private juce::Timer
+{
+public:
+    /** saveDump writes the full diagnostics dump to the chosen file. */
+    CallbackMonitorPanel (CallbackMonitor& monitorToShow,
+                          std::function<juce::Result (const juce::File&)> saveDump)
+        : monitor (monitorToShow), writeDump (std::move (saveDump))
+    {
+        resetButton.onClick = [this]() { monitor.requestReset(); };
+        addAndMakeVisible (resetButton);
+
+        saveButton.onClick = [this]() { saveToFile(); };
+        addAndMakeVisible (saveButton);
+    }
+
+    //==========================================================================
+    void paint (juce::Graphics& g) override
+    {
+        auto bounds = getLocalBounds().toFloat();
+        g.setColour (CustomLookAndFeel::textDark.withAlpha (0.92f));
+        g.fillRoundedRectangle (bounds, 6.0f);
+
+        auto area = getLocalBounds().reduced (padding);
+        area.removeFromBottom (buttonHeight + padding);
+
+        auto formatPercent = [] (double utilisation) { return juce::String (utilisation * 100.0, 1) + "%"; };
+
+        const auto stats = monitor.getStatistics();
+        const auto thresholds = monitor.getNearMissThresholds();
+
+        g.setFont (juce::FontOptions (juce::Font::getDefaultMonospacedFontName(), 11.0f, juce::Font::plain));
+        g.setColour (CustomLookAndFeel::panelWhite);
+        g.drawText ("CALLBACKS " + juce::String (stats.count)
+                      + "   mean " + formatPercent (stats.meanUtilisation)
+                      + "   p99 " + formatPercent (stats.p99Utilisation)
+                      + "   max " + formatPercent (stats.maxUtilisation),
+                    area.removeFromTop (rowHeight), juce::Justification::centredLeft);
+
+        juce::String nearMisses ("NEAR MISSES");
+
+        for (int i = 0; i < thresholds.size(); ++i)
+            nearMisses << "   >=" << juce::roundToInt (thresholds[i] * 100.0f) << "%: " << monitor.getNearMisses (i);
+
+        g.drawText (nearMisses, area.removeFromTop (rowHeight), juce::Justification::centredLeft);
+
+        g.setColour (stats.overruns > 0 ? CustomLookAndFeel::accentRed : CustomLookAndFeel::panelWhite);
+        g.drawText ("OVERRUNS " + juce::String (stats.overruns) + "  (callbacks over their budget)",
+                    area.removeFromTop (rowHeight), juce::Justification::centredLeft);
+
+        area.removeFromTop (padding / 2);
+        paintHistogram (g, area.removeFromTop (histogramHeight).toFloat(), thresholds);
+        area.removeFromTop (padding / 2);
+
+        g.setColour (CustomLookAndFeel::panelWhite);
+        g.drawText ("WORST      UTIL   TIME/BUDGET (us)  BLOCK    RATE  MODEL      HP EQ",
+                    area.removeFromTop (rowHeight), juce::Justification::centredLeft);
+
+        for (auto& callback : monitor.getWorstCallbacks())
+        {
+            const auto& config = callback.configuration;
+
+            g.setColour (callback.utilisation >= 1.0 ? CustomLookAndFeel::meterYellow : CustomLookAndFeel::panelWhite);
+            g.drawText (juce::Time (callback.timeMs).formatted ("%H:%M:%S")
+                          + formatPercent (callback.utilisation).paddedLeft (' ', 9)
+                          + (juce::String (juce::roundToInt (callback.elapsedUs)) + "/"
+                               + juce::String (juce::roundToInt (callback.budgetUs))).paddedLeft (' ', 18)
+                          + juce::String (config.blockSize).paddedLeft (' ', 7)
+                          + juce::String (config.sampleRate / 1000.0, 1).paddedLeft (' ', 8)
+                          + "  " + juce::String (config.model).paddedRight (' ', 11)
+                          + config.headphoneEQ
+                          + (config.userIR ? " +IR" : "")
+                          + (juce::String (config.quality) != QualityGovernor::getTierName (QualityGovernor::fullQuality)
+                               ? ", " + juce::String (config.quality) : juce::String())
+                          + (config.bypassed ? " (bypassed)" : ""),
+                        area.removeFromTop (rowHeight), juce::Justification::centredLeft);
+        }
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced (padding).removeFromBottom (buttonHeight);
+        saveButton.setBounds (area.removeFromRight (70));
+        area.removeFromRight (padding);
+        resetButton.setBounds (area.removeFromRight (70));
+    }
+
+    void visibilityChanged() override
+    {
+        if (isVisible())
+            startTimerHz (4);
+        else
+            stopTimer();
+    }
+
+    /** Height that fits the summary, histogram, worst callbacks and buttons. */
+    static int getPreferredHeight()
+    {
+        return 2 * padding + (4 + CallbackMonitor::numWorst) * rowHeight + padding + histogramHeight
+                 + padding + buttonHeight;
+    }
+
+private:
+    void timerCallback() override { repaint(); }
+
+    // Bars scaled to the fullest bin; threshold lines in yellow, the budget in red
+    void paintHistogram (juce::Graphics& g, juce::Rectangle<float> area, const juce::Array<float>& thresholds)
+    {
+        g.setColour (CustomLookAndFeel::panelWhite.withAlpha (0.15f));
+        g.fillRect (area);
+
+        juce::int64 fullest = 1;
+
+        for (int i = 0; i < CallbackMonitor::numBins; ++i)
+            fullest = juce::jmax (fullest, monitor.getBinCount (i));
+
+        const auto binWidth = area.getWidth() / static_cast<float> (CallbackMonitor::numBins);
+
+        auto utilisationToX = [area, binWidth] (double utilisation)
+        {
+            return area.getX() + static_cast<float> (utilisation / CallbackMonitor::binWidth) * binWidth;
+        };
+
+        g.setColour (CustomLookAndFeel::panelWhite);
+
+        for (int i = 0; i < CallbackMonitor::numBins; ++i)
+        {
+            const auto count = monitor.getBinCount (i);
+
+            if (count == 0)
+                continue;
+
+            // Log scale, so a handful of slow callbacks still shows next to millions of normal ones
+            const auto height = area.getHeight() * static_cast<float> (std::log1p (static_cast<double> (count))
+                                                                        / std::log1p (static_cast<double> (fullest)));
+            g.fillRect (area.getX() + static_cast<float> (i) * binWidth + 1.0f, area.getBottom() - height,
+                        binWidth - 2.0f, height);
+        }
+
+        g.setColour (CustomLookAndFeel::meterYellow);
+
+        for (auto threshold : thresholds)
+            g.drawVerticalLine (juce::roundToInt (utilisationToX (threshold)), area.getY(), area.getBottom());
+
+        g.setColour (CustomLookAndFeel::accentRed);
+        g.drawVerticalLine (juce::roundToInt (utilisationToX (1.0)), area.getY(), area.getBottom());
+    }
+
+    void saveToFile()
+    {
+        chooser = std::make_unique<juce::FileChooser> ("Save diagnostics",
+                                                       juce::File::getSpecialLocation (juce::File::userDocumentsDirectory)
+                                                           .getChildFile ("earfix-diagnostics.json"),
+                                                       "*.json");
+
+        chooser->launchAsync (juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                                | juce::FileBrowserComponent::warnAboutOverwriting,
+                              [this] (const juce::FileChooser& fc)
+        {
+            auto file = fc.getResult();
+
+            if (file == juce::File())
+                return;
+
+            auto result = writeDump (file);
+
+            if (result.failed())
+                juce::AlertWindow::showMessageBoxAsync (juce::MessageBoxIconType::WarningIcon,
+                                                        "Diagnostics", result.getErrorMessage());
+        });
+    }
+
+    static constexpr int padding = 8;
+    static constexpr int rowHeight = 15;
+    static constexpr int histogramHeight = 40;
+    static constexpr int buttonHeight = 22;
+
+    CallbackMonitor& monitor;
+    std::function<juce::Result (const juce::File&)> writeDump;
+    juce::TextButton resetButton { "Reset" };
+    juce::TextButton saveButton { "Save..." };
+    std::unique_ptr<juce::FileChooser> chooser;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CallbackMonitorPanel)
+};
@@ -0,0 +1,376 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.cpp
+    Debug checker for allocation, locking and file access in the audio callback
+
+  ==============================================================================
+*/
+
+// The file-access hooks define open() and fopen(), which glibc's fortified
+// headers provide as inline wrappers
+#if defined (__linux__) && defined (EARFIX_RT_CHECKS) && EARFIX_RT_CHECKS
+ #undef _FORTIFY_SOURCE
+#endif
+
+#include "RealtimeSafety.h"
+
+#if EARFIX_RT_CHECKS
+
+#include <new>
+#include <cstdarg>
+#include <cstdio>
+
+#if JUCE_LINUX || JUCE_MAC
+ #include <dlfcn.h>
+ #include <execinfo.h>
+ #include <fcntl.h>
+ #include <pthread.h>
+ #define EARFIX_RT_CHECKS_INTERPOSE 1
+#elif JUCE_WINDOWS
+ extern "C" __declspec (dllimport) unsigned short __stdcall RtlCaptureStackBackTrace (unsigned long, unsigned long, void**, unsigned long*);
+#endif
+
+//==============================================================================
+namespace
+{
+    thread_local int contextDepth = 0;
+    thread_local bool insideCheck = false;      // Reporting itself may allocate or lock
+
+    constexpr int maxRecords = 256;
+    constexpr int maxFrames = 32;
+
+    struct Record
+    {
+        std::atomic<bool> ready { false };
+        RealtimeSafety::ViolationType type = RealtimeSafety::ViolationType::Allocation;
+        char detail[160] {};
+        void* frames[maxFrames] {};
+        int numFrames = 0;
+    };
+
+    std::array<Record, maxRecords> records;
+    std::atomic<int> numViolations { 0 };
+
+    int captureStack (void** frames, int maxNumFrames) noexcept
+    {
+       #if EARFIX_RT_CHECKS_INTERPOSE
+        return backtrace (frames, maxNumFrames);
+       #elif JUCE_WINDOWS
+        return static_cast<int> (RtlCaptureStackBackTrace (0, static_cast<unsigned long> (maxNumFrames), frames, nullptr));
+       #else
+        juce::ignoreUnused (frames, maxNumFrames);
+        return 0;
+       #endif
+    }
+
+    // Called from the hooks on every thread: must not allocate, lock or throw
+    void report (RealtimeSafety::ViolationType type, const char* format, ...) noexcept
+    {
+        if (contextDepth == 0 || insideCheck)
+            return;
+
+        insideCheck = true;
+        const int index = numViolations.fetch_add (1, std::memory_order_relaxed);
+
+        if (index < maxRecords)
+        {
+            auto& record = records[static_cast<size_t> (index)];
+            record.type = type;
+
+            va_list args;
+            va_start (args, format);
+            std::vsnprintf (record.detail, sizeof (record.detail), format, args);
+            va_end (args);
+
+            record.numFrames = captureStack (record.frames, maxFrames);
+            record.ready.store (true, std::memory_order_release);
+        }
+
+        insideCheck = false;
+    }
+
+    // Warm up backtrace() (it loads the unwinder on first use) before any callback runs
+    struct StackCaptureInitialiser
+    {
+        StackCaptureInitialiser()
+        {
+            void* frames[4];
+            captureStack (frames, 4);
+        }
+    };
+
+    const StackCaptureInitialiser stackCaptureInitialiser;
+}
+
+//==============================================================================
+RealtimeSafety::ScopedContext::ScopedContext() noexcept   { ++contextDepth; }
+RealtimeSafety::ScopedContext::~ScopedContext() noexcept  { --contextDepth; }
+
+int RealtimeSafety::getNumViolations() noexcept
+{
+    return numViolations.load (std::memory_order_relaxed);
+}
+
+void RealtimeSafety::clear() noexcept
+{
+    for (auto& record : records)
+        record.ready.store (false, std::memory_order_relaxed);
+
+    numViolations.store (0, std::memory_order_release);
+}
+
+std::vector<RealtimeSafety::Violation> RealtimeSafety::getViolations()
+{
+    const juce::ScopedValueSetter<bool> notAViolation (insideCheck, true);
+
+    std::vector<Violation> violations;
+    std::vector<const Record*> firstRecords;
+
+    const int numStored = juce::jmin (maxRecords, getNumViolations());
+
+    for (int i = 0; i < numStored; ++i)
+    {
+        const auto& record = records[static_cast<size_t> (i)];
+
+        if (! record.ready.load (std::memory_order_acquire))
+            continue;
+
+        auto sameSite = [&record] (const Record* other)
+        {
+            return other->type == record.type && other->numFrames == record.numFrames
+                && std::equal (record.frames, record.frames + record.numFrames, other->frames);
+        };
+
+        auto existing = std::find_if (firstRecords.begin(), firstRecords.end(), sameSite);
+
+        if (existing != firstRecords.end())
+        {
+            ++violations[static_cast<size_t> (std::distance (firstRecords.begin(), existing))].count;
+            continue;
+        }
+
+        Violation violation;
+        violation.type = record.type;
+        violation.detail = juce::String::fromUTF8 (record.detail);
+        violation.count = 1;
+
+       #if EARFIX_RT_CHECKS_INTERPOSE
+        if (auto* symbols = backtrace_symbols (record.frames, record.numFrames))
+        {
+            for (int frame = 0; frame < record.numFrames; ++frame)
+                violation.stack.add (juce::String::fromUTF8 (symbols[frame]));
+
+            std::free (symbols);
+        }
+       #else
+        for (int frame = 0; frame < record.numFrames; ++frame)
+            violation.stack.add ("0x" + juce::String::toHexString (static_cast<juce::int64> (reinterpret_cast<juce::pointer_sized_int> (record.frames[frame]))));
+       #endif
+
+        firstRecords.push_back (&record);
+        violations.push_back (std::move (violation));
+    }
+
+    return violations;
+}
+
+juce::String RealtimeSafety::getTypeName (ViolationType type)
+{
+    switch (type)
+    {
+        case ViolationType::Allocation:     return "allocation";
+        case ViolationType::Deallocation:   return "deallocation";
+        case ViolationType::Lock:           return "lock";
+        case ViolationType::FileAccess:     return "file access";
+    }
+
+    return {};
+}
+
+juce::String RealtimeSafety::describe (const Violation& violation)
+{
+    auto text = getTypeName (violation.type) + " (" + violation.detail + ")";
+
+    if (violation.count > 1)
+        text << " x" << violation.count;
+
+    for (auto& frame : violation.stack)
+        text << "\n    " << frame;
+
+    return text;
+}
+
+//==============================================================================
+// Allocation: replacing the global operators catches every C++ allocation in
+// this image (the whole program for the tools, the plugin's own code in a host)
+void* operator new (std::size_t size)
+{
+    report (RealtimeSafety::ViolationType::Allocation, "%zu bytes", size);
+
+    if (auto* p = std::malloc (size > 0 ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)
+{
+    report (RealtimeSafety::ViolationType::Allocation, "%zu bytes", size);
+
+    if (auto* p = std::malloc (size > 0 ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    report (RealtimeSafety::ViolationType::Allocation, "%zu bytes", size);
+    return std::malloc (size > 0 ? size : 1);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    report (RealtimeSafety::ViolationType::Allocation, "%zu bytes", size);
+    return std::malloc (size > 0 ? size : 1);
+}
+
+void operator delete (void* p) noexcept
+{
+    if (p != nullptr)
+        report (RealtimeSafety::ViolationType::Deallocation, "%p", p);
+
+    std::free (p);
+}
+
+void operator delete[] (void* p) noexcept
+{
+    if (p != nullptr)
+        report (RealtimeSafety::ViolationType::Deallocation, "%p", p);
+
+    std::free (p);
+}
+
+void operator delete (void* p, std::size_t) noexcept     { operator delete (p); }
+void operator delete[] (void* p, std::size_t) noexcept   { operator delete[] (p); }
+
+//==============================================================================
+// Locks and file access: interposed C library functions
+#if EARFIX_RT_CHECKS_INTERPOSE
+
+#if JUCE_LINUX
+
+namespace
+{
+    // The C library's definitions, which the ones below replace. Resolved up front
+    // rather than on first use, which could be inside a callback.
+    using MutexLockFunction = int (*) (pthread_mutex_t*);
+    using OpenFunction = int (*) (const char*, int, ...);
+    using FopenFunction = FILE* (*) (const char*, const char*);
+
+    template <typename Function>
+    Function getNext (const char* name) noexcept
+    {
+        return reinterpret_cast<Function> (dlsym (RTLD_NEXT, name));
+    }
+
+    const auto nextMutexLock = getNext<MutexLockFunction> ("pthread_mutex_lock");
+    const auto nextOpen      = getNext<OpenFunction> ("open");
+    const auto nextOpen64    = getNext<OpenFunction> ("open64");
+    const auto nextFopen     = getNext<FopenFunction> ("fopen");
+    const auto nextFopen64   = getNext<FopenFunction> ("fopen64");
+
+    mode_t getOpenMode (int flags, va_list args) noexcept
+    {
+        return (flags & O_CREAT) != 0 ? static_cast<mode_t> (va_arg (args, int)) : 0;
+    }
+}
+
+extern "C" int pthread_mutex_lock (pthread_mutex_t* mutex) noexcept
+{
+    report (RealtimeSafety::ViolationType::Lock, "mutex %p", static_cast<void*> (mutex));
+    return (nextMutexLock != nullptr ? nextMutexLock : getNext<MutexLockFunction> ("pthread_mutex_lock")) (mutex);
+}
+
+extern "C" int open (const char* path, int flags, ...)
+{
+    va_list args;
+    va_start (args, flags);
+    const auto mode = getOpenMode (flags, args);
+    va_end (args);
+
+    report (RealtimeSafety::ViolationType::FileAccess, "open %s", path);
+    return (nextOpen != nullptr ? nextOpen : getNext<OpenFunction> ("open")) (path, flags, mode);
+}
+
+extern "C" int open64 (const char* path, int flags, ...)
+{
+    va_list args;
+    va_start (args, flags);
+    const auto mode = getOpenMode (flags, args);
+    va_end (args);
+
+    report (RealtimeSafety::ViolationType::FileAccess, "open %s", path);
+    return (nextOpen64 != nullptr ? nextOpen64 : getNext<OpenFunction> ("open64")) (path, flags, mode);
+}
+
+extern "C" FILE* fopen (const char* path, const char* mode)
+{
+    report (RealtimeSafety::ViolationType::FileAccess, "fopen %s", path);
+    return (nextFopen != nullptr ? nextFopen : getNext<FopenFunction> ("fopen")) (path, mode);
+}
+
+extern "C" FILE* fopen64 (const char* path, const char* mode)
+{
+    report (RealtimeSafety::ViolationType::FileAccess, "fopen %s", path);
+    return (nextFopen64 != nullptr ? nextFopen64 : getNext<FopenFunction> ("fopen64")) (path, mode);
+}
+
+#else
+
+namespace
+{
+    // dyld interposing: calls from other images go to these; calls from here reach the originals
+    int checkedMutexLock (pthread_mutex_t* mutex)
+    {
+        report (RealtimeSafety::ViolationType::Lock, "mutex %p", static_cast<void*> (mutex));
+        return pthread_mutex_lock (mutex);
+    }
+
+    int checkedOpen (const char* path, int flags, ...)
+    {
+        va_list args;
+        va_start (args, flags);
+        const auto mode = (flags & O_CREAT) != 0 ? static_cast<mode_t> (va_arg (args, int)) : mode_t (0);
+        va_end (args);
+
+        report (RealtimeSafety::ViolationType::FileAccess, "open %s", path);
+        return open (path, flags, mode);
+    }
+
+    FILE* checkedFopen (const char* path, const char* mode)
+    {
+        report (RealtimeSafety::ViolationType::FileAccess, "fopen %s", path);
+        return fopen (path, mode);
+    }
+
+    struct Interpose
+    {
+        const void* replacement;
+        const void* original;
+    };
+
+    __attribute__ ((used, section ("__DATA,__interpose")))
+    const Interpose interposers[] = {
+        { reinterpret_cast<const void*> (&checkedMutexLock), reinterpret_cast<const void*> (&pthread_mutex_lock) },
+        { reinterpret_cast<const void*> (&checkedOpen),      reinterpret_cast<const void*> (&open) },
+        { reinterpret_cast<const void*> (&checkedFopen),     reinterpret_cast<const void*> (&fopen) }
+    };
+}
+
+#endif
+
+#endif // EARFIX_RT_CHECKS_INTERPOSE
+
+#endif // EARFIX_RT_CHECKS
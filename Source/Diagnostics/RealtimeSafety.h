@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.h
+    Debug checker for allocation, locking and file access in the audio callback
+
+    Build with EARFIX_RT_CHECKS=1 (debug builds; not for release) to check
+    that nothing under processBlock() allocates, blocks on a mutex or opens
+    a file. processBlock() marks its thread as "in the audio callback" for
+    its duration, and while a thread is marked these are recorded as
+    violations, each with the call stack it came from:
+
+      allocation    global operator new / delete (all C++ allocations:
+                    containers, juce::String, reference-counted objects)
+      lock          pthread_mutex_lock (juce::CriticalSection, std::mutex,
+                    juce::WaitableEvent); try-locks are allowed
+      file access   open / fopen
+
+    Allocations are caught everywhere. The lock and file hooks interpose
+    the C library functions, so they need Linux or macOS; on macOS the
+    dynamic linker only honours them for the image they are linked into,
+    which for the command-line tools is the whole program. EarFixRender's
+    --golden-check fails if any case records a violation.
+
+    With the flag at its default of 0 nothing here is compiled in.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef EARFIX_RT_CHECKS
+ #define EARFIX_RT_CHECKS 0
+#endif
+
+//==============================================================================
+struct RealtimeSafety
+{
+    enum class ViolationType
+    {
+        Allocation,
+        Deallocation,
+        Lock,
+        FileAccess
+    };
+
+    // One distinct violation: every recorded occurrence with the same type and call stack
+    struct Violation
+    {
+        ViolationType type;
+        juce::String detail;            // Size, mutex address or path of the first occurrence
+        juce::StringArray stack;        // Symbolised frames, innermost first
+        int count = 0;
+    };
+
+    /** Marks the calling thread as inside the audio callback for its lifetime. Nestable. */
+    class ScopedContext
+    {
+    public:
+        ScopedContext() noexcept;
+        ~ScopedContext() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedContext)
+    };
+
+    /** True in EARFIX_RT_CHECKS builds. */
+    static constexpr bool isEnabled() { return EARFIX_RT_CHECKS != 0; }
+
+    /** Every violation since the last clear(), including any beyond the stored ones. */
+    static int getNumViolations() noexcept;
+
+    /** The stored violations, merged by type and stack. Allocates: not for the audio thread. */
+    static std::vector<Violation> getViolations();
+
+    /** Forgets all violations. Call while no thread is inside a ScopedContext. */
+    static void clear() noexcept;
+
+    static juce::String getTypeName (ViolationType type);
+
+    /** Type, detail, count and stack, one frame per line. */
+    static juce::String describe (const Violation& violation);
+};
+
+#if EARFIX_RT_CHECKS
+ #define EARFIX_REALTIME_CONTEXT() \
+    const RealtimeSafety::ScopedContext JUCE_JOIN_MACRO (realtimeContext_, __LINE__)
+#else
+ #define EARFIX_REALTIME_CONTEXT()
+#endif
@@ -0,0 +1,311 @@
+/*
+  ==============================================================================
+
+    StageTimings.h
+    Optional per-stage CPU timing of processBlock()
+
+    Build with EARFIX_STAGE_TIMING=1 (Projucer: Preprocessor Definitions) to
+    time each stage of processBlock() with the CPU's cycle counter (rdtsc on
+    x86, the virtual counter on arm64). With the flag at its default of 0 the
+    processor has no StageTimings member and EARFIX_TIME_STAGE expands to
+    nothing (or, in EARFIX_TRACING builds, only to a trace scope), so a
+    normal build pays nothing.
+
+    Each stage keeps a count, sum, min and max and a log2 histogram (four
+    bins per octave) that gives an approximate p99. Only the audio thread
+    writes, so every counter is a relaxed atomic with no read-modify-write;
+    readers (the diagnostics panel, a dump to file) may see a block's update
+    half applied, which only ever skews one sample. A reset is requested
+    from any thread and carried out by the audio thread at the start of its
+    next block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TraceRecorder.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+#ifndef EARFIX_STAGE_TIMING
+ #define EARFIX_STAGE_TIMING 0
+#endif
+
+//==============================================================================
+enum class ProcessingStage
+{
+    InputMeter,     // Input level metering
+    HeadphoneEQ,    // Headphone correction (parametric or FIR)
+    UserIR,         // Per-ear impulse responses
+    Parameters,     // Model and WDRC coefficient updates
+    Loudness,       // Specific-loudness analysis (MOSL Loudness)
+    Crossover,      // Linkwitz-Riley band split
+    WDRC,           // Per-band envelope, gain and band sum
+    OutputGain,     // Output gain ramp
+    Limiter,        // Output lookahead limiter
+    OutputMeter,    // Output level metering
+    Total,          // The whole of processBlock()
+    numStages
+};
+
+//==============================================================================
+class StageTimings
+{
+public:
+    static constexpr int numStages = static_cast<int> (ProcessingStage::numStages);
+
+    struct Statistics
+    {
+        juce::int64 count = 0;
+        double minNs = 0.0, meanNs = 0.0, p99Ns = 0.0, maxNs = 0.0;
+    };
+
+    StageTimings()
+        : startTicks (readCounter()),
+          startSeconds (juce::Time::getMillisecondCounterHiRes() * 0.001)
+    {
+        clear();
+    }
+
+    //==========================================================================
+    /** Current value of the counter the stages are timed with. */
+    static inline juce::uint64 readCounter() noexcept
+    {
+       #if JUCE_INTEL
+        return static_cast<juce::uint64> (__rdtsc());
+       #elif JUCE_ARM && JUCE_64BIT && ! JUCE_MSVC
+        juce::uint64 value;
+        asm volatile ("mrs %0, cntvct_el0" : "=r" (value));
+        return value;
+       #else
+        return static_cast<juce::uint64> (juce::Time::getHighResolutionTicks());
+       #endif
+    }
+
+    /** Audio thread: call at the start of every block. Carries out a pending reset. */
+    void beginBlock() noexcept
+    {
+        if (resetRequested.exchange (false, std::memory_order_acquire))
+            clear();
+    }
+
+    /** Audio thread: adds one measurement (counter ticks) to a stage. */
+    void record (ProcessingStage stage, juce::uint64 ticks) noexcept
+    {
+        auto& s = stages[static_cast<size_t> (stage)];
+        const auto count = s.count.load (std::memory_order_relaxed);
+
+        s.count.store (count + 1, std::memory_order_relaxed);
+        s.sum.store (s.sum.load (std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+
+        if (ticks < s.min.load (std::memory_order_relaxed))
+            s.min.store (ticks, std::memory_order_relaxed);
+
+        if (ticks > s.max.load (std::memory_order_relaxed))
+            s.max.store (ticks, std::memory_order_relaxed);
+
+        auto& bin = s.histogram[static_cast<size_t> (getBin (ticks))];
+        bin.store (bin.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    /** Any thread: clears every stage before the audio thread's next block. */
+    void requestReset() noexcept { resetRequested.store (true, std::memory_order_release); }
+
+    //==========================================================================
+    /** Any thread: the statistics so far for one stage. */
+    Statistics getStatistics (ProcessingStage stage) const
+    {
+        const auto& s = stages[static_cast<size_t> (stage)];
+        Statistics result;
+        result.count = static_cast<juce::int64> (s.count.load (std::memory_order_relaxed));
+
+        if (result.count == 0)
+            return result;
+
+        const auto nsPerTick = 1.0e9 / getTicksPerSecond();
+        result.minNs = static_cast<double> (s.min.load (std::memory_order_relaxed)) * nsPerTick;
+        result.maxNs = static_cast<double> (s.max.load (std::memory_order_relaxed)) * nsPerTick;
+        result.meanNs = static_cast<double> (s.sum.load (std::memory_order_relaxed)) * nsPerTick
+                          / static_cast<double> (result.count);
+
+        // p99: the bin holding the 99th percentile, at its centre, clamped to what was seen
+        const auto rank = static_cast<juce::uint64> (std::ceil (0.99 * static_cast<double> (result.count)));
+        juce::uint64 seen = 0;
+
+        for (int i = 0; i < numBins; ++i)
+        {
+            seen += s.histogram[static_cast<size_t> (i)].load (std::memory_order_relaxed);
+
+            if (seen >= rank)
+            {
+                const auto centre = 0.5 * (getBinStart (i) + getBinStart (i + 1)) * nsPerTick;
+                result.p99Ns = juce::jlimit (result.minNs, result.maxNs, centre);
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    /** Counter ticks per second: measured against the hi-res clock since construction. */
+    double getTicksPerSecond() const
+    {
+       #if ! (JUCE_INTEL || (JUCE_ARM && JUCE_64BIT && ! JUCE_MSVC))
+        return static_cast<double> (juce::Time::getHighResolutionTicksPerSecond());
+       #else
+        const auto elapsedSeconds = juce::Time::getMillisecondCounterHiRes() * 0.001 - startSeconds;
+        const auto elapsedTicks = static_cast<double> (readCounter() - startTicks);
+        return elapsedSeconds > 0.0 && elapsedTicks > 0.0 ? elapsedTicks / elapsedSeconds : 1.0e9;
+       #endif
+    }
+
+    static const char* getStageName (ProcessingStage stage)
+    {
+        switch (stage)
+        {
+            case ProcessingStage::InputMeter:   return "inputMeter";
+            case ProcessingStage::HeadphoneEQ:  return "headphoneEQ";
+            case ProcessingStage::UserIR:       return "userIR";
+            case ProcessingStage::Parameters:   return "parameters";
+            case ProcessingStage::Loudness:     return "loudness";
+            case ProcessingStage::Crossover:    return "crossover";
+            case ProcessingStage::WDRC:         return "wdrc";
+            case ProcessingStage::OutputGain:   return "outputGain";
+            case ProcessingStage::Limiter:      return "limiter";
+            case ProcessingStage::OutputMeter:  return "outputMeter";
+            case ProcessingStage::Total:        return "processBlock";
+            case ProcessingStage::numStages:    break;
+        }
+
+        return "";
+    }
+
+    //==========================================================================
+    /** Every stage's statistics, in the same shape as EarFixBench's reports. */
+    juce::var toVar() const
+    {
+        auto* root = new juce::DynamicObject();
+        root->setProperty ("ticksPerSecond", getTicksPerSecond());
+
+        juce::Array<juce::var> results;
+
+        for (int i = 0; i < numStages; ++i)
+        {
+            const auto stage = static_cast<ProcessingStage> (i);
+            const auto stats = getStatistics (stage);
+
+            auto* result = new juce::DynamicObject();
+            result->setProperty ("name", getStageName (stage));
+            result->setProperty ("count", stats.count);
+            result->setProperty ("minNs", stats.minNs);
+            result->setProperty ("meanNs", stats.meanNs);
+            result->setProperty ("p99Ns", stats.p99Ns);
+            result->setProperty ("maxNs", stats.maxNs);
+            results.add (juce::var (result));
+        }
+
+        root->setProperty ("stages", results);
+        return juce::var (root);
+    }
+
+    /** Writes toVar() as JSON, e.g. when the diagnostics panel's Save button is pressed. */
+    juce::Result writeToFile (const juce::File& file) const
+    {
+        if (! file.replaceWithText (juce::JSON::toString (toVar())))
+            return juce::Result::fail ("Can't write " + file.getFullPathName());
+
+        return juce::Result::ok();
+    }
+
+private:
+    //==========================================================================
+    // Four bins per octave from 4 ticks up to 2^32 ticks; the last bin also takes anything longer
+    static constexpr int numBins = 128;
+
+    static int getBin (juce::uint64 ticks) noexcept
+    {
+        if (ticks < 4)
+            return static_cast<int> (ticks);
+
+        if (ticks > 0xffffffffull)
+            return numBins - 1;
+
+        const auto octave = juce::findHighestSetBit (static_cast<juce::uint32> (ticks));
+        return octave * 4 + static_cast<int> ((ticks >> (octave - 2)) & 3);
+    }
+
+    static double getBinStart (int bin) noexcept
+    {
+        if (bin < 8)
+            return bin < 4 ? static_cast<double> (bin) : 4.0;
+
+        return static_cast<double> (4 + (bin & 3)) * std::exp2 (static_cast<double> ((bin >> 2) - 2));
+    }
+
+    struct Stage
+    {
+        std::atomic<juce::uint64> count { 0 }, sum { 0 }, min { 0 }, max { 0 };
+        std::array<std::atomic<juce::uint64>, numBins> histogram {};
+    };
+
+    void clear() noexcept
+    {
+        for (auto& s : stages)
+        {
+            s.count.store (0, std::memory_order_relaxed);
+            s.sum.store (0, std::memory_order_relaxed);
+            s.min.store (std::numeric_limits<juce::uint64>::max(), std::memory_order_relaxed);
+            s.max.store (0, std::memory_order_relaxed);
+
+            for (auto& bin : s.histogram)
+                bin.store (0, std::memory_order_relaxed);
+        }
+    }
+
+    std::array<Stage, numStages> stages;
+    std::atomic<bool> resetRequested { false };
+
+    const juce::uint64 startTicks;
+    const double startSeconds;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StageTimings)
+};
+
+//==============================================================================
+/** Times the enclosing scope into one stage. Use through EARFIX_TIME_STAGE. */
+class ScopedStageTimer
+{
+public:
+    ScopedStageTimer (StageTimings& timingsToUse, ProcessingStage stageToTime) noexcept
+        : timings (timingsToUse), stage (stageToTime), start (StageTimings::readCounter())
+    {
+    }
+
+    ~ScopedStageTimer() noexcept { timings.record (stage, StageTimings::readCounter() - start); }
+
+private:
+    StageTimings& timings;
+    const ProcessingStage stage;
+    const juce::uint64 start;
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedStageTimer)
+};
+
+// Times the rest of the scope into a stage, and/or traces it (EARFIX_TRACING), or does nothing
+#if EARFIX_STAGE_TIMING
+ #define EARFIX_STAGE_TIMER_(timings, stage) \
+    const ScopedStageTimer JUCE_JOIN_MACRO (stageTimer_, __LINE__) (timings, ProcessingStage::stage);
+#else
+ #define EARFIX_STAGE_TIMER_(timings, stage)
+#endif
+
+#define EARFIX_TIME_STAGE(timings, stage) \
+    EARFIX_STAGE_TIMER_ (timings, stage) EARFIX_TRACE_SCOPE (StageTimings::getStageName (ProcessingStage::stage))
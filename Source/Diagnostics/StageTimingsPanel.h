@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    StageTimingsPanel.h
+    Hidden editor overlay showing the per-stage processBlock() timings
+
+    Only built with EARFIX_STAGE_TIMING=1. The editor toggles it with
+    Cmd/Ctrl+Shift+D; it refreshes a few times a second, and can reset the
+    counters or save them as JSON.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "StageTimings.h"
+#include "../CustomLookAndFeel.h"
+
+//==============================================================================
+class StageTimingsPanel  : public juce::Component,
+                           private juce::Timer
+{
+public:
+    explicit StageTimingsPanel (StageTimings& timingsToShow)
+        : timings (timingsToShow)
+    {
+        resetButton.onClick = [this]() { timings.requestReset(); };
+        addAndMakeVisible (resetButton);
+
+        saveButton.onClick = [this]() { saveToFile(); };
+        addAndMakeVisible (saveButton);
+    }
+
+    //==========================================================================
+    void paint (juce::Graphics& g) override
+    {
+        auto bounds = getLocalBounds().toFloat();
+        g.setColour (CustomLookAndFeel::textDark.withAlpha (0.92f));
+        g.fillRoundedRectangle (bounds, 6.0f);
+
+        auto area = getLocalBounds().reduced (padding);
+        area.removeFromBottom (buttonHeight + padding);
+
+        g.setFont (juce::FontOptions (juce::Font::getDefaultMonospacedFontName(), 11.0f, juce::Font::plain));
+        g.setColour (CustomLookAndFeel::panelWhite);
+        g.drawText ("STAGE              COUNT      MIN     MEAN      P99      MAX   (us)",
+                    area.removeFromTop (rowHeight), juce::Justification::centredLeft);
+
+        for (int i = 0; i < StageTimings::numStages; ++i)
+        {
+            const auto stage = static_cast<ProcessingStage> (i);
+            const auto stats = timings.getStatistics (stage);
+
+            auto formatUs = [] (double ns) { return juce::String (ns * 0.001, 2).paddedLeft (' ', 9); };
+
+            g.setColour (stage == ProcessingStage::Total ? CustomLookAndFeel::meterYellow
+                                                         : CustomLookAndFeel::panelWhite);
+            g.drawText (juce::String (StageTimings::getStageName (stage)).paddedRight (' ', 14)
+                          + juce::String (stats.count).paddedLeft (' ', 11)
+                          + formatUs (stats.minNs) + formatUs (stats.meanNs)
+                          + formatUs (stats.p99Ns) + formatUs (stats.maxNs),
+                        area.removeFromTop (rowHeight), juce::Justification::centredLeft);
+        }
+    }
+
+    void resized() override
+    {
+        auto area = getLocalBounds().reduced (padding).removeFromBottom (buttonHeight);
+        saveButton.setBounds (area.removeFromRight (70));
+        area.removeFromRight (padding);
+        resetButton.setBounds (area.removeFromRight (70));
+    }
+
+    void visibilityChanged() override
+    {
+        if (isVisible())
+            startTimerHz (4);
+        else
+            stopTimer();
+    }
+
+    /** Height that fits every stage plus the buttons. */
+    static int getPreferredHeight()
+    {
+        return 2 * padding + (StageTimings::numStages + 1) * rowHeight + padding + buttonHeight;
+    }
+
+private:
+    void timerCallback() override { repaint(); }
+
+    void saveToFile()
+    {
+        chooser = std::make_unique<juce::FileChooser> ("Save stage timings",
+                                                       juce::File::getSpecialLocation (juce::File::userDocumentsDirectory)
+                                                           .getChildFile ("earfix-stage-timings.json"),
+                                                       "*.json");
+
+        chooser->launchAsync (juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                                | juce::FileBrowserComponent::warnAboutOverwriting,
+                              [this] (const juce::FileChooser& fc)
+        {
+            auto file = fc.getResult();
+
+            if (file == juce::File())
+                return;
+
+            auto result = timings.writeToFile (file);
+
+            if (result.failed())
+                juce::AlertWindow::showMessageBoxAsync (juce::MessageBoxIconType::WarningIcon,
+                                                        "Stage timings", result.getErrorMessage());
+        });
+    }
+
+    static constexpr int padding = 8;
+    static constexpr int rowHeight = 15;
+    static constexpr int buttonHeight = 22;
+
+    StageTimings& timings;
+    juce::TextButton resetButton { "Reset" };
+    juce::TextButton saveButton { "Save..." };
+    std::unique_ptr<juce::FileChooser> chooser;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StageTimingsPanel)
+};
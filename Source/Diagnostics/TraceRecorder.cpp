@@ -0,0 +1,258 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.cpp
+    Optional Chrome trace-event recording of processing and background work
+
+  ==============================================================================
+*/
+
+#include "TraceRecorder.h"
+
+#if EARFIX_TRACING
+
+//==============================================================================
+TraceRecorder::TraceRecorder()
+    : juce::Thread ("EarFix trace writer")
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    // Every processor should have ended its session by now
+    jassert (numSessions == 0);
+    stopThread (2000);
+}
+
+TraceRecorder& TraceRecorder::getInstance()
+{
+    static TraceRecorder instance;
+    return instance;
+}
+
+juce::File TraceRecorder::getTraceFile() const
+{
+    const juce::ScopedLock sl (sessionLock);
+    return traceFile;
+}
+
+//==============================================================================
+void TraceRecorder::start()
+{
+    const juce::ScopedLock sl (sessionLock);
+
+    if (numSessions++ > 0)
+        return;
+
+    // Allocated once and kept: threads hold on to their buffer between sessions
+    if (buffers.empty())
+        for (int i = 0; i < maxThreads; ++i)
+            buffers.push_back (std::make_unique<ThreadBuffer>());
+
+    auto path = juce::SystemStats::getEnvironmentVariable ("EARFIX_TRACE_FILE", {});
+
+    traceFile = path.isNotEmpty() && juce::File::isAbsolutePath (path)
+                  ? juce::File (path)
+                  : juce::File::getSpecialLocation (juce::File::userDocumentsDirectory)
+                        .getChildFile ("EarFix Traces")
+                        .getChildFile ("earfix-trace-" + juce::Time::getCurrentTime().formatted ("%Y%m%d-%H%M%S") + ".json");
+
+    traceFile.getParentDirectory().createDirectory();
+    traceFile.deleteFile();
+    stream = std::make_unique<juce::FileOutputStream> (traceFile);
+
+    if (stream->failedToOpen())
+    {
+        DBG ("TraceRecorder: Can't write " + traceFile.getFullPathName());
+        stream.reset();
+        return;
+    }
+
+    // Every buffer goes back to the pool, so the threads recording in this session claim
+    // them again and those that have gone since the last one don't hold on to theirs. A
+    // thread still finishing an event of the last session is waited for; events recorded
+    // before this session (if any) are stale.
+    for (auto& buffer : buffers)
+    {
+        while (buffer->writing.load())
+            juce::Thread::yield();
+
+        buffer->named.store (false, std::memory_order_relaxed);
+        buffer->claimed.store (false, std::memory_order_relaxed);
+        buffer->readIndex.store (buffer->writeIndex.load (std::memory_order_acquire), std::memory_order_relaxed);
+        buffer->dropped.store (0, std::memory_order_relaxed);
+        buffer->nameWritten = false;
+    }
+
+    generation.fetch_add (1);
+
+    startTicks = juce::Time::getHighResolutionTicks();
+    microsecondsPerTick = 1.0e6 / static_cast<double> (juce::Time::getHighResolutionTicksPerSecond());
+    firstEvent = true;
+
+    *stream << "[\n";
+    recording.store (true);
+    startThread (juce::Thread::Priority::low);
+
+    DBG ("TraceRecorder: Recording to " + traceFile.getFullPathName());
+}
+
+void TraceRecorder::stop()
+{
+    const juce::ScopedLock sl (sessionLock);
+    jassert (numSessions > 0);
+
+    if (numSessions == 0 || --numSessions > 0)
+        return;
+
+    recording.store (false);
+    stopThread (2000);
+
+    if (stream != nullptr)
+    {
+        flush();
+        *stream << "\n]\n";
+        stream.reset();
+    }
+}
+
+//==============================================================================
+void TraceRecorder::record (const char* name, char phase) noexcept
+{
+    if (! recording.load (std::memory_order_relaxed))
+        return;
+
+    // Trivially destructible, so a thread's first event doesn't register a destructor (which allocates)
+    static thread_local ThreadBuffer* buffer = nullptr;
+    static thread_local juce::uint32 claimedGeneration = 0;
+
+    const auto currentGeneration = generation.load (std::memory_order_acquire);
+
+    if (claimedGeneration != currentGeneration)
+    {
+        buffer = claimBuffer();
+        claimedGeneration = currentGeneration;
+    }
+
+    if (buffer == nullptr)
+        return;
+
+    // start() waits for writing to clear before it hands the buffer out again; seen after
+    // that, the recording or generation check fails, so a buffer has one writer at a time
+    buffer->writing.store (true);
+
+    if (recording.load() && generation.load() == currentGeneration)
+    {
+        const auto write = buffer->writeIndex.load (std::memory_order_relaxed);
+
+        if (write - buffer->readIndex.load (std::memory_order_acquire) >= ThreadBuffer::capacity)
+        {
+            buffer->dropped.store (buffer->dropped.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        else
+        {
+            buffer->events[write & (ThreadBuffer::capacity - 1)] = { name, juce::Time::getHighResolutionTicks(), phase };
+            buffer->writeIndex.store (write + 1, std::memory_order_release);
+        }
+    }
+
+    buffer->writing.store (false, std::memory_order_release);
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::claimBuffer() noexcept
+{
+    int index = 0;
+    ThreadBuffer* buffer = nullptr;
+
+    for (; index < static_cast<int> (buffers.size()); ++index)
+    {
+        auto* candidate = buffers[static_cast<size_t> (index)].get();
+
+        if (bool expected = false; candidate->claimed.compare_exchange_strong (expected, true, std::memory_order_acq_rel))
+        {
+            buffer = candidate;
+            break;
+        }
+    }
+
+    // Too many threads: this one goes untraced until the next recording
+    if (buffer == nullptr)
+        return nullptr;
+
+    auto& name = buffer->threadName;
+
+    // Named without allocating: the audio thread may be the one claiming
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        std::snprintf (name, sizeof (name), "Message thread");
+    else if (auto* thread = juce::Thread::getCurrentThread())
+        std::snprintf (name, sizeof (name), "%s", thread->getThreadName().toRawUTF8());
+    else
+        std::snprintf (name, sizeof (name), "Host thread %d", index);
+
+    buffer->named.store (true, std::memory_order_release);
+    return buffer;
+}
+
+//==============================================================================
+void TraceRecorder::run()
+{
+    while (! threadShouldExit())
+    {
+        wait (100);
+        flush();
+    }
+}
+
+void TraceRecorder::flush()
+{
+    if (stream == nullptr)
+        return;
+
+    for (size_t i = 0; i < buffers.size(); ++i)
+    {
+        auto& buffer = *buffers[i];
+        const int threadId = static_cast<int> (i) + 1;
+
+        if (! buffer.named.load (std::memory_order_acquire))
+            continue;
+
+        if (! buffer.nameWritten)
+        {
+            *stream << (firstEvent ? "" : ",\n")
+                    << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadId
+                    << ",\"args\":{\"name\":" << juce::JSON::toString (juce::String::fromUTF8 (buffer.threadName)) << "}}";
+            firstEvent = false;
+            buffer.nameWritten = true;
+        }
+
+        const auto write = buffer.writeIndex.load (std::memory_order_acquire);
+        auto read = buffer.readIndex.load (std::memory_order_relaxed);
+
+        for (; read != write; ++read)
+            writeEvent (buffer.events[read & (ThreadBuffer::capacity - 1)], threadId);
+
+        buffer.readIndex.store (read, std::memory_order_release);
+
+        if (const auto dropped = buffer.dropped.exchange (0, std::memory_order_relaxed); dropped > 0)
+        {
+            *stream << ",\n{\"name\":\"dropped events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << threadId
+                    << ",\"ts\":" << juce::String (static_cast<double> (juce::Time::getHighResolutionTicks() - startTicks) * microsecondsPerTick, 3)
+                    << ",\"args\":{\"count\":" << static_cast<int> (dropped) << "}}";
+        }
+    }
+
+    stream->flush();
+}
+
+void TraceRecorder::writeEvent (const Event& event, int threadId)
+{
+    const auto timestamp = static_cast<double> (event.ticks - startTicks) * microsecondsPerTick;
+
+    *stream << (firstEvent ? "" : ",\n")
+            << "{\"name\":\"" << event.name << "\",\"ph\":\"" << juce::String::charToString (event.phase)
+            << "\",\"pid\":1,\"tid\":" << threadId << ",\"ts\":" << juce::String (timestamp, 3) << "}";
+
+    firstEvent = false;
+}
+
+#endif
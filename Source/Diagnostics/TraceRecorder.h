@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    TraceRecorder.h
+    Optional Chrome trace-event recording of processing and background work
+
+    Build with EARFIX_TRACING=1 to record begin/end events for the
+    processBlock() stages, headphone database and profile loads, filter and
+    FIR designs, IR loads, prepareToPlay() and editor paints. The file opens
+    in chrome://tracing or ui.perfetto.dev, one track per thread, so the
+    audio thread can be lined up against the host's callbacks and against
+    message-thread stalls. With the flag at its default of 0,
+    EARFIX_TRACE_SCOPE expands to nothing.
+
+    Each thread writes into its own ring buffer (single producer, single
+    consumer: no locks, no allocation); a background thread drains them
+    every 100 ms into the JSON file. Buffers are allocated once, on the
+    first start(), so the audio thread never allocates for tracing; a full
+    buffer drops events rather than wait, and the drop count is written
+    into the trace. Each recording hands the buffers out afresh: a thread
+    claims one with its first event, so threads that have exited since the
+    last recording don't keep theirs. Event names must be string literals - only the pointer
+    is stored.
+
+    Recording runs while any processor exists: the first one starts it, the
+    last one to go finishes the file. It's written to $EARFIX_TRACE_FILE if
+    that is set, otherwise to "EarFix Traces" in the user's documents.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef EARFIX_TRACING
+ #define EARFIX_TRACING 0
+#endif
+
+//==============================================================================
+class TraceRecorder  : private juce::Thread
+{
+public:
+    ~TraceRecorder() override;
+
+    /** The process-wide recorder (all processors and tools share one trace). */
+    static TraceRecorder& getInstance();
+
+    /** Starts recording if this is the first session; every start() needs a stop(). */
+    void start();
+
+    /** Ends a session; the last one flushes everything and closes the file. */
+    void stop();
+
+    /** Any thread: adds an event to the calling thread's buffer. Lock-free, never allocates.
+        phase is 'B' (begin) or 'E' (end); name must outlive the recorder.
+    */
+    void record (const char* name, char phase) noexcept;
+
+    /** The file being written, or the last one written. */
+    juce::File getTraceFile() const;
+
+    /** Holds a recording session for its lifetime. */
+    struct Session
+    {
+        Session()  { getInstance().start(); }
+        ~Session() { getInstance().stop(); }
+
+        JUCE_DECLARE_NON_COPYABLE (Session)
+    };
+
+private:
+    TraceRecorder();
+
+    struct Event
+    {
+        const char* name;
+        juce::int64 ticks;
+        char phase;
+    };
+
+    struct ThreadBuffer
+    {
+        static constexpr juce::uint32 capacity = 8192;     // Power of two
+
+        std::array<Event, capacity> events;
+        std::atomic<juce::uint32> writeIndex { 0 }, readIndex { 0 };
+        std::atomic<juce::uint32> dropped { 0 };
+        std::atomic<bool> claimed { false };
+        std::atomic<bool> named { false };                  // threadName is filled in (after claimed)
+        std::atomic<bool> writing { false };                // Set by the owner around each event
+        char threadName[64] {};
+        bool nameWritten = false;                           // Writer thread only
+    };
+
+    static constexpr int maxThreads = 32;
+
+    /** Takes a free buffer for the calling thread, or nullptr if all are taken. */
+    ThreadBuffer* claimBuffer() noexcept;
+
+    void run() override;
+    void flush();
+    void writeEvent (const Event& event, int threadId);
+
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::atomic<juce::uint32> generation { 0 };             // Counts recordings; claims are for one
+    std::atomic<bool> recording { false };
+
+    juce::CriticalSection sessionLock;                      // Message / worker threads only
+    int numSessions = 0;
+
+    juce::File traceFile;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    juce::int64 startTicks = 0;
+    double microsecondsPerTick = 1.0;
+    bool firstEvent = true;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TraceRecorder)
+};
+
+//==============================================================================
+/** Records a begin event now and the matching end event when it goes out of scope. */
+class ScopedTraceEvent
+{
+public:
+    explicit ScopedTraceEvent (const char* eventName) noexcept
+        : name (eventName)
+    {
+        TraceRecorder::getInstance().record (name, 'B');
+    }
+
+    ~ScopedTraceEvent() noexcept { TraceRecorder::getInstance().record (name, 'E'); }
+
+private:
+    const char* const name;
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedTraceEvent)
+};
+
+#if EARFIX_TRACING
+ #define EARFIX_TRACE_SCOPE(name) \
+    const ScopedTraceEvent JUCE_JOIN_MACRO (traceEvent_, __LINE__) (name)
+#else
+ #define EARFIX_TRACE_SCOPE(name)
+#endif
@@ -8,6 +8,7 @@
 */
 
 #include "HeadphoneEQ.h"
+#include "Diagnostics/TraceRecorder.h"
 
 //==============================================================================
 HeadphoneEQ::HeadphoneEQ()
@@ -34,9 +35,15 @@ juce::File HeadphoneEQ::getHeadphonesDirectory()
 //==============================================================================
 void HeadphoneEQ::loadDatabase()
 {
+    EARFIX_TRACE_SCOPE ("headphoneDatabaseLoad");
     availableHeadphones.clear();
     databaseVersion = "No database";
 
+    {
+        const juce::ScopedLock sl (publishLock);
+        coefficientCache.clear();
+    }
+
     auto dir = getHeadphonesDirectory();
     if (!dir.exists())
     {
@@ -110,6 +117,7 @@ void HeadphoneEQ::parseIndexJSON (const juce::File& indexFile)
 //==============================================================================
 bool HeadphoneEQ::loadProfile (const juce::String& headphoneName)
 {
+    EARFIX_TRACE_SCOPE ("headphoneProfileLoad");
     if (headphoneName.isEmpty())
     {
         clearProfile();
@@ -142,27 +150,39 @@ bool HeadphoneEQ::loadProfile (const juce::String& headphoneName)
         return false;
     }
 
-    currentProfile = parseProfileJSON (profileFile);
+    auto profile = parseProfileJSON (profileFile);
 
-    if (!currentProfile.isValid())
+    if (!profile.isValid())
     {
         DBG ("HeadphoneEQ: Failed to parse profile: " + headphoneName);
+        clearProfile();
         return false;
     }
 
-    updateFilterCoefficients();
-    DBG ("HeadphoneEQ: Loaded profile: " + currentProfile.name + " with " +
-         juce::String (currentProfile.filters.size()) + " filters");
+    DBG ("HeadphoneEQ: Loaded profile: " + profile.name + " with " +
+         juce::String (profile.filters.size()) + " filters");
 
+    setProfile (std::move (profile));
     return true;
 }
 
+void HeadphoneEQ::setProfile (HeadphoneProfile profile)
+{
+    if (!profile.isValid())
+        profile = HeadphoneProfile();
+
+    // Hosts may restore state on any thread while the timer changes the section budget
+    const juce::ScopedLock sl (publishLock);
+    currentProfile = std::move (profile);
+    publishFilterSet();
+}
+
 //==============================================================================
 void HeadphoneEQ::clearProfile()
 {
+    const juce::ScopedLock sl (publishLock);
     currentProfile = HeadphoneProfile();
-    activeFilterCount = 0;
-    preampGain = 1.0f;
+    publishFilterSet();
 }
 
 //==============================================================================
@@ -190,16 +210,40 @@ HeadphoneProfile HeadphoneEQ::parseProfileJSON (const juce::File& jsonFile)
                 if (auto* filterObj = item.getDynamicObject())
                 {
                     HeadphoneFilter filter;
-                    filter.type = filterObj->getProperty ("type").toString();
+                    filter.type = parseFilterType (filterObj->getProperty ("type").toString());
                     filter.frequency = static_cast<float> (filterObj->getProperty ("freq"));
                     filter.gain = static_cast<float> (filterObj->getProperty ("gain"));
                     filter.q = static_cast<float> (filterObj->getProperty ("q"));
 
-                    if (filter.frequency > 0.0f && filter.q > 0.0f)
+                    if (filter.type == HeadphoneFilterType::Unknown)
+                        DBG ("HeadphoneEQ: Unknown filter type: " + filterObj->getProperty ("type").toString());
+                    else if (filter.frequency > 0.0f && filter.q > 0.0f)
                         profile.filters.push_back (filter);
                 }
             }
         }
+
+        // Raw correction curve, exported by convert_autoeq.py when the source data has one
+        if (auto* curveObj = obj->getProperty ("curve").getDynamicObject())
+        {
+            auto* frequencies = curveObj->getProperty ("frequency").getArray();
+            auto* gains = curveObj->getProperty ("equalization").getArray();
+
+            if (frequencies != nullptr && gains != nullptr && frequencies->size() == gains->size())
+            {
+                for (int i = 0; i < frequencies->size(); ++i)
+                {
+                    const auto frequency = static_cast<float> ((*frequencies)[i]);
+
+                    // Must be strictly increasing for interpolation
+                    if (frequency > 0.0f && (profile.curveFrequencies.empty() || frequency > profile.curveFrequencies.back()))
+                    {
+                        profile.curveFrequencies.push_back (frequency);
+                        profile.curveGains.push_back (static_cast<float> ((*gains)[i]));
+                    }
+                }
+            }
+        }
     }
 
     return profile;
@@ -208,111 +252,605 @@ HeadphoneProfile HeadphoneEQ::parseProfileJSON (const juce::File& jsonFile)
 //==============================================================================
 void HeadphoneEQ::prepare (double sampleRate, int /*samplesPerBlock*/)
 {
+    // Crossfade tables: quarter-period sin/cos for an equal-power fade
+    fadeLength = juce::jmax (1, juce::roundToInt (sampleRate * crossfadeMs / 1000.0));
+    fadeInTable.resize (static_cast<size_t> (fadeLength));
+    fadeOutTable.resize (static_cast<size_t> (fadeLength));
+    duckInTable.resize (static_cast<size_t> (fadeLength));
+    duckOutTable.resize (static_cast<size_t> (fadeLength));
+
+    const int duckHalf = juce::jmax (1, fadeLength / 2);
+
+    for (int i = 0; i < fadeLength; ++i)
+    {
+        auto phase = juce::MathConstants<double>::halfPi * (i + 1) / fadeLength;
+        fadeInTable[(size_t) i]  = static_cast<float> (std::sin (phase));
+        fadeOutTable[(size_t) i] = static_cast<float> (std::cos (phase));
+
+        // Silent at the midpoint, where the output's delay changes
+        const auto outPhase = juce::MathConstants<double>::halfPi * juce::jmin (i + 1, duckHalf) / duckHalf;
+        const auto inPhase = juce::MathConstants<double>::halfPi * juce::jmax (0, i + 1 - duckHalf)
+                               / juce::jmax (1, fadeLength - duckHalf);
+        duckOutTable[(size_t) i] = static_cast<float> (std::cos (outPhase));
+        duckInTable[(size_t) i]  = static_cast<float> (std::sin (inPhase));
+    }
+
+    fadePosition = 0;
+
+    const juce::ScopedLock sl (publishLock);
     currentSampleRate = sampleRate;
+    ++designGeneration;     // Anything still being designed is for the old rate
 
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = 512;
-    spec.numChannels = 1;
+    for (auto& set : slots)
+        set.ensureCapacity (juce::jmax (defaultSectionCapacity, static_cast<int> (currentProfile.filters.size())));
 
-    for (int i = 0; i < maxFilters; ++i)
+    // Audio is stopped here, so install the redesigned correction directly
+    if (isFIRMode())
     {
-        leftFilters[i].prepare (spec);
-        rightFilters[i].prepare (spec);
+        const auto request = makeFIRRequest();
+        installFIR (slots[0], designFIR (request), getFIRLatencySamples (request));
+    }
+    else
+    {
+        designFilterSet (slots[0]);
     }
 
-    if (currentProfile.isValid())
-        updateFilterCoefficients();
+    mailbox.reset (0);
+    publishedLatency.store (slots[0].latencySamples, std::memory_order_relaxed);
 }
 
 //==============================================================================
 void HeadphoneEQ::reset()
 {
-    for (int i = 0; i < maxFilters; ++i)
+    for (auto& set : slots)
+        set.resetState();
+
+    fadePosition = 0;
+}
+
+void HeadphoneEQ::clearActiveState()
+{
+    if (mailbox.getSnapshot().fading != SlotMailbox::noSlot)
+        mailbox.releaseFading();
+
+    slots[mailbox.getSnapshot().active].resetState();
+}
+
+//==============================================================================
+void HeadphoneEQ::FilterSet::resetState()
+{
+    std::fill (leftState.begin(), leftState.end(), BiquadState());
+    std::fill (rightState.begin(), rightState.end(), BiquadState());
+    convolver.reset();
+}
+
+void HeadphoneEQ::FilterSet::ensureCapacity (int numSectionsNeeded)
+{
+    const auto needed = static_cast<size_t> (numSectionsNeeded);
+
+    if (sections.size() < needed)
     {
-        leftFilters[i].reset();
-        rightFilters[i].reset();
+        sections.resize (needed);
+        leftState.resize (needed);
+        rightState.resize (needed);
     }
 }
 
 //==============================================================================
-void HeadphoneEQ::updateFilterCoefficients()
+HeadphoneFilterType HeadphoneEQ::parseFilterType (const juce::String& typeString)
 {
-    activeFilterCount = 0;
-    preampGain = juce::Decibels::decibelsToGain (currentProfile.preamp);
+    if (typeString == "PK")                         return HeadphoneFilterType::Peak;
+    if (typeString == "LSC" || typeString == "LS")  return HeadphoneFilterType::LowShelf;
+    if (typeString == "HSC" || typeString == "HS")  return HeadphoneFilterType::HighShelf;
+    if (typeString == "LP")                         return HeadphoneFilterType::LowPass;
+    if (typeString == "HP")                         return HeadphoneFilterType::HighPass;
 
-    for (size_t i = 0; i < currentProfile.filters.size() && activeFilterCount < maxFilters; ++i)
-    {
-        const auto& filter = currentProfile.filters[i];
+    return HeadphoneFilterType::Unknown;
+}
 
-        // Skip filters above Nyquist
-        if (filter.frequency >= currentSampleRate * 0.45f)
-            continue;
+//==============================================================================
+int HeadphoneEQ::getCachedRateIndex (double sampleRate)
+{
+    for (size_t i = 0; i < commonSampleRates.size(); ++i)
+        if (std::abs (commonSampleRates[i] - sampleRate) < 1.0)
+            return static_cast<int> (i);
+
+    return -1;
+}
+
+const HeadphoneEQ::CachedProfile& HeadphoneEQ::getCachedProfile (const HeadphoneProfile& profile)
+{
+    auto existing = coefficientCache.find (profile.name);
+    if (existing != coefficientCache.end())
+        return existing->second;
+
+    // Bounded: A/B sessions only ever revisit a handful of profiles
+    if (coefficientCache.size() >= maxCachedProfiles)
+        coefficientCache.clear();
+
+    auto& cached = coefficientCache[profile.name];
+
+    for (size_t i = 0; i < commonSampleRates.size(); ++i)
+        designCascade (profile, commonSampleRates[i], cached[i]);
+
+    return cached;
+}
+
+//==============================================================================
+void HeadphoneEQ::designCascade (const HeadphoneProfile& profile, double sampleRate, DesignedCascade& result) const
+{
+    result.sections.clear();
+    result.preampGain = profile.isValid() ? juce::Decibels::decibelsToGain (profile.preamp) : 1.0f;
 
-        auto coeffs = createFilterCoefficients (filter);
-        if (coeffs != nullptr)
+    const float designLimit = static_cast<float> (sampleRate * 0.45);
+    std::vector<HeadphoneFilter> filters;
+    filters.reserve (profile.filters.size());
+
+    for (const auto& filter : profile.filters)
+    {
+        if (filter.frequency < designLimit)
+        {
+            filters.push_back (filter);
+        }
+        else if (filter.type == HeadphoneFilterType::HighShelf)
         {
-            leftFilters[activeFilterCount].coefficients = coeffs;
-            rightFilters[activeFilterCount].coefficients = coeffs;
-            ++activeFilterCount;
+            // A shelf above Nyquist still lifts the top of the band; keep it at the design limit
+            auto clamped = filter;
+            clamped.frequency = designLimit;
+            filters.push_back (clamped);
         }
+        // Peaks and pass filters above the limit have no meaningful in-band effect
+    }
+
+    if (sectionBudget > 0 && static_cast<int> (filters.size()) > sectionBudget)
+        reduceToSectionBudget (filters, sectionBudget, sampleRate);
+
+    for (const auto& filter : filters)
+    {
+        BiquadCoefficients coeffs;
+        if (createFilterCoefficients (filter, sampleRate, coeffs))
+            result.sections.push_back (coeffs);
     }
+}
+
+void HeadphoneEQ::designFilterSet (FilterSet& set)
+{
+    EARFIX_TRACE_SCOPE ("headphoneEQDesign");
+    DesignedCascade uncached;
+    const DesignedCascade* cascade = &uncached;
+
+    if (!currentProfile.isValid())
+        uncached = {};
+    else if (auto rateIndex = getCachedRateIndex (currentSampleRate); rateIndex >= 0)
+        cascade = &getCachedProfile (currentProfile)[(size_t) rateIndex];
+    else
+        designCascade (currentProfile, currentSampleRate, uncached);
 
-    DBG ("HeadphoneEQ: Updated " + juce::String (activeFilterCount) + " filters, preamp: " +
+    const int numSections = static_cast<int> (cascade->sections.size());
+
+    set.ensureCapacity (numSections);
+    std::copy (cascade->sections.begin(), cascade->sections.end(), set.sections.begin());
+    set.numSections = numSections;
+    set.preampGain = cascade->preampGain;
+    set.convolver.clear();
+    set.latencySamples = 0;
+    set.resetState();
+    lastDesignedSections = numSections;
+
+    DBG ("HeadphoneEQ: Installed " + juce::String (set.numSections) + " filters, preamp: " +
          juce::String (currentProfile.preamp, 1) + " dB");
 }
 
 //==============================================================================
-juce::dsp::IIR::Coefficients<float>::Ptr HeadphoneEQ::createFilterCoefficients (const HeadphoneFilter& filter)
+void HeadphoneEQ::setSectionBudget (int maxSections)
 {
-    float gain = juce::Decibels::decibelsToGain (filter.gain);
+    maxSections = juce::jmax (0, maxSections);
+
+    const juce::ScopedLock sl (publishLock);
+
+    if (maxSections == sectionBudget)
+        return;
+
+    sectionBudget = maxSections;
+    coefficientCache.clear();
 
-    if (filter.type == "PK")
+    if (currentProfile.isValid())
+        publishFilterSet();
+}
+
+//==============================================================================
+void HeadphoneEQ::setMode (HeadphoneEQMode newMode)
+{
+    const juce::ScopedLock sl (publishLock);
+
+    if (newMode == mode)
+        return;
+
+    mode = newMode;
+    publishFilterSet();
+}
+
+int HeadphoneEQ::getMaxLatencySamples() const
+{
+    return firPartitionSize + FIRDesign::getLatencySamples (FIRDesign::getLengthForSampleRate (currentSampleRate),
+                                                            FIRDesign::Phase::Linear);
+}
+
+int HeadphoneEQ::getTailLengthSamples() const
+{
+    return isFIRMode() ? FIRDesign::getLengthForSampleRate (currentSampleRate) : 0;
+}
+
+HeadphoneEQ::FIRRequest HeadphoneEQ::makeFIRRequest()
+{
+    FIRRequest request;
+    request.sampleRate = currentSampleRate;
+    request.phase = mode == HeadphoneEQMode::FIRLinearPhase ? FIRDesign::Phase::Linear : FIRDesign::Phase::Minimum;
+
+    if (currentProfile.hasCurve())
     {
-        // Peak/parametric filter
-        return juce::dsp::IIR::Coefficients<float>::makePeakFilter (
-            currentSampleRate, filter.frequency, filter.q, gain);
+        // AutoEq curves can boost; leave enough headroom for the largest boost
+        request.frequencies = currentProfile.curveFrequencies;
+        request.gainsDb = currentProfile.curveGains;
+        request.extraGainDb = -juce::jmax (0.0f, *std::max_element (request.gainsDb.begin(), request.gainsDb.end()));
     }
-    else if (filter.type == "LSC" || filter.type == "LS")
+    else if (currentProfile.isValid())
     {
-        // Low shelf filter
-        return juce::dsp::IIR::Coefficients<float>::makeLowShelf (
-            currentSampleRate, filter.frequency, filter.q, gain);
+        // No raw data: follow the parametric response at 1/24 octave instead
+        DesignedCascade cascade;
+        designCascade (currentProfile, currentSampleRate, cascade);
+
+        const double highHz = juce::jmin (20000.0, currentSampleRate * 0.45);
+        for (double f = 20.0; f <= highHz; f *= std::pow (2.0, 1.0 / 24.0))
+        {
+            float gainDb = 0.0f;
+            for (const auto& section : cascade.sections)
+                gainDb += getMagnitudeDb (section, f, currentSampleRate);
+
+            request.frequencies.push_back (static_cast<float> (f));
+            request.gainsDb.push_back (gainDb);
+        }
+
+        request.extraGainDb = currentProfile.preamp;
     }
-    else if (filter.type == "HSC" || filter.type == "HS")
+
+    // No profile: an empty curve designs a (delayed) unit impulse, so the
+    // latency reported to the host stays the same with or without a profile
+    return request;
+}
+
+std::vector<float> HeadphoneEQ::designFIR (const FIRRequest& request)
+{
+    EARFIX_TRACE_SCOPE ("headphoneFIRDesign");
+    return FIRDesign::designFromCurve (request.frequencies, request.gainsDb, request.extraGainDb, request.sampleRate,
+                                       FIRDesign::getLengthForSampleRate (request.sampleRate), request.phase);
+}
+
+int HeadphoneEQ::getFIRLatencySamples (const FIRRequest& request)
+{
+    return firPartitionSize + FIRDesign::getLatencySamples (FIRDesign::getLengthForSampleRate (request.sampleRate),
+                                                            request.phase);
+}
+
+void HeadphoneEQ::installFIR (FilterSet& set, const std::vector<float>& impulse, int latencySamples)
+{
+    set.numSections = 0;
+    set.preampGain = 1.0f;
+    set.convolver.setImpulseResponse (impulse.data(), static_cast<int> (impulse.size()), firPartitionSize);
+    set.latencySamples = latencySamples;
+    set.resetState();
+}
+
+void HeadphoneEQ::startFIRDesign()
+{
+    // The request snapshots currentProfile, so it is taken under the producers' lock
+    const juce::ScopedLock sl (publishLock);
+    const int generation = ++designGeneration;
+
+    designPool.addJob ([this, generation, request = makeFIRRequest()]
+    {
+        auto impulse = designFIR (request);
+
+        const juce::ScopedLock sl (publishLock);
+
+        // Superseded while designing: drop it, the newer request will publish
+        if (generation != designGeneration.load())
+            return;
+
+        const int slot = mailbox.findFreeSlot();
+        if (slot < 0)
+            return;
+
+        installFIR (slots[(size_t) slot], impulse, getFIRLatencySamples (request));
+        mailbox.post (slot);
+        publishedLatency.store (slots[(size_t) slot].latencySamples, std::memory_order_relaxed);
+
+        DBG ("HeadphoneEQ: Installed " + juce::String (impulse.size()) + "-tap FIR");
+    });
+}
+
+//==============================================================================
+float HeadphoneEQ::getMagnitudeDb (const BiquadCoefficients& c, double frequency, double sampleRate)
+{
+    const auto w = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+    const std::complex<double> z1 = std::polar (1.0, -w);
+    const std::complex<double> z2 = z1 * z1;
+
+    const auto num = (double) c.b0 + (double) c.b1 * z1 + (double) c.b2 * z2;
+    const auto den = 1.0 + (double) c.a1 * z1 + (double) c.a2 * z2;
+
+    return static_cast<float> (20.0 * std::log10 (std::abs (num) / std::abs (den) + 1.0e-12));
+}
+
+void HeadphoneEQ::reduceToSectionBudget (std::vector<HeadphoneFilter>& filters, int budget, double sampleRate)
+{
+    // Error is measured on a log-spaced grid over the audible band. Because
+    // cascaded sections add in dB, the cost of a candidate edit is just the
+    // RMS of the dB curve it removes or changes.
+    constexpr int gridSize = 96;
+    const double lowHz = 20.0;
+    const double highHz = juce::jmin (20000.0, sampleRate * 0.45);
+
+    std::array<double, gridSize> grid;
+    for (int i = 0; i < gridSize; ++i)
+        grid[(size_t) i] = lowHz * std::pow (highHz / lowHz, i / (double) (gridSize - 1));
+
+    auto responseDb = [&] (const HeadphoneFilter& filter, std::array<float, gridSize>& curve)
+    {
+        BiquadCoefficients coeffs;
+        if (!createFilterCoefficients (filter, sampleRate, coeffs))
+        {
+            curve.fill (0.0f);
+            return;
+        }
+
+        for (int i = 0; i < gridSize; ++i)
+            curve[(size_t) i] = getMagnitudeDb (coeffs, grid[(size_t) i], sampleRate);
+    };
+
+    auto rms = [] (const std::array<float, gridSize>& curve)
+    {
+        double sum = 0.0;
+        for (auto v : curve)
+            sum += (double) v * v;
+        return std::sqrt (sum / gridSize);
+    };
+
+    // Merging a pair of peaks: gain-weighted centre, summed gain, and the best of a few widths
+    auto mergePeaks = [] (const HeadphoneFilter& a, const HeadphoneFilter& b, float q)
+    {
+        const float wa = std::abs (a.gain) + 1.0e-3f;
+        const float wb = std::abs (b.gain) + 1.0e-3f;
+
+        HeadphoneFilter merged;
+        merged.type = HeadphoneFilterType::Peak;
+        merged.frequency = std::exp ((wa * std::log (a.frequency) + wb * std::log (b.frequency)) / (wa + wb));
+        merged.gain = a.gain + b.gain;
+        merged.q = q;
+        return merged;
+    };
+
+    // Nearest peak at or above filters[i] in frequency, or filters.size() if none
+    auto findPeakAbove = [&filters] (size_t i)
+    {
+        size_t neighbour = filters.size();
+
+        for (size_t j = 0; j < filters.size(); ++j)
+            if (j != i && filters[j].type == HeadphoneFilterType::Peak && filters[j].frequency >= filters[i].frequency
+                && (neighbour == filters.size() || filters[j].frequency < filters[neighbour].frequency))
+                neighbour = j;
+
+        return neighbour;
+    };
+
+    std::vector<std::array<float, gridSize>> curves (filters.size());
+    for (size_t i = 0; i < filters.size(); ++i)
+        responseDb (filters[i], curves[i]);
+
+    std::array<float, gridSize> candidate, difference;
+
+    while (static_cast<int> (filters.size()) > budget)
     {
-        // High shelf filter
-        return juce::dsp::IIR::Coefficients<float>::makeHighShelf (
-            currentSampleRate, filter.frequency, filter.q, gain);
+        double bestError = std::numeric_limits<double>::max();
+        size_t bestIndex = 0;
+        bool bestIsMerge = false;
+        HeadphoneFilter bestMerged;
+
+        for (size_t i = 0; i < filters.size(); ++i)
+        {
+            // Option 1: drop this section
+            const double dropError = rms (curves[i]);
+            if (dropError < bestError)
+            {
+                bestError = dropError;
+                bestIndex = i;
+                bestIsMerge = false;
+            }
+
+            // Option 2: merge with the nearest peak above it in frequency
+            if (filters[i].type != HeadphoneFilterType::Peak)
+                continue;
+
+            const size_t neighbour = findPeakAbove (i);
+            if (neighbour == filters.size())
+                continue;
+
+            const auto& a = filters[i];
+            const auto& b = filters[neighbour];
+            const float octaves = std::log2 (b.frequency / a.frequency);
+
+            for (float q : { juce::jmin (a.q, b.q), std::sqrt (a.q * b.q), juce::jmin (a.q, b.q) / (1.0f + octaves) })
+            {
+                const auto merged = mergePeaks (a, b, juce::jmax (0.1f, q));
+                responseDb (merged, candidate);
+
+                for (int k = 0; k < gridSize; ++k)
+                    difference[(size_t) k] = curves[i][(size_t) k] + curves[neighbour][(size_t) k] - candidate[(size_t) k];
+
+                const double mergeError = rms (difference);
+                if (mergeError < bestError)
+                {
+                    bestError = mergeError;
+                    bestIndex = i;
+                    bestIsMerge = true;
+                    bestMerged = merged;
+                }
+            }
+        }
+
+        if (bestIsMerge)
+        {
+            // Replace the lower peak with the merged one and remove its neighbour
+            const size_t neighbour = findPeakAbove (bestIndex);
+
+            filters[bestIndex] = bestMerged;
+            responseDb (bestMerged, curves[bestIndex]);
+            filters.erase (filters.begin() + (std::ptrdiff_t) neighbour);
+            curves.erase (curves.begin() + (std::ptrdiff_t) neighbour);
+        }
+        else
+        {
+            filters.erase (filters.begin() + (std::ptrdiff_t) bestIndex);
+            curves.erase (curves.begin() + (std::ptrdiff_t) bestIndex);
+        }
+
+        DBG ("HeadphoneEQ: Section budget " + juce::String (budget) + ": "
+             + (bestIsMerge ? "merged" : "dropped") + " section, error " + juce::String (bestError, 2) + " dB RMS");
     }
-    else if (filter.type == "LP")
+}
+
+//==============================================================================
+bool HeadphoneEQ::createFilterCoefficients (const HeadphoneFilter& filter, double sampleRate,
+                                            BiquadCoefficients& result)
+{
+    using Array = juce::dsp::IIR::ArrayCoefficients<float>;
+
+    float gain = juce::Decibels::decibelsToGain (filter.gain);
+    std::array<float, 6> c;
+
+    switch (filter.type)
     {
-        // Low pass filter (gain ignored)
-        return juce::dsp::IIR::Coefficients<float>::makeLowPass (
-            currentSampleRate, filter.frequency, filter.q);
+        case HeadphoneFilterType::Peak:
+            c = Array::makePeakFilter (sampleRate, filter.frequency, filter.q, gain);
+            break;
+
+        case HeadphoneFilterType::LowShelf:
+            c = Array::makeLowShelf (sampleRate, filter.frequency, filter.q, gain);
+            break;
+
+        case HeadphoneFilterType::HighShelf:
+            c = Array::makeHighShelf (sampleRate, filter.frequency, filter.q, gain);
+            break;
+
+        case HeadphoneFilterType::LowPass:
+            // Gain ignored
+            c = Array::makeLowPass (sampleRate, filter.frequency, filter.q);
+            break;
+
+        case HeadphoneFilterType::HighPass:
+            // Gain ignored
+            c = Array::makeHighPass (sampleRate, filter.frequency, filter.q);
+            break;
+
+        case HeadphoneFilterType::Unknown:
+        default:
+            return false;
     }
-    else if (filter.type == "HP")
+
+    // Array order is b0, b1, b2, a0, a1, a2 - normalise so a0 == 1
+    const float a0inv = 1.0f / c[3];
+    result.b0 = c[0] * a0inv;
+    result.b1 = c[1] * a0inv;
+    result.b2 = c[2] * a0inv;
+    result.a1 = c[4] * a0inv;
+    result.a2 = c[5] * a0inv;
+    return true;
+}
+
+//==============================================================================
+void HeadphoneEQ::publishFilterSet()
+{
+    if (isFIRMode())
     {
-        // High pass filter (gain ignored)
-        return juce::dsp::IIR::Coefficients<float>::makeHighPass (
-            currentSampleRate, filter.frequency, filter.q);
+        startFIRDesign();
+        return;
     }
 
-    DBG ("HeadphoneEQ: Unknown filter type: " + filter.type);
-    return nullptr;
+    const juce::ScopedLock sl (publishLock);
+    ++designGeneration;
+
+    const int slot = mailbox.findFreeSlot();
+    if (slot < 0)
+        return;
+
+    designFilterSet (slots[(size_t) slot]);
+    mailbox.post (slot);
+    publishedLatency.store (0, std::memory_order_relaxed);
 }
 
 //==============================================================================
 void HeadphoneEQ::process (juce::AudioBuffer<float>& buffer)
 {
-    if (!enabled || !currentProfile.isValid() || activeFilterCount == 0)
-        return;
+    // Take a pending cascade once any previous crossfade has finished
+    if (mailbox.takePending())
+        fadePosition = 0;
 
+    const auto roles = mailbox.getSnapshot();
     const int numSamples = buffer.getNumSamples();
+    int fadeSamples = 0;
 
-    // Apply preamp
-    if (std::abs (preampGain - 1.0f) > 0.001f)
-        buffer.applyGain (preampGain);
+    if (roles.fading != SlotMailbox::noSlot)
+    {
+        // While bypassed there is nothing to fade, so finish immediately
+        fadeSamples = isEnabled() ? juce::jmin (numSamples, fadeLength - fadePosition) : 0;
+
+        if (fadeSamples > 0)
+            processCrossfade (buffer, slots[roles.fading], slots[roles.active], fadeSamples);
+
+        // Crossfade done: release the old cascade back to the producers
+        if (fadePosition >= fadeLength || !isEnabled())
+            mailbox.releaseFading();
+    }
+
+    if (!isEnabled())
+        return;
+
+    // Rest of the block (or all of it) on the active cascade alone
+    if (fadeSamples < numSamples)
+        processActive (buffer, slots[roles.active], fadeSamples, numSamples - fadeSamples);
+}
+
+void HeadphoneEQ::processActive (juce::AudioBuffer<float>& buffer, FilterSet& set,
+                                 int startSample, int numSamples) noexcept
+{
+    if (set.isFlat())
+        return;
+
+    if (buffer.getNumChannels() >= 2)
+    {
+        auto* leftChannel = buffer.getWritePointer (0, startSample);
+        auto* rightChannel = buffer.getWritePointer (1, startSample);
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            set.processStereo (leftChannel[sample], rightChannel[sample]);
+    }
+    else if (buffer.getNumChannels() >= 1)
+    {
+        auto* channel = buffer.getWritePointer (0, startSample);
+
+        for (int sample = 0; sample < numSamples; ++sample)
+            channel[sample] = set.processMono (channel[sample]);
+    }
+}
+
+void HeadphoneEQ::processCrossfade (juce::AudioBuffer<float>& buffer, FilterSet& oldSet, FilterSet& newSet,
+                                    int numSamples) noexcept
+{
+    // Both corrections run on the same input, so the new one is warmed up when it is heard.
+    // Equal latencies crossfade; different ones dip through silence instead of comb filtering.
+    const bool aligned = oldSet.latencySamples == newSet.latencySamples;
+    const float* fadeIn  = (aligned ? fadeInTable : duckInTable).data() + fadePosition;
+    const float* fadeOut = (aligned ? fadeOutTable : duckOutTable).data() + fadePosition;
 
     if (buffer.getNumChannels() >= 2)
     {
@@ -321,17 +859,14 @@ void HeadphoneEQ::process (juce::AudioBuffer<float>& buffer)
 
         for (int sample = 0; sample < numSamples; ++sample)
         {
-            float leftSample = leftChannel[sample];
-            float rightSample = rightChannel[sample];
+            float oldLeft = leftChannel[sample], oldRight = rightChannel[sample];
+            float newLeft = oldLeft, newRight = oldRight;
 
-            for (int i = 0; i < activeFilterCount; ++i)
-            {
-                leftSample = leftFilters[i].processSample (leftSample);
-                rightSample = rightFilters[i].processSample (rightSample);
-            }
+            oldSet.processStereo (oldLeft, oldRight);
+            newSet.processStereo (newLeft, newRight);
 
-            leftChannel[sample] = leftSample;
-            rightChannel[sample] = rightSample;
+            leftChannel[sample]  = oldLeft * fadeOut[sample] + newLeft * fadeIn[sample];
+            rightChannel[sample] = oldRight * fadeOut[sample] + newRight * fadeIn[sample];
         }
     }
     else if (buffer.getNumChannels() >= 1)
@@ -340,12 +875,10 @@ void HeadphoneEQ::process (juce::AudioBuffer<float>& buffer)
 
         for (int sample = 0; sample < numSamples; ++sample)
         {
-            float sampleVal = channel[sample];
-
-            for (int i = 0; i < activeFilterCount; ++i)
-                sampleVal = leftFilters[i].processSample (sampleVal);
-
-            channel[sample] = sampleVal;
+            const float x = channel[sample];
+            channel[sample] = oldSet.processMono (x) * fadeOut[sample] + newSet.processMono (x) * fadeIn[sample];
         }
     }
+
+    fadePosition += numSamples;
 }
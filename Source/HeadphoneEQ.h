@@ -15,11 +15,33 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "DSP/FIRDesign.h"
+#include "DSP/PartitionedConvolver.h"
+#include "DSP/SlotMailbox.h"
+
+//==============================================================================
+enum class HeadphoneFilterType
+{
+    Peak,       // "PK"
+    LowShelf,   // "LSC" / "LS"
+    HighShelf,  // "HSC" / "HS"
+    LowPass,    // "LP"
+    HighPass,   // "HP"
+    Unknown
+};
+
+//==============================================================================
+enum class HeadphoneEQMode
+{
+    Parametric,         // Biquad cascade from the AutoEq parametric filters
+    FIRMinimumPhase,    // FIR from the raw AutoEq correction curve, minimum phase
+    FIRLinearPhase      // FIR from the raw AutoEq correction curve, linear phase (adds latency)
+};
 
 //==============================================================================
 struct HeadphoneFilter
 {
-    juce::String type;  // "PK" (peak), "LSC" (low shelf), "HSC" (high shelf)
+    HeadphoneFilterType type = HeadphoneFilterType::Unknown;  // Parsed from the AutoEq type string at load time
     float frequency = 1000.0f;
     float gain = 0.0f;
     float q = 1.0f;
@@ -34,7 +56,33 @@ struct HeadphoneProfile
     float preamp = 0.0f;
     std::vector<HeadphoneFilter> filters;
 
+    // Optional raw AutoEq correction curve (equalization dB vs Hz), used by the FIR modes
+    std::vector<float> curveFrequencies;
+    std::vector<float> curveGains;
+
     bool isValid() const { return name.isNotEmpty() && !filters.empty(); }
+    bool hasCurve() const { return !curveFrequencies.empty() && curveFrequencies.size() == curveGains.size(); }
+};
+
+//==============================================================================
+// Normalised biquad coefficients (a0 == 1), processed in transposed direct form II
+struct BiquadCoefficients
+{
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f;
+    float a1 = 0.0f, a2 = 0.0f;
+};
+
+struct BiquadState
+{
+    float s1 = 0.0f, s2 = 0.0f;
+
+    inline float process (const BiquadCoefficients& c, float x) noexcept
+    {
+        const float y = c.b0 * x + s1;
+        s1 = c.b1 * x - c.a1 * y + s2;
+        s2 = c.b2 * x - c.a2 * y;
+        return y;
+    }
 };
 
 //==============================================================================
@@ -56,7 +104,7 @@ public:
     //==========================================================================
     // Database management
 
-    /** Scans the headphones directory and loads the index. */
+    /** Scans the headphones directory and loads the index. Also drops cached coefficients. */
     void loadDatabase();
 
     /** Returns the path to the headphones data directory. */
@@ -74,35 +122,110 @@ public:
     //==========================================================================
     // Profile selection
 
-    /** Loads a headphone profile by name. Returns true if successful. */
+    /** Loads a headphone profile by name. Returns true if successful.
+
+        Must be called from the message thread. The JSON is parsed and the new
+        cascade is designed here, then handed to the audio thread through a
+        lock-free mailbox; process() crossfades from the old cascade to the new
+        one without allocating.
+    */
     bool loadProfile (const juce::String& headphoneName);
 
-    /** Clears the current profile (no headphone correction). */
+    /** Uses a profile built in code rather than read from the database (test tools
+        use a fixed one); otherwise as loadProfile(). An invalid profile clears the correction.
+    */
+    void setProfile (HeadphoneProfile profile);
+
+    /** Clears the current profile (no headphone correction). Crossfades to flat. */
     void clearProfile();
 
     /** Returns the currently loaded profile name, or empty if none. */
-    juce::String getCurrentProfileName() const { return currentProfile.name; }
+    juce::String getCurrentProfileName() const { const juce::ScopedLock sl (publishLock); return currentProfile.name; }
 
     /** Returns true if a profile is currently loaded. */
-    bool hasProfile() const { return currentProfile.isValid(); }
+    bool hasProfile() const { const juce::ScopedLock sl (publishLock); return currentProfile.isValid(); }
 
     //==========================================================================
     // Audio processing
 
-    /** Prepares the EQ for playback. */
+    /** Prepares the EQ for playback. Must not be called while process() is running. */
     void prepare (double sampleRate, int samplesPerBlock);
 
     /** Resets the filter states. */
     void reset();
 
+    /** Audio thread: clears the state of the cascade in use, finishing any crossfade, when
+        processing resumes after a gap. Unlike reset(), leaves the sets producers design into alone.
+    */
+    void clearActiveState();
+
     /** Processes a stereo audio buffer. */
     void process (juce::AudioBuffer<float>& buffer);
 
     /** Sets whether headphone EQ is enabled. */
-    void setEnabled (bool shouldBeEnabled) { enabled = shouldBeEnabled; }
+    void setEnabled (bool shouldBeEnabled) { enabled.store (shouldBeEnabled, std::memory_order_relaxed); }
 
     /** Returns true if headphone EQ is enabled. */
-    bool isEnabled() const { return enabled; }
+    bool isEnabled() const { return enabled.load (std::memory_order_relaxed); }
+
+    //==========================================================================
+    // Section budget
+
+    /** Limits the number of biquad sections per channel (0 = unlimited).
+
+        When a profile has more sections than the budget, the sections that
+        contribute least to the magnitude response across the audible band are
+        merged with a neighbour or dropped, one at a time, so accuracy degrades
+        gradually and the per-sample cost stays bounded. Any thread but the
+        audio thread: serialised with profile and mode changes by publishLock.
+        The redesigned cascade is crossfaded in like a profile change.
+    */
+    void setSectionBudget (int maxSections);
+
+    /** Returns the current section budget (0 = unlimited). */
+    int getSectionBudget() const { return sectionBudget; }
+
+    /** Returns the number of sections in the last designed cascade. */
+    int getNumActiveSections() const { return lastDesignedSections; }
+
+    //==========================================================================
+    // Correction mode
+
+    /** Selects parametric (biquad) or FIR correction. Any thread but the audio thread.
+
+        The FIR modes follow the raw AutoEq correction curve when the profile
+        has one, and the parametric response otherwise. The FIR is designed on
+        a background thread and switched in once ready; the current
+        correction keeps running until then. Corrections with different
+        latencies are switched with a dip through silence rather than a
+        crossfade, so two time-shifted copies are never mixed.
+    */
+    void setMode (HeadphoneEQMode newMode);
+
+    /** Returns the current correction mode. */
+    HeadphoneEQMode getMode() const { return mode; }
+
+    /** Returns true if the loaded profile carries a raw correction curve. */
+    bool hasResponseCurve() const { const juce::ScopedLock sl (publishLock); return currentProfile.hasCurve(); }
+
+    /** Latency of the last published correction, in samples.
+
+        This only changes once a redesigned correction has been handed to the
+        audio thread (for the FIR modes, when the background design finishes),
+        so poll it rather than reading it straight after setMode().
+    */
+    int getLatencySamples() const { return publishedLatency.load (std::memory_order_relaxed); }
+
+    /** The most getLatencySamples() can report at the prepared sample rate (linear-phase FIR). */
+    int getMaxLatencySamples() const;
+
+    /** Length of the FIR in the FIR modes (0 for parametric), in samples. */
+    int getTailLengthSamples() const;
+
+    /** Host sample rates for which designed coefficients are cached. */
+    static constexpr std::array<double, 6> commonSampleRates = {
+        44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0
+    };
 
 private:
     //==========================================================================
@@ -114,26 +237,163 @@ private:
     //==========================================================================
     // Filter management
 
-    void updateFilterCoefficients();
-    juce::dsp::IIR::Coefficients<float>::Ptr createFilterCoefficients (const HeadphoneFilter& filter);
+    // Sections preallocated per slot in prepare(); longer profiles grow the
+    // (free) slot they are designed into, never a slot the audio thread owns
+    static constexpr int defaultSectionCapacity = 32;
+
+    // One fully designed correction - a biquad cascade or an FIR - plus its
+    // per-channel state. Written only by a producer (under publishLock) while
+    // the slot is free, then owned by the audio thread once published.
+    struct FilterSet
+    {
+        std::vector<BiquadCoefficients> sections;
+        std::vector<BiquadState> leftState;
+        std::vector<BiquadState> rightState;
+        int numSections = 0;
+        float preampGain = 1.0f;
+        PartitionedConvolver convolver;     // Loaded only in the FIR modes
+        int latencySamples = 0;             // 0 for a cascade, partition + FIR delay for an FIR
+
+        void resetState();
+        void ensureCapacity (int numSectionsNeeded);
+
+        bool isFlat() const noexcept { return numSections == 0 && !convolver.isLoaded(); }
+
+        inline void processStereo (float& left, float& right) noexcept
+        {
+            left *= preampGain;
+            right *= preampGain;
+
+            for (int i = 0; i < numSections; ++i)
+            {
+                left = leftState[i].process (sections[i], left);
+                right = rightState[i].process (sections[i], right);
+            }
+
+            convolver.processSample (left, right);
+        }
+
+        inline float processMono (float x) noexcept
+        {
+            x *= preampGain;
+
+            for (int i = 0; i < numSections; ++i)
+                x = leftState[i].process (sections[i], x);
+
+            float unused = 0.0f;
+            convolver.processSample (x, unused);
+            return x;
+        }
+    };
+
+    void designFilterSet (FilterSet& set);
+    static HeadphoneFilterType parseFilterType (const juce::String& typeString);
+    static bool createFilterCoefficients (const HeadphoneFilter& filter, double sampleRate,
+                                          BiquadCoefficients& result);
+
+    //==========================================================================
+    // Coefficient cache, keyed by profile name and sample rate.
+    //
+    // Every profile is designed for the common host rates when it is loaded,
+    // so prepare() at one of those rates is a copy rather than a redesign.
+    // Other rates fall back to designing on the spot.
+
+    static constexpr size_t maxCachedProfiles = 16;
+
+    struct DesignedCascade
+    {
+        std::vector<BiquadCoefficients> sections;
+        float preampGain = 1.0f;
+    };
+
+    using CachedProfile = std::array<DesignedCascade, commonSampleRates.size()>;
+
+    static int getCachedRateIndex (double sampleRate);
+    void designCascade (const HeadphoneProfile& profile, double sampleRate, DesignedCascade& result) const;
+    const CachedProfile& getCachedProfile (const HeadphoneProfile& profile);
+
+    std::map<juce::String, CachedProfile> coefficientCache;
+
+    //==========================================================================
+    // Section budgeting (producers, under publishLock)
+
+    static float getMagnitudeDb (const BiquadCoefficients& c, double frequency, double sampleRate);
+    static void reduceToSectionBudget (std::vector<HeadphoneFilter>& filters, int budget, double sampleRate);
+
+    std::atomic<int> sectionBudget { 0 };
+    std::atomic<int> lastDesignedSections { 0 };
+
+    //==========================================================================
+    // FIR correction
+    //
+    // The FIR is designed from a copy of the curve on designPool, then
+    // installed into a free slot and published like a cascade. publishLock
+    // serialises the producers (message thread, the host's state-restore
+    // thread and the design thread) and guards currentProfile,
+    // coefficientCache and sectionBudget; the audio thread never takes it. designGeneration lets a finished design
+    // detect that a newer profile, mode or sample rate has superseded it.
+
+    static constexpr int firPartitionSize = 128;
+
+    struct FIRRequest
+    {
+        std::vector<float> frequencies;
+        std::vector<float> gainsDb;
+        float extraGainDb = 0.0f;
+        double sampleRate = 44100.0;
+        FIRDesign::Phase phase = FIRDesign::Phase::Minimum;
+    };
+
+    bool isFIRMode() const { return mode != HeadphoneEQMode::Parametric; }
+    FIRRequest makeFIRRequest();
+    static std::vector<float> designFIR (const FIRRequest& request);
+    static int getFIRLatencySamples (const FIRRequest& request);
+    static void installFIR (FilterSet& set, const std::vector<float>& impulse, int latencySamples);
+    void startFIRDesign();
+
+    std::atomic<HeadphoneEQMode> mode { HeadphoneEQMode::Parametric };
+    juce::CriticalSection publishLock;
+    std::atomic<int> designGeneration { 0 };
+    std::atomic<int> publishedLatency { 0 };
+
+    //==========================================================================
+    // Lock-free mailbox between the producers and the audio thread
+
+    /** Designs currentProfile into a free slot and posts it as pending (FIR modes: asynchronously). */
+    void publishFilterSet();
+
+    std::array<FilterSet, SlotMailbox::numSlots> slots;
+    SlotMailbox mailbox;
+
+    // Equal-power crossfade between old and new cascades (audio thread only).
+    // When their latencies differ the duck tables are used instead: the old
+    // correction fades out over the first half, the new one in over the second.
+    static constexpr double crossfadeMs = 20.0;
+    std::vector<float> fadeInTable;     // sin, 0 -> 1
+    std::vector<float> fadeOutTable;    // cos, 1 -> 0
+    std::vector<float> duckInTable;     // 0, then sin 0 -> 1
+    std::vector<float> duckOutTable;    // cos 1 -> 0, then 0
+    int fadeLength = 0;
+    int fadePosition = 0;
+
+    void processActive (juce::AudioBuffer<float>& buffer, FilterSet& set,
+                        int startSample, int numSamples) noexcept;
+    void processCrossfade (juce::AudioBuffer<float>& buffer, FilterSet& oldSet, FilterSet& newSet,
+                           int numSamples) noexcept;
 
     //==========================================================================
     // Data
 
     std::vector<HeadphoneIndexEntry> availableHeadphones;
     juce::String databaseVersion;
-    HeadphoneProfile currentProfile;
+    HeadphoneProfile currentProfile;        // Under publishLock
 
     // Processing state
-    bool enabled = false;
+    std::atomic<bool> enabled { false };
     double currentSampleRate = 44100.0;
 
-    // Up to 10 filter bands (typical AutoEq output)
-    static constexpr int maxFilters = 10;
-    std::array<juce::dsp::IIR::Filter<float>, maxFilters> leftFilters;
-    std::array<juce::dsp::IIR::Filter<float>, maxFilters> rightFilters;
-    int activeFilterCount = 0;
-    float preampGain = 1.0f;
+    // Last member: destroyed first, so a running design finishes before anything it touches goes away
+    juce::ThreadPool designPool { 1 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HeadphoneEQ)
 };
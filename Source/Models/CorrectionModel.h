@@ -11,6 +11,7 @@
 
 #include <JuceHeader.h>
 #include <array>
+#include <algorithm>
 
 //==============================================================================
 // Audiogram data structure
@@ -50,6 +51,13 @@ public:
     virtual float calculateGain (float frequency, float hearingLossDb,
                                   float inputLevelDb = 65.0f) const = 0;
 
+    // Gain for sounds below the compression threshold (the WDRC target);
+    // by default the gain at the standard 65 dB SPL input
+    virtual float getSoftSoundGain (float frequency, float hearingLossDb) const
+    {
+        return calculateGain (frequency, hearingLossDb);
+    }
+
     // Compression parameters for a given frequency/hearing loss
     virtual CompressionParams getCompressionParams (float frequency,
                                                      float hearingLossDb) const = 0;
@@ -57,6 +65,19 @@ public:
     // Whether this model uses compression
     virtual bool hasCompression() const = 0;
 
+    // Whether calculateGain() follows inputLevelDb, i.e. the model's compression is
+    // already in its gain (the processor then applies that curve as it is)
+    virtual bool hasLevelDependentGain() const { return false; }
+
+    // calculateGain() at numLevels input levels 1 dB apart, starting at firstLevelDb;
+    // table-driven models override it to share the per-band work across the curve
+    virtual void calculateGainCurve (float frequency, float hearingLossDb, float firstLevelDb,
+                                     int numLevels, float* gainsDb) const
+    {
+        for (int i = 0; i < numLevels; ++i)
+            gainsDb[i] = calculateGain (frequency, hearingLossDb, firstLevelDb + static_cast<float> (i));
+    }
+
     // User-configurable parameters specific to this model
     virtual void setOverallGainOffset (float dB) { overallGainOffset = dB; }
     virtual float getOverallGainOffset() const { return overallGainOffset; }
@@ -64,6 +85,12 @@ public:
 protected:
     float overallGainOffset = 0.0f;  // User adjustment (-10 to +10 dB)
 
+    // juce::jmap, usable in constant expressions
+    static constexpr float mapRange (float value, float sourceMin, float sourceMax, float targetMin, float targetMax) noexcept
+    {
+        return targetMin + ((targetMax - targetMin) * (value - sourceMin)) / (sourceMax - sourceMin);
+    }
+
     // Helper: linear interpolation between audiogram frequencies
     static float interpolateHearingLoss (const AudiogramData& audiogram, float frequency)
     {
@@ -15,7 +15,7 @@
 #include "CorrectionModel.h"
 
 //==============================================================================
-class HalfGainModel : public CorrectionModel
+class HalfGainModel final : public CorrectionModel
 {
 public:
     HalfGainModel() = default;
@@ -32,7 +32,7 @@ public:
     }
 
     float calculateGain (float /*frequency*/, float hearingLossDb,
-                         float /*inputLevelDb*/) const override
+                         float /*inputLevelDb*/ = 65.0f) const override
     {
         // Simple half-gain rule: apply 50% of hearing loss as boost
         float gain = hearingLossDb * 0.5f;
@@ -25,7 +25,7 @@
 #include "CorrectionModel.h"
 
 //==============================================================================
-class MOSLModel : public CorrectionModel
+class MOSLModel final : public CorrectionModel
 {
 public:
     MOSLModel() = default;
@@ -42,10 +42,10 @@ public:
     }
 
     float calculateGain (float frequency, float hearingLossDb,
-                         float /*inputLevelDb*/) const override
+                         float /*inputLevelDb*/ = 65.0f) const override
     {
         // Get frequency-specific gain factor based on music perception research
-        float gainFactor = getGainFactor (frequency);
+        float gainFactor = getGainFactor (frequency, bassEmphasis);
 
         // Base gain calculation
         float gain = hearingLossDb * gainFactor;
@@ -142,14 +142,9 @@ public:
 
     int getBassEmphasis() const { return bassEmphasis; }
 
-private:
-    float compressionThreshold = 65.0f;  // Higher than NAL's 50 dB
-    float attackMs = 8.0f;               // Slightly slower attack
-    float releaseMs = 200.0f;            // Much slower release
-    bool brightnessBoost = false;        // Disabled by default to avoid excess gain
-    int bassEmphasis = 1;                // Neutral bass by default
-
     //==========================================================================
+    // The prescription formulas, constexpr so the compiler can fold them
+    //
     // Frequency-dependent gain factors based on:
     // - Equal-loudness contours (ISO 226)
     // - Music perception research (Fitz & McKinney)
@@ -159,7 +154,7 @@ private:
     // Unlike simple half-gain (0.5 everywhere), we vary by frequency to
     // better restore the perceived spectral balance for music.
 
-    float getGainFactor (float frequency) const
+    static constexpr float getGainFactor (float frequency, int bassEmphasisLevel) noexcept
     {
         // Frequency-specific insertion gain factors
         // Designed to restore specific loudness pattern for music
@@ -170,8 +165,8 @@ private:
             // Low bass: 0.32 factor (was 0.40)
             // Matches NAL's approach of reduced low-freq gain
             float factor = 0.32f;
-            if (bassEmphasis == 1) factor = 0.34f;
-            else if (bassEmphasis == 2) factor = 0.36f;
+            if (bassEmphasisLevel == 1) factor = 0.34f;
+            else if (bassEmphasisLevel == 2) factor = 0.36f;
             return factor;
         }
 
@@ -180,7 +175,7 @@ private:
             // Upper bass / low mids: interpolate 0.32 -> 0.38
             float t = (frequency - 250.0f) / 250.0f;
             float baseFactor = 0.32f + t * 0.06f;
-            if (bassEmphasis >= 1) baseFactor += 0.02f;
+            if (bassEmphasisLevel >= 1) baseFactor += 0.02f;
             return baseFactor;
         }
 
@@ -223,14 +218,14 @@ private:
     // Brightness boost: subtle high-frequency shelf
     // Based on research showing CAM2's HF advantage for music perception
 
-    float getBrightnessBoost (float frequency, float hearingLossDb) const
+    static constexpr float getBrightnessBoost (float frequency, float hearingLossDb) noexcept
     {
         if (frequency < 3000.0f)
             return 0.0f;
 
         // Maximum boost of 1.5 dB at 6-8 kHz for mild losses (reduced from 3 dB)
         // Tapers down for more severe losses to avoid harshness
-        float maxBoost = juce::jmap (hearingLossDb, 0.0f, 60.0f, 1.5f, 0.0f);
+        float maxBoost = mapRange (hearingLossDb, 0.0f, 60.0f, 1.5f, 0.0f);
         maxBoost = std::max (0.0f, maxBoost);
 
         // Shelf shape: ramps up from 3 kHz, plateaus at 6 kHz
@@ -247,7 +242,7 @@ private:
     // Gentle compression ratio calculation
     // Much more conservative than NAL's formula
 
-    float calculateCompressionRatio (float hearingLossDb) const
+    static constexpr float calculateCompressionRatio (float hearingLossDb) noexcept
     {
         // Formula: 1.0 + (hearingLoss / 120)
         // This gives:
@@ -259,6 +254,17 @@ private:
         // Compare to NAL which can go up to 3:1!
 
         float ratio = 1.0f + (hearingLossDb / 120.0f);
-        return juce::jlimit (1.0f, 1.7f, ratio);
+        return std::clamp (ratio, 1.0f, 1.7f);
     }
+
+private:
+    float compressionThreshold = 65.0f;  // Higher than NAL's 50 dB
+    float attackMs = 8.0f;               // Slightly slower attack
+    float releaseMs = 200.0f;            // Much slower release
+    bool brightnessBoost = false;        // Disabled by default to avoid excess gain
+    int bassEmphasis = 1;                // Neutral bass by default
 };
+
+static_assert (MOSLModel::getGainFactor (250.0f, 0) == 0.32f);
+static_assert (MOSLModel::getBrightnessBoost (8000.0f, 0.0f) == 1.5f);
+static_assert (MOSLModel::calculateCompressionRatio (120.0f) == 1.7f);
@@ -18,7 +18,7 @@
 #include "CorrectionModel.h"
 
 //==============================================================================
-class NALModel : public CorrectionModel
+class NALModel final : public CorrectionModel
 {
 public:
     NALModel() = default;
@@ -35,7 +35,7 @@ public:
     }
 
     float calculateGain (float frequency, float hearingLossDb,
-                         float inputLevelDb) const override
+                         float inputLevelDb = 65.0f) const override
     {
         // Start with half-gain rule
         float gain = hearingLossDb * 0.5f;
@@ -81,6 +81,11 @@ public:
         return true;
     }
 
+    bool hasLevelDependentGain() const override
+    {
+        return true;
+    }
+
     // NAL-specific configurable parameters
     void setCompressionSpeed (bool fast)
     {
@@ -115,20 +120,17 @@ public:
 
     float getExperienceGainFactor() const { return experienceGainFactor; }
 
-private:
-    float compressionThreshold = 50.0f;  // dB SPL
-    float attackMs = 5.0f;
-    float releaseMs = 100.0f;
-    float experienceGainFactor = 1.0f;   // 0.7 for new, 0.85 for some, 1.0 for experienced
+    //==========================================================================
+    // The prescription formulas, constexpr so the compiler can fold them
 
     // Frequency-specific gain adjustments based on NAL research
-    float getFrequencyAdjustment (float frequency, float hearingLossDb) const
+    static constexpr float getFrequencyAdjustment (float frequency, float hearingLossDb) noexcept
     {
         // Low frequencies (250-500 Hz): reduce gain to avoid muddiness
         if (frequency <= 500.0f)
         {
             // -3 to -5 dB reduction, scaled by how low the frequency is
-            float reduction = juce::jmap (frequency, 250.0f, 500.0f, -5.0f, -3.0f);
+            float reduction = mapRange (frequency, 250.0f, 500.0f, -5.0f, -3.0f);
             return reduction;
         }
 
@@ -144,7 +146,7 @@ private:
             if (hearingLossDb > 60.0f)
             {
                 // Severe loss: significant reduction (diminishing returns)
-                float reduction = juce::jmap (hearingLossDb, 60.0f, 80.0f, -5.0f, -10.0f);
+                float reduction = mapRange (hearingLossDb, 60.0f, 80.0f, -5.0f, -10.0f);
                 return reduction;
             }
             else if (hearingLossDb > 40.0f)
@@ -159,9 +161,19 @@ private:
 
     // Calculate compression ratio based on hearing loss severity
     // Formula: CR = 1 + (hearingLoss / 40), clamped to 1.5-3.0
-    float calculateCompressionRatio (float hearingLossDb) const
+    static constexpr float calculateCompressionRatio (float hearingLossDb) noexcept
     {
         float ratio = 1.0f + (hearingLossDb / 40.0f);
-        return juce::jlimit (1.5f, 3.0f, ratio);
+        return std::clamp (ratio, 1.5f, 3.0f);
     }
+
+private:
+    float compressionThreshold = 50.0f;  // dB SPL
+    float attackMs = 5.0f;
+    float releaseMs = 100.0f;
+    float experienceGainFactor = 1.0f;   // 0.7 for new, 0.85 for some, 1.0 for experienced
 };
+
+static_assert (NALModel::getFrequencyAdjustment (250.0f, 30.0f) == -5.0f);
+static_assert (NALModel::getFrequencyAdjustment (4000.0f, 50.0f) == -2.0f);
+static_assert (NALModel::calculateCompressionRatio (40.0f) == 2.0f);
@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    NALNL2Model.h
+    Table-driven NAL-NL2-style prescription
+
+    Unlike the formula-based NAL model, gains come from precomputed tables
+    over frequency, degree of loss, input level and user experience (see
+    PrescriptionTable and scripts/build_nal_nl2_tables.py), so targets follow
+    the prescription's level dependence rather than a single curve:
+
+    - Soft-sound gain is the table's gain at its compression threshold
+    - Compression ratio per band is the slope of the table's level -> gain
+      curve above the threshold
+    - The experience level selects the new / some / experienced table
+
+    The tables span 40-90 dB SPL, narrower than the processor's 20-100 dB SPL
+    gain curve. Outside that range the gain holds at the nearest edge: below
+    it the prescription is linear anyway (its threshold is near 50 dB SPL),
+    and above it the curve turns linear at the loudest level's gain rather
+    than extrapolating the compression.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "CorrectionModel.h"
+#include "PrescriptionTable.h"
+
+//==============================================================================
+class NALNL2Model final : public CorrectionModel
+{
+public:
+    NALNL2Model() = default;
+
+    juce::String getName() const override
+    {
+        return "NAL-NL2";
+    }
+
+    juce::String getDescription() const override
+    {
+        return "Table-driven NAL-NL2-style prescription: level-dependent gains "
+               "and compression per band, adjusted for experience. For fitting.";
+    }
+
+    float calculateGain (float frequency, float hearingLossDb,
+                         float inputLevelDb = 65.0f) const override
+    {
+        float gain = table.getGain (frequency, hearingLossDb, inputLevelDb, experienceLevel);
+
+        // Apply user's overall adjustment
+        gain += overallGainOffset;
+
+        return juce::jlimit (0.0f, 40.0f, gain);
+    }
+
+    /** One frequency / loss interpolation for the table's whole level axis, then linear
+        in level; matches calculateGain() at every point, edge clamping included. */
+    void calculateGainCurve (float frequency, float hearingLossDb, float firstLevelDb,
+                             int numLevels, float* gainsDb) const override
+    {
+        if (! table.isValid())
+        {
+            std::fill (gainsDb, gainsDb + numLevels, juce::jlimit (0.0f, 40.0f, overallGainOffset));
+            return;
+        }
+
+        const auto& levels = table.getLevels();
+        std::array<float, PrescriptionTable::maxLevels> tableGains;
+        table.getGainCurve (frequency, hearingLossDb, experienceLevel, tableGains.data());
+
+        const auto last = levels.size() - 1;
+        size_t lower = 0;
+
+        for (int i = 0; i < numLevels; ++i)
+        {
+            const float level = juce::jlimit (levels.front(), levels.back(), firstLevelDb + static_cast<float> (i));
+
+            while (lower + 1 < last && level > levels[lower + 1])
+                ++lower;
+
+            const float fraction = (level - levels[lower]) / (levels[lower + 1] - levels[lower]);
+            const float gain = tableGains[lower] + fraction * (tableGains[lower + 1] - tableGains[lower]);
+
+            gainsDb[i] = juce::jlimit (0.0f, 40.0f, gain + overallGainOffset);
+        }
+    }
+
+    /** Gain below the compression threshold, where the prescription is linear. */
+    float getSoftSoundGain (float frequency, float hearingLossDb) const override
+    {
+        return calculateGain (frequency, hearingLossDb, table.getCompressionThreshold());
+    }
+
+    CompressionParams getCompressionParams (float frequency,
+                                             float hearingLossDb) const override
+    {
+        CompressionParams params;
+        params.threshold = table.getCompressionThreshold();
+
+        // Average slope of the gain curve from the threshold to the loudest level
+        const auto& levels = table.getLevels();
+        const float loudest = levels.back();
+        const float gainReduction = table.getGain (frequency, hearingLossDb, params.threshold, experienceLevel)
+                                      - table.getGain (frequency, hearingLossDb, loudest, experienceLevel);
+        const float slope = juce::jlimit (0.0f, 0.9f, gainReduction / (loudest - params.threshold));
+
+        params.ratio = 1.0f / (1.0f - slope);
+        params.attackMs = attackMs;
+        params.releaseMs = releaseMs;
+        params.makeupGain = 0.0f;
+
+        return params;
+    }
+
+    bool hasCompression() const override
+    {
+        return true;
+    }
+
+    bool hasLevelDependentGain() const override
+    {
+        return true;
+    }
+
+    void setCompressionSpeed (bool fast)
+    {
+        attackMs = fast ? 5.0f : 10.0f;
+        releaseMs = fast ? 50.0f : 150.0f;
+    }
+
+    // Experience level: 0 = New User, 1 = Some Experience, 2 = Experienced
+    void setExperienceLevel (int level)
+    {
+        experienceLevel = juce::jlimit (0, 2, level);
+    }
+
+    const PrescriptionTable& getTable() const noexcept { return table; }
+
+private:
+    const PrescriptionTable& table = PrescriptionTable::getNALNL2();
+    float attackMs = 5.0f;
+    float releaseMs = 50.0f;
+    int experienceLevel = 2;
+};
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    PrescriptionTable.cpp
+    Precomputed prescription gains with fast trilinear lookup
+
+  ==============================================================================
+*/
+
+#include "PrescriptionTable.h"
+
+//==============================================================================
+juce::Result PrescriptionTable::loadFromMemory (const void* data, size_t numBytes)
+{
+    juce::MemoryInputStream stream (data, numBytes, false);
+
+    char magic[4] = {};
+    stream.read (magic, 4);
+
+    if (std::memcmp (magic, "ENL2", 4) != 0)
+        return juce::Result::fail ("Not a prescription table");
+
+    const int version = static_cast<juce::uint16> (stream.readShort());
+
+    if (version != 1)
+        return juce::Result::fail ("Unsupported prescription table version " + juce::String (version));
+
+    const int numFrequencies = static_cast<juce::uint16> (stream.readShort());
+    const int numLosses      = static_cast<juce::uint16> (stream.readShort());
+    const int numLevels      = static_cast<juce::uint16> (stream.readShort());
+    const int numExperienceLevels = static_cast<juce::uint16> (stream.readShort());
+
+    if (numFrequencies < 2 || numLosses < 2 || numLevels < 2 || numExperienceLevels < 1)
+        return juce::Result::fail ("Empty prescription table");
+
+    if (numLevels > maxLevels)
+        return juce::Result::fail ("Too many input levels in prescription table");
+
+    const auto numGains = static_cast<size_t> (numExperienceLevels * numFrequencies * numLosses * numLevels);
+    const auto expectedBytes = 14 + 4 * static_cast<size_t> (numFrequencies + numLosses + numLevels + 1) + 2 * numGains;
+
+    if (numBytes < expectedBytes)
+        return juce::Result::fail ("Truncated prescription table");
+
+    auto readAxis = [&stream] (int size)
+    {
+        std::vector<float> axis (static_cast<size_t> (size));
+
+        for (auto& value : axis)
+            value = stream.readFloat();
+
+        return axis;
+    };
+
+    frequencies = readAxis (numFrequencies);
+    losses = readAxis (numLosses);
+    levels = readAxis (numLevels);
+    compressionThreshold = stream.readFloat();
+
+    logFrequencies.resize (frequencies.size());
+    std::transform (frequencies.begin(), frequencies.end(), logFrequencies.begin(),
+                    [] (float f) { return std::log2 (f); });
+
+    gains.resize (numGains);
+
+    for (auto& gain : gains)
+        gain = static_cast<float> (stream.readShort()) * 0.01f;
+
+    numExperience = numExperienceLevels;
+    return juce::Result::ok();
+}
+
+const PrescriptionTable& PrescriptionTable::getNALNL2()
+{
+    static const auto table = []
+    {
+        auto t = std::make_unique<PrescriptionTable>();
+        const auto result = t->loadFromMemory (BinaryData::NALNL2Tables_bin,
+                                               static_cast<size_t> (BinaryData::NALNL2Tables_binSize));
+        juce::ignoreUnused (result);
+        jassert (result.wasOk());
+        return t;
+    }();
+
+    return *table;
+}
+
+//==============================================================================
+PrescriptionTable::AxisPosition PrescriptionTable::locate (const std::vector<float>& axis, float value) noexcept
+{
+    // Axes are short (a few dozen points): a linear scan beats a binary search
+    const int last = static_cast<int> (axis.size()) - 1;
+
+    if (value <= axis.front())
+        return { 0, 0.0f };
+
+    if (value >= axis.back())
+        return { last - 1, 1.0f };
+
+    int i = 0;
+
+    while (value > axis[static_cast<size_t> (i + 1)])
+        ++i;
+
+    const auto lower = axis[static_cast<size_t> (i)];
+    return { i, (value - lower) / (axis[static_cast<size_t> (i + 1)] - lower) };
+}
+
+const float* PrescriptionTable::getSlab (int experience) const noexcept
+{
+    const auto slabSize = frequencies.size() * losses.size() * levels.size();
+    return gains.data() + static_cast<size_t> (juce::jlimit (0, numExperience - 1, experience)) * slabSize;
+}
+
+float PrescriptionTable::getGain (float frequency, float hearingLossDb, float inputLevelDb, int experience) const noexcept
+{
+    if (! isValid())
+        return 0.0f;
+
+    const auto f = locate (logFrequencies, std::log2 (juce::jmax (1.0f, frequency)));
+    const auto l = locate (losses, hearingLossDb);
+    const auto v = locate (levels, inputLevelDb);
+
+    const auto numLevels = levels.size();
+    const auto frequencyStride = losses.size() * numLevels;
+    const float* corner = getSlab (experience) + static_cast<size_t> (f.index) * frequencyStride
+                            + static_cast<size_t> (l.index) * numLevels + static_cast<size_t> (v.index);
+
+    // Interpolate along level, then loss, then frequency
+    auto alongLevel = [&v] (const float* p) { return p[0] + v.fraction * (p[1] - p[0]); };
+    auto alongLoss = [&] (const float* p)
+    {
+        const float lower = alongLevel (p);
+        return lower + l.fraction * (alongLevel (p + numLevels) - lower);
+    };
+
+    const float lower = alongLoss (corner);
+    return lower + f.fraction * (alongLoss (corner + frequencyStride) - lower);
+}
+
+void PrescriptionTable::getGainCurve (float frequency, float hearingLossDb, int experience, float* gainsDb) const noexcept
+{
+    const auto numLevels = levels.size();
+
+    if (! isValid())
+    {
+        std::fill (gainsDb, gainsDb + numLevels, 0.0f);
+        return;
+    }
+
+    const auto f = locate (logFrequencies, std::log2 (juce::jmax (1.0f, frequency)));
+    const auto l = locate (losses, hearingLossDb);
+
+    const auto frequencyStride = losses.size() * numLevels;
+    const float* p00 = getSlab (experience) + static_cast<size_t> (f.index) * frequencyStride
+                         + static_cast<size_t> (l.index) * numLevels;
+    const float* p01 = p00 + numLevels;
+    const float* p10 = p00 + frequencyStride;
+    const float* p11 = p10 + numLevels;
+
+    // Bilinear weights for the four (frequency, loss) corners, shared by every level
+    const float w00 = (1.0f - f.fraction) * (1.0f - l.fraction);
+    const float w01 = (1.0f - f.fraction) * l.fraction;
+    const float w10 = f.fraction * (1.0f - l.fraction);
+    const float w11 = f.fraction * l.fraction;
+
+    for (size_t i = 0; i < numLevels; ++i)
+        gainsDb[i] = w00 * p00[i] + w01 * p01[i] + w10 * p10[i] + w11 * p11[i];
+}
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    PrescriptionTable.h
+    Precomputed prescription gains with fast trilinear lookup
+
+    Insertion gain in dB over (frequency, hearing loss, input level), one
+    slab per experience level, as built by scripts/build_nal_nl2_tables.py
+    and shipped as a binary resource. Lookups interpolate linearly in log
+    frequency, loss and level and clamp at the edges of the grid: a level
+    outside the table's range (40-90 dB SPL as shipped) gets the gain at the
+    nearest end.
+
+    getGainCurve() fills a band's gains at every table level with one
+    frequency / loss weight computation; NALNL2Model interpolates the
+    processor's level -> gain curve from it, so compiling the curves costs
+    one locate per band instead of three plus a log2 per curve point.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class PrescriptionTable
+{
+public:
+    PrescriptionTable() = default;
+
+    /** Most input levels a table may have (getGainCurve() callers can size a buffer with it). */
+    static constexpr int maxLevels = 64;
+
+    /** Parses a table in the builder script's layout. */
+    juce::Result loadFromMemory (const void* data, size_t numBytes);
+
+    /** The NAL-NL2-style tables built into the plugin (loaded on first use). */
+    static const PrescriptionTable& getNALNL2();
+
+    bool isValid() const noexcept { return ! gains.empty(); }
+
+    /** Insertion gain (dB) for one band; experience is clamped to the table's range. */
+    float getGain (float frequency, float hearingLossDb, float inputLevelDb, int experience) const noexcept;
+
+    /** Gains at each of the table's input levels (getLevels()) for one band. */
+    void getGainCurve (float frequency, float hearingLossDb, int experience, float* gainsDb) const noexcept;
+
+    const std::vector<float>& getLevels() const noexcept { return levels; }
+    int getNumExperienceLevels() const noexcept { return numExperience; }
+
+    /** Input level (dB SPL) below which the prescription is linear. */
+    float getCompressionThreshold() const noexcept { return compressionThreshold; }
+
+private:
+    // Position along one axis: the lower grid index and the weight of the upper one
+    struct AxisPosition
+    {
+        int index = 0;
+        float fraction = 0.0f;
+    };
+
+    static AxisPosition locate (const std::vector<float>& axis, float value) noexcept;
+
+    const float* getSlab (int experience) const noexcept;
+
+    std::vector<float> frequencies, losses, levels;
+    std::vector<float> logFrequencies;      // log2 of frequencies, the interpolation axis
+    std::vector<float> gains;               // dB, [experience][frequency][loss][level]
+    int numExperience = 0;
+    float compressionThreshold = 50.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PrescriptionTable)
+};
@@ -57,6 +57,8 @@ HearingCorrectionAUv2AudioProcessorEditor::HearingCorrectionAUv2AudioProcessorEd
     modelSelector.addItem ("Half-Gain", 1);
     modelSelector.addItem ("NAL (Speech)", 2);
     modelSelector.addItem ("MOSL (Music)", 3);
+    modelSelector.addItem ("NAL-NL2 (Fitting)", 4);
+    modelSelector.addItem ("MOSL Loudness (Music)", 5);
     addAndMakeVisible (modelSelector);
     modelLabel.setText ("MODEL", juce::dontSendNotification);
     modelLabel.setFont (juce::FontOptions (11.0f).withStyle ("Bold"));
@@ -137,6 +139,17 @@ HearingCorrectionAUv2AudioProcessorEditor::HearingCorrectionAUv2AudioProcessorEd
     addAndMakeVisible (headphoneSelector);
     populateHeadphoneList();
 
+    // Item IDs are HeadphoneEQMode + 1
+    headphoneModeSelector.addItem ("Parametric", 1);
+    headphoneModeSelector.addItem ("FIR min-phase", 2);
+    headphoneModeSelector.addItem ("FIR linear", 3);
+    headphoneModeSelector.setSelectedId (static_cast<int> (audioProcessor.getHeadphoneEQMode()) + 1, juce::dontSendNotification);
+    headphoneModeSelector.onChange = [this]() {
+        audioProcessor.setHeadphoneEQMode (static_cast<HeadphoneEQMode> (headphoneModeSelector.getSelectedId() - 1));
+        updateHeadphoneInfo();
+    };
+    addAndMakeVisible (headphoneModeSelector);
+
     headphoneEnableButton.setName ("headphoneEQ");
     addAndMakeVisible (headphoneEnableButton);
 
@@ -148,6 +161,11 @@ HearingCorrectionAUv2AudioProcessorEditor::HearingCorrectionAUv2AudioProcessorEd
     };
     addAndMakeVisible (headphoneRefreshButton);
 
+    headphoneIRButton.setColour (juce::TextButton::buttonColourId, CustomLookAndFeel::panelWhite);
+    headphoneIRButton.setColour (juce::TextButton::textColourOffId, CustomLookAndFeel::textDark);
+    headphoneIRButton.onClick = [this]() { showImpulseResponseMenu(); };
+    addAndMakeVisible (headphoneIRButton);
+
     headphoneInfoLabel.setFont (juce::FontOptions (10.0f));
     headphoneInfoLabel.setColour (juce::Label::textColourId, CustomLookAndFeel::textMuted);
     headphoneInfoLabel.setJustificationType (juce::Justification::centredLeft);
@@ -204,6 +222,14 @@ HearingCorrectionAUv2AudioProcessorEditor::HearingCorrectionAUv2AudioProcessorEd
     // Start timer for meter updates
     startTimerHz (30);
 
+    addChildComponent (callbackMonitorPanel);
+
+   #if EARFIX_STAGE_TIMING
+    addChildComponent (stageTimingsPanel);
+   #endif
+
+    setWantsKeyboardFocus (true);
+
     setSize (560, 580);  // Compact height - audiograms fill available space
 }
 
@@ -238,8 +264,8 @@ void HearingCorrectionAUv2AudioProcessorEditor::timerCallback()
         float outLevel = std::max (displayOutputL, displayOutputR);
         if (inLevel > 0.0001f && outLevel > 0.0001f)
         {
-            float inDb = juce::Decibels::gainToDecibels (inLevel);
-            float outDb = juce::Decibels::gainToDecibels (outLevel);
+            float inDb = FastDecibels::gainToDecibels<FastDecibels::Accuracy::Fast> (inLevel);
+            float outDb = FastDecibels::gainToDecibels<FastDecibels::Accuracy::Fast> (outLevel);
             float diff = inDb - outDb;
             float currentGain = outputGainSlider.getValue();
             float newGain = juce::jlimit (-24.0f, 24.0f, static_cast<float> (currentGain + diff * 0.1f));
@@ -302,6 +328,17 @@ void HearingCorrectionAUv2AudioProcessorEditor::populateHeadphoneList()
 
 void HearingCorrectionAUv2AudioProcessorEditor::updateHeadphoneInfo()
 {
+    // User IRs take precedence in the info line: they're easy to forget about
+    auto leftIR = audioProcessor.getUserImpulseResponseFile (UserIRStage::Ear::Left);
+    auto rightIR = audioProcessor.getUserImpulseResponseFile (UserIRStage::Ear::Right);
+
+    if (leftIR != juce::File() || rightIR != juce::File())
+    {
+        auto describe = [] (const juce::File& f) { return f == juce::File() ? juce::String ("-") : f.getFileName(); };
+        headphoneInfoLabel.setText ("IR  L: " + describe (leftIR) + "  R: " + describe (rightIR), juce::dontSendNotification);
+        return;
+    }
+
     auto currentName = audioProcessor.getCurrentHeadphoneName();
     if (currentName.isEmpty())
     {
@@ -317,6 +354,10 @@ void HearingCorrectionAUv2AudioProcessorEditor::updateHeadphoneInfo()
         {
             // Only show source (type is often unknown)
             juce::String info = "Source: " + hp.source;
+
+            if (audioProcessor.getHeadphoneEQMode() != HeadphoneEQMode::Parametric && !audioProcessor.headphoneEQ.hasResponseCurve())
+                info += " (FIR from parametric EQ)";
+
             headphoneInfoLabel.setText (info, juce::dontSendNotification);
             return;
         }
@@ -325,9 +366,47 @@ void HearingCorrectionAUv2AudioProcessorEditor::updateHeadphoneInfo()
     headphoneInfoLabel.setText ("", juce::dontSendNotification);
 }
 
+void HearingCorrectionAUv2AudioProcessorEditor::showImpulseResponseMenu()
+{
+    juce::PopupMenu menu;
+    menu.addItem ("Load IR for both ears...", [this]() { chooseImpulseResponse (true, true); });
+    menu.addItem ("Load left ear IR...", [this]() { chooseImpulseResponse (true, false); });
+    menu.addItem ("Load right ear IR...", [this]() { chooseImpulseResponse (false, true); });
+    menu.addSeparator();
+    menu.addItem ("Clear IRs", audioProcessor.userIR.hasImpulseResponse(), false, [this]()
+    {
+        audioProcessor.clearUserImpulseResponse (UserIRStage::Ear::Left);
+        audioProcessor.clearUserImpulseResponse (UserIRStage::Ear::Right);
+        updateHeadphoneInfo();
+    });
+
+    menu.showMenuAsync (juce::PopupMenu::Options().withTargetComponent (&headphoneIRButton));
+}
+
+void HearingCorrectionAUv2AudioProcessorEditor::chooseImpulseResponse (bool left, bool right)
+{
+    irChooser = std::make_unique<juce::FileChooser> ("Select impulse response", juce::File(), "*.wav;*.aif;*.aiff");
+
+    irChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                            [this, left, right] (const juce::FileChooser& chooser)
+    {
+        auto file = chooser.getResult();
+        if (file == juce::File())
+            return;
+
+        if (left)
+            audioProcessor.loadUserImpulseResponse (UserIRStage::Ear::Left, file);
+        if (right)
+            audioProcessor.loadUserImpulseResponse (UserIRStage::Ear::Right, file);
+
+        updateHeadphoneInfo();
+    });
+}
+
 //==============================================================================
 void HearingCorrectionAUv2AudioProcessorEditor::paint (juce::Graphics& g)
 {
+    EARFIX_TRACE_SCOPE ("editorPaint");
     CustomLookAndFeel::drawAluminumBackground (g, getLocalBounds());
 
     // Universal spacing (must match resized())
@@ -337,7 +416,17 @@ void HearingCorrectionAUv2AudioProcessorEditor::paint (juce::Graphics& g)
     // === HEADPHONE CORRECTION header ===
     g.setColour (CustomLookAndFeel::textMuted);
     g.setFont (juce::FontOptions (11.0f).withStyle ("Bold"));
-    g.drawText ("HEADPHONE CORRECTION", bounds.removeFromTop (HEADER_H), juce::Justification::centred);
+    auto headerRow = bounds.removeFromTop (HEADER_H);
+    g.drawText ("HEADPHONE CORRECTION", headerRow, juce::Justification::centred);
+
+    // Quality governor: shown while it has stepped down to save CPU
+    if (const auto tier = audioProcessor.qualityGovernor.getTier(); tier > QualityGovernor::fullQuality)
+    {
+        g.setColour (CustomLookAndFeel::accentRed);
+        g.setFont (juce::FontOptions (10.0f).withStyle ("Bold"));
+        g.drawText ("CPU SAVER: " + juce::String (QualityGovernor::getTierName (tier)).toUpperCase(),
+                    headerRow, juce::Justification::centredRight);
+    }
 
     // Draw headphone panel
     if (!headphonePanelBounds.isEmpty())
@@ -499,15 +588,19 @@ void HearingCorrectionAUv2AudioProcessorEditor::resized()
     int hpW = static_cast<int>(headphonePanelBounds.getWidth()) - 2 * PANEL_PAD;
     int hpH = static_cast<int>(headphonePanelBounds.getHeight()) - 2 * PANEL_PAD;
 
-    // Row 1: icon, dropdown, toggle, refresh
-    int iconW = 28, toggleW = 40, refreshW = 50, elemH = 26;  // Wider refresh for text
+    // Row 1: icon, dropdown, mode, toggle, IR, refresh
+    int iconW = 28, modeW = 110, toggleW = 40, irW = 32, refreshW = 50, elemH = 26;  // Wider refresh for text
     int refreshX = hpX + hpW - refreshW;
-    int toggleX = refreshX - 8 - toggleW;
+    int irX = refreshX - 6 - irW;
+    int toggleX = irX - 8 - toggleW;
+    int modeX = toggleX - 8 - modeW;
     int dropX = hpX + iconW + 8;
-    int dropW = toggleX - 8 - dropX;
+    int dropW = modeX - 8 - dropX;
 
     headphoneSelector.setBounds (dropX, hpY, dropW, elemH);
+    headphoneModeSelector.setBounds (modeX, hpY, modeW, elemH);
     headphoneEnableButton.setBounds (toggleX, hpY + 3, toggleW, 20);
+    headphoneIRButton.setBounds (irX, hpY, irW, elemH);
     headphoneRefreshButton.setBounds (refreshX, hpY, refreshW, elemH);
 
     // Row 2: info label (with padding from bottom)
@@ -626,4 +719,32 @@ void HearingCorrectionAUv2AudioProcessorEditor::resized()
     int btnH = 40;
     int btnY = mfY + (mfH - btnH - 20) / 2;
     autoGainButton.setBounds (col4 - btnW / 2, btnY, btnW, btnH);
+
+    // Diagnostics overlays stacked from the bottom
+    auto diagnosticsArea = getLocalBounds().reduced (MARGIN);
+
+   #if EARFIX_STAGE_TIMING
+    stageTimingsPanel.setBounds (diagnosticsArea.removeFromBottom (StageTimingsPanel::getPreferredHeight()));
+    diagnosticsArea.removeFromBottom (MARGIN);
+   #endif
+
+    callbackMonitorPanel.setBounds (diagnosticsArea.removeFromBottom (CallbackMonitorPanel::getPreferredHeight()));
+}
+
+bool HearingCorrectionAUv2AudioProcessorEditor::keyPressed (const juce::KeyPress& key)
+{
+    // Cmd+Shift+D on macOS, Ctrl+Shift+D elsewhere
+    if (key == juce::KeyPress ('d', juce::ModifierKeys::commandModifier | juce::ModifierKeys::shiftModifier, 0))
+    {
+        const bool show = ! callbackMonitorPanel.isVisible();
+        callbackMonitorPanel.setVisible (show);
+
+       #if EARFIX_STAGE_TIMING
+        stageTimingsPanel.setVisible (show);
+       #endif
+
+        return true;
+    }
+
+    return false;
 }
@@ -13,6 +13,11 @@
 #include "PluginProcessor.h"
 #include "AudiogramComponent.h"
 #include "CustomLookAndFeel.h"
+#include "Diagnostics/CallbackMonitorPanel.h"
+
+#if EARFIX_STAGE_TIMING
+ #include "Diagnostics/StageTimingsPanel.h"
+#endif
 
 //==============================================================================
 class HearingCorrectionAUv2AudioProcessorEditor  : public juce::AudioProcessorEditor,
@@ -27,6 +32,7 @@ public:
     void paint (juce::Graphics&) override;
     void resized() override;
     void timerCallback() override;
+    bool keyPressed (const juce::KeyPress& key) override;
 
 private:
     void parameterChanged (const juce::String& parameterID, float newValue) override;
@@ -100,13 +106,18 @@ private:
 
     // Headphone EQ section
     juce::ComboBox     headphoneSelector;
+    juce::ComboBox     headphoneModeSelector;  // Parametric / FIR min-phase / FIR linear-phase
     juce::ToggleButton headphoneEnableButton { "headphoneEQ" };
     juce::TextButton   headphoneRefreshButton { "Refresh" };  // Text button - icon too small
+    juce::TextButton   headphoneIRButton { "IR" };            // Per-ear impulse response menu
+    std::unique_ptr<juce::FileChooser> irChooser;
     juce::Label        headphoneInfoLabel;
     std::unique_ptr<ButtonAttachment> headphoneEnableAttachment;
 
     void populateHeadphoneList();
     void updateHeadphoneInfo();
+    void showImpulseResponseMenu();
+    void chooseImpulseResponse (bool left, bool right);
 
     // Section bounds for painting
     juce::Rectangle<float> headphonePanelBounds;
@@ -116,5 +127,13 @@ private:
     float displayInputL = 0.0f, displayInputR = 0.0f;
     float displayOutputL = 0.0f, displayOutputR = 0.0f;
 
+    // Diagnostics overlays, hidden until Cmd/Ctrl+Shift+D
+    CallbackMonitorPanel callbackMonitorPanel { audioProcessor.callbackMonitor,
+                                                [this] (const juce::File& file) { return audioProcessor.writeDiagnosticsDump (file); } };
+
+   #if EARFIX_STAGE_TIMING
+    StageTimingsPanel stageTimingsPanel { audioProcessor.stageTimings };
+   #endif
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HearingCorrectionAUv2AudioProcessorEditor)
 };
@@ -41,11 +41,12 @@ HearingCorrectionAUv2AudioProcessor::createParameterLayout()
         "Bypass",
         false));
 
-    // Model selection: 0 = Half-Gain, 1 = NAL, 2 = MOSL (Music)
+    // Model selection: 0 = Half-Gain, 1 = NAL, 2 = MOSL (Music), 3 = NAL-NL2 (table-driven),
+    // 4 = MOSL Loudness (MOSL with real-time specific-loudness restoration)
     params.push_back (std::make_unique<juce::AudioParameterChoice> (
         juce::ParameterID { "modelSelect", 1 },
         "Model",
-        juce::StringArray { "Half-Gain", "NAL (Speech)", "MOSL (Music)" },
+        juce::StringArray { "Half-Gain", "NAL (Speech)", "MOSL (Music)", "NAL-NL2 (Fitting)", "MOSL Loudness (Music)" },
         2));  // Default to MOSL for music-focused use
 
     // Output gain: -24 to +24 dB
@@ -72,14 +73,14 @@ HearingCorrectionAUv2AudioProcessor::createParameterLayout()
         25.0f,
         juce::AudioParameterFloatAttributes().withLabel ("dB")));
 
-    // Compression speed: 0 = Fast, 1 = Slow (only used by NAL model)
+    // Compression speed: 0 = Fast, 1 = Slow (time constants of the NAL, MOSL and NAL-NL2 models)
     params.push_back (std::make_unique<juce::AudioParameterChoice> (
         juce::ParameterID { "compressionSpeed", 1 },
         "Compression",
         juce::StringArray { "Fast", "Slow" },
         0));
 
-    // Experience level: NAL-NL2 reduces gain for new users (0 = New, 1 = Experienced)
+    // Experience level: NAL-NL2 reduces gain for new users (0 = New, 1 = Some, 2 = Experienced)
     params.push_back (std::make_unique<juce::AudioParameterChoice> (
         juce::ParameterID { "experienceLevel", 1 },
         "Experience",
@@ -104,6 +105,44 @@ HearingCorrectionAUv2AudioProcessor::createParameterLayout()
         "Headphone EQ",
         false));
 
+    // Output ceiling: the lookahead limiter at the end of the chain holds peaks to this level
+    params.push_back (std::make_unique<juce::AudioParameterFloat> (
+        juce::ParameterID { "outputCeiling", 1 },
+        "Output Ceiling",
+        juce::NormalisableRange<float> (-12.0f, 0.0f, 0.1f),
+        -1.0f,
+        juce::AudioParameterFloatAttributes().withLabel ("dBFS")));
+
+    // Automatic quality: step down to cheaper processing rather than drop out under CPU load
+    params.push_back (std::make_unique<juce::AudioParameterBool> (
+        juce::ParameterID { "autoQuality", 1 },
+        "Auto Quality",
+        true));
+
+    // Stereo link: how much each band's level detector follows both ears (0% = each ear on its
+    // own, 100% = one detector per band shared by both), and whether it follows the louder ear
+    // or their average. Each ear keeps its own gain curves either way.
+    params.push_back (std::make_unique<juce::AudioParameterFloat> (
+        juce::ParameterID { "stereoLink", 1 },
+        "Stereo Link",
+        juce::NormalisableRange<float> (0.0f, 100.0f, 1.0f),
+        0.0f,
+        juce::AudioParameterFloatAttributes().withLabel ("%")));
+
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { "linkDetector", 1 },
+        "Link Detector",
+        juce::StringArray { "Louder Ear", "Average" },
+        0));
+
+    // Level detector: 0 = Peak (follows every sample's magnitude), 1 = RMS (the energy of
+    // short sub-blocks, how prescriptions define input level)
+    params.push_back (std::make_unique<juce::AudioParameterChoice> (
+        juce::ParameterID { "levelDetector", 1 },
+        "Level Detector",
+        juce::StringArray { "Peak", "RMS" },
+        0));
+
     // Audiogram values per ear (-20 to 120 dB HL, standard audiometric range)
     // Right ear first (audiological convention)
     // Version 4: simplified numeric IDs for correct host Controls view ordering
@@ -154,32 +193,52 @@ HearingCorrectionAUv2AudioProcessor::HearingCorrectionAUv2AudioProcessor()
     leftEnableParam         = parameters.getRawParameterValue ("leftEnable");
     rightEnableParam        = parameters.getRawParameterValue ("rightEnable");
     headphoneEQEnableParam  = parameters.getRawParameterValue ("headphoneEQEnable");
+    autoQualityParam        = parameters.getRawParameterValue ("autoQuality");
+    stereoLinkParam         = parameters.getRawParameterValue ("stereoLink");
+    linkDetectorParam       = parameters.getRawParameterValue ("linkDetector");
+    outputCeilingParam      = parameters.getRawParameterValue ("outputCeiling");
+    levelDetectorParam      = parameters.getRawParameterValue ("levelDetector");
 
     for (int i = 0; i < numAudiogramBands; ++i)
     {
         rightAudiogramParams[i] = parameters.getRawParameterValue ("audiogram_" + rightParamSuffixes[i]);
         leftAudiogramParams[i]  = parameters.getRawParameterValue ("audiogram_" + leftParamSuffixes[i]);
     }
+
+    // Near-miss thresholds for the callback monitor, e.g. "60,80,95" (percent of the budget)
+    auto thresholds = juce::StringArray::fromTokens (juce::SystemStats::getEnvironmentVariable ("EARFIX_NEAR_MISS_THRESHOLDS", {}), ",", {});
+    thresholds.removeEmptyStrings();
+
+    if (! thresholds.isEmpty())
+    {
+        juce::Array<float> values;
+
+        for (auto& threshold : thresholds)
+            values.add (threshold.getFloatValue() / 100.0f);
+
+        callbackMonitor.setNearMissThresholds (values);
+    }
+
+    // Compiles WDRC tables as the parameters change and applies the governor's headphone EQ tier
+    startTimerHz (30);
 }
 
-HearingCorrectionAUv2AudioProcessor::~HearingCorrectionAUv2AudioProcessor() = default;
+HearingCorrectionAUv2AudioProcessor::~HearingCorrectionAUv2AudioProcessor()
+{
+    stopTimer();
+}
 
 //==============================================================================
 void HearingCorrectionAUv2AudioProcessor::updateCurrentModel()
 {
     int modelIndex = static_cast<int> (modelSelectParam->load());
 
-    switch (modelIndex)
-    {
-        case 0:  currentModel = &halfGainModel; break;
-        case 1:  currentModel = &nalModel; break;
-        case 2:  currentModel = &moslModel; break;
-        default: currentModel = &moslModel; break;
-    }
-
     // Update model-specific settings
     float strength = correctionStrengthParam->load() / 100.0f;
-    currentModel->setOverallGainOffset ((strength - 0.5f) * 10.0f);  // -5 to +5 dB based on strength
+    visitCurrentModel ([strength] (auto& model)
+    {
+        model.setOverallGainOffset ((strength - 0.5f) * 10.0f);  // -5 to +5 dB based on strength
+    });
 
     // NAL-specific settings
     if (modelIndex == 1)
@@ -191,8 +250,8 @@ void HearingCorrectionAUv2AudioProcessor::updateCurrentModel()
         nalModel.setExperienceLevel (experienceLevel);
     }
 
-    // MOSL-specific settings
-    if (modelIndex == 2)
+    // MOSL-specific settings (also the time constants of MOSL Loudness)
+    if (modelIndex == 2 || modelIndex == 4)
     {
         bool fastCompression = compressionSpeedParam->load() < 0.5f;
         moslModel.setCompressionSpeed (fastCompression);
@@ -203,6 +262,13 @@ void HearingCorrectionAUv2AudioProcessor::updateCurrentModel()
         moslModel.setBrightnessBoost (experienceLevel >= 1);  // Enable for experienced users
         moslModel.setBassEmphasis (experienceLevel);          // More bass for experienced
     }
+
+    // NAL-NL2: speed and the experience table
+    if (modelIndex == 3)
+    {
+        nalNL2Model.setCompressionSpeed (compressionSpeedParam->load() < 0.5f);
+        nalNL2Model.setExperienceLevel (static_cast<int> (experienceLevelParam->load()));
+    }
 }
 
 //==============================================================================
@@ -210,7 +276,11 @@ const juce::String HearingCorrectionAUv2AudioProcessor::getName() const { return
 bool HearingCorrectionAUv2AudioProcessor::acceptsMidi() const { return false; }
 bool HearingCorrectionAUv2AudioProcessor::producesMidi() const { return false; }
 bool HearingCorrectionAUv2AudioProcessor::isMidiEffect() const { return false; }
-double HearingCorrectionAUv2AudioProcessor::getTailLengthSeconds() const { return 0.0; }
+double HearingCorrectionAUv2AudioProcessor::getTailLengthSeconds() const
+{
+    // FIR headphone correction and user IRs ring on after the input stops
+    return (headphoneEQ.getTailLengthSamples() + userIR.getTailLengthSamples()) / currentSampleRate;
+}
 
 int HearingCorrectionAUv2AudioProcessor::getNumPrograms()    { return 1; }
 int HearingCorrectionAUv2AudioProcessor::getCurrentProgram() { return 0; }
@@ -221,31 +291,58 @@ void HearingCorrectionAUv2AudioProcessor::changeProgramName (int, const juce::St
 //==============================================================================
 void HearingCorrectionAUv2AudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    EARFIX_TRACE_SCOPE ("prepareToPlay");
     currentSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlock;
 
-    // Prepare headphone EQ
+    // Prepare headphone EQ (the FIR modes add latency)
     headphoneEQ.prepare (sampleRate, samplesPerBlock);
 
-    previousGain = juce::Decibels::decibelsToGain (outputGainParam->load());
+    // Output limiter: its lookahead delay line is sized here
+    outputLimiter.prepare (sampleRate);
+    updateLatency();
+
+    // True-peak meters
+    inputMeter.prepare (samplesPerBlock);
+    outputMeter.prepare (samplesPerBlock);
+
+    // Bypass delay, long enough for any latency the headphone EQ mode can add
+    const int bypassDelaySize = juce::nextPowerOfTwo (headphoneEQ.getMaxLatencySamples()
+                                                      + outputLimiter.getLatencySamples() + 1);
+    bypassDelayMask = bypassDelaySize - 1;
+    bypassWritePosition = 0;
 
-    // Prepare filter spec for mono processing
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = static_cast<juce::uint32> (samplesPerBlock);
-    spec.numChannels = 1;
+    for (auto& line : bypassDelayLines)
+        line.assign (static_cast<size_t> (bypassDelaySize), 0.0f);
 
-    // Prepare Linkwitz-Riley crossover filters (5 crossovers for 6 bands)
+    bypassFadeBuffer.setSize (2, juce::jmax (1, samplesPerBlock));
+    bypassFadeLength = juce::jmax (1, juce::roundToInt (sampleRate * bypassFadeMs / 1000.0));
+    bypassFadePosition = bypassFadeEnd = 0;
+    wasBypassed = false;
+
+    // User IRs are reloaded at the new rate (zero latency)
+    userIR.prepare (sampleRate, samplesPerBlock, isNonRealtime());
+
+    // Loudness restoration on the same full-scale calibration as the WDRC thresholds
+    loudnessRestorer.prepare (sampleRate, crossoverFrequencies.data(), numCrossovers, wdrcFullScaleDbSpl);
+
+    previousGain = FastDecibels::decibelsToGain (outputGainParam->load());
+
+    // Band signals for both ears, one host block at a time, plus copies for WDRC mode crossfades
+    bandBuffers.setSize (2 * numAudiogramBands, juce::jmax (1, samplesPerBlock));
+    fadeBandBuffers.setSize (2 * numAudiogramBands, juce::jmax (1, samplesPerBlock));
+    fadeOutputBuffer.setSize (2, juce::jmax (1, samplesPerBlock));
+    linkDetectorBuffer.setSize (2, juce::jmax (1, samplesPerBlock));
+
+    activeWDRCMode = getWDRCMode (getQualityTier());
+    wdrcFadeLength = juce::jmax (1, juce::roundToInt (sampleRate * wdrcFadeMs / 1000.0));
+    wdrcFadePosition = wdrcFadeLength;
+
+    // Reset Linkwitz-Riley crossover state (5 crossovers for 6 bands)
     for (int i = 0; i < numCrossovers; ++i)
     {
-        leftLowpass[i].prepare (spec);
-        leftHighpass[i].prepare (spec);
-        rightLowpass[i].prepare (spec);
-        rightHighpass[i].prepare (spec);
-
-        leftLowpass[i].reset();
-        leftHighpass[i].reset();
-        rightLowpass[i].reset();
-        rightHighpass[i].reset();
+        leftCrossover[i].reset();
+        rightCrossover[i].reset();
     }
 
     // Reset WDRC state for all bands
@@ -257,105 +354,369 @@ void HearingCorrectionAUv2AudioProcessor::prepareToPlay (double sampleRate, int
         rightWDRC[i].smoothedGain = 1.0f;
     }
 
-    updateWDRCCoefficients();
     updateCrossoverCoefficients();
-    updateCurrentModel();
+
+    // The first table at this rate goes straight in: the audio thread isn't running
+    {
+        const juce::ScopedLock lock (wdrcTableLock);
+        compiledWDRCTableKey = getWDRCTableKey();
+        compileWDRCTable (wdrcTables[0]);
+        wdrcTableMailbox.reset (0);
+        wdrcTable = &wdrcTables[0];
+        loudnessSource = nullptr;
+    }
 }
 
 void HearingCorrectionAUv2AudioProcessor::releaseResources() {}
 
-void HearingCorrectionAUv2AudioProcessor::updateCrossoverCoefficients()
+HearingCorrectionAUv2AudioProcessor::WDRCSettings HearingCorrectionAUv2AudioProcessor::getWDRCSettings() const
+{
+    WDRCSettings settings;
+    settings.crossover = crossoverCoeffs;
+
+    const auto& table = wdrcTable->bands;
+
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        for (int i = 0; i < numAudiogramBands; ++i)
+        {
+            const auto index = static_cast<size_t> (ear * numAudiogramBands + i);
+
+            (ear == 0 ? settings.leftTargetsDb : settings.rightTargetsDb)[i] = table.targetDb[index];
+            (ear == 0 ? settings.leftRatios : settings.rightRatios)[i] = 1.0f / (1.0f - table.slope[index]);
+            auto& curve = (ear == 0 ? settings.leftGainCurves : settings.rightGainCurves)[i];
+
+            if (table.flatGains)
+                curve.fill (table.flatGain[index]);
+            else
+                curve = table.gainCurve[index];
+
+            (ear == 0 ? settings.leftAttackCoeffs : settings.rightAttackCoeffs)[i] = table.attackCoeff[index];
+            (ear == 0 ? settings.leftReleaseCoeffs : settings.rightReleaseCoeffs)[i] = table.releaseCoeff[index];
+        }
+    }
+
+    settings.gainSmoothCoeff = wdrcTable->gainSmoothCoeff;
+    settings.loudnessRestoration = wdrcTable->loudnessRestoration;
+    settings.loudnessFitting = wdrcTable->loudnessFitting;
+    settings.loudnessStrength = wdrcTable->loudnessStrength;
+    settings.loudnessMaxBoostDb = wdrcTable->loudnessMaxBoostDb;
+    settings.stereoLink = stereoLinkParam->load() / 100.0f;
+    settings.averageLink = linkDetectorParam->load() > 0.5f;
+    settings.energyDetector = levelDetectorParam->load() > 0.5f;
+
+    settings.leftEnabled  = leftEnableParam->load() > 0.5f;
+    settings.rightEnabled = rightEnableParam->load() > 0.5f;
+    settings.outputGain = FastDecibels::decibelsToGain (outputGainParam->load());
+    settings.outputCeiling = FastDecibels::decibelsToGain (outputCeilingParam->load());
+    settings.sampleRate = currentSampleRate;
+
+    return settings;
+}
+
+HearingCorrectionAUv2AudioProcessor::WDRCBandLevels HearingCorrectionAUv2AudioProcessor::getWDRCBandLevels (int ear) const
+{
+    const auto& bands = ear == 0 ? leftWDRC : rightWDRC;
+    WDRCBandLevels levels;
+
+    for (int i = 0; i < numAudiogramBands; ++i)
+    {
+        levels.envelopes[i] = bands[i].envelope;
+        levels.gains[i] = bands[i].smoothedGain;
+    }
+
+    return levels;
+}
+
+void HearingCorrectionAUv2AudioProcessor::processFrontEnd (juce::AudioBuffer<float>& buffer)
 {
+    // Apply headphone EQ correction (flattens headphone response before hearing correction)
+    {
+        EARFIX_TIME_STAGE (stageTimings, HeadphoneEQ);
+        bool headphoneEQEnabled = headphoneEQEnableParam->load() > 0.5f;
+        headphoneEQ.setEnabled (headphoneEQEnabled);
+        headphoneEQ.process (buffer);
+    }
+
+    // Measured per-ear IRs, if any
+    EARFIX_TIME_STAGE (stageTimings, UserIR);
+    userIR.process (buffer);
+}
+
+HearingCorrectionAUv2AudioProcessor::CrossoverDesign
+HearingCorrectionAUv2AudioProcessor::designCrossover (double sampleRate)
+{
+    CrossoverDesign design;
+
     // Set up Linkwitz-Riley crossover filters at each crossover frequency
     for (int i = 0; i < numCrossovers; ++i)
     {
         float freq = crossoverFrequencies[i];
 
         // Skip if frequency is too high for current sample rate
-        if (freq >= currentSampleRate * 0.45f)
-            freq = static_cast<float> (currentSampleRate * 0.44f);
+        if (freq >= sampleRate * 0.45f)
+            freq = static_cast<float> (sampleRate * 0.44f);
 
-        leftLowpass[i].setType (juce::dsp::LinkwitzRileyFilterType::lowpass);
-        leftLowpass[i].setCutoffFrequency (freq);
+        design[i] = LinkwitzRileyCoefficients::design (sampleRate, freq);
+    }
 
-        leftHighpass[i].setType (juce::dsp::LinkwitzRileyFilterType::highpass);
-        leftHighpass[i].setCutoffFrequency (freq);
+    return design;
+}
 
-        rightLowpass[i].setType (juce::dsp::LinkwitzRileyFilterType::lowpass);
-        rightLowpass[i].setCutoffFrequency (freq);
+void HearingCorrectionAUv2AudioProcessor::updateCrossoverCoefficients()
+{
+    // Designs for the common host rates are built once and shared by all instances
+    static const auto cachedDesigns = []
+    {
+        std::array<CrossoverDesign, HeadphoneEQ::commonSampleRates.size()> designs;
+        for (size_t i = 0; i < designs.size(); ++i)
+            designs[i] = designCrossover (HeadphoneEQ::commonSampleRates[i]);
+        return designs;
+    }();
 
-        rightHighpass[i].setType (juce::dsp::LinkwitzRileyFilterType::highpass);
-        rightHighpass[i].setCutoffFrequency (freq);
+    for (size_t i = 0; i < cachedDesigns.size(); ++i)
+    {
+        if (std::abs (HeadphoneEQ::commonSampleRates[i] - currentSampleRate) < 1.0)
+        {
+            crossoverCoeffs = cachedDesigns[i];
+            return;
+        }
     }
+
+    crossoverCoeffs = designCrossover (currentSampleRate);
 }
 
-void HearingCorrectionAUv2AudioProcessor::updateWDRCCoefficients()
+HearingCorrectionAUv2AudioProcessor::WDRCTableKey HearingCorrectionAUv2AudioProcessor::getWDRCTableKey() const noexcept
 {
-    bool fastCompression = compressionSpeedParam->load() < 0.5f;
+    WDRCTableKey key { modelSelectParam->load(), correctionStrengthParam->load(), maxBoostParam->load(),
+                       compressionSpeedParam->load(), experienceLevelParam->load(),
+                       static_cast<float> (currentSampleRate) };
 
-    // Attack/release times for envelope follower
-    float attackMs  = fastCompression ? 5.0f : 10.0f;
-    float releaseMs = fastCompression ? 50.0f : 150.0f;
+    for (int i = 0; i < numAudiogramBands; ++i)
+    {
+        key[static_cast<size_t> (6 + i)] = leftAudiogramParams[i]->load();
+        key[static_cast<size_t> (6 + numAudiogramBands + i)] = rightAudiogramParams[i]->load();
+    }
 
-    attackCoeff  = std::exp (-1.0f / (static_cast<float> (currentSampleRate) * attackMs / 1000.0f));
-    releaseCoeff = std::exp (-1.0f / (static_cast<float> (currentSampleRate) * releaseMs / 1000.0f));
+    return key;
+}
 
-    // Gain smoothing (10ms time constant)
-    gainSmoothCoeff = std::exp (-1.0f / (static_cast<float> (currentSampleRate) * 0.01f));
+void HearingCorrectionAUv2AudioProcessor::compileWDRCTable (WDRCTable& table)
+{
+    updateCurrentModel();
+    visitCurrentModel ([this, &table] (const auto& model) { compileWDRCTable (model, table); });
+
+    table.loudnessRestoration = static_cast<int> (modelSelectParam->load()) == 4;
 
-    // Update target gains for each band based on hearing loss
+    if (table.loudnessRestoration)
+        compileLoudnessFitting (table);
+}
+
+void HearingCorrectionAUv2AudioProcessor::compileLoudnessFitting (WDRCTable& table)
+{
+    auto& fitting = table.loudnessFitting;
+
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        const auto& audiogram = ear == 0 ? leftAudiogramParams : rightAudiogramParams;
+        std::array<float, numAudiogramBands> losses;
+
+        for (int i = 0; i < numAudiogramBands; ++i)
+            losses[static_cast<size_t> (i)] = audiogram[i]->load();
+
+        LoudnessRestorer::fitEar (currentSampleRate, audiogramFrequencies.data(), losses.data(), numAudiogramBands,
+                                  fitting.ears[static_cast<size_t> (ear)]);
+    }
+
+    // MOSL's (slow) time constants, applied across analysis frames
+    const auto compression = moslModel.getCompressionParams (1000.0f, 0.0f);
+    fitting.attackMs = compression.attackMs;
+    fitting.releaseMs = compression.releaseMs;
+
+    table.loudnessStrength = correctionStrengthParam->load() / 100.0f;
+    table.loudnessMaxBoostDb = maxBoostParam->load();
+}
+
+template <typename Model>
+void HearingCorrectionAUv2AudioProcessor::compileWDRCTable (const Model& model, WDRCTable& table)
+{
+    const bool fastCompression = compressionSpeedParam->load() < 0.5f;
+    const bool modelCompresses = model.hasCompression();
     const float strength = correctionStrengthParam->load() / 100.0f;
     const float maxBoost = maxBoostParam->load();
 
-    for (int i = 0; i < numAudiogramBands; ++i)
+    auto timeToCoeff = [this] (float ms)
+    {
+        return std::exp (-1.0f / (static_cast<float> (currentSampleRate) * ms / 1000.0f));
+    };
+
+    auto& bands = table.bands;
+    std::array<std::array<float, numGainCurvePoints>, WDRCBandTable::size> curvesDb;
+
+    for (int ear = 0; ear < 2; ++ear)
     {
-        const float freq = audiogramFrequencies[i];
-        const float leftLoss  = std::max (0.0f, leftAudiogramParams[i]->load());
-        const float rightLoss = std::max (0.0f, rightAudiogramParams[i]->load());
+        const auto& audiogram = ear == 0 ? leftAudiogramParams : rightAudiogramParams;
+
+        for (int i = 0; i < numAudiogramBands; ++i)
+        {
+            const float freq = audiogramFrequencies[i];
+            const float loss = std::max (0.0f, audiogram[i]->load());
+
+            // Target gain for soft sounds (full correction), capped to maxBoost
+            const float target = std::min (model.getSoftSoundGain (freq, loss) * strength, maxBoost);
 
-        // Calculate target gain for soft sounds (full correction)
-        float leftGain  = currentModel->calculateGain (freq, leftLoss) * strength;
-        float rightGain = currentModel->calculateGain (freq, rightLoss) * strength;
+            CompressionParams compression;
 
-        // Cap to maxBoost
-        leftWDRC[i].targetGainForSoftSounds = std::min (leftGain, maxBoost);
-        rightWDRC[i].targetGainForSoftSounds = std::min (rightGain, maxBoost);
+            if (modelCompresses)
+            {
+                compression = model.getCompressionParams (freq, loss);
+                compression.threshold -= wdrcFullScaleDbSpl;
+            }
+            else
+            {
+                // The processor's own WDRC: fixed kneepoint, ratio from the target
+                compression.threshold = wdrcKneepointDb;
+                compression.ratio = getCompressionRatio (target);
+                compression.attackMs = fastCompression ? 5.0f : 10.0f;
+                compression.releaseMs = fastCompression ? 50.0f : 150.0f;
+            }
+
+            const auto index = static_cast<size_t> (ear * numAudiogramBands + i);
+            bands.targetDb[index] = target;
+            bands.thresholdDb[index] = compression.threshold;
+            bands.slope[index] = 1.0f - 1.0f / std::max (1.0f, compression.ratio);
+            bands.makeupDb[index] = compression.makeupGain;
+            bands.attackCoeff[index] = timeToCoeff (compression.attackMs);
+            bands.releaseCoeff[index] = timeToCoeff (compression.releaseMs);
+
+            // The level -> gain curve: a level-dependent model's own gains (with the same
+            // strength and maxBoost as the target), otherwise the WDRC law through its knee
+            auto& curveDb = curvesDb[index];
+
+            if (model.hasLevelDependentGain())
+            {
+                model.calculateGainCurve (freq, loss, gainCurveMinDbSpl, numGainCurvePoints, curveDb.data());
+
+                for (auto& gainDb : curveDb)
+                    gainDb = std::min (gainDb * strength, maxBoost) + compression.makeupGain;
+            }
+            else
+            {
+                for (int point = 0; point < numGainCurvePoints; ++point)
+                {
+                    const float levelDbSpl = gainCurveMinDbSpl + static_cast<float> (point);
+                    curveDb[static_cast<size_t> (point)] = calculateWDRCGain (levelDbSpl - wdrcFullScaleDbSpl, target, compression.threshold,
+                                                                              bands.slope[index], compression.makeupGain);
+                }
+            }
+        }
     }
+
+    auto toGainCurve = [] (const std::array<float, numGainCurvePoints>& curveDb, GainCurve& curve)
+    {
+        FastDecibels::decibelsToGain (curveDb.data(), curve.data(), numGainCurvePoints);
+    };
+
+    for (size_t index = 0; index < static_cast<size_t> (WDRCBandTable::size); ++index)
+        toGainCurve (curvesDb[index], bands.gainCurve[index]);
+
+    // Merged bands: each pair's lower entry stands for both, with the slower time constants
+    // and the curves averaged in dB
+    auto& merged = table.mergedBands;
+    merged = bands;
+
+    for (size_t lower = 0; lower < static_cast<size_t> (WDRCBandTable::size); lower += 2)
+    {
+        const auto upper = lower + 1;
+        merged.targetDb[lower] = 0.5f * (bands.targetDb[lower] + bands.targetDb[upper]);
+        merged.thresholdDb[lower] = 0.5f * (bands.thresholdDb[lower] + bands.thresholdDb[upper]);
+        merged.slope[lower] = 0.5f * (bands.slope[lower] + bands.slope[upper]);
+        merged.makeupDb[lower] = 0.5f * (bands.makeupDb[lower] + bands.makeupDb[upper]);
+        merged.attackCoeff[lower] = std::max (bands.attackCoeff[lower], bands.attackCoeff[upper]);
+        merged.releaseCoeff[lower] = std::max (bands.releaseCoeff[lower], bands.releaseCoeff[upper]);
+
+        std::array<float, numGainCurvePoints> mergedDb;
+
+        for (size_t point = 0; point < mergedDb.size(); ++point)
+            mergedDb[point] = 0.5f * (curvesDb[lower][point] + curvesDb[upper][point]);
+
+        toGainCurve (mergedDb, merged.gainCurve[lower]);
+    }
+
+    // Gain smoothing (10ms time constant)
+    table.gainSmoothCoeff = std::exp (-1.0f / (static_cast<float> (currentSampleRate) * 0.01f));
 }
 
-float HearingCorrectionAUv2AudioProcessor::calculateWDRCGain (float inputLevelDb,
-                                                               float targetGainDb,
-                                                               float maxBoostDb) const
+void HearingCorrectionAUv2AudioProcessor::updateWDRCTable()
 {
-    // WDRC: Wide Dynamic Range Compression
-    // Soft sounds get full gain, loud sounds get reduced gain
+    const auto key = getWDRCTableKey();
 
-    // Kneepoint: below this input level, apply full target gain
-    const float kneepoint = -40.0f;  // dB (relative to 0dBFS)
+    if (key == compiledWDRCTableKey)
+        return;
+
+    compiledWDRCTableKey = key;
 
-    // Above kneepoint, compression kicks in
-    // Compression ratio increases with target gain (more correction = more compression)
-    float compressionRatio = 1.0f + (targetGainDb / 30.0f);
-    compressionRatio = juce::jlimit (1.5f, 4.0f, compressionRatio);
+    const int slot = wdrcTableMailbox.findFreeSlot();
+    compileWDRCTable (wdrcTables[static_cast<size_t> (slot)]);
+    wdrcTableMailbox.post (slot);
+}
 
-    if (inputLevelDb <= kneepoint)
+void HearingCorrectionAUv2AudioProcessor::takeWDRCTable() noexcept
+{
+    // No crossfade: the gain smoothing already glides between the old and new gains
+    if (wdrcTableMailbox.takePending())
     {
-        // Below kneepoint: full target gain
-        return targetGainDb;
+        wdrcTableMailbox.releaseFading();
+        loudnessSource = nullptr;   // The slot may be the one loudnessTable was built from, recompiled
     }
-    else
+
+    wdrcTable = &wdrcTables[wdrcTableMailbox.getSnapshot().active];
+}
+
+void HearingCorrectionAUv2AudioProcessor::applyLoudnessRestoration (const float* left, const float* right,
+                                                                    int numSamples) noexcept
+{
+    const auto& compiled = *wdrcTable;
+    loudnessRestorer.process (left, right, numSamples, compiled.loudnessFitting);
+
+    // The restorer's gains replace the gain curves: a flat gain per band, which the WDRC's
+    // gain smoothing glides to from the last one. The detectors and time constants are
+    // MOSL's, so switching tiers or models behaves as before. They only change with the
+    // compiled table, so they're copied once per table rather than every block.
+    if (loudnessSource != &compiled)
     {
-        // Above kneepoint: compress
-        float overKnee = inputLevelDb - kneepoint;
-        float compressedOver = overKnee / compressionRatio;
-        float gainReduction = overKnee - compressedOver;
+        loudnessTable = compiled;
+        loudnessSource = &compiled;
 
-        // Reduce target gain based on how much above kneepoint
-        float gain = targetGainDb - gainReduction;
+        for (auto* table : { &loudnessTable.bands, &loudnessTable.mergedBands })
+        {
+            table->slope.fill (0.0f);
+            table->makeupDb.fill (0.0f);
+            table->flatGains = true;
+        }
+    }
 
-        // Never go below 0 dB gain (no attenuation in correction bands)
-        return std::max (0.0f, gain);
+    auto& bands = loudnessTable.bands;
+    auto& merged = loudnessTable.mergedBands;
+
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        for (int band = 0; band < numAudiogramBands; ++band)
+        {
+            const auto index = static_cast<size_t> (ear * numAudiogramBands + band);
+            bands.targetDb[index] = std::min (loudnessRestorer.getGainDb (ear, band) * compiled.loudnessStrength,
+                                              compiled.loudnessMaxBoostDb);
+        }
     }
+
+    // Merged: each pair's lower entry stands for both
+    for (size_t lower = 0; lower < static_cast<size_t> (WDRCBandTable::size); lower += 2)
+        merged.targetDb[lower] = 0.5f * (bands.targetDb[lower] + bands.targetDb[lower + 1]);
+
+    FastDecibels::decibelsToGain (bands.targetDb.data(), bands.flatGain.data(), WDRCBandTable::size);
+    FastDecibels::decibelsToGain (merged.targetDb.data(), merged.flatGain.data(), WDRCBandTable::size);
+
+    wdrcTable = &loudnessTable;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -372,158 +733,510 @@ bool HearingCorrectionAUv2AudioProcessor::isBusesLayoutSupported (const BusesLay
 void HearingCorrectionAUv2AudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
                                                          juce::MidiBuffer& midiMessages)
 {
+    EARFIX_REALTIME_CONTEXT();
+    const ScopedCallbackTimer callbackTimer (callbackMonitor, getEngineConfiguration (buffer.getNumSamples()));
     juce::ScopedNoDenormals noDenormals;
     juce::ignoreUnused (midiMessages);
 
+   #if EARFIX_STAGE_TIMING
+    stageTimings.beginBlock();
+   #endif
+
+    EARFIX_TIME_STAGE (stageTimings, Total);
+
     const auto numSamples = buffer.getNumSamples();
 
     for (auto i = getTotalNumInputChannels(); i < getTotalNumOutputChannels(); ++i)
         buffer.clear (i, 0, numSamples);
 
-    // Measure input levels
+    const int governorTier = updateQualityGovernor (numSamples);
+
+    // Measure input levels (true peak, so the overs between samples show)
     if (buffer.getNumChannels() >= 2)
     {
-        inputLevelLeft.store (buffer.getMagnitude (0, 0, numSamples), std::memory_order_relaxed);
-        inputLevelRight.store (buffer.getMagnitude (1, 0, numSamples), std::memory_order_relaxed);
+        EARFIX_TIME_STAGE (stageTimings, InputMeter);
+        std::array<float, 2> peaks;
+        inputMeter.process (buffer.getReadPointer (0), buffer.getReadPointer (1), numSamples, nullptr, peaks.data());
+        inputLevelLeft.store (peaks[0], std::memory_order_relaxed);
+        inputLevelRight.store (peaks[1], std::memory_order_relaxed);
     }
 
-    if (bypassParam->load() > 0.5f)
+    const bool bypassed = bypassParam->load() > 0.5f;
+
+    // Coming out of bypass: the wet chain still holds audio from before it engaged
+    if (wasBypassed && ! bypassed)
+        clearWetChain();
+
+    wasBypassed = bypassed;
+    processBypassDelay (buffer, bypassed);
+
+    if (bypassed)
     {
         outputLevelLeft.store (inputLevelLeft.load (std::memory_order_relaxed), std::memory_order_relaxed);
         outputLevelRight.store (inputLevelRight.load (std::memory_order_relaxed), std::memory_order_relaxed);
         return;
     }
 
-    // Apply headphone EQ correction (flattens headphone response before hearing correction)
-    bool headphoneEQEnabled = headphoneEQEnableParam->load() > 0.5f;
-    headphoneEQ.setEnabled (headphoneEQEnabled);
-    headphoneEQ.process (buffer);
+    processFrontEnd (buffer);
 
-    // Update model and WDRC parameters
-    updateCurrentModel();
-    updateWDRCCoefficients();
+    // Pick up the latest WDRC table and mode
+    {
+        EARFIX_TIME_STAGE (stageTimings, Parameters);
+
+        if (isNonRealtime())
+        {
+            // Offline renders outrun the timer, and have no deadline to keep
+            const juce::ScopedTryLock lock (wdrcTableLock);
+
+            if (lock.isLocked())
+                updateWDRCTable();
+        }
+
+        takeWDRCTable();
+        setWDRCMode (getWDRCMode (governorTier));
+        stereoLinkAmount = juce::jlimit (0.0f, 1.0f, stereoLinkParam->load() / 100.0f);
+    }
+
+    if (wdrcTable->loudnessRestoration && buffer.getNumChannels() >= 2)
+    {
+        EARFIX_TIME_STAGE (stageTimings, Loudness);
+        applyLoudnessRestoration (buffer.getReadPointer (0), buffer.getReadPointer (1), numSamples);
+    }
 
     const bool leftEnabled  = leftEnableParam->load() > 0.5f;
     const bool rightEnabled = rightEnableParam->load() > 0.5f;
-    const float maxBoost = maxBoostParam->load();
 
     if (buffer.getNumChannels() >= 2)
     {
-        auto* leftChannel  = buffer.getWritePointer (0);
-        auto* rightChannel = buffer.getWritePointer (1);
+        // Signal flow: Input -> Split into bands -> WDRC each band -> Sum.
+        // Each stage runs over the whole block (or a bandBuffers-sized piece of it)
+        // per band; the arithmetic per sample is the same as a sample-by-sample loop.
+        const bool earEnabled[2] = { leftEnabled, rightEnabled };
+        const int bandBlockSize = bandBuffers.getNumSamples();
 
-        for (int sample = 0; sample < numSamples; ++sample)
+        for (int start = 0; start < numSamples; start += bandBlockSize)
         {
-            float leftIn  = leftChannel[sample];
-            float rightIn = rightChannel[sample];
-            float leftOut = 0.0f;
-            float rightOut = 0.0f;
+            const int blockSize = juce::jmin (bandBlockSize, numSamples - start);
 
-            // Process through multiband crossover with WDRC
-            // Signal flow: Input -> Split into bands -> WDRC each band -> Sum
+            {
+                EARFIX_TIME_STAGE (stageTimings, Crossover);
+
+                for (int ear = 0; ear < 2; ++ear)
+                    bandBuffers.copyFrom (ear * numAudiogramBands, 0, buffer, ear, start, blockSize);
 
-            float leftRemaining = leftIn;
-            float rightRemaining = rightIn;
+                splitBands (leftCrossover, 0, blockSize);
+                splitBands (rightCrossover, 1, blockSize);
+            }
 
-            for (int band = 0; band < numAudiogramBands; ++band)
+            EARFIX_TIME_STAGE (stageTimings, WDRC);
+
+            // While a mode change fades in, the previous mode runs on copies of the bands
+            const bool fading = wdrcFadePosition < wdrcFadeLength;
+
+            if (fading)
+                for (int channel = 0; channel < bandBuffers.getNumChannels(); ++channel)
+                    fadeBandBuffers.copyFrom (channel, 0, bandBuffers, channel, 0, blockSize);
+
+            // A disabled ear keeps its original signal
+            float* outputs[2] = { buffer.getWritePointer (0, start), buffer.getWritePointer (1, start) };
+            processWDRCStage (activeWDRCMode, leftWDRC, rightWDRC, bandBuffers, outputs, earEnabled, blockSize);
+
+            if (fading)
             {
-                float leftBand, rightBand;
+                float* fadeOutputs[2] = { fadeOutputBuffer.getWritePointer (0), fadeOutputBuffer.getWritePointer (1) };
+                processWDRCStage (fadingWDRCMode, fadeLeftWDRC, fadeRightWDRC, fadeBandBuffers, fadeOutputs,
+                                  earEnabled, blockSize);
 
-                if (band < numCrossovers)
-                {
-                    // Extract this band using lowpass, pass remainder through highpass
-                    leftBand = leftLowpass[band].processSample (0, leftRemaining);
-                    leftRemaining = leftHighpass[band].processSample (0, leftRemaining);
+                // Linear: both modes carry the same, highly correlated signal
+                const int fadeSamples = juce::jmin (blockSize, wdrcFadeLength - wdrcFadePosition);
+                const float fadeStep = 1.0f / static_cast<float> (wdrcFadeLength);
 
-                    rightBand = rightLowpass[band].processSample (0, rightRemaining);
-                    rightRemaining = rightHighpass[band].processSample (0, rightRemaining);
-                }
-                else
+                for (int ear = 0; ear < 2; ++ear)
                 {
-                    // Last band gets the remainder (highpass only)
-                    leftBand = leftRemaining;
-                    rightBand = rightRemaining;
+                    if (! earEnabled[ear])
+                        continue;
+
+                    for (int i = 0; i < fadeSamples; ++i)
+                    {
+                        const float amount = static_cast<float> (wdrcFadePosition + i) * fadeStep;
+                        outputs[ear][i] = fadeOutputs[ear][i] + amount * (outputs[ear][i] - fadeOutputs[ear][i]);
+                    }
                 }
 
-                // Apply WDRC to this band if enabled
-                if (leftEnabled && leftWDRC[band].targetGainForSoftSounds > 0.0f)
-                {
-                    // Envelope follower for this band
-                    float inputLevel = std::abs (leftBand);
-                    float& env = leftWDRC[band].envelope;
-                    float coeff = (inputLevel > env) ? attackCoeff : releaseCoeff;
-                    env = env * coeff + inputLevel * (1.0f - coeff);
-
-                    // Calculate input level in dB
-                    float inputDb = juce::Decibels::gainToDecibels (env + 1e-6f);
-
-                    // Calculate WDRC gain based on input level
-                    float targetGainDb = calculateWDRCGain (inputDb,
-                                                            leftWDRC[band].targetGainForSoftSounds,
-                                                            maxBoost);
-
-                    // Smooth gain changes
-                    float targetGainLinear = juce::Decibels::decibelsToGain (targetGainDb);
-                    leftWDRC[band].smoothedGain = leftWDRC[band].smoothedGain * gainSmoothCoeff
-                                                  + targetGainLinear * (1.0f - gainSmoothCoeff);
-
-                    leftBand *= leftWDRC[band].smoothedGain;
-                }
+                wdrcFadePosition += fadeSamples;
+            }
+        }
+    }
 
-                if (rightEnabled && rightWDRC[band].targetGainForSoftSounds > 0.0f)
-                {
-                    // Envelope follower for this band
-                    float inputLevel = std::abs (rightBand);
-                    float& env = rightWDRC[band].envelope;
-                    float coeff = (inputLevel > env) ? attackCoeff : releaseCoeff;
-                    env = env * coeff + inputLevel * (1.0f - coeff);
-
-                    // Calculate input level in dB
-                    float inputDb = juce::Decibels::gainToDecibels (env + 1e-6f);
-
-                    // Calculate WDRC gain based on input level
-                    float targetGainDb = calculateWDRCGain (inputDb,
-                                                            rightWDRC[band].targetGainForSoftSounds,
-                                                            maxBoost);
-
-                    // Smooth gain changes
-                    float targetGainLinear = juce::Decibels::decibelsToGain (targetGainDb);
-                    rightWDRC[band].smoothedGain = rightWDRC[band].smoothedGain * gainSmoothCoeff
-                                                   + targetGainLinear * (1.0f - gainSmoothCoeff);
-
-                    rightBand *= rightWDRC[band].smoothedGain;
-                }
+    // Output gain with smoothing
+    {
+        EARFIX_TIME_STAGE (stageTimings, OutputGain);
+        const float targetGain = FastDecibels::decibelsToGain (outputGainParam->load());
+
+        if (std::abs (targetGain - previousGain) > 0.0001f)
+        {
+            buffer.applyGainRamp (0, numSamples, previousGain, targetGain);
+            previousGain = targetGain;
+        }
+        else
+        {
+            buffer.applyGain (targetGain);
+        }
+    }
+
+    // Nothing leaves above the ceiling, whatever the boost and output gain add up to
+    if (buffer.getNumChannels() >= 2)
+    {
+        EARFIX_TIME_STAGE (stageTimings, Limiter);
+        outputLimiter.setCeiling (FastDecibels::decibelsToGain (outputCeilingParam->load()));
+        outputLimiter.process (buffer.getWritePointer (0), buffer.getWritePointer (1), numSamples);
+        limiterGain.store (outputLimiter.getMinGain(), std::memory_order_relaxed);
+    }
+
+    processBypassFade (buffer);
+
+    // Measure output levels (true peak, as the limiter holds them)
+    if (buffer.getNumChannels() >= 2)
+    {
+        EARFIX_TIME_STAGE (stageTimings, OutputMeter);
+        std::array<float, 2> peaks;
+        outputMeter.process (buffer.getReadPointer (0), buffer.getReadPointer (1), numSamples, nullptr, peaks.data());
+        outputLevelLeft.store (peaks[0], std::memory_order_relaxed);
+        outputLevelRight.store (peaks[1], std::memory_order_relaxed);
+    }
+}
+
+CallbackMonitor::EngineConfiguration HearingCorrectionAUv2AudioProcessor::getEngineConfiguration (int numSamples) const noexcept
+{
+    static constexpr const char* modelNames[] = { "Half-Gain", "NAL", "MOSL", "NAL-NL2", "MOSL Loudness" };
+    static constexpr const char* headphoneEQModeNames[] = { "parametric", "FIR minimum phase", "FIR linear phase" };
+
+    CallbackMonitor::EngineConfiguration configuration;
+    configuration.sampleRate = currentSampleRate;
+    configuration.blockSize = numSamples;
+    configuration.preparedBlockSize = preparedBlockSize;
+    configuration.latencySamples = getLatencySamples();
+    configuration.model = modelNames[juce::jlimit (0, 4, static_cast<int> (modelSelectParam->load()))];
+    configuration.headphoneEQ = headphoneEQEnableParam->load() > 0.5f
+                                  ? headphoneEQModeNames[juce::jlimit (0, 2, headphoneEQModeIndex.load (std::memory_order_relaxed))]
+                                  : "off";
+    configuration.quality = QualityGovernor::getTierName (getQualityTier());
+    configuration.userIR = userIR.getTailLengthSamples() > 0;
+    configuration.leftEnabled = leftEnableParam->load() > 0.5f;
+    configuration.rightEnabled = rightEnableParam->load() > 0.5f;
+    configuration.bypassed = bypassParam->load() > 0.5f;
+    configuration.nonRealtime = isNonRealtime();
+    return configuration;
+}
+
+void HearingCorrectionAUv2AudioProcessor::splitBands (std::array<LinkwitzRileySplitter, numCrossovers>& splitters,
+                                                      int ear, int numSamples) noexcept
+{
+    // The input is in the ear's first band; each crossover extracts its band with the
+    // lowpass and passes the remainder on through the highpass, so the last band gets
+    // what's left above the top crossover
+    for (int band = 0; band < numCrossovers; ++band)
+    {
+        auto* low = bandBuffers.getWritePointer (ear * numAudiogramBands + band);
+        auto* high = bandBuffers.getWritePointer (ear * numAudiogramBands + band + 1);
+        auto& splitter = splitters[static_cast<size_t> (band)];
+        const auto& coeffs = crossoverCoeffs[static_cast<size_t> (band)];
+
+        for (int i = 0; i < numSamples; ++i)
+            splitter.process (coeffs, low[i], low[i], high[i]);
+    }
+}
+
+HearingCorrectionAUv2AudioProcessor::WDRCMode HearingCorrectionAUv2AudioProcessor::getWDRCMode (int governorTier) const noexcept
+{
+    WDRCMode mode;
+    mode.gainInterval = governorTier >= QualityGovernor::controlRateGains ? controlRateInterval : 1;
+    mode.mergedBands = governorTier >= QualityGovernor::mergedBands;
+
+    // A fully linked detector is the shared one, whether the user or the governor asks for it
+    mode.linkedDetection = governorTier >= QualityGovernor::linkedDetection || stereoLinkParam->load() >= 100.0f;
+    mode.averageLink = linkDetectorParam->load() > 0.5f;
+    mode.energyDetector = levelDetectorParam->load() > 0.5f;
+    return mode;
+}
+
+void HearingCorrectionAUv2AudioProcessor::setWDRCMode (const WDRCMode& newMode) noexcept
+{
+    if (newMode == activeWDRCMode)
+        return;
+
+    // The old mode carries on from the current state until the fade ends
+    fadingWDRCMode = activeWDRCMode;
+    fadeLeftWDRC = leftWDRC;
+    fadeRightWDRC = rightWDRC;
+    wdrcFadePosition = 0;
+
+    // Start the new mode's detectors from where the old ones were
+    for (auto* bands : { &leftWDRC, &rightWDRC })
+    {
+        for (int band = 0; band < numAudiogramBands; band += 2)
+        {
+            auto& lower = (*bands)[static_cast<size_t> (band)];
+            auto& upper = (*bands)[static_cast<size_t> (band + 1)];
+
+            if (newMode.mergedBands && ! activeWDRCMode.mergedBands)
+            {
+                // The pair runs on the lower band's state and hears both
+                lower.envelope = std::max (lower.envelope, upper.envelope);
+            }
+            else if (! newMode.mergedBands && activeWDRCMode.mergedBands)
+            {
+                upper.envelope = lower.envelope;
+                upper.smoothedGain = lower.smoothedGain;
+            }
+        }
+    }
+
+    if (newMode.linkedDetection && ! activeWDRCMode.linkedDetection)
+    {
+        for (int band = 0; band < numAudiogramBands; ++band)
+        {
+            auto& l = leftWDRC[static_cast<size_t> (band)].envelope;
+            auto& r = rightWDRC[static_cast<size_t> (band)].envelope;
+            l = r = newMode.averageLink ? 0.5f * (l + r) : std::max (l, r);
+        }
+    }
+
+    activeWDRCMode = newMode;
+}
+
+void HearingCorrectionAUv2AudioProcessor::processWDRCStage (const WDRCMode& mode, WDRCBands& left, WDRCBands& right,
+                                                            juce::AudioBuffer<float>& bands, float* const* outputs,
+                                                            const bool* earEnabled, int numSamples) noexcept
+{
+    WDRCBands* states[2] = { &left, &right };
+
+    for (int ear = 0; ear < 2; ++ear)
+        if (earEnabled[ear])
+            juce::FloatVectorOperations::clear (outputs[ear], numSamples);
+
+    // Merged: each pair's upper band is folded into the lower one, which then stands for both
+    const int bandStep = mode.mergedBands ? 2 : 1;
+    const auto& table = mode.mergedBands ? wdrcTable->mergedBands : wdrcTable->bands;
+
+    for (int band = 0; band < numAudiogramBands; band += bandStep)
+    {
+        float* samples[2];
+
+        for (int ear = 0; ear < 2; ++ear)
+        {
+            samples[ear] = bands.getWritePointer (ear * numAudiogramBands + band);
 
-                // Sum this band to output
-                leftOut += leftBand;
-                rightOut += rightBand;
+            if (mode.mergedBands)
+                juce::FloatVectorOperations::add (samples[ear], bands.getReadPointer (ear * numAudiogramBands + band + 1), numSamples);
+        }
+
+        if (mode.linkedDetection)
+        {
+            processLinkedWDRCBand (left[static_cast<size_t> (band)], right[static_cast<size_t> (band)], table, band,
+                                   samples, earEnabled, numSamples, mode);
+        }
+        else
+        {
+            // Partly linked: each ear's detector hears a blend of its own level and the link's,
+            // taken before either ear's gain is applied
+            const float* detectors[2] = { samples[0], samples[1] };
+
+            if (stereoLinkAmount > 0.0f)
+            {
+                float* blended[2] = { linkDetectorBuffer.getWritePointer (0), linkDetectorBuffer.getWritePointer (1) };
+                blendLinkedLevels (samples, blended, numSamples, stereoLinkAmount, mode.averageLink);
+                detectors[0] = blended[0];
+                detectors[1] = blended[1];
             }
 
-            // If ear is disabled, pass through original signal
-            leftChannel[sample]  = leftEnabled ? leftOut : leftIn;
-            rightChannel[sample] = rightEnabled ? rightOut : rightIn;
+            // Apply WDRC to this band if it has any gain to give
+            for (int ear = 0; ear < 2; ++ear)
+            {
+                const int index = ear * numAudiogramBands + band;
+
+                if (! earEnabled[ear] || table.targetDb[static_cast<size_t> (index)] <= 0.0f)
+                    continue;
+
+                auto& state = (*states[ear])[static_cast<size_t> (band)];
+
+                processWDRCBand (state, table, index, samples[ear], detectors[ear], numSamples, mode);
+            }
         }
+
+        // Sum this band to output
+        for (int ear = 0; ear < 2; ++ear)
+            if (earEnabled[ear])
+                juce::FloatVectorOperations::add (outputs[ear], samples[ear], numSamples);
     }
+}
 
-    // Output gain with smoothing
-    const float targetGain = juce::Decibels::decibelsToGain (outputGainParam->load());
+void HearingCorrectionAUv2AudioProcessor::blendLinkedLevels (const float* const* samples, float* const* levels,
+                                                             int numSamples, float amount, bool average) noexcept
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float left = std::abs (samples[0][i]);
+        const float right = std::abs (samples[1][i]);
+        const float linked = average ? 0.5f * (left + right) : std::max (left, right);
+
+        levels[0][i] = left + amount * (linked - left);
+        levels[1][i] = right + amount * (linked - right);
+    }
+}
 
-    if (std::abs (targetGain - previousGain) > 0.0001f)
+void HearingCorrectionAUv2AudioProcessor::processWDRCBand (WDRCBandState& state, const WDRCBandTable& table, int index,
+                                                           float* samples, const float* detector, int numSamples,
+                                                           const WDRCMode& mode) const noexcept
+{
+    const auto i0 = static_cast<size_t> (index);
+
+    WDRCKernel::Lanes<1> lanes;
+    lanes.envelope[0] = state.envelope;
+    lanes.smoothedGain[0] = state.smoothedGain;
+    lanes.attackCoeff[0] = table.attackCoeff[i0];
+    lanes.releaseCoeff[0] = table.releaseCoeff[i0];
+    lanes.gainSmoothCoeff[0] = wdrcTable->gainSmoothCoeff;
+    lanes.tracking[0] = lanes.active[0] = true;
+
+    // WDRC gain for the envelope level, from the band's compiled curve (or its flat gain)
+    auto gainLaw = [&table, i0] (int, float inputDb) { return getBandGain (table, i0, inputDb); };
+    auto apply = [samples] (int i, const float* gains) { samples[i] *= gains[0]; };
+
+    if (mode.energyDetector)
     {
-        buffer.applyGainRamp (0, numSamples, previousGain, targetGain);
-        previousGain = targetGain;
+        WDRCKernel::processEnergy (lanes, numSamples,
+                                   [detector] (int start, int length, float* meanSquares)
+                                   {
+                                       meanSquares[0] = WDRCKernel::getMeanSquare (detector + start, length);
+                                   },
+                                   gainLaw, apply);
     }
     else
     {
-        buffer.applyGain (targetGain);
+        WDRCKernel::processPeak (lanes, numSamples, mode.gainInterval,
+                                 [detector] (int i, float* levels) { levels[0] = std::abs (detector[i]); },
+                                 gainLaw, apply);
     }
 
-    // Measure output levels
-    if (buffer.getNumChannels() >= 2)
+    state.envelope = lanes.envelope[0];
+    state.smoothedGain = lanes.smoothedGain[0];
+}
+
+void HearingCorrectionAUv2AudioProcessor::processLinkedWDRCBand (WDRCBandState& left, WDRCBandState& right,
+                                                                 const WDRCBandTable& table, int band,
+                                                                 float* const* samples, const bool* earEnabled,
+                                                                 int numSamples, const WDRCMode& mode) const noexcept
+{
+    // One detector on the louder ear (or the ears' average), kept in the left state, with the
+    // slower of the ears' time constants; each ear keeps its own gain law
+    WDRCBandState* states[2] = { &left, &right };
+    const size_t index[2] = { static_cast<size_t> (band), static_cast<size_t> (numAudiogramBands + band) };
+    const float attackCoeff = std::max (table.attackCoeff[index[0]], table.attackCoeff[index[1]]);
+    const float releaseCoeff = std::max (table.releaseCoeff[index[0]], table.releaseCoeff[index[1]]);
+    const bool average = mode.averageLink;
+
+    WDRCKernel::Lanes<2> lanes;
+
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        lanes.envelope[ear] = left.envelope;
+        lanes.smoothedGain[ear] = states[ear]->smoothedGain;
+        lanes.attackCoeff[ear] = attackCoeff;
+        lanes.releaseCoeff[ear] = releaseCoeff;
+        lanes.gainSmoothCoeff[ear] = wdrcTable->gainSmoothCoeff;
+        lanes.tracking[ear] = true;
+        lanes.active[ear] = earEnabled[ear] && table.targetDb[index[ear]] > 0.0f;
+    }
+
+    auto gainLaw = [&table, &index] (int ear, float inputDb) { return getBandGain (table, index[ear], inputDb); };
+    auto apply = [samples] (int i, const float* gains)
+    {
+        samples[0][i] *= gains[0];
+        samples[1][i] *= gains[1];
+    };
+
+    if (mode.energyDetector)
+    {
+        // The linked energy of the sub-block, before its gains are applied
+        WDRCKernel::processEnergy (lanes, numSamples,
+                                   [samples, average] (int start, int length, float* meanSquares)
+                                   {
+                                       const float leftEnergy = WDRCKernel::getMeanSquare (samples[0] + start, length);
+                                       const float rightEnergy = WDRCKernel::getMeanSquare (samples[1] + start, length);
+                                       meanSquares[0] = meanSquares[1] = average ? 0.5f * (leftEnergy + rightEnergy)
+                                                                                 : std::max (leftEnergy, rightEnergy);
+                                   },
+                                   gainLaw, apply);
+    }
+    else
     {
-        outputLevelLeft.store (buffer.getMagnitude (0, 0, numSamples), std::memory_order_relaxed);
-        outputLevelRight.store (buffer.getMagnitude (1, 0, numSamples), std::memory_order_relaxed);
+        WDRCKernel::processPeak (lanes, numSamples, mode.gainInterval,
+                                 [samples, average] (int i, float* levels)
+                                 {
+                                     const float leftLevel = std::abs (samples[0][i]);
+                                     const float rightLevel = std::abs (samples[1][i]);
+                                     levels[0] = levels[1] = average ? 0.5f * (leftLevel + rightLevel)
+                                                                     : std::max (leftLevel, rightLevel);
+                                 },
+                                 gainLaw, apply);
     }
+
+    left.envelope = right.envelope = lanes.envelope[0];
+    left.smoothedGain = lanes.smoothedGain[0];
+    right.smoothedGain = lanes.smoothedGain[1];
+}
+
+//==============================================================================
+void HearingCorrectionAUv2AudioProcessor::holdQualityTier (int tier)
+{
+    heldQualityTier.store (tier < 0 ? -1 : juce::jmin (tier, QualityGovernor::numTiers - 1), std::memory_order_relaxed);
+
+    // Offline tools may have no message loop to run the timer
+    const bool reduce = getQualityTier() >= QualityGovernor::fewerHeadphoneSections;
+    headphoneEQ.setSectionBudget (reduce ? reducedHeadphoneSections : 0);
+}
+
+int HearingCorrectionAUv2AudioProcessor::getQualityTier() const noexcept
+{
+    const auto held = heldQualityTier.load (std::memory_order_relaxed);
+    return held >= 0 ? held : qualityGovernor.getTier();
+}
+
+int HearingCorrectionAUv2AudioProcessor::updateQualityGovernor (int numSamples) noexcept
+{
+    const auto utilisation = callbackMonitor.takeLastUtilisation();
+
+    if (const auto held = heldQualityTier.load (std::memory_order_relaxed); held >= 0)
+        return held;
+
+    // Offline renders have no deadline, and the governor can be switched off
+    if (isNonRealtime() || autoQualityParam->load() < 0.5f)
+    {
+        qualityGovernor.reset();
+        return QualityGovernor::fullQuality;
+    }
+
+    if (utilisation < 0.0)
+        return qualityGovernor.getTier();
+
+    return qualityGovernor.update (utilisation, numSamples / currentSampleRate);
+}
+
+void HearingCorrectionAUv2AudioProcessor::timerCallback()
+{
+    {
+        const juce::ScopedLock lock (wdrcTableLock);
+        updateWDRCTable();
+    }
+
+    // Redesigned off the audio thread and crossfaded in by the headphone EQ itself
+    const bool reduce = getQualityTier() >= QualityGovernor::fewerHeadphoneSections;
+    headphoneEQ.setSectionBudget (reduce ? reducedHeadphoneSections : 0);
+
+    // An FIR mode's latency applies once its background design is published
+    if (headphoneEQ.getLatencySamples() + outputLimiter.getLatencySamples() != getLatencySamples())
+        updateLatency();
 }
 
 //==============================================================================
@@ -551,6 +1264,129 @@ void HearingCorrectionAUv2AudioProcessor::loadHeadphoneProfile (const juce::Stri
     }
 }
 
+void HearingCorrectionAUv2AudioProcessor::setHeadphoneEQMode (HeadphoneEQMode mode)
+{
+    headphoneEQ.setMode (mode);
+    headphoneEQModeIndex.store (static_cast<int> (mode), std::memory_order_relaxed);
+    updateLatency();
+}
+
+void HearingCorrectionAUv2AudioProcessor::updateLatency()
+{
+    setLatencySamples (headphoneEQ.getLatencySamples() + outputLimiter.getLatencySamples());
+}
+
+void HearingCorrectionAUv2AudioProcessor::processBypassDelay (juce::AudioBuffer<float>& buffer, bool bypassed) noexcept
+{
+    if (bypassDelayLines[0].empty())
+        return;
+
+    const int numSamples = buffer.getNumSamples();
+    const int numChannels = juce::jmin (2, buffer.getNumChannels());
+    const int delay = juce::jmin (getLatencySamples(), bypassDelayMask);
+    const bool fading = ! bypassed && bypassFadePosition < bypassFadeEnd;
+    const int numFadeSamples = fading ? juce::jmin (numSamples, bypassFadeBuffer.getNumSamples()) : 0;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* line = bypassDelayLines[static_cast<size_t> (ch)].data();
+        auto* data = buffer.getWritePointer (ch);
+        auto* dry = bypassFadeBuffer.getWritePointer (ch);
+        int position = bypassWritePosition;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            line[position] = data[i];
+            const float delayed = line[(position - delay) & bypassDelayMask];
+
+            if (bypassed)
+                data[i] = delayed;
+            else if (i < numFadeSamples)
+                dry[i] = delayed;
+
+            position = (position + 1) & bypassDelayMask;
+        }
+    }
+
+    bypassWritePosition = (bypassWritePosition + numSamples) & bypassDelayMask;
+}
+
+void HearingCorrectionAUv2AudioProcessor::clearWetChain()
+{
+    for (int i = 0; i < numCrossovers; ++i)
+    {
+        leftCrossover[i].reset();
+        rightCrossover[i].reset();
+    }
+
+    headphoneEQ.clearActiveState();
+    userIR.clearActiveState();
+    outputLimiter.reset();
+    outputMeter.reset();
+
+    // Cleared, the chain outputs silence for its latency, so the dry input carries on alone until then
+    bypassFadePosition = 0;
+    bypassFadeEnd = getLatencySamples() + bypassFadeLength;
+}
+
+void HearingCorrectionAUv2AudioProcessor::processBypassFade (juce::AudioBuffer<float>& buffer) noexcept
+{
+    if (bypassFadePosition >= bypassFadeEnd)
+        return;
+
+    const int numSamples = juce::jmin (buffer.getNumSamples(), bypassFadeBuffer.getNumSamples());
+    const int numChannels = juce::jmin (2, buffer.getNumChannels());
+    const int fadeStart = bypassFadeEnd - bypassFadeLength;
+    const float fadeStep = 1.0f / static_cast<float> (bypassFadeLength);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* output = buffer.getWritePointer (ch);
+        const auto* dry = bypassFadeBuffer.getReadPointer (ch);
+
+        // Linear: dry and wet carry the same, highly correlated signal
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float amount = juce::jlimit (0.0f, 1.0f, static_cast<float> (bypassFadePosition + i - fadeStart) * fadeStep);
+            output[i] = dry[i] + amount * (output[i] - dry[i]);
+        }
+    }
+
+    // A block longer than the prepared size ends the fade: only its start was buffered
+    bypassFadePosition = buffer.getNumSamples() > numSamples ? bypassFadeEnd : bypassFadePosition + numSamples;
+}
+
+//==============================================================================
+juce::var HearingCorrectionAUv2AudioProcessor::createDiagnosticsDump() const
+{
+    auto* root = new juce::DynamicObject();
+    root->setProperty ("plugin", juce::String (ProjectInfo::projectName) + " " + ProjectInfo::versionString);
+    root->setProperty ("format", juce::AudioProcessor::getWrapperTypeDescription (wrapperType));
+    root->setProperty ("host", juce::PluginHostType().getHostDescription());
+    root->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+    root->setProperty ("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty ("time", juce::Time::getCurrentTime().toISO8601 (true));
+
+    // The current settings, in the same form as each worst callback's
+    root->setProperty ("engine", CallbackMonitor::toVar (getEngineConfiguration (preparedBlockSize)));
+    root->setProperty ("headphoneProfile", selectedHeadphoneName);
+    root->setProperty ("callbacks", callbackMonitor.toVar());
+
+   #if EARFIX_STAGE_TIMING
+    root->setProperty ("stageTimings", stageTimings.toVar());
+   #endif
+
+    return juce::var (root);
+}
+
+juce::Result HearingCorrectionAUv2AudioProcessor::writeDiagnosticsDump (const juce::File& file) const
+{
+    if (! file.replaceWithText (juce::JSON::toString (createDiagnosticsDump())))
+        return juce::Result::fail ("Can't write " + file.getFullPathName());
+
+    return juce::Result::ok();
+}
+
 //==============================================================================
 void HearingCorrectionAUv2AudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
@@ -558,6 +1394,11 @@ void HearingCorrectionAUv2AudioProcessor::getStateInformation (juce::MemoryBlock
 
     // Add headphone name to state
     state.setProperty ("headphoneName", selectedHeadphoneName, nullptr);
+    state.setProperty ("headphoneEQMode", static_cast<int> (headphoneEQ.getMode()), nullptr);
+
+    // User IR files (full paths; empty when unused)
+    state.setProperty ("userIRLeft", userIR.getImpulseResponseFile (UserIRStage::Ear::Left).getFullPathName(), nullptr);
+    state.setProperty ("userIRRight", userIR.getImpulseResponseFile (UserIRStage::Ear::Right).getFullPathName(), nullptr);
 
     if (auto xml = state.createXml())
         copyXmlToBinary (*xml, destData);
@@ -571,10 +1412,26 @@ void HearingCorrectionAUv2AudioProcessor::setStateInformation (const void* data,
         {
             parameters.replaceState (juce::ValueTree::fromXml (*xml));
 
+            // Restore correction mode first so the profile is only designed once
+            const int modeIndex = parameters.state.getProperty ("headphoneEQMode", 0);
+            setHeadphoneEQMode (static_cast<HeadphoneEQMode> (juce::jlimit (0, 2, modeIndex)));
+
             // Restore headphone profile
             auto headphoneName = parameters.state.getProperty ("headphoneName").toString();
             if (headphoneName.isNotEmpty())
                 loadHeadphoneProfile (headphoneName);
+
+            // Restore user IRs (a file that has since gone missing leaves that ear uncorrected)
+            for (auto [ear, key] : { std::pair { UserIRStage::Ear::Left, "userIRLeft" },
+                                     std::pair { UserIRStage::Ear::Right, "userIRRight" } })
+            {
+                auto path = parameters.state.getProperty (key).toString();
+
+                const bool loaded = path.isNotEmpty() && userIR.loadImpulseResponse (ear, juce::File (path));
+
+                if (!loaded && userIR.getImpulseResponseFile (ear) != juce::File())
+                    userIR.clearImpulseResponse (ear);
+            }
         }
     }
 }
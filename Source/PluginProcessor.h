@@ -16,10 +16,25 @@
 #include "Models/HalfGainModel.h"
 #include "Models/NALModel.h"
 #include "Models/MOSLModel.h"
+#include "Models/NALNL2Model.h"
 #include "HeadphoneEQ.h"
+#include "UserIRStage.h"
+#include "DSP/LinkwitzRileyCrossover.h"
+#include "DSP/SlotMailbox.h"
+#include "DSP/QualityGovernor.h"
+#include "DSP/LoudnessRestorer.h"
+#include "DSP/FastDecibels.h"
+#include "DSP/WDRCKernel.h"
+#include "DSP/LookaheadLimiter.h"
+#include "DSP/TruePeakDetector.h"
+#include "Diagnostics/CallbackMonitor.h"
+#include "Diagnostics/StageTimings.h"
+#include "Diagnostics/TraceRecorder.h"
+#include "Diagnostics/RealtimeSafety.h"
 
 //==============================================================================
-class HearingCorrectionAUv2AudioProcessor  : public juce::AudioProcessor
+class HearingCorrectionAUv2AudioProcessor  : public juce::AudioProcessor,
+                                             private juce::Timer
 {
 public:
     //==============================================================================
@@ -62,6 +77,12 @@ public:
     //==============================================================================
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
+   #if EARFIX_TRACING
+    // Keeps the trace recording while this processor exists; declared before the
+    // other members so the headphone database load in their constructors is traced
+    TraceRecorder::Session traceSession;
+   #endif
+
     juce::AudioProcessorValueTreeState parameters { *this, nullptr, "PARAMETERS", createParameterLayout() };
 
     //==============================================================================
@@ -74,11 +95,12 @@ public:
     // Processing bands (audiogram + interpolated intermediate bands)
     static constexpr int numFilterBands = 11;
 
-    // Level metering (read by UI)
+    // Level metering (read by UI): true peaks, linear
     std::atomic<float> inputLevelLeft { 0.0f };
     std::atomic<float> inputLevelRight { 0.0f };
     std::atomic<float> outputLevelLeft { 0.0f };
     std::atomic<float> outputLevelRight { 0.0f };
+    std::atomic<float> limiterGain { 1.0f };       // Lowest output limiter gain in the last block
     static constexpr std::array<float, numFilterBands> filterFrequencies = {
         250.0f,    // Audiogram band 0
         354.0f,    // Interpolated (geometric mean of 250 & 500)
@@ -109,16 +131,189 @@ public:
     /** Reloads the headphone database (for UI refresh button). */
     void reloadHeadphoneDatabase() { headphoneEQ.loadDatabase(); }
 
+    /** Selects parametric or FIR headphone correction and updates the reported latency. */
+    void setHeadphoneEQMode (HeadphoneEQMode mode);
+
+    /** Returns the current headphone correction mode. */
+    HeadphoneEQMode getHeadphoneEQMode() const { return headphoneEQ.getMode(); }
+
+    //==============================================================================
+    // User impulse responses (measured headphone / earpiece IRs, one per ear)
+    UserIRStage userIR;
+
+    /** Selects an IR file for one ear; loads in the background. Returns false if the file doesn't exist. */
+    bool loadUserImpulseResponse (UserIRStage::Ear ear, const juce::File& file) { return userIR.loadImpulseResponse (ear, file); }
+
+    /** Removes the IR for one ear. */
+    void clearUserImpulseResponse (UserIRStage::Ear ear) { userIR.clearImpulseResponse (ear); }
+
+    /** Returns the IR file selected for an ear, or an empty File. */
+    juce::File getUserImpulseResponseFile (UserIRStage::Ear ear) const { return userIR.getImpulseResponseFile (ear); }
+
+    //==============================================================================
+    // Band split and WDRC settings, for offline tools that run these stages
+    // themselves (EarFixRender's multi-listener batch)
+    static constexpr int numCrossovers = 5;
+    using CrossoverDesign = std::array<LinkwitzRileyCoefficients, numCrossovers>;
+
+    // Crossover frequencies at geometric means between audiogram bands
+    static constexpr std::array<float, numCrossovers> crossoverFrequencies = {
+        354.0f, 707.0f, 1414.0f, 2828.0f, 5657.0f
+    };
+
+    // WDRC gain law: full target gain below the threshold, compressed above it.
+    // Models give their thresholds in dB SPL; 0 dBFS is taken as wdrcFullScaleDbSpl,
+    // which puts NAL's 50 dB SPL threshold on the original -40 dBFS kneepoint.
+    // Models without compression of their own keep that kneepoint.
+    static constexpr float wdrcKneepointDb = -40.0f;
+    static constexpr float wdrcFullScaleDbSpl = 90.0f;
+
+    // Each band's gain law is compiled into a level -> gain curve, sampled every 1 dB
+    // from 20 to 100 dB SPL input and held flat beyond; levels in dBFS at run time
+    static constexpr int numGainCurvePoints = 81;
+    static constexpr float gainCurveMinDbSpl = 20.0f;
+    static constexpr float gainCurveMinDb = gainCurveMinDbSpl - wdrcFullScaleDbSpl;
+
+    using GainCurve = std::array<float, numGainCurvePoints>;     // Linear gains
+
+    struct WDRCSettings
+    {
+        CrossoverDesign crossover;
+
+        // Per band, from the model: gain for soft sounds (dB), nominal compression ratio,
+        // level -> gain curve, envelope attack / release coefficients
+        std::array<float, numAudiogramBands> leftTargetsDb {}, rightTargetsDb {};
+        std::array<float, numAudiogramBands> leftRatios {}, rightRatios {};
+        std::array<GainCurve, numAudiogramBands> leftGainCurves {}, rightGainCurves {};
+        std::array<float, numAudiogramBands> leftAttackCoeffs {}, rightAttackCoeffs {};
+        std::array<float, numAudiogramBands> leftReleaseCoeffs {}, rightReleaseCoeffs {};
+
+        float gainSmoothCoeff = 0.0f;
+
+        // MOSL Loudness: the gains follow the signal, so the targets above are only a snapshot;
+        // a LoudnessRestorer with this fitting gives each block's targets
+        bool loudnessRestoration = false;
+        LoudnessRestorer::Fitting loudnessFitting;
+        float loudnessStrength = 1.0f;
+        float loudnessMaxBoostDb = 0.0f;
+
+        // Detectors that hear the other ear (0 = independent ears, 1 = one shared detector),
+        // moved towards the louder ear's level or the ears' average
+        float stereoLink = 0.0f;
+        bool averageLink = false;
+
+        // RMS level detection (sub-block energy) rather than the peak follower
+        bool energyDetector = false;
+
+        bool leftEnabled = true;
+        bool rightEnabled = true;
+        float outputGain = 1.0f;    // Linear
+        float outputCeiling = 1.0f; // Linear, for the output limiter
+
+        double sampleRate = 44100.0;
+    };
+
+    /** Returns the settings derived from the current parameters. Call after prepareToPlay(). */
+    WDRCSettings getWDRCSettings() const;
+
+    /** Runs the stages before the band split (headphone EQ, user IRs) in place. */
+    void processFrontEnd (juce::AudioBuffer<float>& buffer);
+
+    // Per-band envelope and smoothed gain (both linear) of one ear's WDRC
+    struct WDRCBandLevels
+    {
+        std::array<float, numAudiogramBands> envelopes {}, gains {};
+    };
+
+    /** Returns the WDRC state after the last processed sample (ear 0 = left, 1 = right).
+        Reads audio-thread state unsynchronised: only call it between processBlock() calls.
+    */
+    WDRCBandLevels getWDRCBandLevels (int ear) const;
+
+    /** WDRC gain in dB for a band's envelope level (dBFS): the soft-sound target up to the
+        threshold, less slope (1 - 1 / ratio) dB per dB above it but never below 0 dB, plus makeup.
+    */
+    static float calculateWDRCGain (float inputLevelDb, float targetGainDb, float thresholdDb,
+                                    float slope, float makeupDb) noexcept
+    {
+        const float overThreshold = std::max (0.0f, inputLevelDb - thresholdDb);
+        return std::max (0.0f, targetGainDb - overThreshold * slope) + makeupDb;
+    }
+
+    /** Linear gain from a band's gain curve for an envelope level in dBFS, interpolated
+        between the 1 dB points: one table lookup, whatever the model's law.
+    */
+    static float lookupGainCurve (const float* curve, float inputLevelDb) noexcept
+    {
+        const float position = juce::jlimit (0.0f, static_cast<float> (numGainCurvePoints - 1), inputLevelDb - gainCurveMinDb);
+        const int index = std::min (static_cast<int> (position), numGainCurvePoints - 2);
+        const float fraction = position - static_cast<float> (index);
+        return curve[index] + fraction * (curve[index + 1] - curve[index]);
+    }
+
+    /** Compression ratio for models without their own, from a band's soft-sound target
+        (more correction = more compression).
+    */
+    static float getCompressionRatio (float targetGainDb) { return juce::jlimit (1.5f, 4.0f, 1.0f + targetGainDb / 30.0f); }
+
+    //==============================================================================
+    // Callback deadline monitoring (always on; shown with Cmd/Ctrl+Shift+D)
+    CallbackMonitor callbackMonitor;
+
+    // Steps quality down when callbacks run close to their deadline ("autoQuality"
+    // parameter; never during offline renders). The editor shows its tier.
+    QualityGovernor qualityGovernor;
+
+    /** Runs at a fixed governor tier regardless of load (-1 hands control back to the
+        governor). For offline tools that render each tier, since offline renders
+        otherwise always run at full quality. Message thread, before prepareToPlay.
+    */
+    void holdQualityTier (int tier);
+
+    /** Everything support needs about a running instance: host, settings, callback
+        deadlines and (in EARFIX_STAGE_TIMING builds) stage timings. Message thread.
+    */
+    juce::var createDiagnosticsDump() const;
+
+    /** Writes createDiagnosticsDump() as JSON. */
+    juce::Result writeDiagnosticsDump (const juce::File& file) const;
+
+   #if EARFIX_STAGE_TIMING
+    //==============================================================================
+    // Per-stage CPU timings of processBlock() (EARFIX_STAGE_TIMING builds only)
+    StageTimings stageTimings;
+   #endif
+
 private:
     //==============================================================================
-    // Correction models
+    // Correction models (configured and queried only while compiling the WDRC table)
     HalfGainModel halfGainModel;
     NALModel nalModel;
     MOSLModel moslModel;
-    CorrectionModel* currentModel = &halfGainModel;
-
+    NALNL2Model nalNL2Model;
+
+    /** Calls function with the selected model as its own (final) type, so each model's
+        calls are resolved at compile time and inlined into a specialised instantiation.
+        MOSL Loudness (4) compiles MOSL's table, which its restorer then overrides.
+    */
+    template <typename Function>
+    void visitCurrentModel (Function&& function)
+    {
+        switch (static_cast<int> (modelSelectParam->load()))
+        {
+            case 0:  function (halfGainModel); break;
+            case 1:  function (nalModel); break;
+            case 3:  function (nalNL2Model); break;
+            default: function (moslModel); break;
+        }
+    }
+
+    /** Applies the strength, speed and experience parameters to the selected model. */
     void updateCurrentModel();
 
+    /** The settings the callback monitor records against each callback. Audio thread. */
+    CallbackMonitor::EngineConfiguration getEngineConfiguration (int numSamples) const noexcept;
+
     //==============================================================================
     // Cached parameter pointers
     std::atomic<float>* bypassParam           = nullptr;
@@ -131,29 +326,77 @@ private:
     std::atomic<float>* leftEnableParam       = nullptr;
     std::atomic<float>* rightEnableParam      = nullptr;
     std::atomic<float>* headphoneEQEnableParam = nullptr;
+    std::atomic<float>* autoQualityParam      = nullptr;
+    std::atomic<float>* stereoLinkParam       = nullptr;
+    std::atomic<float>* linkDetectorParam     = nullptr;
+    std::atomic<float>* levelDetectorParam    = nullptr;
+    std::atomic<float>* outputCeilingParam    = nullptr;
 
     // Headphone profile name (stored separately as strings aren't supported in APVTS)
     juce::String selectedHeadphoneName;
 
+    // The headphone EQ mode, readable from the audio thread (for the callback monitor)
+    std::atomic<int> headphoneEQModeIndex { 0 };
+
     std::array<std::atomic<float>*, numAudiogramBands> leftAudiogramParams;
     std::array<std::atomic<float>*, numAudiogramBands> rightAudiogramParams;
 
     // Gain smoothing
     float previousGain = 1.0f;
 
+    // Final stage: holds the output's true peak below the ceiling, with a fixed lookahead latency
+    LookaheadLimiter outputLimiter;
+
+    // 4x true-peak measurement for the level meters
+    TruePeakDetector inputMeter, outputMeter;
+
+    /** Reports the headphone EQ's latency plus the limiter's. */
+    void updateLatency();
+
+    // The dry input delayed by the reported latency, so bypass stays aligned with the
+    // host's latency compensation; fed every block so it is ready when bypass engages
+    std::array<std::vector<float>, 2> bypassDelayLines;
+    int bypassDelayMask = 0;
+    int bypassWritePosition = 0;
+
+    /** Pushes the input into the bypass delay; when bypassed, replaces it with the delayed input,
+        and while un-bypassing copies the delayed input into bypassFadeBuffer.
+    */
+    void processBypassDelay (juce::AudioBuffer<float>& buffer, bool bypassed) noexcept;
+
+    // Coming out of bypass, the wet chain is cleared of the audio it held from before bypass
+    // engaged and faded in from the delayed dry input: the dry alone while the cleared chain
+    // refills its latency, then a linear crossfade
+    static constexpr double bypassFadeMs = 10.0;
+    juce::AudioBuffer<float> bypassFadeBuffer;
+    int bypassFadeLength = 0;
+    int bypassFadePosition = 0;         // Samples since bypass ended
+    int bypassFadeEnd = 0;              // Latency plus fade length; no fade once reached
+    bool wasBypassed = false;
+
+    /** Clears the stages that hold audio (crossovers, headphone EQ, user IRs, limiter and output
+        meter) and starts the fade from the dry input. Audio thread.
+    */
+    void clearWetChain();
+
+    /** Mixes the delayed dry input into the wet output while fading in after bypass. */
+    void processBypassFade (juce::AudioBuffer<float>& buffer) noexcept;
+
     //==============================================================================
-    // Linkwitz-Riley Multiband Crossover (5 crossovers for 6 bands)
-    // Crossover frequencies at geometric means between audiogram bands
-    static constexpr int numCrossovers = 5;
-    static constexpr std::array<float, numCrossovers> crossoverFrequencies = {
-        354.0f, 707.0f, 1414.0f, 2828.0f, 5657.0f
-    };
+    // Linkwitz-Riley Multiband Crossover (5 crossovers for 6 bands, at crossoverFrequencies)
+
+    // Per-channel crossover splitters (each yields the LP and HP outputs)
+    CrossoverDesign crossoverCoeffs;
+    std::array<LinkwitzRileySplitter, numCrossovers> leftCrossover;
+    std::array<LinkwitzRileySplitter, numCrossovers> rightCrossover;
+
+    static CrossoverDesign designCrossover (double sampleRate);
+
+    // Band signals for one run of the split / WDRC / sum: channel ear * numAudiogramBands + band,
+    // left ear first. Sized in prepareToPlay(); longer host blocks are processed in pieces.
+    juce::AudioBuffer<float> bandBuffers;
 
-    // Per-channel crossover filters (LP and HP pairs)
-    std::array<juce::dsp::LinkwitzRileyFilter<float>, numCrossovers> leftLowpass;
-    std::array<juce::dsp::LinkwitzRileyFilter<float>, numCrossovers> leftHighpass;
-    std::array<juce::dsp::LinkwitzRileyFilter<float>, numCrossovers> rightLowpass;
-    std::array<juce::dsp::LinkwitzRileyFilter<float>, numCrossovers> rightHighpass;
+    void splitBands (std::array<LinkwitzRileySplitter, numCrossovers>& splitters, int ear, int numSamples) noexcept;
 
     //==============================================================================
     // True WDRC state per band per ear
@@ -161,24 +404,175 @@ private:
     {
         float envelope = 0.0f;           // Envelope follower state
         float smoothedGain = 0.0f;       // Smoothed gain value
-        float targetGainForSoftSounds = 0.0f;  // Max gain (for quiet inputs)
     };
 
     std::array<WDRCBandState, numAudiogramBands> leftWDRC;
     std::array<WDRCBandState, numAudiogramBands> rightWDRC;
 
-    float attackCoeff = 0.0f;
-    float releaseCoeff = 0.0f;
-    float gainSmoothCoeff = 0.0f;  // For smooth gain transitions
+    using WDRCBands = std::array<WDRCBandState, numAudiogramBands>;
 
-    void updateWDRCCoefficients();
-    void updateCrossoverCoefficients();
+    // Per-band WDRC parameters compiled from the model, as structure-of-arrays
+    // indexed ear * numAudiogramBands + band (left first)
+    struct WDRCBandTable
+    {
+        static constexpr int size = 2 * numAudiogramBands;
+
+        std::array<float, size> targetDb {};        // Gain for soft sounds
+        std::array<float, size> thresholdDb {};     // dBFS
+        std::array<float, size> slope {};           // 1 - 1 / ratio
+        std::array<float, size> makeupDb {};
+        std::array<float, size> attackCoeff {};
+        std::array<float, size> releaseCoeff {};
+
+        // What the audio thread applies: the model's own level -> gain curve, or for models
+        // whose gain doesn't depend on level, the law above (threshold, slope, makeup) sampled
+        std::array<GainCurve, size> gainCurve {};
+
+        // Loudness restoration: one gain per band, whatever the level, in place of the curves
+        bool flatGains = false;
+        std::array<float, size> flatGain {};        // Linear
+    };
+
+    /** Linear gain for a band at an envelope level (dBFS): its flat gain, or from its curve. */
+    static float getBandGain (const WDRCBandTable& table, size_t index, float inputLevelDb) noexcept
+    {
+        return table.flatGains ? table.flatGain[index] : lookupGainCurve (table.gainCurve[index].data(), inputLevelDb);
+    }
 
-    // Calculate WDRC gain based on input level and hearing loss
-    float calculateWDRCGain (float inputLevelDb, float hearingLossDb, float maxBoostDb) const;
+    struct WDRCTable
+    {
+        WDRCBandTable bands;
+        WDRCBandTable mergedBands;      // Each pair combined into its lower band (merged-bands tier)
+        float gainSmoothCoeff = 0.0f;   // For smooth gain transitions
+
+        // MOSL Loudness: the bands' gains come from the loudness restorer each block
+        bool loudnessRestoration = false;
+        LoudnessRestorer::Fitting loudnessFitting;
+        float loudnessStrength = 1.0f;
+        float loudnessMaxBoostDb = 0.0f;
+    };
+
+    // Everything a table is compiled from: the model parameters, audiogram and sample rate
+    using WDRCTableKey = std::array<float, 6 + 2 * numAudiogramBands>;
+
+    // Compiled on the message thread when the parameters change (and in prepareToPlay()),
+    // then handed to the audio thread through the mailbox. Offline renders compile their
+    // own in processBlock(), as they run faster than the timer.
+    std::array<WDRCTable, SlotMailbox::numSlots> wdrcTables;
+    SlotMailbox wdrcTableMailbox;
+    const WDRCTable* wdrcTable = &wdrcTables[0];   // Audio thread: the table in use
+    juce::CriticalSection wdrcTableLock;           // Serialises the producers; the audio thread only try-locks it
+    WDRCTableKey compiledWDRCTableKey {};
+
+    WDRCTableKey getWDRCTableKey() const noexcept;
+    void compileWDRCTable (WDRCTable& table);
+    void compileLoudnessFitting (WDRCTable& table);
+
+    template <typename Model>
+    void compileWDRCTable (const Model& model, WDRCTable& table);
+
+    /** Compiles and posts a new table if its inputs changed. Hold wdrcTableLock. */
+    void updateWDRCTable();
+
+    /** Audio thread: switches to the newest posted table. */
+    void takeWDRCTable() noexcept;
+
+    //==============================================================================
+    // Specific-loudness restoration (MOSL Loudness): estimates each ear's loudness
+    // per ERB band and sets the band gains that restore it, its analysis spread over blocks
+    LoudnessRestorer loudnessRestorer;
+    WDRCTable loudnessTable;                        // Audio thread: this block's table, with the restorer's gains
+    const WDRCTable* loudnessSource = nullptr;      // The compiled table loudnessTable was built from
+
+    /** Audio thread: analyses the block and points wdrcTable at loudnessTable. Only the
+        targets and flat gains change per block; the rest is copied when a new table is taken.
+    */
+    void applyLoudnessRestoration (const float* left, const float* right, int numSamples) noexcept;
+
+    // How the WDRC stage runs; the quality governor's tiers select cheaper modes
+    struct WDRCMode
+    {
+        int gainInterval = 1;           // Samples between evaluations of the gain law
+        bool mergedBands = false;       // Adjacent band pairs share one detector and gain
+        bool linkedDetection = false;   // One detector per band, fed by both ears
+        bool averageLink = false;       // Linked detectors hear the ears' average level, not the louder
+        bool energyDetector = false;    // RMS over WDRCKernel::energyInterval sub-blocks instead of the peak follower
+
+        bool operator== (const WDRCMode& other) const noexcept
+        {
+            return gainInterval == other.gainInterval && mergedBands == other.mergedBands
+                && linkedDetection == other.linkedDetection && averageLink == other.averageLink
+                && energyDetector == other.energyDetector;
+        }
+
+        bool operator!= (const WDRCMode& other) const noexcept { return ! operator== (other); }
+    };
+
+    static constexpr int controlRateInterval = 16;
+    WDRCMode getWDRCMode (int governorTier) const noexcept;
+
+    // Stereo link short of 100%: each ear keeps its detector, fed from linkDetectorBuffer
+    float stereoLinkAmount = 0.0f;             // Audio thread: this block's link (0 to 1)
+    juce::AudioBuffer<float> linkDetectorBuffer;
+
+    /** Writes each ear's detector input: its own level moved amount of the way to the
+        linked level (the louder ear's, or the average).
+    */
+    static void blendLinkedLevels (const float* const* samples, float* const* levels, int numSamples,
+                                   float amount, bool average) noexcept;
+
+    /** Applies each ear's WDRC to its bands and sums them into outputs (enabled ears only). */
+    void processWDRCStage (const WDRCMode& mode, WDRCBands& left, WDRCBands& right, juce::AudioBuffer<float>& bands,
+                           float* const* outputs, const bool* earEnabled, int numSamples) noexcept;
+
+    /** One ear's band through the WDRCKernel (peak or RMS detector, as mode says). index is
+        the band's entry in the table (ear * numAudiogramBands + band). The envelope follows
+        detector, which may be samples itself.
+    */
+    void processWDRCBand (WDRCBandState& state, const WDRCBandTable& table, int index, float* samples,
+                          const float* detector, int numSamples, const WDRCMode& mode) const noexcept;
+
+    /** Both ears' band through the WDRCKernel as two lanes fed the same linked level, with
+        the same time constants, so their envelopes stay equal.
+    */
+    void processLinkedWDRCBand (WDRCBandState& left, WDRCBandState& right, const WDRCBandTable& table, int band,
+                                float* const* samples, const bool* earEnabled, int numSamples,
+                                const WDRCMode& mode) const noexcept;
+
+    // Mode changes are crossfaded: the previous mode keeps running on a copy of
+    // the state and the band signals, and the output fades from it to the new one
+    static constexpr double wdrcFadeMs = 20.0;
+    WDRCMode activeWDRCMode, fadingWDRCMode;
+    WDRCBands fadeLeftWDRC, fadeRightWDRC;
+    juce::AudioBuffer<float> fadeBandBuffers, fadeOutputBuffer;
+    int wdrcFadeLength = 0;
+    int wdrcFadePosition = 0;          // == wdrcFadeLength when not fading
+
+    void setWDRCMode (const WDRCMode& newMode) noexcept;
+
+    //==============================================================================
+    // Quality governor
+
+    static constexpr int reducedHeadphoneSections = 5;
+
+    std::atomic<int> heldQualityTier { -1 };
+
+    /** The held tier if there is one, otherwise the governor's. Any thread. */
+    int getQualityTier() const noexcept;
+
+    /** Feeds the last callback's utilisation to the governor; returns the tier to run at. */
+    int updateQualityGovernor (int numSamples) noexcept;
+
+    /** Compiles WDRC tables for parameter changes, and applies the tiers that need
+        the message thread (headphone EQ redesign).
+    */
+    void timerCallback() override;
+
+    void updateCrossoverCoefficients();
 
     //==============================================================================
     double currentSampleRate = 44100.0;
+    int preparedBlockSize = 0;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HearingCorrectionAUv2AudioProcessor)
 };
@@ -0,0 +1,335 @@
+/*
+  ==============================================================================
+
+    UserIRStage.cpp
+    User-supplied impulse responses (one per ear), convolved with zero latency
+
+  ==============================================================================
+*/
+
+#include "UserIRStage.h"
+#include "Diagnostics/TraceRecorder.h"
+
+//==============================================================================
+UserIRStage::UserIRStage()
+{
+    for (auto& engine : engines)
+        engine.setWorker (&worker);
+}
+
+//==============================================================================
+bool UserIRStage::loadImpulseResponse (Ear ear, const juce::File& file)
+{
+    if (!file.existsAsFile())
+    {
+        DBG ("UserIRStage: IR file not found: " + file.getFullPathName());
+        return false;
+    }
+
+    files[(size_t) ear] = file;
+    startLoad();
+    return true;
+}
+
+void UserIRStage::clearImpulseResponse (Ear ear)
+{
+    files[(size_t) ear] = juce::File();
+    startLoad();
+}
+
+void UserIRStage::startLoad()
+{
+    const int generation = ++loadGeneration;
+
+    loaderPool.addJob ([this, generation, irFiles = files, sampleRate = currentSampleRate]
+    {
+        const auto impulses = decode (irFiles, sampleRate);
+
+        const juce::ScopedLock sl (publishLock);
+
+        // Superseded while loading: drop it, the newer request will publish
+        if (generation != loadGeneration.load())
+            return;
+
+        const int slot = mailbox.findFreeSlot();
+        if (slot < 0)
+            return;
+
+        install (engines[(size_t) slot], impulses);
+        mailbox.post (slot);
+    });
+}
+
+//==============================================================================
+bool UserIRStage::readImpulseResponse (const juce::File& file, int preferredChannel,
+                                       std::vector<float>& samples, double& fileSampleRate)
+{
+    std::unique_ptr<juce::AudioFormat> format;
+
+    if (file.hasFileExtension ("wav"))
+        format = std::make_unique<juce::WavAudioFormat>();
+    else if (file.hasFileExtension ("aif;aiff"))
+        format = std::make_unique<juce::AiffAudioFormat>();
+    else
+        return false;
+
+    // Mapped rather than streamed: long IRs are read in one pass without a copy of the file
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader (format->createMemoryMappedReader (file));
+
+    if (reader == nullptr || !reader->mapEntireFile() || reader->lengthInSamples <= 0)
+    {
+        DBG ("UserIRStage: Could not map " + file.getFullPathName());
+        return false;
+    }
+
+    const auto length = (int) juce::jmin<juce::int64> (reader->lengthInSamples, ZeroLatencyConvolver::maxImpulseLength);
+    const int channel = juce::jmin (preferredChannel, (int) reader->numChannels - 1);
+
+    juce::AudioBuffer<float> data ((int) reader->numChannels, length);
+    reader->read (&data, 0, length, 0, true, true);
+
+    samples.assign (data.getReadPointer (channel), data.getReadPointer (channel) + length);
+    fileSampleRate = reader->sampleRate;
+    return true;
+}
+
+std::vector<float> UserIRStage::resample (const std::vector<float>& samples, double fromRate, double toRate)
+{
+    if (fromRate <= 0.0 || std::abs (fromRate - toRate) < 1.0)
+        return samples;
+
+    DBG ("UserIRStage: Resampling IR from " + juce::String (fromRate) + " Hz to " + juce::String (toRate) + " Hz");
+
+    // Blackman-windowed sinc, tabulated over its zero crossings and linearly interpolated.
+    // The cutoff sits just below the lower of the two Nyquists, so downsampling doesn't alias.
+    constexpr int zeroCrossings = 16;
+    constexpr int tableResolution = 512;
+
+    static const std::vector<float> kernel = []
+    {
+        std::vector<float> table ((size_t) (zeroCrossings * tableResolution + 2), 0.0f);
+
+        for (int i = 0; i <= zeroCrossings * tableResolution; ++i)
+        {
+            const double x = (double) i / tableResolution;
+            const double w = juce::MathConstants<double>::pi * x;
+            const double window = 0.42 + 0.5 * std::cos (w / zeroCrossings) + 0.08 * std::cos (2.0 * w / zeroCrossings);
+            table[(size_t) i] = (float) ((i == 0 ? 1.0 : std::sin (w) / w) * window);
+        }
+
+        return table;
+    }();
+
+    const double ratio = fromRate / toRate;
+    const double cutoff = 0.95 * juce::jmin (1.0, toRate / fromRate);    // In input-rate Nyquists
+    const double reach = zeroCrossings / cutoff;                          // Kernel half-width, input samples
+    const auto inLength = (int) samples.size();
+    const auto outLength = (int) std::ceil ((double) inLength / ratio);
+
+    // Taps are per-sample weights: more of them at a higher rate, so scale by the ratio to keep the gain
+    const double gain = cutoff * ratio;
+    std::vector<float> resampled ((size_t) outLength);
+
+    for (int n = 0; n < outLength; ++n)
+    {
+        const double t = n * ratio;
+        const int first = juce::jmax (0, (int) std::ceil (t - reach));
+        const int last = juce::jmin (inLength - 1, (int) std::floor (t + reach));
+        double sum = 0.0;
+
+        for (int k = first; k <= last; ++k)
+        {
+            const double position = std::abs (t - k) * cutoff * tableResolution;
+            const auto index = (size_t) position;
+            const double frac = position - (double) index;
+            sum += samples[(size_t) k] * (kernel[index] + frac * (kernel[index + 1] - kernel[index]));
+        }
+
+        resampled[(size_t) n] = (float) (sum * gain);
+    }
+
+    return resampled;
+}
+
+UserIRStage::ImpulsePair UserIRStage::decode (const std::array<juce::File, 2>& irFiles, double sampleRate)
+{
+    EARFIX_TRACE_SCOPE ("userIRLoad");
+    ImpulsePair impulses;
+
+    for (size_t ear = 0; ear < irFiles.size(); ++ear)
+    {
+        std::vector<float> samples;
+        double fileSampleRate = 0.0;
+
+        if (irFiles[ear] != juce::File() && readImpulseResponse (irFiles[ear], (int) ear, samples, fileSampleRate))
+            impulses[ear] = resample (samples, fileSampleRate, sampleRate);
+    }
+
+    return impulses;
+}
+
+void UserIRStage::install (ZeroLatencyConvolver& engine, const ImpulsePair& impulses)
+{
+    EARFIX_TRACE_SCOPE ("userIRInstall");
+    const auto longest = juce::jmax (impulses[0].size(), impulses[1].size());
+    tailLength = (int) juce::jmin (longest, (size_t) ZeroLatencyConvolver::maxImpulseLength);
+
+    if (longest == 0)
+    {
+        engine.clear();
+        return;
+    }
+
+    // An ear without an IR passes through
+    static const std::vector<float> unitImpulse { 1.0f };
+    const auto& left = impulses[0].empty() ? unitImpulse : impulses[0];
+    const auto& right = impulses[1].empty() ? unitImpulse : impulses[1];
+
+    engine.setImpulseResponses (left.data(), (int) left.size(), right.data(), (int) right.size());
+
+    DBG ("UserIRStage: Installed IRs, " + juce::String (left.size()) + " / " + juce::String (right.size()) + " taps");
+}
+
+//==============================================================================
+void UserIRStage::prepare (double sampleRate, int samplesPerBlock, bool nonRealtime)
+{
+    const bool rateChanged = !prepared || std::abs (sampleRate - currentSampleRate) >= 1.0;
+    currentSampleRate = sampleRate;
+    prepared = true;
+
+    // Crossfade tables: quarter-period sin/cos for an equal-power fade
+    fadeLength = juce::jmax (1, juce::roundToInt (sampleRate * crossfadeMs / 1000.0));
+    fadeInTable.resize (static_cast<size_t> (fadeLength));
+    fadeOutTable.resize (static_cast<size_t> (fadeLength));
+
+    for (int i = 0; i < fadeLength; ++i)
+    {
+        auto phase = juce::MathConstants<double>::halfPi * (i + 1) / fadeLength;
+        fadeInTable[(size_t) i]  = static_cast<float> (std::sin (phase));
+        fadeOutTable[(size_t) i] = static_cast<float> (std::cos (phase));
+    }
+
+    fadePosition = 0;
+    fadeBuffer.setSize (2, juce::jmax (1, samplesPerBlock));
+
+    // Audio is stopped here, so the mailbox can be reset directly
+    if (nonRealtime)
+    {
+        const juce::ScopedLock sl (publishLock);
+        ++loadGeneration;
+
+        // Detached before the install, which waits for anything still on the worker
+        for (auto& engine : engines)
+            engine.setWorker (nullptr);
+
+        install (engines[0], decode (files, sampleRate));
+        mailbox.reset (0);
+        return;
+    }
+
+    for (auto& engine : engines)
+        engine.setWorker (&worker);
+
+    if (!rateChanged)
+        return;
+
+    // The old IRs are at the wrong rate: drop them and decode off this thread, which
+    // hosts often call from the message thread with the UI waiting on it
+    {
+        const juce::ScopedLock sl (publishLock);
+        ++loadGeneration;
+
+        engines[0].clear();
+        mailbox.reset (0);
+        tailLength = 0;
+    }
+
+    if (hasImpulseResponse())
+        startLoad();
+}
+
+void UserIRStage::reset()
+{
+    for (auto& engine : engines)
+        engine.reset();
+
+    fadePosition = 0;
+}
+
+void UserIRStage::clearActiveState()
+{
+    if (mailbox.getSnapshot().fading != SlotMailbox::noSlot)
+        mailbox.releaseFading();
+
+    engines[mailbox.getSnapshot().active].reset();
+}
+
+//==============================================================================
+void UserIRStage::process (juce::AudioBuffer<float>& buffer)
+{
+    // Take a pending IR set once any previous crossfade has finished
+    if (mailbox.takePending())
+        fadePosition = 0;
+
+    const auto roles = mailbox.getSnapshot();
+    const int numSamples = buffer.getNumSamples();
+    int fadeSamples = 0;
+
+    if (roles.fading != SlotMailbox::noSlot)
+    {
+        fadeSamples = juce::jmin (numSamples, fadeLength - fadePosition);
+
+        if (fadeSamples > 0)
+            processCrossfade (buffer, engines[roles.fading], engines[roles.active], fadeSamples);
+
+        if (fadePosition >= fadeLength)
+            mailbox.releaseFading();
+    }
+
+    auto& engine = engines[roles.active];
+
+    if (fadeSamples < numSamples && engine.isLoaded() && buffer.getNumChannels() > 0)
+    {
+        engine.process (buffer.getWritePointer (0, fadeSamples),
+                        buffer.getNumChannels() > 1 ? buffer.getWritePointer (1, fadeSamples) : nullptr,
+                        numSamples - fadeSamples);
+    }
+}
+
+void UserIRStage::processCrossfade (juce::AudioBuffer<float>& buffer, ZeroLatencyConvolver& oldEngine,
+                                    ZeroLatencyConvolver& newEngine, int numSamples) noexcept
+{
+    const int numChannels = juce::jmin (2, buffer.getNumChannels());
+    if (numChannels == 0)
+    {
+        fadePosition += numSamples;
+        return;
+    }
+
+    // The old engine runs in place, the new one on a copy; then mix with sin/cos gains
+    for (int done = 0; done < numSamples;)
+    {
+        const int n = juce::jmin (numSamples - done, fadeBuffer.getNumSamples());
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            fadeBuffer.copyFrom (ch, 0, buffer, ch, done, n);
+
+        oldEngine.process (buffer.getWritePointer (0, done), numChannels > 1 ? buffer.getWritePointer (1, done) : nullptr, n);
+        newEngine.process (fadeBuffer.getWritePointer (0), numChannels > 1 ? fadeBuffer.getWritePointer (1) : nullptr, n);
+
+        const float* fadeIn  = fadeInTable.data() + fadePosition;
+        const float* fadeOut = fadeOutTable.data() + fadePosition;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* out = buffer.getWritePointer (ch, done);
+            const auto* incoming = fadeBuffer.getReadPointer (ch);
+
+            for (int i = 0; i < n; ++i)
+                out[i] = out[i] * fadeOut[i] + incoming[i] * fadeIn[i];
+        }
+
+        fadePosition += n;
+        done += n;
+    }
+}
@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    UserIRStage.h
+    User-supplied impulse responses (one per ear), convolved with zero latency
+
+    Runs after HeadphoneEQ for measured headphone or earpiece responses that
+    a parametric or curve-based correction can't capture. Each ear takes a
+    WAV or AIFF file; the file is memory-mapped and decoded on a background
+    thread, resampled to the host rate and installed into a
+    ZeroLatencyConvolver, then crossfaded in through the same slot mailbox
+    HeadphoneEQ uses.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "DSP/SlotMailbox.h"
+#include "DSP/ZeroLatencyConvolver.h"
+
+//==============================================================================
+class UserIRStage
+{
+public:
+    enum class Ear
+    {
+        Left = 0,
+        Right = 1
+    };
+
+    UserIRStage();
+    ~UserIRStage() = default;
+
+    //==========================================================================
+    // Impulse response selection (message thread)
+
+    /** Selects the IR file for one ear and loads it in the background.
+        Returns false if the file doesn't exist.
+
+        A stereo file uses its first channel for the left ear and its second
+        for the right. An ear without a file passes through unchanged.
+    */
+    bool loadImpulseResponse (Ear ear, const juce::File& file);
+
+    /** Removes the IR for one ear. */
+    void clearImpulseResponse (Ear ear);
+
+    /** Returns the selected file for an ear (may not have finished loading). */
+    juce::File getImpulseResponseFile (Ear ear) const { return files[(size_t) ear]; }
+
+    /** Returns true if either ear has an IR selected. */
+    bool hasImpulseResponse() const { return files[0] != juce::File() || files[1] != juce::File(); }
+
+    /** Length of the longest installed IR at the prepared rate, in samples. */
+    int getTailLengthSamples() const { return tailLength.load(); }
+
+    //==========================================================================
+    // Audio processing
+
+    /** Prepares for playback. Must not be called while process() is running.
+
+        If the rate changed, the IRs are reloaded at the new one: on the loader
+        thread (passing dry until they crossfade in), or before returning when
+        nonRealtime is set, as offline renders need them from the first sample.
+        At an unchanged rate the installed IRs are kept.
+
+        Offline, every segment is also convolved inline instead of on the
+        worker: the audio thread's bounded wait for a late segment would
+        otherwise drop IR tail blocks depending on the machine's load.
+    */
+    void prepare (double sampleRate, int samplesPerBlock, bool nonRealtime);
+
+    /** Resets the convolution state. */
+    void reset();
+
+    /** Audio thread: clears the state of the engine in use, finishing any crossfade, when
+        processing resumes after a gap. Unlike reset(), leaves the engines being loaded alone.
+    */
+    void clearActiveState();
+
+    /** Convolves a mono or stereo buffer in place. */
+    void process (juce::AudioBuffer<float>& buffer);
+
+private:
+    //==========================================================================
+    // Loading
+
+    using ImpulsePair = std::array<std::vector<float>, 2>;
+
+    /** Reads one channel of an audio file through a memory-mapped reader. */
+    static bool readImpulseResponse (const juce::File& file, int preferredChannel,
+                                     std::vector<float>& samples, double& fileSampleRate);
+
+    /** Resamples to the host rate with a windowed-sinc filter, keeping the response's gain. */
+    static std::vector<float> resample (const std::vector<float>& samples, double fromRate, double toRate);
+
+    /** Reads both ears' files at the given rate (empty vectors for ears without one). */
+    static ImpulsePair decode (const std::array<juce::File, 2>& irFiles, double sampleRate);
+
+    /** Partitions the IRs into engine and updates the tail length. Allocates; caller holds publishLock. */
+    void install (ZeroLatencyConvolver& engine, const ImpulsePair& impulses);
+
+    void startLoad();
+
+    //==========================================================================
+    // Engines handed to the audio thread through the mailbox; producers
+    // (message thread, loader thread) are serialised by publishLock
+
+    std::array<ZeroLatencyConvolver, SlotMailbox::numSlots> engines;
+    SlotMailbox mailbox;
+    juce::CriticalSection publishLock;
+    std::atomic<int> loadGeneration { 0 };
+    std::atomic<int> tailLength { 0 };
+
+    std::array<juce::File, 2> files;
+    double currentSampleRate = 44100.0;
+    bool prepared = false;
+
+    // Equal-power crossfade between IR sets (audio thread only)
+    static constexpr double crossfadeMs = 20.0;
+    std::vector<float> fadeInTable;     // sin, 0 -> 1
+    std::vector<float> fadeOutTable;    // cos, 1 -> 0
+    int fadeLength = 0;
+    int fadePosition = 0;
+    juce::AudioBuffer<float> fadeBuffer;
+
+    void processCrossfade (juce::AudioBuffer<float>& buffer, ZeroLatencyConvolver& oldEngine,
+                           ZeroLatencyConvolver& newEngine, int numSamples) noexcept;
+
+    // Declared after the engines so they outlive any queued background work
+    ConvolutionWorker worker;
+    juce::ThreadPool loaderPool { 1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UserIRStage)
+};
@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    AccuracyChecks.cpp
+    Numerical accuracy checks for the approximations the DSP relies on
+
+  ==============================================================================
+*/
+
+#include "AccuracyChecks.h"
+#include "../../../Source/DSP/FastDecibels.h"
+
+//==============================================================================
+namespace
+{
+    using Accuracy = FastDecibels::Accuracy;
+
+    constexpr float lowestDb = -140.0f;
+    constexpr float highestDb = 140.0f;
+    constexpr double stepDb = 0.001;     // Fine enough to visit every region of the mantissa many times
+
+    // Below the sweep, so no value in it is treated as silence
+    constexpr float sweepMinusInfinityDb = -200.0f;
+
+    std::vector<float> makeDecibelSweep()
+    {
+        std::vector<float> decibels;
+
+        for (double db = lowestDb; db <= highestDb; db += stepDb)
+            decibels.push_back ((float) db);
+
+        return decibels;
+    }
+
+    template <Accuracy accuracy>
+    AccuracyChecks::Result checkGainToDecibels (const std::vector<float>& sweep, const juce::String& tier, double bound)
+    {
+        AccuracyChecks::Result result { "fastDecibels/to-db/" + tier, 0.0, 0.0, bound, "dB" };
+
+        std::vector<float> gains, batch (sweep.size());
+
+        for (auto db : sweep)
+            gains.push_back ((float) std::pow (10.0, db / 20.0));
+
+        FastDecibels::gainToDecibels<accuracy> (gains.data(), batch.data(), (int) gains.size(), sweepMinusInfinityDb);
+
+        // The batch version is vectorised, so it is held to the bound separately rather than compared bit for bit
+        for (size_t i = 0; i < gains.size(); ++i)
+        {
+            const auto reference = 20.0 * std::log10 ((double) gains[i]);
+            const auto scalar = FastDecibels::gainToDecibels<accuracy> (gains[i], sweepMinusInfinityDb);
+
+            result.maxError = juce::jmax (result.maxError, std::abs ((double) scalar - reference),
+                                          std::abs ((double) batch[i] - reference));
+            result.maxJuceError = juce::jmax (result.maxJuceError,
+                                              std::abs ((double) juce::Decibels::gainToDecibels (gains[i], sweepMinusInfinityDb) - reference));
+        }
+
+        // As juce::Decibels: silence and negative gains map to minusInfinityDb
+        const bool edgesMatch = FastDecibels::gainToDecibels<accuracy> (0.0f) == -100.0f
+                             && FastDecibels::gainToDecibels<accuracy> (-1.0f, -80.0f) == -80.0f
+                             && FastDecibels::gainToDecibels<accuracy> (1.0e-6f) == -100.0f;
+
+        result.passed = result.maxError <= bound && edgesMatch;
+        return result;
+    }
+
+    template <Accuracy accuracy>
+    AccuracyChecks::Result checkDecibelsToGain (const std::vector<float>& sweep, const juce::String& tier, double bound)
+    {
+        AccuracyChecks::Result result { "fastDecibels/from-db/" + tier, 0.0, 0.0, bound, "dB" };
+
+        std::vector<float> batch (sweep.size());
+        FastDecibels::decibelsToGain<accuracy> (sweep.data(), batch.data(), (int) sweep.size(), sweepMinusInfinityDb);
+
+        // Measured as the level error of the gain, in dB, so the bound means the same in both directions
+        for (size_t i = 0; i < sweep.size(); ++i)
+        {
+            const auto reference = std::pow (10.0, sweep[i] / 20.0);
+            const auto scalar = FastDecibels::decibelsToGain<accuracy> (sweep[i], sweepMinusInfinityDb);
+            const auto juceGain = juce::Decibels::decibelsToGain (sweep[i], sweepMinusInfinityDb);
+
+            result.maxError = juce::jmax (result.maxError, std::abs (20.0 * std::log10 ((double) scalar / reference)),
+                                          std::abs (20.0 * std::log10 ((double) batch[i] / reference)));
+            result.maxJuceError = juce::jmax (result.maxJuceError, std::abs (20.0 * std::log10 ((double) juceGain / reference)));
+        }
+
+        // As juce::Decibels: at or below minusInfinityDb is silence
+        const bool edgesMatch = FastDecibels::decibelsToGain<accuracy> (-100.0f) == 0.0f
+                             && FastDecibels::decibelsToGain<accuracy> (-120.0f) == 0.0f
+                             && FastDecibels::decibelsToGain<accuracy> (-60.0f, -60.0f) == 0.0f;
+
+        result.passed = result.maxError <= bound && edgesMatch;
+        return result;
+    }
+}
+
+//==============================================================================
+std::vector<AccuracyChecks::Result> AccuracyChecks::fastDecibels()
+{
+    const auto sweep = makeDecibelSweep();
+
+    return { checkGainToDecibels<Accuracy::Precise> (sweep, "precise", 2.0e-5),
+             checkGainToDecibels<Accuracy::Fast> (sweep, "fast", 1.0e-3),
+             checkDecibelsToGain<Accuracy::Precise> (sweep, "precise", 2.0e-5),
+             checkDecibelsToGain<Accuracy::Fast> (sweep, "fast", 1.0e-3) };
+}
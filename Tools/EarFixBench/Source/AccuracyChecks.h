@@ -0,0 +1,41 @@
+/*
+  ==============================================================================
+
+    AccuracyChecks.h
+    Numerical accuracy checks for the approximations the DSP relies on
+
+    The benchmarks say how fast an approximation is; these say whether it is
+    still as accurate as its documentation claims. Each check sweeps its
+    working range against a double-precision reference (and juce's float
+    version, for comparison) and fails if the largest error exceeds the
+    stated bound, so a coefficient tweak made for speed can't silently cost
+    accuracy.
+
+      EarFixBench --check-accuracy
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+namespace AccuracyChecks
+{
+    struct Result
+    {
+        juce::String name;          // "fastDecibels/<to-db|from-db>/<precise|fast>", ...
+        double maxError = 0.0;      // Against double precision
+        double maxJuceError = 0.0;  // juce's float version against the same reference
+        double bound = 0.0;
+        juce::String unit;
+        bool passed = false;
+    };
+
+    /** FastDecibels' gainToDecibels() / decibelsToGain() in both tiers, scalar and batch, from -140 to
+        +140 dB, plus the minus-infinity handling juce::Decibels defines.
+        Bounds: Precise within 2e-5 dB, Fast within 0.001 dB.
+    */
+    std::vector<Result> fastDecibels();
+}
@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+    Benchmark.cpp
+    Timing harness and results for EarFixBench
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+//==============================================================================
+namespace
+{
+    double percentile (const std::vector<double>& sorted, double fraction)
+    {
+        if (sorted.empty())
+            return 0.0;
+
+        // Nearest rank
+        const auto index = (size_t) juce::jlimit (0, (int) sorted.size() - 1,
+                                                  (int) std::ceil (fraction * (double) sorted.size()) - 1);
+        return sorted[index];
+    }
+
+    double ticksToNs (juce::int64 ticks)
+    {
+        return juce::Time::highResolutionTicksToSeconds (ticks) * 1.0e9;
+    }
+
+    volatile float sink = 0.0f;
+}
+
+void doNotOptimise (float value)
+{
+    sink = value;
+}
+
+//==============================================================================
+juce::var BenchmarkResult::toVar() const
+{
+    auto* obj = new juce::DynamicObject();
+
+    obj->setProperty ("name", name);
+    obj->setProperty ("group", group);
+
+    auto* params = new juce::DynamicObject();
+
+    for (auto& parameter : parameters)
+        params->setProperty (parameter.name, parameter.value);
+
+    obj->setProperty ("parameters", juce::var (params));
+    obj->setProperty ("item", itemName);
+    obj->setProperty ("itemsPerIteration", itemsPerIteration);
+    obj->setProperty ("iterations", numIterations);
+    obj->setProperty ("nsPerItem", getNsPerItem());
+    obj->setProperty ("meanNs", meanNs);
+    obj->setProperty ("p50Ns", p50Ns);
+    obj->setProperty ("p90Ns", p90Ns);
+    obj->setProperty ("p99Ns", p99Ns);
+    obj->setProperty ("maxNs", maxNs);
+
+    if (budgetNs > 0.0)
+    {
+        obj->setProperty ("budgetNs", budgetNs);
+        obj->setProperty ("p99BudgetPercent", 100.0 * p99Ns / budgetNs);
+    }
+
+    return juce::var (obj);
+}
+
+//==============================================================================
+BenchmarkRunner::BenchmarkRunner (Options optionsToUse)
+    : options (std::move (optionsToUse))
+{
+}
+
+bool BenchmarkRunner::isSelected (const juce::String& name) const
+{
+    return options.filter.isEmpty() || name.containsIgnoreCase (options.filter);
+}
+
+void BenchmarkRunner::run (const juce::String& name, const juce::NamedValueSet& parameters,
+                           const juce::String& itemName, double itemsPerIteration, double budgetNs,
+                           const std::function<void()>& body,
+                           const std::function<void()>& prepareIteration)
+{
+    if (! isSelected (name))
+        return;
+
+    for (int i = 0; i < options.warmupIterations; ++i)
+    {
+        if (prepareIteration != nullptr)
+            prepareIteration();
+
+        body();
+    }
+
+    std::vector<double> iterationNs;
+    iterationNs.reserve ((size_t) options.minIterations * 4);
+
+    double timedNs = 0.0;
+
+    while ((int) iterationNs.size() < options.minIterations || timedNs < options.minSeconds * 1.0e9)
+    {
+        if (prepareIteration != nullptr)
+            prepareIteration();
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        body();
+        const auto elapsed = ticksToNs (juce::Time::getHighResolutionTicks() - start);
+
+        iterationNs.push_back (elapsed);
+        timedNs += elapsed;
+    }
+
+    auto result = summarise (name, parameters, itemName, itemsPerIteration, std::move (iterationNs));
+    result.budgetNs = budgetNs;
+    results.push_back (result);
+
+    if (onResult != nullptr)
+        onResult (results.back());
+}
+
+void BenchmarkRunner::addResult (const juce::String& name, const juce::NamedValueSet& parameters,
+                                 const juce::String& itemName, double itemsPerIteration,
+                                 std::vector<double> iterationNs)
+{
+    if (! isSelected (name) || iterationNs.empty())
+        return;
+
+    results.push_back (summarise (name, parameters, itemName, itemsPerIteration, std::move (iterationNs)));
+
+    if (onResult != nullptr)
+        onResult (results.back());
+}
+
+BenchmarkResult BenchmarkRunner::summarise (const juce::String& name, const juce::NamedValueSet& parameters,
+                                            const juce::String& itemName, double itemsPerIteration,
+                                            std::vector<double> iterationNs) const
+{
+    BenchmarkResult result;
+    result.name = name;
+    result.group = name.upToFirstOccurrenceOf ("/", false, false);
+    result.parameters = parameters;
+    result.itemName = itemName;
+    result.itemsPerIteration = itemsPerIteration;
+    result.numIterations = (int) iterationNs.size();
+
+    std::sort (iterationNs.begin(), iterationNs.end());
+
+    result.meanNs = std::accumulate (iterationNs.begin(), iterationNs.end(), 0.0) / (double) iterationNs.size();
+    result.p50Ns = percentile (iterationNs, 0.50);
+    result.p90Ns = percentile (iterationNs, 0.90);
+    result.p99Ns = percentile (iterationNs, 0.99);
+    result.maxNs = iterationNs.back();
+
+    return result;
+}
+
+//==============================================================================
+juce::var BenchmarkRunner::toJSON() const
+{
+    auto* report = new juce::DynamicObject();
+
+    report->setProperty ("format", 1);
+    report->setProperty ("tool", "EarFixBench " + juce::String (ProjectInfo::versionString));
+    report->setProperty ("date", juce::Time::getCurrentTime().toISO8601 (true));
+
+    auto* system = new juce::DynamicObject();
+    system->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+    system->setProperty ("cpu", juce::SystemStats::getCpuModel());
+    system->setProperty ("cores", juce::SystemStats::getNumPhysicalCpus());
+    system->setProperty ("threads", juce::SystemStats::getNumCpus());
+    system->setProperty ("cpuMHz", juce::SystemStats::getCpuSpeedInMegahertz());
+   #if JUCE_DEBUG
+    system->setProperty ("build", "debug");
+   #else
+    system->setProperty ("build", "release");
+   #endif
+    report->setProperty ("system", juce::var (system));
+
+    auto* settings = new juce::DynamicObject();
+    settings->setProperty ("minSeconds", options.minSeconds);
+    settings->setProperty ("minIterations", options.minIterations);
+    settings->setProperty ("warmupIterations", options.warmupIterations);
+    settings->setProperty ("quick", options.quick);
+    report->setProperty ("settings", juce::var (settings));
+
+    juce::Array<juce::var> entries;
+
+    for (auto& result : results)
+        entries.add (result.toVar());
+
+    report->setProperty ("results", entries);
+
+    return juce::var (report);
+}
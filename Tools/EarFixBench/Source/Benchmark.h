@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    Benchmark.h
+    Timing harness and results for EarFixBench
+
+    Each benchmark times one iteration at a time (one processBlock() call, one
+    batch of gain function calls, one profile load) with the high-resolution
+    counter, after a few untimed warm-up iterations. It keeps going until both
+    a minimum iteration count and a minimum time are reached, then reports
+    the per-iteration distribution (mean, p50 / p90 / p99, max) and the mean
+    cost per item (sample, call). Benchmarks that run in real time also
+    report their budget, so p99 can be read as a fraction of it.
+
+    Results are collected into a JSON report (see toJSON()) meant to be kept
+    per release and diffed: names are stable paths such as
+    "processBlock/mosl/48000/512/both", and every axis is repeated as a
+    parameter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+struct BenchmarkResult
+{
+    juce::String name;                  // Stable identifier, "group/axis/axis/..."
+    juce::String group;                 // First path element
+    juce::NamedValueSet parameters;     // Axis values, for filtering reports
+
+    juce::String itemName;              // What itemsPerIteration counts ("sample", "call", ...)
+    double itemsPerIteration = 1.0;
+    int numIterations = 0;
+
+    // Per-iteration wall time, nanoseconds
+    double meanNs = 0.0, p50Ns = 0.0, p90Ns = 0.0, p99Ns = 0.0, maxNs = 0.0;
+
+    // Real-time budget per iteration (block duration), or 0 if not real-time
+    double budgetNs = 0.0;
+
+    double getNsPerItem() const { return itemsPerIteration > 0.0 ? meanNs / itemsPerIteration : 0.0; }
+
+    juce::var toVar() const;
+};
+
+//==============================================================================
+class BenchmarkRunner
+{
+public:
+    struct Options
+    {
+        double minSeconds = 0.2;        // Timed per benchmark, at least
+        int minIterations = 50;
+        int warmupIterations = 10;
+        juce::String filter;            // Only run benchmarks whose name contains this
+        bool quick = false;             // Smaller parameter matrices (suites read this)
+    };
+
+    explicit BenchmarkRunner (Options optionsToUse);
+
+    const Options& getOptions() const { return options; }
+
+    /** True if a benchmark with this name passes the filter. */
+    bool isSelected (const juce::String& name) const;
+
+    /** Times body() and records the result under name.
+
+        prepareIteration, if given, runs before every iteration outside the
+        timed region (refilling an input buffer, say). Does nothing if name
+        doesn't pass the filter.
+    */
+    void run (const juce::String& name, const juce::NamedValueSet& parameters,
+              const juce::String& itemName, double itemsPerIteration, double budgetNs,
+              const std::function<void()>& body,
+              const std::function<void()>& prepareIteration = {});
+
+    /** Records an externally timed benchmark (one entry per iteration, in ns). */
+    void addResult (const juce::String& name, const juce::NamedValueSet& parameters,
+                    const juce::String& itemName, double itemsPerIteration,
+                    std::vector<double> iterationNs);
+
+    const std::vector<BenchmarkResult>& getResults() const { return results; }
+
+    /** The whole report: format version, build and machine details, and every result. */
+    juce::var toJSON() const;
+
+    /** Called after each result is recorded (progress output). */
+    std::function<void (const BenchmarkResult&)> onResult;
+
+private:
+    BenchmarkResult summarise (const juce::String& name, const juce::NamedValueSet& parameters,
+                               const juce::String& itemName, double itemsPerIteration,
+                               std::vector<double> iterationNs) const;
+
+    Options options;
+    std::vector<BenchmarkResult> results;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BenchmarkRunner)
+};
+
+//==============================================================================
+/** Keeps a value alive so the optimiser can't drop the computation behind it. */
+void doNotOptimise (float value);
@@ -0,0 +1,534 @@
+/*
+  ==============================================================================
+
+    BenchmarkSuites.cpp
+    The EarFix benchmarks, one function per area
+
+  ==============================================================================
+*/
+
+#include "BenchmarkSuites.h"
+#include "../../../Source/PluginProcessor.h"
+
+//==============================================================================
+namespace
+{
+    using Processor = HearingCorrectionAUv2AudioProcessor;
+
+    constexpr int numBands = Processor::numAudiogramBands;
+
+    // Moderate sloping loss (dB HL, 250 Hz..8 kHz): every band has gain and compresses
+    constexpr std::array<float, numBands> benchmarkAudiogram { 25.0f, 30.0f, 40.0f, 50.0f, 60.0f, 65.0f };
+
+    const std::array<std::pair<const char*, int>, 5> models { { { "half-gain", 0 }, { "nal", 1 }, { "mosl", 2 }, { "nal-nl2", 3 },
+                                                                { "mosl-loudness", 4 } } };
+
+    std::vector<double> getSampleRates (const BenchmarkRunner& runner)
+    {
+        if (runner.getOptions().quick)
+            return { 48000.0, 96000.0 };
+
+        return { HeadphoneEQ::commonSampleRates.begin(), HeadphoneEQ::commonSampleRates.end() };
+    }
+
+    std::vector<int> getBlockSizes (const BenchmarkRunner& runner)
+    {
+        if (runner.getOptions().quick)
+            return { 64, 512, 4096 };
+
+        return { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    }
+
+    void setParameter (Processor& processor, const juce::String& id, float value)
+    {
+        auto* parameter = processor.parameters.getParameter (id);
+        jassert (parameter != nullptr);
+
+        if (parameter != nullptr)
+            parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    /** A second of pink-ish stereo noise around -20 dBFS, the same on every run. */
+    juce::AudioBuffer<float> makeStimulus (double sampleRate)
+    {
+        juce::AudioBuffer<float> stimulus (2, (int) sampleRate);
+        juce::Random random (0x5eed);
+
+        for (int ch = 0; ch < stimulus.getNumChannels(); ++ch)
+        {
+            // Paul Kellet's economy pink filter
+            float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+            auto* data = stimulus.getWritePointer (ch);
+
+            for (int i = 0; i < stimulus.getNumSamples(); ++i)
+            {
+                const float white = random.nextFloat() * 2.0f - 1.0f;
+                b0 = 0.99765f * b0 + white * 0.0990460f;
+                b1 = 0.96300f * b1 + white * 0.2965164f;
+                b2 = 0.57000f * b2 + white * 1.0526913f;
+                data[i] = 0.05f * (b0 + b1 + b2 + white * 0.1848f);
+            }
+        }
+
+        return stimulus;
+    }
+
+    /** Hands out consecutive blocks of a stimulus, wrapping at its end. */
+    struct StimulusPlayer
+    {
+        const juce::AudioBuffer<float>& stimulus;
+        juce::AudioBuffer<float>& block;
+        int position = 0;
+
+        void fillNext()
+        {
+            const int numSamples = block.getNumSamples();
+
+            if (position + numSamples > stimulus.getNumSamples())
+                position = 0;
+
+            for (int ch = 0; ch < block.getNumChannels(); ++ch)
+                block.copyFrom (ch, 0, stimulus, ch, position, numSamples);
+
+            position += numSamples;
+        }
+    };
+
+    double getBlockBudgetNs (int blockSize, double sampleRate)
+    {
+        return 1.0e9 * blockSize / sampleRate;
+    }
+}
+
+//==============================================================================
+void BenchmarkSuites::processBlock (BenchmarkRunner& runner)
+{
+    struct EarSetup { const char* name; bool left, right; };
+    const std::vector<EarSetup> earSetups = runner.getOptions().quick
+        ? std::vector<EarSetup> { { "both", true, true } }
+        : std::vector<EarSetup> { { "both", true, true }, { "left", true, false },
+                                  { "right", false, true }, { "none", false, false } };
+
+    juce::MidiBuffer midi;
+
+    for (auto [modelName, modelIndex] : models)
+    {
+        for (auto& ears : earSetups)
+        {
+            // One processor per configuration, re-prepared for every rate and block size
+            std::unique_ptr<Processor> processor;
+
+            for (auto sampleRate : getSampleRates (runner))
+            {
+                const auto stimulus = makeStimulus (sampleRate);
+
+                for (auto blockSize : getBlockSizes (runner))
+                {
+                    const auto name = "processBlock/" + juce::String (modelName) + "/" + juce::String ((int) sampleRate)
+                                      + "/" + juce::String (blockSize) + "/" + ears.name;
+
+                    if (! runner.isSelected (name))
+                        continue;
+
+                    if (processor == nullptr)
+                    {
+                        processor = std::make_unique<Processor>();
+                        setParameter (*processor, "modelSelect", (float) modelIndex);
+                        setParameter (*processor, "leftEnable", ears.left ? 1.0f : 0.0f);
+                        setParameter (*processor, "rightEnable", ears.right ? 1.0f : 0.0f);
+
+                        // Full quality throughout: the governor would step down under a slow configuration
+                        setParameter (*processor, "autoQuality", 0.0f);
+
+                        for (int band = 0; band < numBands; ++band)
+                        {
+                            setParameter (*processor, "audiogram_" + juce::String (band + 1).paddedLeft ('0', 2), benchmarkAudiogram[(size_t) band]);
+                            setParameter (*processor, "audiogram_" + juce::String (numBands + band + 1).paddedLeft ('0', 2), benchmarkAudiogram[(size_t) band]);
+                        }
+                    }
+
+                    processor->setRateAndBufferSizeDetails (sampleRate, blockSize);
+                    processor->prepareToPlay (sampleRate, blockSize);
+
+                    juce::AudioBuffer<float> block (2, blockSize);
+                    StimulusPlayer player { stimulus, block };
+
+                    juce::NamedValueSet parameters;
+                    parameters.set ("model", modelName);
+                    parameters.set ("sampleRate", sampleRate);
+                    parameters.set ("blockSize", blockSize);
+                    parameters.set ("ears", ears.name);
+
+                    runner.run (name, parameters, "sample", blockSize, getBlockBudgetNs (blockSize, sampleRate),
+                                [&] { processor->processBlock (block, midi); },
+                                [&] { player.fillNext(); });
+
+                    processor->releaseResources();
+                }
+            }
+        }
+    }
+}
+
+//==============================================================================
+void BenchmarkSuites::headphoneEQ (BenchmarkRunner& runner, const juce::String& headphoneName)
+{
+    if (! runner.isSelected ("headphoneEQ/"))
+        return;
+
+    HeadphoneEQ probe;
+
+    if (probe.getNumHeadphones() == 0)
+    {
+        std::cerr << "headphoneEQ: skipped, no headphone database in "
+                  << HeadphoneEQ::getHeadphonesDirectory().getFullPathName() << std::endl;
+        return;
+    }
+
+    const auto profileName = headphoneName.isNotEmpty() ? headphoneName : probe.getAvailableHeadphones().front().name;
+    constexpr int blockSize = 512;
+
+    if (! probe.loadProfile (profileName))
+    {
+        std::cerr << "headphoneEQ: skipped, can't load profile '" << profileName << "'" << std::endl;
+        return;
+    }
+
+    probe.prepare (48000.0, blockSize);
+    const int fullSections = probe.getNumActiveSections();
+
+    // Section budgets doubling up to the full profile (budget 0 = unlimited)
+    std::vector<int> budgets;
+
+    for (int sections = 1; sections < fullSections; sections *= 2)
+        budgets.push_back (sections);
+
+    budgets.push_back (0);
+
+    struct ModeSetup { const char* name; HeadphoneEQMode mode; };
+    const std::array<ModeSetup, 3> modes { { { "parametric", HeadphoneEQMode::Parametric },
+                                             { "fir-min", HeadphoneEQMode::FIRMinimumPhase },
+                                             { "fir-linear", HeadphoneEQMode::FIRLinearPhase } } };
+
+    for (auto sampleRate : getSampleRates (runner))
+    {
+        const auto stimulus = makeStimulus (sampleRate);
+
+        for (auto& mode : modes)
+        {
+            // The FIR modes don't depend on the section count
+            const bool parametric = mode.mode == HeadphoneEQMode::Parametric;
+
+            for (auto budget : parametric ? budgets : std::vector<int> { 0 })
+            {
+                HeadphoneEQ eq;
+                eq.loadProfile (profileName);
+                eq.setSectionBudget (budget);
+                eq.setMode (mode.mode);
+                eq.setEnabled (true);
+
+                // prepare() designs and installs the correction synchronously
+                eq.prepare (sampleRate, blockSize);
+
+                const int sections = parametric ? eq.getNumActiveSections() : 0;
+                const auto name = "headphoneEQ/" + juce::String (mode.name) + "/" + juce::String ((int) sampleRate)
+                                  + (parametric ? "/" + juce::String (sections) : juce::String());
+
+                juce::AudioBuffer<float> block (2, blockSize);
+                StimulusPlayer player { stimulus, block };
+
+                juce::NamedValueSet parameters;
+                parameters.set ("profile", profileName);
+                parameters.set ("mode", mode.name);
+                parameters.set ("sampleRate", sampleRate);
+                parameters.set ("blockSize", blockSize);
+                parameters.set ("sections", sections);
+                parameters.set ("latencySamples", eq.getLatencySamples());
+
+                runner.run (name, parameters, "sample", blockSize, getBlockBudgetNs (blockSize, sampleRate),
+                            [&] { eq.process (block); },
+                            [&] { player.fillNext(); });
+            }
+        }
+    }
+}
+
+//==============================================================================
+void BenchmarkSuites::truePeak (BenchmarkRunner& runner)
+{
+    if (! runner.isSelected ("truePeak/"))
+        return;
+
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 512;
+    constexpr int oversampling = TruePeakDetector::oversampling;
+    constexpr int numTaps = oversampling * TruePeakDetector::tapsPerPhase;
+
+    const auto stimulus = makeStimulus (sampleRate);
+    juce::AudioBuffer<float> block (2, blockSize);
+    StimulusPlayer player { stimulus, block };
+
+    juce::NamedValueSet parameters;
+    parameters.set ("sampleRate", sampleRate);
+    parameters.set ("blockSize", blockSize);
+    parameters.set ("taps", numTaps);
+
+    TruePeakDetector detector;
+    detector.prepare (blockSize);
+    std::array<float, 2> peaks {};
+
+    runner.run ("truePeak/polyphase", parameters, "sample", blockSize, getBlockBudgetNs (blockSize, sampleRate),
+                [&]
+                {
+                    detector.process (block.getReadPointer (0), block.getReadPointer (1), blockSize, nullptr, peaks.data());
+                    doNotOptimise (peaks[0]);
+                },
+                [&] { player.fillNext(); });
+
+    // The same 48 taps as one filter at the high rate, run over the input zero-stuffed to 4x
+    std::vector<float> prototype (numTaps);
+    std::array<float, TruePeakDetector::tapsPerPhase> phase {};
+
+    for (int p = 0; p < oversampling; ++p)
+    {
+        TruePeakDetector::designPhase (p, phase.data());
+
+        for (int k = 0; k < TruePeakDetector::tapsPerPhase; ++k)
+            prototype[(size_t) (oversampling * k + p)] = phase[(size_t) k];
+    }
+
+    std::array<std::vector<float>, 2> stuffed;
+
+    for (auto& channel : stuffed)
+        channel.assign ((size_t) (numTaps - 1 + oversampling * blockSize), 0.0f);
+
+    runner.run ("truePeak/oversampled", parameters, "sample", blockSize, getBlockBudgetNs (blockSize, sampleRate),
+                [&]
+                {
+                    for (int ch = 0; ch < 2; ++ch)
+                    {
+                        auto& upsampled = stuffed[(size_t) ch];
+                        const float* input = block.getReadPointer (ch);
+                        float* current = upsampled.data() + numTaps - 1;
+
+                        // Keep the history, then zero-stuff the block
+                        std::copy (upsampled.end() - (numTaps - 1), upsampled.end(), upsampled.begin());
+
+                        for (int i = 0; i < blockSize; ++i)
+                        {
+                            current[oversampling * i] = input[i];
+                            std::fill (current + oversampling * i + 1, current + oversampling * (i + 1), 0.0f);
+                        }
+
+                        float peak = 0.0f;
+
+                        for (int n = 0; n < oversampling * blockSize; ++n)
+                        {
+                            float sum = 0.0f;
+
+                            for (int m = 0; m < numTaps; ++m)
+                                sum += prototype[(size_t) m] * current[n - m];
+
+                            peak = std::max (peak, std::abs (sum));
+                        }
+
+                        peaks[(size_t) ch] = peak;
+                    }
+
+                    doNotOptimise (peaks[0]);
+                },
+                [&] { player.fillNext(); });
+}
+
+//==============================================================================
+void BenchmarkSuites::gainFunctions (BenchmarkRunner& runner)
+{
+    constexpr int callsPerIteration = 4096;
+
+    // Envelope levels sweeping -100..0 dBFS across the thresholds, and a spread of targets and ratios
+    std::vector<float> levelsDb (callsPerIteration), targetsDb (callsPerIteration), lossesDb (callsPerIteration);
+    std::vector<float> thresholdsDb (callsPerIteration), slopes (callsPerIteration);
+
+    for (int i = 0; i < callsPerIteration; ++i)
+    {
+        levelsDb[(size_t) i] = -100.0f + 100.0f * (float) i / callsPerIteration;
+        targetsDb[(size_t) i] = (float) ((i * 7) % 41);
+        lossesDb[(size_t) i] = (float) ((i * 13) % 121);
+        thresholdsDb[(size_t) i] = -40.0f + (float) ((i * 5) % 16);
+        slopes[(size_t) i] = 1.0f - 1.0f / Processor::getCompressionRatio (targetsDb[(size_t) i]);
+    }
+
+    juce::NamedValueSet wdrcParameters;
+    wdrcParameters.set ("function", "calculateWDRCGain");
+
+    runner.run ("gain/wdrc", wdrcParameters, "call", callsPerIteration, 0.0, [&]
+    {
+        float sum = 0.0f;
+
+        for (int i = 0; i < callsPerIteration; ++i)
+            sum += Processor::calculateWDRCGain (levelsDb[(size_t) i], targetsDb[(size_t) i], thresholdsDb[(size_t) i],
+                                                 slopes[(size_t) i], 0.0f);
+
+        doNotOptimise (sum);
+    });
+
+    // The compiled form the audio thread uses: the law sampled into a gain curve, then looked up
+    Processor::GainCurve curve;
+
+    for (int point = 0; point < Processor::numGainCurvePoints; ++point)
+        curve[(size_t) point] = juce::Decibels::decibelsToGain (Processor::calculateWDRCGain (
+            Processor::gainCurveMinDb + (float) point, 25.0f, Processor::wdrcKneepointDb,
+            1.0f - 1.0f / Processor::getCompressionRatio (25.0f), 0.0f));
+
+    juce::NamedValueSet curveParameters;
+    curveParameters.set ("function", "lookupGainCurve");
+
+    runner.run ("gain/wdrc-curve", curveParameters, "call", callsPerIteration, 0.0, [&]
+    {
+        float sum = 0.0f;
+
+        for (int i = 0; i < callsPerIteration; ++i)
+            sum += Processor::lookupGainCurve (curve.data(), levelsDb[(size_t) i]);
+
+        doNotOptimise (sum);
+    });
+
+    // dB <-> gain conversions over a block: JUCE's, and FastDecibels' batch versions per tier
+    std::vector<float> gains (callsPerIteration), converted (callsPerIteration);
+
+    for (int i = 0; i < callsPerIteration; ++i)
+        gains[(size_t) i] = juce::Decibels::decibelsToGain (levelsDb[(size_t) i]);
+
+    auto benchmarkConversion = [&] (const juce::String& name, const char* function, const std::vector<float>& source,
+                                    auto&& convert)
+    {
+        juce::NamedValueSet parameters;
+        parameters.set ("function", function);
+
+        runner.run ("gain/" + name, parameters, "call", callsPerIteration, 0.0, [&]
+        {
+            convert (source.data(), converted.data(), callsPerIteration);
+            doNotOptimise (converted[(size_t) callsPerIteration / 2]);
+        });
+    };
+
+    using Accuracy = FastDecibels::Accuracy;
+
+    benchmarkConversion ("to-db/juce", "juce::Decibels::gainToDecibels", gains, [] (const float* in, float* out, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            out[i] = juce::Decibels::gainToDecibels (in[i]);
+    });
+
+    benchmarkConversion ("to-db/precise", "FastDecibels::gainToDecibels<Precise>", gains, [] (const float* in, float* out, int n)
+    {
+        FastDecibels::gainToDecibels<Accuracy::Precise> (in, out, n);
+    });
+
+    benchmarkConversion ("to-db/fast", "FastDecibels::gainToDecibels<Fast>", gains, [] (const float* in, float* out, int n)
+    {
+        FastDecibels::gainToDecibels<Accuracy::Fast> (in, out, n);
+    });
+
+    benchmarkConversion ("from-db/juce", "juce::Decibels::decibelsToGain", levelsDb, [] (const float* in, float* out, int n)
+    {
+        for (int i = 0; i < n; ++i)
+            out[i] = juce::Decibels::decibelsToGain (in[i]);
+    });
+
+    benchmarkConversion ("from-db/precise", "FastDecibels::decibelsToGain<Precise>", levelsDb, [] (const float* in, float* out, int n)
+    {
+        FastDecibels::decibelsToGain<Accuracy::Precise> (in, out, n);
+    });
+
+    benchmarkConversion ("from-db/fast", "FastDecibels::decibelsToGain<Fast>", levelsDb, [] (const float* in, float* out, int n)
+    {
+        FastDecibels::decibelsToGain<Accuracy::Fast> (in, out, n);
+    });
+
+    // Called on the concrete model type, as the processor's table compile does
+    auto benchmarkModel = [&] (const char* shortName, const auto& model)
+    {
+        juce::NamedValueSet parameters;
+        parameters.set ("function", model.getName() + "::calculateGain");
+
+        runner.run ("gain/" + juce::String (shortName), parameters, "call", callsPerIteration, 0.0, [&]
+        {
+            float sum = 0.0f;
+
+            for (int i = 0; i < callsPerIteration; ++i)
+                sum += model.calculateGain (Processor::audiogramFrequencies[(size_t) (i % numBands)], lossesDb[(size_t) i]);
+
+            doNotOptimise (sum);
+        });
+    };
+
+    benchmarkModel ("half-gain", HalfGainModel());
+    benchmarkModel ("nal", NALModel());
+    benchmarkModel ("mosl", MOSLModel());
+    benchmarkModel ("nal-nl2", NALNL2Model());
+}
+
+//==============================================================================
+void BenchmarkSuites::database (BenchmarkRunner& runner, const juce::String& headphoneName)
+{
+    if (! runner.isSelected ("database/"))
+        return;
+
+    HeadphoneEQ eq;
+    const int numIterations = runner.getOptions().quick ? 5 : 20;
+
+    // Index scan
+    {
+        std::vector<double> iterationNs;
+
+        for (int i = 0; i < numIterations; ++i)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            eq.loadDatabase();
+            iterationNs.push_back (juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start) * 1.0e9);
+        }
+
+        juce::NamedValueSet parameters;
+        parameters.set ("headphones", eq.getNumHeadphones());
+
+        runner.addResult ("database/scan", parameters, "scan", 1.0, std::move (iterationNs));
+    }
+
+    if (eq.getNumHeadphones() == 0)
+        return;
+
+    // Profile loads (JSON parse + cascade design), over profiles spread through the index
+    {
+        const auto& headphones = eq.getAvailableHeadphones();
+        juce::StringArray names;
+
+        if (headphoneName.isNotEmpty())
+            names.add (headphoneName);
+
+        for (int i = 0; i < 16; ++i)
+            names.addIfNotAlreadyThere (headphones[(size_t) i * headphones.size() / 16].name);
+
+        eq.prepare (48000.0, 512);
+
+        std::vector<double> iterationNs;
+
+        for (int i = 0; i < numIterations * names.size(); ++i)
+        {
+            const auto start = juce::Time::getHighResolutionTicks();
+            const bool loaded = eq.loadProfile (names[i % names.size()]);
+            const auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start) * 1.0e9;
+
+            if (loaded)
+                iterationNs.push_back (elapsed);
+
+            // Nothing consumes the posted cascades here; re-preparing frees the slots
+            eq.prepare (48000.0, 512);
+        }
+
+        juce::NamedValueSet parameters;
+        parameters.set ("profiles", names.size());
+
+        runner.addResult ("database/profileLoad", parameters, "load", 1.0, std::move (iterationNs));
+    }
+}
@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    BenchmarkSuites.h
+    The EarFix benchmarks, one function per area
+
+    Every suite builds its own processors / EQs, feeds them deterministic
+    input, and records into the runner; names that don't pass the runner's
+    filter are skipped before anything is built.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "Benchmark.h"
+
+//==============================================================================
+namespace BenchmarkSuites
+{
+    /** processBlock() end to end, per model, sample rate, block size and enabled ears.
+        Names: processBlock/<model>/<rate>/<blockSize>/<both|left|right|none>
+    */
+    void processBlock (BenchmarkRunner& runner);
+
+    /** HeadphoneEQ::process() on one profile at increasing section counts, and in the FIR modes.
+        Names: headphoneEQ/<parametric|fir-min|fir-linear>/<rate>/<sections>
+    */
+    void headphoneEQ (BenchmarkRunner& runner, const juce::String& headphoneName);
+
+    /** TruePeakDetector::process() against zero-stuffing to 4x and filtering at the high rate.
+        Names: truePeak/<polyphase|oversampled>
+    */
+    void truePeak (BenchmarkRunner& runner);
+
+    /** calculateWDRCGain(), lookupGainCurve(), the dB <-> gain conversions and each model's
+        calculateGain(), per call.
+        Names: gain/wdrc, gain/wdrc-curve, gain/<to-db|from-db>/<juce|precise|fast>, gain/<model>
+    */
+    void gainFunctions (BenchmarkRunner& runner);
+
+    /** Headphone database scan and profile load (parse + design) times.
+        Names: database/scan, database/profileLoad
+    */
+    void database (BenchmarkRunner& runner, const juce::String& headphoneName);
+}
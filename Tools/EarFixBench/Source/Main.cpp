@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    EarFixBench
+    Benchmarks for the EarFix DSP stages
+
+    Times processBlock() end to end across models, sample rates, block sizes
+    and enabled ears, the headphone EQ across section counts and modes, the
+    gain functions on their own, and headphone database loads. Prints a
+    summary and writes every result to a JSON report to compare between
+    builds. Build in Release for meaningful numbers.
+
+      EarFixBench -o bench-1.4.0.json
+      EarFixBench --quick --filter processBlock/mosl
+
+    It also checks the accuracy of the fast approximations against their
+    stated bounds (see AccuracyChecks.h), exiting non-zero if one is exceeded:
+
+      EarFixBench --check-accuracy
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "BenchmarkSuites.h"
+#include "AccuracyChecks.h"
+
+//==============================================================================
+namespace
+{
+    juce::String formatNs (double ns)
+    {
+        if (ns >= 1.0e6) return juce::String (ns / 1.0e6, 2) + " ms";
+        if (ns >= 1.0e3) return juce::String (ns / 1.0e3, 2) + " us";
+        return juce::String (ns, 1) + " ns";
+    }
+
+    void printResult (const BenchmarkResult& result)
+    {
+        std::cout << result.name.paddedRight (' ', 44) << "  "
+                  << (formatNs (result.getNsPerItem()) + "/" + result.itemName).paddedRight (' ', 18)
+                  << "p50 " << formatNs (result.p50Ns).paddedRight (' ', 11)
+                  << "p99 " << formatNs (result.p99Ns).paddedRight (' ', 11);
+
+        if (result.budgetNs > 0.0)
+            std::cout << juce::String (100.0 * result.p99Ns / result.budgetNs, 2) << "% of budget";
+
+        std::cout << std::endl;
+    }
+
+    void bench (const juce::ArgumentList& arguments)
+    {
+        juce::ArgumentList args (arguments);
+        BenchmarkRunner::Options options;
+
+        const auto outputFile = args.containsOption ("--output|-o")
+                                  ? juce::File::getCurrentWorkingDirectory().getChildFile (args.removeValueForOption ("--output|-o"))
+                                  : juce::File::getCurrentWorkingDirectory().getChildFile ("earfix-bench.json");
+
+        if (args.containsOption ("--filter"))
+            options.filter = args.removeValueForOption ("--filter");
+
+        if (args.containsOption ("--min-time"))
+            options.minSeconds = args.removeValueForOption ("--min-time").getDoubleValue();
+
+        juce::String headphoneName;
+
+        if (args.containsOption ("--headphone"))
+            headphoneName = args.removeValueForOption ("--headphone");
+
+        options.quick = args.removeOptionIfFound ("--quick");
+
+        if (! args.arguments.isEmpty())
+            juce::ConsoleApplication::fail ("Unknown argument: " + args.arguments.getReference (0).text);
+
+        if (options.minSeconds <= 0.0 || options.minSeconds > 60.0)
+            juce::ConsoleApplication::fail ("--min-time must be between 0 and 60 seconds");
+
+       #if JUCE_DEBUG
+        std::cerr << "Warning: this is a debug build; timings won't be representative" << std::endl;
+       #endif
+
+        BenchmarkRunner runner (options);
+        runner.onResult = printResult;
+
+        BenchmarkSuites::gainFunctions (runner);
+        BenchmarkSuites::processBlock (runner);
+        BenchmarkSuites::headphoneEQ (runner, headphoneName);
+        BenchmarkSuites::truePeak (runner);
+        BenchmarkSuites::database (runner, headphoneName);
+
+        if (runner.getResults().empty())
+            juce::ConsoleApplication::fail ("No benchmarks matched '" + options.filter + "'");
+
+        if (! outputFile.replaceWithText (juce::JSON::toString (runner.toJSON())))
+            juce::ConsoleApplication::fail ("Can't write " + outputFile.getFullPathName());
+
+        std::cout << runner.getResults().size() << " results written to " << outputFile.getFullPathName() << std::endl;
+    }
+
+    void checkAccuracy (const juce::ArgumentList& args)
+    {
+        if (args.size() > 1)
+            juce::ConsoleApplication::fail ("Unknown argument: " + args.arguments.getReference (1).text);
+
+        int numFailed = 0;
+
+        for (const auto& result : AccuracyChecks::fastDecibels())
+        {
+            std::cout << result.name.paddedRight (' ', 44) << "  "
+                      << ("max " + juce::String (result.maxError, 7) + " " + result.unit).paddedRight (' ', 18)
+                      << ("bound " + juce::String (result.bound, 7)).paddedRight (' ', 17)
+                      << ("juce " + juce::String (result.maxJuceError, 7)).paddedRight (' ', 17)
+                      << (result.passed ? "ok" : "FAILED") << std::endl;
+
+            numFailed += result.passed ? 0 : 1;
+        }
+
+        if (numFailed > 0)
+            juce::ConsoleApplication::fail (juce::String (numFailed) + " accuracy check(s) failed");
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand ("--help|-h",
+                        "Usage: EarFixBench [options]\n\n"
+                        "Options:\n"
+                        "  --output, -o <file.json>      Where to write the report (default: earfix-bench.json)\n"
+                        "  --filter <text>               Only run benchmarks whose name contains text\n"
+                        "                                (e.g. processBlock/mosl, headphoneEQ, gain/)\n"
+                        "  --quick                       Fewer sample rates, block sizes and ear setups\n"
+                        "  --min-time <seconds>          Time spent per benchmark, at least (default: 0.2)\n"
+                        "  --headphone <name>            Profile for the headphone EQ and load benchmarks\n"
+                        "                                (default: the first in the database)\n"
+                        "  --check-accuracy              Check the fast approximations against their error bounds\n",
+                        false);
+
+    app.addVersionCommand ("--version|-v", "EarFixBench " + juce::String (ProjectInfo::versionString));
+
+    app.addCommand ({ "--check-accuracy",
+                      "--check-accuracy",
+                      "Checks the fast approximations against their stated error bounds",
+                      {},
+                      checkAccuracy });
+
+    app.addDefaultCommand ({ "",
+                             "[options]",
+                             "Runs the EarFix benchmarks",
+                             {},
+                             bench });
+
+    return app.findAndRunCommand (argc, argv);
+}
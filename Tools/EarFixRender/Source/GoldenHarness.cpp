@@ -0,0 +1,801 @@
+/*
+  ==============================================================================
+
+    GoldenHarness.cpp
+    Golden-output regression checks for the EarFix processor
+
+  ==============================================================================
+*/
+
+#include "GoldenHarness.h"
+
+//==============================================================================
+namespace
+{
+    constexpr int fileMagic = 0x31474645;           // "EFG1"
+    constexpr int formatVersion = 1;
+    constexpr float fullScale24 = 8388607.0f;
+
+    constexpr int numBands = HearingCorrectionAUv2AudioProcessor::numAudiogramBands;
+
+    //==========================================================================
+    // Matrix
+
+    const juce::StringArray stimuli { "sweep", "pink", "impulses", "speech", "steps" };
+
+    const std::array<std::pair<const char*, int>, 5> models { { { "half-gain", 0 }, { "nal", 1 }, { "mosl", 2 }, { "nal-nl2", 3 },
+                                                                { "mosl-loudness", 4 } } };
+
+    struct AudiogramSetup
+    {
+        const char* name;
+        std::array<float, numBands> right, left;    // dB HL, 250 Hz..8 kHz
+    };
+
+    const std::array<AudiogramSetup, 3> audiograms { {
+        { "flat",       { 25, 25, 30, 30, 35, 35 }, { 25, 25, 30, 30, 35, 35 } },
+        { "sloping",    { 20, 25, 35, 50, 60, 70 }, { 20, 25, 35, 50, 60, 70 } },
+        { "asymmetric", { 30, 35, 45, 60, 70, 80 }, { 10, 15, 20, 25, 30, 35 } }
+    } };
+
+    struct ParameterSetup
+    {
+        const char* name;
+        std::map<juce::String, float> values;       // On top of the plugin defaults
+        const char* audiogram = nullptr;            // Only rendered with this audiogram (all if null)
+    };
+
+    // The stereo link sets only make a difference when the ears differ. "ceiling" drives the
+    // output into a lowered ceiling, so the true-peak limiter works on every stimulus
+    const std::array<ParameterSetup, 8> parameterSets { {
+        { "default", {} },
+        { "strong",  { { "correctionStrength", 100.0f }, { "maxBoost", 40.0f }, { "compressionSpeed", 1.0f },
+                       { "experienceLevel", 0.0f }, { "outputGain", -6.0f } } },
+        { "link50",         { { "stereoLink", 50.0f } },                            "asymmetric" },
+        { "link50-average", { { "stereoLink", 50.0f }, { "linkDetector", 1.0f } },  "asymmetric" },
+        { "link100",        { { "stereoLink", 100.0f } },                           "asymmetric" },
+        { "rms",            { { "levelDetector", 1.0f } },                          "sloping" },
+        { "rms-link100",    { { "levelDetector", 1.0f }, { "stereoLink", 100.0f } }, "asymmetric" },
+        { "ceiling",        { { "outputCeiling", -6.0f }, { "outputGain", 6.0f } },   "sloping" }
+    } };
+
+    // Headphone correction cases: one model, audiogram and parameter set, every stimulus,
+    // each correction mode on the built-in test profile
+    const std::array<std::pair<const char*, HeadphoneEQMode>, 3> headphoneModes { {
+        { "parametric", HeadphoneEQMode::Parametric },
+        { "fir-min",    HeadphoneEQMode::FIRMinimumPhase },
+        { "fir-linear", HeadphoneEQMode::FIRLinearPhase }
+    } };
+
+    /** A fixed AutoEq-style profile, so the headphone cases don't depend on the installed database.
+        Eight sections (more than the governor's reduced budget) and a raw curve for the FIR modes.
+    */
+    HeadphoneProfile makeTestHeadphoneProfile()
+    {
+        HeadphoneProfile profile;
+        profile.name = "Golden Test Headphone";
+        profile.source = "EarFixRender";
+        profile.type = "over-ear";
+        profile.preamp = -6.0f;
+
+        profile.filters = { { HeadphoneFilterType::LowShelf,  105.0f,   5.5f, 0.7f },
+                            { HeadphoneFilterType::Peak,      180.0f,  -2.5f, 0.9f },
+                            { HeadphoneFilterType::Peak,      650.0f,   1.5f, 1.4f },
+                            { HeadphoneFilterType::Peak,     1800.0f,  -1.0f, 2.0f },
+                            { HeadphoneFilterType::Peak,     2900.0f,  -4.0f, 2.5f },
+                            { HeadphoneFilterType::Peak,     5800.0f,   6.0f, 3.0f },
+                            { HeadphoneFilterType::Peak,     8200.0f,  -3.0f, 4.0f },
+                            { HeadphoneFilterType::HighShelf, 10000.0f, -2.0f, 0.7f } };
+
+        profile.curveFrequencies = { 20.0f, 50.0f, 100.0f, 200.0f, 500.0f, 1000.0f, 2000.0f, 3000.0f,
+                                     4000.0f, 6000.0f, 8000.0f, 10000.0f, 16000.0f, 20000.0f };
+        profile.curveGains = { 6.0f, 5.5f, 4.5f, 0.5f, 1.0f, 0.0f, -1.0f, -4.0f,
+                               -1.5f, 5.5f, -2.5f, -2.0f, -3.0f, -3.0f };
+
+        return profile;
+    }
+
+    /** A generated stereo user IR: a direct impulse, then half a second of noise decaying by 60 dB,
+        independent per ear. Long enough to run through the deferred 1024- and 8192-sample segments.
+    */
+    juce::Result writeTestImpulseResponse (const juce::File& file)
+    {
+        constexpr int length = 24000;
+
+        juce::AudioBuffer<float> impulse (2, length);
+        juce::Random random (0x1e5);
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            auto* data = impulse.getWritePointer (ch);
+
+            for (int i = 0; i < length; ++i)
+                data[i] = 0.02f * (random.nextFloat() * 2.0f - 1.0f) * std::pow (10.0f, -3.0f * (float) i / (float) length);
+
+            data[0] = 1.0f;
+        }
+
+        file.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream (std::make_unique<juce::FileOutputStream> (file));
+        juce::WavAudioFormat wav;
+
+        auto writer = wav.createWriterFor (stream, juce::AudioFormatWriterOptions{}
+                                                       .withSampleRate (GoldenHarness::sampleRate)
+                                                       .withNumChannels (2)
+                                                       .withBitsPerSample (32)
+                                                       .withSampleFormat (juce::AudioFormatWriterOptions::SampleFormat::floatingPoint));
+
+        if (writer == nullptr || ! writer->writeFromAudioSampleBuffer (impulse, 0, length))
+            return juce::Result::fail ("Can't write the test impulse response to " + file.getFullPathName());
+
+        return juce::Result::ok();
+    }
+
+    //==========================================================================
+    // Stimuli, all at GoldenHarness::sampleRate and identical on every run
+
+    void fillPinkNoise (float* data, int numSamples, float gain, juce::Random& random)
+    {
+        // Paul Kellet's economy pink filter
+        float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float white = random.nextFloat() * 2.0f - 1.0f;
+            b0 = 0.99765f * b0 + white * 0.0990460f;
+            b1 = 0.96300f * b1 + white * 0.2965164f;
+            b2 = 0.57000f * b2 + white * 1.0526913f;
+            data[i] = gain * (b0 + b1 + b2 + white * 0.1848f);
+        }
+    }
+
+    juce::AudioBuffer<float> makeStimulus (const juce::String& name)
+    {
+        constexpr int numSamples = GoldenHarness::numSamples;
+        constexpr double fs = GoldenHarness::sampleRate;
+
+        juce::AudioBuffer<float> buffer (2, numSamples);
+        buffer.clear();
+
+        juce::Random random (0x601d);
+        auto* left = buffer.getWritePointer (0);
+        auto* right = buffer.getWritePointer (1);
+
+        if (name == "sweep")
+        {
+            // Exponential sine sweep, 20 Hz to 20 kHz at -12 dBFS
+            const double duration = numSamples / fs;
+            const double rate = std::log (20000.0 / 20.0);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const double t = i / fs;
+                const double phase = juce::MathConstants<double>::twoPi * 20.0 * duration / rate
+                                     * (std::exp (t * rate / duration) - 1.0);
+                left[i] = right[i] = 0.25f * (float) std::sin (phase);
+            }
+        }
+        else if (name == "pink")
+        {
+            // Independent pink noise per ear, around -20 dBFS
+            fillPinkNoise (left, numSamples, 0.05f, random);
+            fillPinkNoise (right, numSamples, 0.05f, random);
+        }
+        else if (name == "impulses")
+        {
+            // Every 100 ms: shows the crossover's and compressor's response to transients
+            for (int i = 0; i < numSamples; i += (int) (fs / 10.0))
+                left[i] = right[i] = 0.5f;
+        }
+        else if (name == "speech")
+        {
+            // Syllable-like bursts of pink noise: 150 ms with a Hann envelope every 250 ms,
+            // alternating soft (-35 dBFS) and loud (-15 dBFS), with a speech-like treble roll-off
+            fillPinkNoise (left, numSamples, 1.0f, random);
+
+            const int period = (int) (0.25 * fs);
+            const int burst = (int) (0.15 * fs);
+            float lowpass = 0.0f;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                lowpass += 0.3f * (left[i] - lowpass);
+
+                const int position = i % period;
+                const float level = (i / period) % 2 == 0 ? 0.018f : 0.18f;
+                const float window = position < burst
+                                         ? 0.5f - 0.5f * std::cos (juce::MathConstants<float>::twoPi * (float) position / (float) burst)
+                                         : 0.0f;
+
+                left[i] = right[i] = level * window * lowpass;
+            }
+        }
+        else if (name == "steps")
+        {
+            // 1 kHz tone stepping through the thresholds every 200 ms: attack and release
+            const std::array<float, 5> levelsDb { -60.0f, -40.0f, -20.0f, -10.0f, -40.0f };
+            const int stepLength = numSamples / (int) levelsDb.size();
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto gain = juce::Decibels::decibelsToGain (levelsDb[(size_t) juce::jmin (i / stepLength, 4)]);
+                left[i] = right[i] = gain * (float) std::sin (juce::MathConstants<double>::twoPi * 1000.0 * i / fs);
+            }
+        }
+        else
+        {
+            jassertfalse;
+        }
+
+        return buffer;
+    }
+
+    //==========================================================================
+    juce::String getEarName (int ear)
+    {
+        return ear == 0 ? "left" : "right";
+    }
+
+    juce::String getBandName (int band)
+    {
+        const auto frequency = HearingCorrectionAUv2AudioProcessor::audiogramFrequencies[(size_t) band];
+
+        return frequency >= 1000.0f ? juce::String (frequency / 1000.0f) + " kHz"
+                                    : juce::String (juce::roundToInt (frequency)) + " Hz";
+    }
+
+    juce::String formatTime (int sample)
+    {
+        return juce::String (sample / GoldenHarness::sampleRate, 3) + " s";
+    }
+
+    /** Output energy per audiogram band (octave around each audiogram frequency), dB. */
+    std::array<std::array<double, numBands>, 2> getBandEnergiesDb (const juce::AudioBuffer<float>& audio)
+    {
+        constexpr int order = 16;
+        static_assert ((1 << order) >= GoldenHarness::numSamples, "FFT must cover the stimulus");
+
+        juce::dsp::FFT fft (order);
+        const int size = fft.getSize();
+        const double binHz = GoldenHarness::sampleRate / size;
+
+        std::vector<float> data ((size_t) size * 2);
+        std::array<std::array<double, numBands>, 2> energiesDb {};
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            std::fill (data.begin(), data.end(), 0.0f);
+            std::copy_n (audio.getReadPointer (ch), audio.getNumSamples(), data.begin());
+            fft.performFrequencyOnlyForwardTransform (data.data());
+
+            for (int band = 0; band < numBands; ++band)
+            {
+                const double centre = HearingCorrectionAUv2AudioProcessor::audiogramFrequencies[(size_t) band];
+                const int first = (int) std::ceil (centre / juce::MathConstants<double>::sqrt2 / binHz);
+                const int last = juce::jmin (size / 2, (int) (centre * juce::MathConstants<double>::sqrt2 / binHz));
+
+                double energy = 0.0;
+
+                for (int bin = first; bin <= last; ++bin)
+                    energy += (double) data[(size_t) bin] * data[(size_t) bin];
+
+                energiesDb[(size_t) ch][(size_t) band] = 10.0 * std::log10 (energy + 1.0e-20);
+            }
+        }
+
+        return energiesDb;
+    }
+}
+
+//==============================================================================
+std::vector<GoldenHarness::Case> GoldenHarness::getCases (const juce::String& filter)
+{
+    std::vector<Case> cases;
+
+    for (auto& stimulus : stimuli)
+    {
+        for (auto [modelName, modelIndex] : models)
+        {
+            for (auto& audiogram : audiograms)
+            {
+                for (auto& parameterSet : parameterSets)
+                {
+                    if (parameterSet.audiogram != nullptr && juce::String (parameterSet.audiogram) != audiogram.name)
+                        continue;
+
+                    Case c;
+                    c.name = stimulus + "_" + modelName + "_" + audiogram.name + "_" + parameterSet.name;
+                    c.stimulus = stimulus;
+
+                    if (filter.isNotEmpty() && ! c.name.containsIgnoreCase (filter))
+                        continue;
+
+                    auto& parameters = c.settings.parameters;
+                    parameters = parameterSet.values;
+                    parameters["modelSelect"] = (float) modelIndex;
+
+                    for (int band = 0; band < numBands; ++band)
+                    {
+                        parameters["audiogram_" + juce::String (band + 1).paddedLeft ('0', 2)] = audiogram.right[(size_t) band];
+                        parameters["audiogram_" + juce::String (numBands + band + 1).paddedLeft ('0', 2)] = audiogram.left[(size_t) band];
+                    }
+
+                    cases.push_back (std::move (c));
+                }
+            }
+        }
+    }
+
+    // The headphone, tier and user IR cases all use NAL-R on the sloping audiogram, with the test headphone
+    auto addHeadphoneCase = [&] (const juce::String& stimulus, const juce::String& suffix,
+                                 HeadphoneEQMode mode, int qualityTier, bool impulseResponse)
+    {
+        Case c;
+        c.name = stimulus + "_nal_sloping_" + suffix;
+        c.stimulus = stimulus;
+
+        if (filter.isNotEmpty() && ! c.name.containsIgnoreCase (filter))
+            return;
+
+        const auto& audiogram = audiograms[1];
+        auto& parameters = c.settings.parameters;
+        parameters["modelSelect"] = 1.0f;
+        parameters["headphoneEQEnable"] = 1.0f;
+
+        for (int band = 0; band < numBands; ++band)
+        {
+            parameters["audiogram_" + juce::String (band + 1).paddedLeft ('0', 2)] = audiogram.right[(size_t) band];
+            parameters["audiogram_" + juce::String (numBands + band + 1).paddedLeft ('0', 2)] = audiogram.left[(size_t) band];
+        }
+
+        c.settings.headphoneEQMode = mode;
+        c.testHeadphone = true;
+        c.qualityTier = qualityTier;
+        c.testImpulseResponse = impulseResponse;
+        cases.push_back (std::move (c));
+    };
+
+    for (auto& stimulus : stimuli)
+    {
+        // Headphone correction ahead of the WDRC, in each mode
+        for (auto [modeName, mode] : headphoneModes)
+            addHeadphoneCase (stimulus, juce::String ("headphone-") + modeName, mode, -1, false);
+
+        // Each reduced governor tier, held; parametric, so the section budget applies
+        for (int tier = QualityGovernor::controlRateGains; tier < QualityGovernor::numTiers; ++tier)
+            addHeadphoneCase (stimulus, "tier" + juce::String (tier), HeadphoneEQMode::Parametric, tier, false);
+
+        // A generated user IR after the parametric correction, through the zero-latency convolver
+        addHeadphoneCase (stimulus, "user-ir", HeadphoneEQMode::Parametric, -1, true);
+    }
+
+    return cases;
+}
+
+//==============================================================================
+juce::Result GoldenHarness::render (const Case& c, Capture& capture)
+{
+    // Declared first, so the file outlives the processor's IR loader
+    juce::TemporaryFile impulseFile (".wav");
+    auto processor = std::make_unique<HearingCorrectionAUv2AudioProcessor>();
+
+    if (auto result = c.settings.applyTo (*processor); result.failed())
+        return result;
+
+    if (c.testHeadphone)
+        processor->headphoneEQ.setProfile (makeTestHeadphoneProfile());
+
+    // Loaded like a user's file (first channel left, second right) and decoded in prepareToPlay()
+    if (c.testImpulseResponse)
+    {
+        if (auto result = writeTestImpulseResponse (impulseFile.getFile()); result.failed())
+            return result;
+
+        for (auto ear : { UserIRStage::Ear::Left, UserIRStage::Ear::Right })
+            processor->loadUserImpulseResponse (ear, impulseFile.getFile());
+    }
+
+    processor->holdQualityTier (c.qualityTier);
+
+    processor->setNonRealtime (true);
+    processor->setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor->prepareToPlay (sampleRate, blockSize);
+
+    const auto wdrc = processor->getWDRCSettings();
+    capture.targetsDb = { wdrc.leftTargetsDb, wdrc.rightTargetsDb };
+    capture.ratios = { wdrc.leftRatios, wdrc.rightRatios };
+
+    capture.output = makeStimulus (c.stimulus);
+    capture.envelopesDb.clear();
+    capture.gainsDb.clear();
+
+    juce::MidiBuffer midi;
+
+    for (int start = 0; start < numSamples; start += blockSize)
+    {
+        juce::AudioBuffer<float> block (capture.output.getArrayOfWritePointers(), 2, start,
+                                        juce::jmin (blockSize, numSamples - start));
+        processor->processBlock (block, midi);
+
+        if ((start + blockSize) % frameSize == 0)
+        {
+            for (int ear = 0; ear < 2; ++ear)
+            {
+                const auto levels = processor->getWDRCBandLevels (ear);
+
+                for (int band = 0; band < numBands; ++band)
+                {
+                    capture.envelopesDb.push_back (juce::Decibels::gainToDecibels (levels.envelopes[(size_t) band], -200.0f));
+                    capture.gainsDb.push_back (juce::Decibels::gainToDecibels (levels.gains[(size_t) band], -200.0f));
+                }
+            }
+        }
+    }
+
+    // Line the output up with the stimulus: drop the reported latency (the output limiter's
+    // lookahead, plus any FIR headphone correction), flushing it out with silence
+    if (const int latency = juce::jmin (processor->getLatencySamples(), numSamples); latency > 0)
+    {
+        juce::AudioBuffer<float> tail (2, latency);
+        tail.clear();
+
+        for (int start = 0; start < latency; start += blockSize)
+        {
+            juce::AudioBuffer<float> block (tail.getArrayOfWritePointers(), 2, start, juce::jmin (blockSize, latency - start));
+            processor->processBlock (block, midi);
+        }
+
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            auto* output = capture.output.getWritePointer (channel);
+            std::memmove (output, output + latency, sizeof (float) * (size_t) (numSamples - latency));
+            std::copy (tail.getReadPointer (channel), tail.getReadPointer (channel) + latency, output + numSamples - latency);
+        }
+    }
+
+    processor->releaseResources();
+
+    jassert ((int) capture.gainsDb.size() == numFrames * 2 * numBands);
+    return juce::Result::ok();
+}
+
+juce::Result GoldenHarness::write (const juce::File& file, const Capture& capture)
+{
+    juce::MemoryOutputStream data;
+
+    data.writeInt (fileMagic);
+    data.writeInt (formatVersion);
+    data.writeInt (numSamples);
+    data.writeInt (numFrames);
+
+    for (auto* table : { &capture.targetsDb, &capture.ratios })
+        for (auto& ear : *table)
+            for (auto value : ear)
+                data.writeFloat (value);
+
+    for (auto* trajectory : { &capture.envelopesDb, &capture.gainsDb })
+        for (auto value : *trajectory)
+            data.writeFloat (value);
+
+    // Waveform: 24-bit fractions of each channel's peak (well below any useful tolerance)
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        const auto peak = capture.output.getMagnitude (ch, 0, numSamples);
+        const auto scale = peak > 0.0f ? peak : 1.0f;
+        const auto* samples = capture.output.getReadPointer (ch);
+
+        data.writeFloat (scale);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            char bytes[3];
+            juce::ByteOrder::littleEndian24BitToChars (juce::roundToInt (samples[i] / scale * fullScale24), bytes);
+            data.write (bytes, 3);
+        }
+    }
+
+    file.deleteFile();
+    juce::FileOutputStream fileStream (file);
+
+    if (! fileStream.openedOk())
+        return juce::Result::fail ("Can't write " + file.getFullPathName());
+
+    {
+        juce::GZIPCompressorOutputStream gzip (fileStream, 9);
+
+        if (! gzip.write (data.getData(), data.getDataSize()))
+            return juce::Result::fail ("Write failed: " + file.getFullPathName());
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result GoldenHarness::read (const juce::File& file, Capture& capture)
+{
+    juce::FileInputStream fileStream (file);
+
+    if (! fileStream.openedOk())
+        return juce::Result::fail ("Can't read " + file.getFullPathName());
+
+    juce::GZIPDecompressorInputStream gzip (fileStream);
+
+    if (gzip.readInt() != fileMagic || gzip.readInt() != formatVersion)
+        return juce::Result::fail ("Not a golden file of this format (record it again)");
+
+    if (gzip.readInt() != numSamples || gzip.readInt() != numFrames)
+        return juce::Result::fail ("Recorded with different harness settings (record it again)");
+
+    for (auto* table : { &capture.targetsDb, &capture.ratios })
+        for (auto& ear : *table)
+            for (auto& value : ear)
+                value = gzip.readFloat();
+
+    for (auto* trajectory : { &capture.envelopesDb, &capture.gainsDb })
+    {
+        trajectory->resize ((size_t) (numFrames * 2 * numBands));
+
+        for (auto& value : *trajectory)
+            value = gzip.readFloat();
+    }
+
+    capture.output.setSize (2, numSamples);
+    std::vector<char> bytes ((size_t) numSamples * 3);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        const auto scale = gzip.readFloat() / fullScale24;
+
+        if (gzip.read (bytes.data(), (int) bytes.size()) != (int) bytes.size())
+            return juce::Result::fail ("Truncated golden file: " + file.getFullPathName());
+
+        auto* samples = capture.output.getWritePointer (ch);
+
+        for (int i = 0; i < numSamples; ++i)
+            samples[i] = (float) juce::ByteOrder::littleEndian24Bit (bytes.data() + i * 3) * scale;
+    }
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+GoldenHarness::CaseResult GoldenHarness::compare (const Case& c, const Capture& golden, const Capture& current,
+                                                  const GoldenTolerances& tolerances)
+{
+    CaseResult result;
+    result.name = c.name;
+
+    // Stages are checked in processing order; the first one out of tolerance is reported
+    auto diverged = [&result] (const juce::String& stage, const juce::String& details)
+    {
+        if (result.passed())
+        {
+            result.divergedStage = stage;
+            result.error = stage + ": " + details;
+        }
+    };
+
+    // Model: per-band targets and ratios
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        for (int band = 0; band < numBands; ++band)
+        {
+            const auto goldenTarget = golden.targetsDb[(size_t) ear][(size_t) band];
+            const auto target = current.targetsDb[(size_t) ear][(size_t) band];
+            const auto goldenRatio = golden.ratios[(size_t) ear][(size_t) band];
+            const auto ratio = current.ratios[(size_t) ear][(size_t) band];
+
+            if (std::abs (target - goldenTarget) > tolerances.targetErrorDb)
+                diverged ("model", getEarName (ear) + " " + getBandName (band) + " target gain "
+                                   + juce::String (target, 2) + " dB, golden " + juce::String (goldenTarget, 2) + " dB");
+
+            if (std::abs (ratio - goldenRatio) > 1.0e-3f)
+                diverged ("model", getEarName (ear) + " " + getBandName (band) + " ratio "
+                                   + juce::String (ratio, 3) + ":1, golden " + juce::String (goldenRatio, 3) + ":1");
+        }
+    }
+
+    // Envelope followers (band split + detector), then the smoothed gains
+    for (auto [stage, goldenTrajectory, trajectory] : { std::make_tuple ("envelope", &golden.envelopesDb, &current.envelopesDb),
+                                                        std::make_tuple ("gain", &golden.gainsDb, &current.gainsDb) })
+    {
+        double worst = 0.0;
+        size_t worstIndex = 0;
+
+        for (size_t i = 0; i < trajectory->size(); ++i)
+        {
+            const auto expected = (*goldenTrajectory)[i];
+            const auto actual = (*trajectory)[i];
+
+            // Below -100 dBFS an envelope is silence either way
+            if (expected < -100.0f && actual < -100.0f)
+                continue;
+
+            const auto difference = (double) std::abs (actual - expected);
+
+            if (difference > worst)
+            {
+                worst = difference;
+                worstIndex = i;
+            }
+        }
+
+        result.trajectoryErrorDb = juce::jmax (result.trajectoryErrorDb, worst);
+
+        if (worst > tolerances.trajectoryErrorDb)
+        {
+            const auto frame = (int) (worstIndex / (2 * numBands));
+            const auto ear = (int) (worstIndex / numBands) % 2;
+            const auto band = (int) (worstIndex % numBands);
+
+            diverged (stage, getEarName (ear) + " " + getBandName (band) + " band off by " + juce::String (worst, 3)
+                             + " dB at " + formatTime ((frame + 1) * frameSize) + " ("
+                             + juce::String ((*trajectory)[worstIndex], 2) + " dB, golden "
+                             + juce::String ((*goldenTrajectory)[worstIndex], 2) + " dB)");
+        }
+    }
+
+    // Output spectrum: energy per audiogram band
+    {
+        const auto goldenEnergies = getBandEnergiesDb (golden.output);
+        const auto energies = getBandEnergiesDb (current.output);
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            for (int band = 0; band < numBands; ++band)
+            {
+                const auto difference = std::abs (energies[(size_t) ch][(size_t) band] - goldenEnergies[(size_t) ch][(size_t) band]);
+                result.spectralErrorDb = juce::jmax (result.spectralErrorDb, difference);
+
+                if (difference > tolerances.spectralErrorDb)
+                    diverged ("output spectrum", getEarName (ch) + " " + getBandName (band) + " band energy off by "
+                                                 + juce::String (difference, 3) + " dB");
+            }
+        }
+    }
+
+    // Output waveform
+    {
+        float peak = 0.0f;
+        int peakChannel = 0, peakSample = 0;
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            const auto* expected = golden.output.getReadPointer (ch);
+            const auto* actual = current.output.getReadPointer (ch);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto difference = std::abs (actual[i] - expected[i]);
+
+                if (difference > peak)
+                {
+                    peak = difference;
+                    peakChannel = ch;
+                    peakSample = i;
+                }
+            }
+        }
+
+        result.maxAbsErrorDb = juce::Decibels::gainToDecibels ((double) peak, -200.0);
+
+        if (result.maxAbsErrorDb > tolerances.maxAbsErrorDb)
+            diverged ("output", getEarName (peakChannel) + " differs by " + juce::String (result.maxAbsErrorDb, 1)
+                                + " dBFS at " + formatTime (peakSample));
+    }
+
+    return result;
+}
+
+//==============================================================================
+juce::Result GoldenHarness::record (const juce::File& folder, const juce::String& filter,
+                                    std::function<void (const juce::String&)> onCaseDone)
+{
+    const auto cases = getCases (filter);
+
+    if (cases.empty())
+        return juce::Result::fail ("No cases match '" + filter + "'");
+
+    if (! folder.createDirectory())
+        return juce::Result::fail ("Can't create " + folder.getFullPathName());
+
+    for (auto& c : cases)
+    {
+        Capture capture;
+        auto result = render (c, capture);
+
+        if (result.wasOk())
+            result = write (folder.getChildFile (c.name + ".golden"), capture);
+
+        if (result.failed())
+            return juce::Result::fail (c.name + ": " + result.getErrorMessage());
+
+        if (onCaseDone != nullptr)
+            onCaseDone (c.name);
+    }
+
+    // What's in the folder and how it was made, for people comparing folders
+    auto* manifest = new juce::DynamicObject();
+    manifest->setProperty ("format", formatVersion);
+    manifest->setProperty ("tool", "EarFixRender " + juce::String (ProjectInfo::versionString));
+    manifest->setProperty ("date", juce::Time::getCurrentTime().toISO8601 (true));
+    manifest->setProperty ("sampleRate", sampleRate);
+    manifest->setProperty ("blockSize", blockSize);
+    manifest->setProperty ("frameSize", frameSize);
+
+    juce::Array<juce::var> names;
+
+    for (auto& file : folder.findChildFiles (juce::File::findFiles, false, "*.golden"))
+        names.add (file.getFileNameWithoutExtension());
+
+    manifest->setProperty ("cases", names);
+
+    if (! folder.getChildFile ("manifest.json").replaceWithText (juce::JSON::toString (juce::var (manifest))))
+        return juce::Result::fail ("Can't write the manifest in " + folder.getFullPathName());
+
+    return juce::Result::ok();
+}
+
+std::vector<GoldenHarness::CaseResult> GoldenHarness::check (const juce::File& folder, const GoldenTolerances& tolerances,
+                                                             const juce::String& filter,
+                                                             std::function<void (const CaseResult&)> onCaseDone)
+{
+    std::vector<CaseResult> results;
+
+    for (auto& c : getCases (filter))
+    {
+        CaseResult result;
+        result.name = c.name;
+
+        const auto file = folder.getChildFile (c.name + ".golden");
+        Capture golden, current;
+
+        RealtimeSafety::clear();
+
+        if (! file.existsAsFile())
+        {
+            result.divergedStage = "missing";
+            result.error = "no golden output (record it with --golden-record)";
+        }
+        else if (auto readResult = read (file, golden); readResult.failed())
+        {
+            result.divergedStage = "missing";
+            result.error = readResult.getErrorMessage();
+        }
+        else if (auto renderResult = render (c, current); renderResult.failed())
+        {
+            result.divergedStage = "render";
+            result.error = renderResult.getErrorMessage();
+        }
+        else
+        {
+            result = compare (c, golden, current, tolerances);
+        }
+
+        // Real-time safety fails a case whatever the output, but a divergence is still reported
+        if (const auto numViolations = RealtimeSafety::getNumViolations(); numViolations > 0)
+        {
+            result.realtimeViolations = RealtimeSafety::getViolations();
+
+            auto error = juce::String (numViolations) + " real-time safety violation(s) in processBlock";
+
+            if (! result.realtimeViolations.empty())
+            {
+                const auto& first = result.realtimeViolations.front();
+                error << ", first: " << RealtimeSafety::getTypeName (first.type) << " (" << first.detail << ")";
+            }
+
+            if (! result.passed())
+                error << "; also " << result.divergedStage << ": " << result.error;
+
+            result.divergedStage = "realtime";
+            result.error = error;
+        }
+
+        if (onCaseDone != nullptr)
+            onCaseDone (result);
+
+        results.push_back (std::move (result));
+    }
+
+    return results;
+}
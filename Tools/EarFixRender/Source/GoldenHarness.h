@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    GoldenHarness.h
+    Golden-output regression checks for the EarFix processor
+
+    A fixed matrix of cases - deterministic stimuli (sweep, pink noise,
+    impulse train, speech-like bursts, level steps) x audiograms x models x
+    parameter sets, plus headphone correction in each mode on a fixed
+    profile, each reduced quality tier and a generated user IR - is rendered through the processor at 48 kHz. For each
+    case the harness captures what every stage produced:
+
+      model     per-band target gains and compression ratios
+      envelope  per-band envelope follower levels, every frameSize samples
+      gain      per-band smoothed WDRC gains, every frameSize samples
+      output    the output waveform
+
+    record() stores these as one gzipped file per case; the waveform is kept
+    as 24-bit fractions of each channel's peak. check() renders again and
+    compares stage by stage, in processing order, so a mismatch names the
+    first stage that diverged (and the ear, band and time) rather than just
+    a different output. The output is compared three ways: peak sample
+    error, energy per audiogram band (spectral error), and, through the
+    gain trajectories, how the compression moved over time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RenderSettings.h"
+#include "../../../Source/Diagnostics/RealtimeSafety.h"
+
+//==============================================================================
+struct GoldenTolerances
+{
+    double maxAbsErrorDb = -90.0;       // Output: peak sample difference, dBFS
+    double spectralErrorDb = 0.05;      // Output: energy per audiogram band, dB
+    double trajectoryErrorDb = 0.05;    // Envelope and gain trajectories, dB
+    double targetErrorDb = 0.01;        // Model target gains, dB
+};
+
+//==============================================================================
+class GoldenHarness
+{
+public:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 64;
+    static constexpr int frameSize = 512;           // Trajectory resolution, samples
+    static constexpr int numSamples = 48000;        // One second per stimulus
+
+    struct Case
+    {
+        juce::String name;                          // "<stimulus>_<model>_<audiogram>_<parameters>"
+        juce::String stimulus;
+        RenderSettings settings;
+        bool testHeadphone = false;                 // Headphone correction with a fixed built-in profile
+        int qualityTier = -1;                       // Held governor tier (-1: the governor decides)
+        bool testImpulseResponse = false;           // A generated user IR on both ears, long enough for every segment
+    };
+
+    /** The regression matrix, optionally only the cases whose name contains filter. */
+    static std::vector<Case> getCases (const juce::String& filter = {});
+
+    struct CaseResult
+    {
+        juce::String name;
+        juce::String error;                         // Empty if the case passed
+        juce::String divergedStage;                 // First stage out of tolerance
+
+        double maxAbsErrorDb = -200.0;
+        double spectralErrorDb = 0.0;
+        double trajectoryErrorDb = 0.0;
+
+        // EARFIX_RT_CHECKS builds: allocations, locks and file access inside processBlock()
+        std::vector<RealtimeSafety::Violation> realtimeViolations;
+
+        bool passed() const { return error.isEmpty(); }
+    };
+
+    /** Renders every case and writes the golden files (plus a manifest) into folder. */
+    juce::Result record (const juce::File& folder, const juce::String& filter,
+                         std::function<void (const juce::String&)> onCaseDone);
+
+    /** Renders every case and compares it with the golden file in folder. */
+    std::vector<CaseResult> check (const juce::File& folder, const GoldenTolerances& tolerances,
+                                   const juce::String& filter,
+                                   std::function<void (const CaseResult&)> onCaseDone);
+
+private:
+    static constexpr int numBands = HearingCorrectionAUv2AudioProcessor::numAudiogramBands;
+    static constexpr int numFrames = numSamples / frameSize;
+
+    struct Capture
+    {
+        std::array<std::array<float, numBands>, 2> targetsDb {}, ratios {};    // [ear][band], left first
+        std::vector<float> envelopesDb, gainsDb;                               // [frame][ear][band]
+        juce::AudioBuffer<float> output;
+    };
+
+    static juce::Result render (const Case& c, Capture& capture);
+    static juce::Result write (const juce::File& file, const Capture& capture);
+    static juce::Result read (const juce::File& file, Capture& capture);
+    static CaseResult compare (const Case& c, const Capture& golden, const Capture& current,
+                               const GoldenTolerances& tolerances);
+};
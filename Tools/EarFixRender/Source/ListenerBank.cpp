@@ -0,0 +1,335 @@
+/*
+  ==============================================================================
+
+    ListenerBank.cpp
+    The plugin's band split and WDRC stage for many listeners at once
+
+  ==============================================================================
+*/
+
+#include "ListenerBank.h"
+
+//==============================================================================
+ListenerBank::ListenerBank (const std::vector<WDRCSettings>& listeners, int maxBlockSizeToUse)
+    : numListeners ((int) listeners.size()),
+      maxBlockSize (maxBlockSizeToUse)
+{
+    jassert (! listeners.empty());
+
+    crossover = listeners.front().crossover;
+
+    // Lanes run one detector kind: peak listeners first, then RMS
+    std::vector<int> order;
+
+    for (const bool energy : { false, true })
+        for (int i = 0; i < numListeners; ++i)
+            if (listeners[(size_t) i].energyDetector == energy)
+                order.push_back (i);
+
+    int groupLane = laneWidth;
+
+    for (const int i : order)
+    {
+        const auto& listener = listeners[(size_t) i];
+
+        // A new group when one is full, and where the detector changes
+        if (groupLane == laneWidth || groups.back().energyDetector != listener.energyDetector)
+        {
+            groups.emplace_back();
+            groups.back().listeners.fill (-1);
+            groups.back().energyDetector = listener.energyDetector;
+            groupLane = 0;
+        }
+
+        auto& group = groups.back();
+        group.listeners[(size_t) groupLane] = i;
+        group.flatGains[groupLane] = listener.loudnessRestoration;
+        group.linkAmount[groupLane] = juce::jlimit (0.0f, 1.0f, listener.stereoLink);
+        group.fullLink[groupLane] = listener.stereoLink >= 1.0f;
+        group.averageLink[groupLane] = listener.averageLink;
+
+        for (int ear = 0; ear < 2; ++ear)
+        {
+            auto& lanes = group.ears[(size_t) ear];
+            const auto& targets = ear == 0 ? listener.leftTargetsDb : listener.rightTargetsDb;
+            const auto& curves = ear == 0 ? listener.leftGainCurves : listener.rightGainCurves;
+            const bool enabled = ear == 0 ? listener.leftEnabled : listener.rightEnabled;
+
+            for (int band = 0; band < numBands; ++band)
+            {
+                for (int point = 0; point < numCurvePoints; ++point)
+                    lanes.gainCurve[band][point][groupLane] = curves[(size_t) band][(size_t) point];
+
+                // A linked detector takes the slower of the ears' time constants
+                auto& bandLanes = lanes.bands[(size_t) band];
+                const auto b = (size_t) band;
+                const float attack = ear == 0 ? listener.leftAttackCoeffs[b] : listener.rightAttackCoeffs[b];
+                const float release = ear == 0 ? listener.leftReleaseCoeffs[b] : listener.rightReleaseCoeffs[b];
+                const bool fullLink = group.fullLink[groupLane];
+
+                bandLanes.attackCoeff[groupLane] = fullLink ? std::max (listener.leftAttackCoeffs[b], listener.rightAttackCoeffs[b]) : attack;
+                bandLanes.releaseCoeff[groupLane] = fullLink ? std::max (listener.leftReleaseCoeffs[b], listener.rightReleaseCoeffs[b]) : release;
+                bandLanes.gainSmoothCoeff[groupLane] = listener.gainSmoothCoeff;
+
+                // Loudness listeners' bands come on with their first gains
+                const bool active = enabled && ! listener.loudnessRestoration && targets[b] > 0.0f;
+                bandLanes.active[groupLane] = active;
+                bandLanes.tracking[groupLane] = active || fullLink;
+            }
+
+            lanes.enabled[groupLane] = enabled;
+            lanes.outputGain[groupLane] = listener.outputGain;
+        }
+
+        if (listener.loudnessRestoration)
+        {
+            auto loudness = std::make_unique<LoudnessLane>();
+            loudness->group = groups.size() - 1;
+            loudness->lane = groupLane;
+            loudness->fitting = listener.loudnessFitting;
+            loudness->strength = listener.loudnessStrength;
+            loudness->maxBoostDb = listener.loudnessMaxBoostDb;
+            loudness->restorer.prepare (listener.sampleRate, HearingCorrectionAUv2AudioProcessor::crossoverFrequencies.data(),
+                                        numCrossovers, HearingCorrectionAUv2AudioProcessor::wdrcFullScaleDbSpl);
+            loudnessLanes.push_back (std::move (loudness));
+        }
+
+        ++groupLane;
+    }
+
+    bandBuffer.resize ((size_t) (2 * numBands * maxBlockSize));
+    laneBuffer.resize ((size_t) (maxBlockSize * laneWidth));
+
+    for (const auto& listener : listeners)
+    {
+        limiters.push_back (std::make_unique<LookaheadLimiter>());
+        limiters.back()->prepare (listener.sampleRate);
+        limiters.back()->setCeiling (listener.outputCeiling);
+    }
+
+    reset();
+}
+
+void ListenerBank::reset()
+{
+    for (auto& ear : splitters)
+        for (auto& splitter : ear)
+            splitter.reset();
+
+    // Same starting point as the plugin's prepareToPlay()
+    for (auto& group : groups)
+    {
+        for (auto& lanes : group.ears)
+        {
+            for (auto& band : lanes.bands)
+            {
+                std::fill (std::begin (band.envelope), std::end (band.envelope), 0.0f);
+                std::fill (std::begin (band.smoothedGain), std::end (band.smoothedGain), 1.0f);
+            }
+        }
+    }
+
+    for (auto& loudness : loudnessLanes)
+        loudness->restorer.reset();
+
+    for (auto& limiter : limiters)
+        limiter->reset();
+}
+
+//==============================================================================
+void ListenerBank::process (const float* left, const float* right, int numSamples,
+                            std::vector<juce::AudioBuffer<float>>& outputs, int outputOffset) noexcept
+{
+    jassert (numSamples <= maxBlockSize);
+    jassert ((int) outputs.size() >= numListeners);
+
+    // The loudness listeners' gains for this block, from the signal before the band split
+    for (auto& loudness : loudnessLanes)
+        updateLoudness (*loudness, left, right, numSamples);
+
+    // Shared band split, the same cascade as processBlock(): each crossover takes
+    // the previous highpass output, the last band is what remains
+    const float* inputs[2] = { left, right };
+
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        auto& earSplitters = splitters[(size_t) ear];
+        float* bands = bandBuffer.data() + ear * numBands * maxBlockSize;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float remaining = inputs[ear][i];
+
+            for (int band = 0; band < numCrossovers; ++band)
+                earSplitters[(size_t) band].process (crossover[(size_t) band], remaining,
+                                                     bands[band * maxBlockSize + i], remaining);
+
+            bands[numCrossovers * maxBlockSize + i] = remaining;
+        }
+    }
+
+    // Per-listener gain stages, laneWidth listeners at a time
+    for (auto& group : groups)
+    {
+        for (int ear = 0; ear < 2; ++ear)
+        {
+            processEar (group, ear, inputs[ear], numSamples);
+
+            for (int lane = 0; lane < laneWidth && group.listeners[(size_t) lane] >= 0; ++lane)
+            {
+                auto* out = outputs[(size_t) group.listeners[(size_t) lane]].getWritePointer (ear, outputOffset);
+
+                for (int i = 0; i < numSamples; ++i)
+                    out[i] = laneBuffer[(size_t) (i * laneWidth + lane)];
+            }
+        }
+
+        for (int lane = 0; lane < laneWidth && group.listeners[(size_t) lane] >= 0; ++lane)
+        {
+            const auto listener = (size_t) group.listeners[(size_t) lane];
+            auto& output = outputs[listener];
+            limiters[listener]->process (output.getWritePointer (0, outputOffset),
+                                         output.getWritePointer (1, outputOffset), numSamples);
+        }
+    }
+}
+
+void ListenerBank::updateLoudness (LoudnessLane& loudness, const float* left, const float* right, int numSamples) noexcept
+{
+    loudness.restorer.process (left, right, numSamples, loudness.fitting);
+
+    // As the plugin's applyLoudnessRestoration(): each band's target from the restorer, as a
+    // flat gain; bands with none to give are left alone
+    auto& group = groups[loudness.group];
+    const int lane = loudness.lane;
+
+    for (int ear = 0; ear < 2; ++ear)
+    {
+        auto& lanes = group.ears[(size_t) ear];
+
+        for (int band = 0; band < numBands; ++band)
+        {
+            const float targetDb = std::min (loudness.restorer.getGainDb (ear, band) * loudness.strength, loudness.maxBoostDb);
+            auto& bandLanes = lanes.bands[(size_t) band];
+
+            lanes.flatGain[band][lane] = FastDecibels::decibelsToGain (targetDb);
+            bandLanes.active[lane] = lanes.enabled[lane] && targetDb > 0.0f;
+            bandLanes.tracking[lane] = bandLanes.active[lane] || group.fullLink[lane];
+        }
+    }
+}
+
+void ListenerBank::getLinkedLevels (const Group& group, float own, float other, float* levels) noexcept
+{
+    // As the plugin: a partly linked detector moves its ear's level towards the linked one,
+    // a fully linked one hears the linked level itself
+    own = std::abs (own);
+    other = std::abs (other);
+
+    for (int l = 0; l < laneWidth; ++l)
+    {
+        const float linked = group.averageLink[l] ? 0.5f * (own + other) : std::max (own, other);
+        const float blended = own + group.linkAmount[l] * (linked - own);
+        levels[l] = group.fullLink[l] ? linked : blended;
+    }
+}
+
+void ListenerBank::getLinkedMeanSquares (const Group& group, const float* own, const float* other, int length,
+                                         float* meanSquares) noexcept
+{
+    const float ownEnergy = WDRCKernel::getMeanSquare (own, length);
+    const float otherEnergy = WDRCKernel::getMeanSquare (other, length);
+
+    for (int l = 0; l < laneWidth; ++l)
+    {
+        if (group.fullLink[l])
+        {
+            // The linked energy of the ears
+            meanSquares[l] = group.averageLink[l] ? 0.5f * (ownEnergy + otherEnergy) : std::max (ownEnergy, otherEnergy);
+        }
+        else if (group.linkAmount[l] > 0.0f)
+        {
+            // The energy of the blended levels, as the plugin's partly linked detectors see them
+            float levels[WDRCKernel::energyInterval];
+
+            for (int i = 0; i < length; ++i)
+            {
+                const float ownLevel = std::abs (own[i]);
+                const float otherLevel = std::abs (other[i]);
+                const float linked = group.averageLink[l] ? 0.5f * (ownLevel + otherLevel) : std::max (ownLevel, otherLevel);
+                levels[i] = ownLevel + group.linkAmount[l] * (linked - ownLevel);
+            }
+
+            meanSquares[l] = WDRCKernel::getMeanSquare (levels, length);
+        }
+        else
+        {
+            meanSquares[l] = ownEnergy;
+        }
+    }
+}
+
+void ListenerBank::processEar (Group& group, int ear, const float* input, int numSamples) noexcept
+{
+    const float* bands = bandBuffer.data() + ear * numBands * maxBlockSize;
+    const float* otherBands = bandBuffer.data() + (1 - ear) * numBands * maxBlockSize;
+    float* sum = laneBuffer.data();
+    auto& lanes = group.ears[(size_t) ear];
+
+    std::fill (sum, sum + numSamples * laneWidth, 0.0f);
+
+    for (int band = 0; band < numBands; ++band)
+    {
+        const float* x = bands + band * maxBlockSize;
+        const float* other = otherBands + band * maxBlockSize;
+        const auto& curve = lanes.gainCurve[band];
+        const float* flatGain = lanes.flatGain[band];
+
+        // Each listener's gain: from its curve, as HearingCorrectionAUv2AudioProcessor::lookupGainCurve(),
+        // or its flat loudness gain
+        auto gainLaw = [&group, &curve, flatGain] (int l, float inputDb)
+        {
+            const float position = juce::jlimit (0.0f, (float) (numCurvePoints - 1),
+                                                 inputDb - HearingCorrectionAUv2AudioProcessor::gainCurveMinDb);
+            const int index = juce::jmin ((int) position, numCurvePoints - 2);
+            const float fraction = position - (float) index;
+            const float curveGain = curve[index][l] + fraction * (curve[index + 1][l] - curve[index][l]);
+            return group.flatGains[l] ? flatGain[l] : curveGain;
+        };
+
+        auto apply = [x, sum] (int i, const float* gains)
+        {
+            float* out = sum + i * laneWidth;
+
+            for (int l = 0; l < laneWidth; ++l)
+                out[l] += x[i] * gains[l];
+        };
+
+        auto& bandLanes = lanes.bands[(size_t) band];
+
+        if (group.energyDetector)
+        {
+            WDRCKernel::processEnergy (bandLanes, numSamples,
+                                       [&group, x, other] (int start, int length, float* meanSquares)
+                                       {
+                                           getLinkedMeanSquares (group, x + start, other + start, length, meanSquares);
+                                       },
+                                       gainLaw, apply);
+        }
+        else
+        {
+            WDRCKernel::processPeak (bandLanes, numSamples, 1,
+                                     [&group, x, other] (int i, float* levels) { getLinkedLevels (group, x[i], other[i], levels); },
+                                     gainLaw, apply);
+        }
+    }
+
+    // Disabled ears pass the input through; then the output gain
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float* out = sum + i * laneWidth;
+
+        for (int l = 0; l < laneWidth; ++l)
+            out[l] = (lanes.enabled[l] ? out[l] : input[i]) * lanes.outputGain[l];
+    }
+}
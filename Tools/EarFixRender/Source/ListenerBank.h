@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    ListenerBank.h
+    The plugin's band split and WDRC stage for many listeners at once
+
+    The crossover is linear and the same for every listener, so it runs once
+    per ear; only the WDRC envelopes and gains depend on the audiogram. Those
+    run through the plugin's WDRCKernel with listeners as lanes, in groups of
+    laneWidth listeners that share a level detector (peak or RMS). Per lane
+    come the gain curve, the stereo link (each ear's detector hears the
+    other ear's band, which the bank has) and, for MOSL Loudness listeners,
+    flat gains set each block by the listener's own LoudnessRestorer.
+
+    Results match running HearingCorrectionAUv2AudioProcessor::processBlock()
+    on each listener's settings at full quality, after the headphone EQ and
+    IR stages.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+//==============================================================================
+class ListenerBank
+{
+public:
+    using WDRCSettings = HearingCorrectionAUv2AudioProcessor::WDRCSettings;
+
+    /** Listeners per SIMD group (two AVX or four SSE / NEON registers of floats). */
+    static constexpr int laneWidth = 8;
+
+    /** All listeners must have been prepared at the same sample rate (same crossover). */
+    ListenerBank (const std::vector<WDRCSettings>& listeners, int maxBlockSize);
+
+    int getNumListeners() const noexcept { return numListeners; }
+
+    /** Clears all filter and envelope state. */
+    void reset();
+
+    /** Splits a stereo block into bands once and renders every listener.
+
+        outputs[i] is listener i's stereo buffer; the block is written at
+        outputOffset. numSamples must not exceed maxBlockSize.
+    */
+    void process (const float* left, const float* right, int numSamples,
+                  std::vector<juce::AudioBuffer<float>>& outputs, int outputOffset) noexcept;
+
+private:
+    static constexpr int numBands = HearingCorrectionAUv2AudioProcessor::numAudiogramBands;
+    static constexpr int numCrossovers = HearingCorrectionAUv2AudioProcessor::numCrossovers;
+    static constexpr int numCurvePoints = HearingCorrectionAUv2AudioProcessor::numGainCurvePoints;
+
+    using BandLanes = WDRCKernel::Lanes<laneWidth>;
+
+    // One ear of a group's listeners
+    struct EarLanes
+    {
+        std::array<BandLanes, numBands> bands;
+        alignas (32) float gainCurve[numBands][numCurvePoints][laneWidth] {};   // Linear
+        alignas (32) float flatGain[numBands][laneWidth] {};                     // Linear, with flatGains
+        alignas (32) float outputGain[laneWidth] {};
+        bool enabled[laneWidth] {};     // Otherwise the ear passes through
+    };
+
+    // laneWidth listeners with the same level detector; unused lanes are inactive
+    struct Group
+    {
+        std::array<EarLanes, 2> ears;
+        std::array<int, laneWidth> listeners;   // Each lane's listener, -1 if unused
+        bool energyDetector = false;
+
+        bool flatGains[laneWidth] {};           // MOSL Loudness: a flat gain per band, not the curves
+        alignas (32) float linkAmount[laneWidth] {};
+        bool fullLink[laneWidth] {};            // One detector for both ears
+        bool averageLink[laneWidth] {};         // Linked to the ears' average rather than the louder
+    };
+
+    // A MOSL Loudness listener's restorer, which sets its lane's flat gains each block
+    struct LoudnessLane
+    {
+        size_t group = 0;
+        int lane = 0;
+        LoudnessRestorer restorer;
+        LoudnessRestorer::Fitting fitting;
+        float strength = 1.0f, maxBoostDb = 0.0f;
+    };
+
+    void updateLoudness (LoudnessLane& loudness, const float* left, const float* right, int numSamples) noexcept;
+    void processEar (Group& group, int ear, const float* input, int numSamples) noexcept;
+
+    /** Each lane's detector input for one sample of its own ear's band and the other ear's. */
+    static void getLinkedLevels (const Group& group, float own, float other, float* levels) noexcept;
+
+    /** Each lane's detector energy over a sub-block of its own ear's band and the other ear's. */
+    static void getLinkedMeanSquares (const Group& group, const float* own, const float* other, int length,
+                                      float* meanSquares) noexcept;
+
+    int numListeners = 0;
+    int maxBlockSize = 0;
+
+    HearingCorrectionAUv2AudioProcessor::CrossoverDesign crossover;
+    std::array<std::array<LinkwitzRileySplitter, numCrossovers>, 2> splitters;
+
+    std::vector<Group> groups;
+    std::vector<std::unique_ptr<LoudnessLane>> loudnessLanes;
+
+    std::vector<float> bandBuffer;      // [ear][band][sample]
+    std::vector<float> laneBuffer;      // [sample][lane]
+
+    // Each listener's output limiter, as at the end of processBlock()
+    std::vector<std::unique_ptr<LookaheadLimiter>> limiters;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ListenerBank)
+};
@@ -0,0 +1,295 @@
+/*
+  ==============================================================================
+
+    EarFixRender
+    Headless offline renderer for the EarFix processor
+
+    Renders WAV / FLAC / AIFF files through the same processor and DSP code as
+    the plugin, with settings from a JSON preset and/or flags, and reports
+    throughput as a realtime factor.
+
+      EarFixRender --preset listener.json -o renders/ music/
+      EarFixRender --model nal --right 20,25,30,40,50,60 --left 20,25,30,40,50,60 song.wav
+      EarFixRender --headphone "Sennheiser HD 650" --listeners clinic.json -o renders/ music/
+
+    It also carries the golden-output regression harness (see GoldenHarness.h):
+
+      EarFixRender --golden-record golden/        # before a DSP change
+      EarFixRender --golden-check golden/         # after it; fails on any divergence
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include "GoldenHarness.h"
+
+//==============================================================================
+namespace
+{
+    juce::String formatSeconds (double seconds)
+    {
+        return juce::String (seconds, seconds < 10.0 ? 2 : 1) + " s";
+    }
+
+    void printStats (const RenderStats& stats)
+    {
+        if (! stats.succeeded())
+        {
+            std::cerr << stats.input.getFileName() << ": " << stats.error << std::endl;
+            return;
+        }
+
+        std::cout << stats.input.getFileName() << " -> " << stats.output.getFileName() << "  "
+                  << formatSeconds (stats.getAudioSeconds()) << " in " << formatSeconds (stats.renderSeconds)
+                  << "  (" << juce::String (stats.getRealtimeFactor(), 1) << "x realtime)";
+
+        if (stats.numSegments > 1)
+            std::cout << "  " << stats.numSegments << " segments";
+
+        if (stats.numListeners > 1)
+            std::cout << "  " << stats.numListeners << " listeners ("
+                      << juce::String (stats.getRealtimeFactor() * stats.numListeners, 1) << "x realtime combined)";
+
+        if (stats.differenceDb.has_value())
+            std::cout << ", " << juce::String (*stats.differenceDb, 1) << " dBFS from serial";
+
+        std::cout << std::endl;
+    }
+
+    void render (const juce::ArgumentList& arguments)
+    {
+        juce::ArgumentList args (arguments);
+        juce::Array<juce::File> inputs;
+        RenderSettings settings;
+
+        if (auto result = settings.parseArguments (args, inputs); result.failed())
+            juce::ConsoleApplication::fail (result.getErrorMessage());
+
+        if (inputs.isEmpty())
+            juce::ConsoleApplication::fail ("No input files (try --help)");
+
+        std::vector<ListenerPreset> listeners;
+
+        if (settings.listenersFile != juce::File())
+            if (auto result = settings.loadListeners (listeners); result.failed())
+                juce::ConsoleApplication::fail (result.getErrorMessage());
+
+        // Catch bad parameter IDs, headphone names and IR paths once, not per file
+        {
+            HearingCorrectionAUv2AudioProcessor probe;
+
+            if (auto result = settings.applyTo (probe); result.failed())
+                juce::ConsoleApplication::fail (result.getErrorMessage());
+        }
+
+        for (auto& listener : listeners)
+        {
+            HearingCorrectionAUv2AudioProcessor probe;
+
+            if (auto result = listener.settings.applyTo (probe); result.failed())
+                juce::ConsoleApplication::fail (listener.name + ": " + result.getErrorMessage());
+        }
+
+        if (settings.outputDirectory != juce::File() && ! settings.outputDirectory.createDirectory())
+            juce::ConsoleApplication::fail ("Can't create " + settings.outputDirectory.getFullPathName());
+
+        for (auto& input : inputs)
+        {
+            juce::Array<juce::File> outputs;
+
+            if (listeners.empty())
+                outputs.add (settings.getOutputFileFor (input));
+
+            for (auto& listener : listeners)
+                outputs.add (settings.getOutputFileFor (input, listener.name));
+
+            if (outputs.contains (input))
+                juce::ConsoleApplication::fail ("Output would overwrite its input: " + input.getFullPathName()
+                                                + (listeners.empty() ? " (use --output-dir or --suffix)"
+                                                                     : " (use --output-dir)"));
+        }
+
+        OfflineRenderer renderer (settings);
+        const auto numThreads = renderer.getNumThreadsFor (settings.splitFiles ? std::numeric_limits<int>::max()
+                                                                                : inputs.size());
+
+        std::cout << "Rendering " << inputs.size() << (inputs.size() == 1 ? " file" : " files")
+                  << (settings.splitFiles ? " in segments" : "")
+                  << (listeners.empty() ? juce::String() : " for " + juce::String ((int) listeners.size()) + " listeners")
+                  << " on " << numThreads << (numThreads == 1 ? " thread" : " threads") << std::endl;
+
+        const auto startTime = juce::Time::getMillisecondCounterHiRes();
+        auto results = renderer.renderAll (inputs, printStats, listeners);
+        const auto wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+        double audioSeconds = 0.0;
+        int numFailed = 0;
+
+        for (auto& stats : results)
+        {
+            if (stats.succeeded())
+                audioSeconds += stats.getAudioSeconds() * stats.numListeners;
+            else
+                ++numFailed;
+        }
+
+        std::cout << "Total: " << formatSeconds (audioSeconds) << " of audio in " << formatSeconds (wallSeconds)
+                  << "  (" << juce::String (wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0, 1)
+                  << "x realtime)" << std::endl;
+
+        if (numFailed > 0)
+            juce::ConsoleApplication::fail (juce::String (numFailed) + " of " + juce::String (inputs.size())
+                                            + " files failed");
+    }
+
+    //==========================================================================
+    juce::File getGoldenFolder (juce::ArgumentList& args, const juce::String& option)
+    {
+        auto path = args.removeValueForOption (option);
+
+        if (path.isEmpty())
+            juce::ConsoleApplication::fail ("Expected " + option + " <folder>");
+
+        return juce::File::getCurrentWorkingDirectory().getChildFile (path);
+    }
+
+    void checkNoArgumentsLeft (const juce::ArgumentList& args)
+    {
+        if (! args.arguments.isEmpty())
+            juce::ConsoleApplication::fail ("Unknown argument: " + args.arguments.getReference (0).text);
+    }
+
+    void goldenRecord (const juce::ArgumentList& arguments)
+    {
+        juce::ArgumentList args (arguments);
+        const auto folder = getGoldenFolder (args, "--golden-record");
+        const auto filter = args.containsOption ("--filter") ? args.removeValueForOption ("--filter") : juce::String();
+        checkNoArgumentsLeft (args);
+
+        GoldenHarness harness;
+        int numRecorded = 0;
+
+        auto result = harness.record (folder, filter, [&numRecorded] (const juce::String& name)
+        {
+            std::cout << "recorded " << name << std::endl;
+            ++numRecorded;
+        });
+
+        if (result.failed())
+            juce::ConsoleApplication::fail (result.getErrorMessage());
+
+        std::cout << numRecorded << " golden outputs in " << folder.getFullPathName() << std::endl;
+    }
+
+    void goldenCheck (const juce::ArgumentList& arguments)
+    {
+        juce::ArgumentList args (arguments);
+        const auto folder = getGoldenFolder (args, "--golden-check");
+        const auto filter = args.containsOption ("--filter") ? args.removeValueForOption ("--filter") : juce::String();
+
+        GoldenTolerances tolerances;
+
+        for (auto [option, value] : { std::pair { "--max-abs-db", &tolerances.maxAbsErrorDb },
+                                      std::pair { "--spectral-db", &tolerances.spectralErrorDb },
+                                      std::pair { "--trajectory-db", &tolerances.trajectoryErrorDb },
+                                      std::pair { "--target-db", &tolerances.targetErrorDb } })
+            if (args.containsOption (option))
+                *value = args.removeValueForOption (option).getDoubleValue();
+
+        checkNoArgumentsLeft (args);
+
+        if (! folder.isDirectory())
+            juce::ConsoleApplication::fail ("No golden outputs in " + folder.getFullPathName());
+
+        GoldenHarness harness;
+        auto results = harness.check (folder, tolerances, filter, [] (const GoldenHarness::CaseResult& result)
+        {
+            if (result.passed())
+                std::cout << "ok    " << result.name << "  (output " << juce::String (result.maxAbsErrorDb, 1)
+                          << " dBFS, spectrum " << juce::String (result.spectralErrorDb, 3)
+                          << " dB, trajectories " << juce::String (result.trajectoryErrorDb, 3) << " dB)" << std::endl;
+            else
+                std::cout << "FAIL  " << result.name << "  " << result.error << std::endl;
+
+            // Where each distinct violation came from
+            for (auto& violation : result.realtimeViolations)
+                std::cout << "      " << RealtimeSafety::describe (violation).replace ("\n", "\n      ") << std::endl;
+        });
+
+        if (results.empty())
+            juce::ConsoleApplication::fail ("No cases match '" + filter + "'");
+
+        // Which stage the failures start in says more than the count
+        std::map<juce::String, int> failuresByStage;
+
+        for (auto& result : results)
+            if (! result.passed())
+                ++failuresByStage[result.divergedStage];
+
+        if (! RealtimeSafety::isEnabled())
+            std::cout << "(Real-time safety not checked: build with EARFIX_RT_CHECKS=1 to check it)" << std::endl;
+
+        if (failuresByStage.empty())
+        {
+            std::cout << "All " << results.size() << " cases match" << std::endl;
+            return;
+        }
+
+        juce::StringArray summary;
+        int numFailed = 0;
+
+        for (auto& [stage, count] : failuresByStage)
+        {
+            summary.add (juce::String (count) + " at " + stage);
+            numFailed += count;
+        }
+
+        juce::ConsoleApplication::fail (juce::String (numFailed) + " of " + juce::String ((int) results.size())
+                                        + " cases diverged (" + summary.joinIntoString (", ") + ")");
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand ("--help|-h",
+                        "Usage: EarFixRender [options] <files or folders...>\n\n"
+                        "Options:\n" + RenderSettings::getOptionsHelp() + "\n"
+                        "Golden-output regression checks:\n"
+                        "  --golden-record <folder>      Render the regression matrix and store it as golden outputs\n"
+                        "  --golden-check <folder>       Render it again and compare; exits non-zero on divergence\n"
+                        "    --filter <text>             Only the cases whose name contains text\n"
+                        "    --max-abs-db <dBFS>         Largest output sample difference (default: -90)\n"
+                        "    --spectral-db <dB>          Largest band energy difference (default: 0.05)\n"
+                        "    --trajectory-db <dB>        Largest envelope / gain difference (default: 0.05)\n"
+                        "    --target-db <dB>            Largest model target gain difference (default: 0.01)\n",
+                        false);
+
+    app.addVersionCommand ("--version|-v", "EarFixRender " + juce::String (ProjectInfo::versionString));
+
+    app.addCommand ({ "--golden-record",
+                      "--golden-record <folder> [--filter <text>]",
+                      "Renders the regression matrix and stores it as golden outputs",
+                      {},
+                      goldenRecord });
+
+    app.addCommand ({ "--golden-check",
+                      "--golden-check <folder> [--filter <text>] [--max-abs-db <dBFS>] [--spectral-db <dB>]\n"
+                      "               [--trajectory-db <dB>] [--target-db <dB>]",
+                      "Renders the regression matrix and compares it with the golden outputs",
+                      {},
+                      goldenCheck });
+
+    app.addDefaultCommand ({ "",
+                             "[options] <files or folders...>",
+                             "Renders audio files through EarFix",
+                             {},
+                             render });
+
+    return app.findAndRunCommand (argc, argv);
+}
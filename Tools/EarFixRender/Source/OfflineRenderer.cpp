@@ -0,0 +1,593 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+    Streams audio files through the EarFix processor
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+
+namespace
+{
+    /** Jobs on a thread pool, and a wait for all of them that the last one to finish wakes. */
+    class JobBatch
+    {
+    public:
+        explicit JobBatch (int numThreads) : pool (numThreads) {}
+
+        void add (std::function<void()> job)
+        {
+            ++remaining;
+
+            pool.addJob ([this, job = std::move (job)]
+            {
+                job();
+
+                if (--remaining == 0)
+                    allDone.signal();
+            });
+        }
+
+        void waitForAll()
+        {
+            // A signal can be left over from a job that finished while others were being added
+            while (remaining.load() > 0)
+                allDone.wait (-1);
+        }
+
+    private:
+        std::atomic<int> remaining { 0 };
+        juce::WaitableEvent allDone;
+        juce::ThreadPool pool;      // Last, so its threads finish before the rest goes
+
+        JUCE_DECLARE_NON_COPYABLE (JobBatch)
+    };
+}
+
+//==============================================================================
+OfflineRenderer::OfflineRenderer (const RenderSettings& settingsToUse)
+    : settings (settingsToUse)
+{
+    formatManager.registerBasicFormats();
+}
+
+int OfflineRenderer::getNumThreadsFor (int numFiles) const
+{
+    auto numThreads = settings.numThreads > 0 ? settings.numThreads : juce::SystemStats::getNumCpus();
+    return juce::jlimit (1, juce::jmax (1, numFiles), numThreads);
+}
+
+//==============================================================================
+std::unique_ptr<HearingCorrectionAUv2AudioProcessor> OfflineRenderer::createProcessor (const RenderSettings& settingsToApply,
+                                                                                       double sampleRate, juce::String& error) const
+{
+    auto processor = std::make_unique<HearingCorrectionAUv2AudioProcessor>();
+
+    if (auto result = settingsToApply.applyTo (*processor); result.failed())
+    {
+        error = result.getErrorMessage();
+        return {};
+    }
+
+    // Offline: HeadphoneEQ and UserIRStage design and load synchronously in prepare
+    processor->setNonRealtime (true);
+    processor->setRateAndBufferSizeDetails (sampleRate, settings.blockSize);
+    processor->prepareToPlay (sampleRate, settings.blockSize);
+
+    return processor;
+}
+
+std::unique_ptr<juce::AudioFormatWriter> OfflineRenderer::createWriter (const juce::File& file, double sampleRate,
+                                                                       int bitDepth, juce::String& error)
+{
+    auto* format = formatManager.findFormatForFileExtension (file.getFileExtension());
+
+    if (format == nullptr)
+    {
+        error = "No writer for " + file.getFileExtension() + " files";
+        return {};
+    }
+
+    // FLAC tops out at 24 bits; 32 bits is written as float
+    if (! format->getPossibleBitDepths().contains (bitDepth))
+        bitDepth = 24;
+
+    const auto sampleFormat = bitDepth == 32 ? juce::AudioFormatWriterOptions::SampleFormat::floatingPoint
+                                             : juce::AudioFormatWriterOptions::SampleFormat::integral;
+
+    file.deleteFile();
+    auto fileStream = std::make_unique<juce::FileOutputStream> (file);
+
+    if (! fileStream->openedOk())
+    {
+        error = "Can't write " + file.getFullPathName();
+        return {};
+    }
+
+    std::unique_ptr<juce::OutputStream> outputStream (std::move (fileStream));
+    auto writer = format->createWriterFor (outputStream, juce::AudioFormatWriterOptions{}
+                                                             .withSampleRate (sampleRate)
+                                                             .withNumChannels (2)
+                                                             .withBitsPerSample (bitDepth)
+                                                             .withSampleFormat (sampleFormat));
+
+    if (writer == nullptr)
+        error = "Can't create a " + format->getFormatName() + " writer at "
+                + juce::String (sampleRate) + " Hz / " + juce::String (bitDepth) + " bit";
+
+    return writer;
+}
+
+//==============================================================================
+juce::String OfflineRenderer::stream (HearingCorrectionAUv2AudioProcessor& processor, juce::AudioFormatReader& reader,
+                                      juce::int64 readStart, juce::int64 outputStart, juce::int64 outputEnd,
+                                      juce::AudioFormatWriter& writer) const
+{
+    const int blockSize = settings.blockSize;
+    const auto numToOutput = outputEnd - outputStart;
+
+    // Output sample t comes out latency samples after input sample t went in
+    auto samplesToDrop = outputStart - readStart + processor.getLatencySamples();
+
+    juce::AudioBuffer<float> chunk (2, streamChunkSize);
+    juce::MidiBuffer midi;
+    juce::int64 readPosition = readStart;
+    juce::int64 samplesWritten = 0;
+
+    while (samplesWritten < numToOutput)
+    {
+        // Past the end of the input the chunk stays silent, which flushes the latency
+        const auto numToProcess = (int) juce::jmin<juce::int64> (streamChunkSize, numToOutput - samplesWritten + samplesToDrop);
+        const auto numToRead = (int) juce::jlimit<juce::int64> (0, numToProcess, reader.lengthInSamples - readPosition);
+
+        chunk.clear();
+
+        // A mono reader is duplicated into both channels; extra channels are ignored
+        if (numToRead > 0)
+            reader.read (&chunk, 0, numToRead, readPosition, true, true);
+
+        readPosition += numToProcess;
+
+        for (int offset = 0; offset < numToProcess; offset += blockSize)
+        {
+            juce::AudioBuffer<float> block (chunk.getArrayOfWritePointers(), 2, offset,
+                                            juce::jmin (blockSize, numToProcess - offset));
+            processor.processBlock (block, midi);
+        }
+
+        const auto firstSample = (int) juce::jmin<juce::int64> (samplesToDrop, numToProcess);
+        const int numToWrite = numToProcess - firstSample;
+        samplesToDrop -= firstSample;
+
+        if (numToWrite > 0 && ! writer.writeFromAudioSampleBuffer (chunk, firstSample, numToWrite))
+            return "Write failed";
+
+        samplesWritten += numToWrite;
+    }
+
+    return {};
+}
+
+juce::String OfflineRenderer::streamListeners (HearingCorrectionAUv2AudioProcessor& front, ListenerBank& bank,
+                                               juce::AudioFormatReader& reader,
+                                               std::vector<std::unique_ptr<juce::AudioFormatWriter>>& writers) const
+{
+    const int blockSize = settings.blockSize;
+    const auto numToOutput = reader.lengthInSamples;
+
+    // The front end's latency and the limiter's (the bank's limiters match the processor's)
+    // are compensated as in stream()
+    auto samplesToDrop = (juce::int64) front.getLatencySamples();
+
+    juce::AudioBuffer<float> chunk (2, streamChunkSize);
+    std::vector<juce::AudioBuffer<float>> outputs ((size_t) bank.getNumListeners());
+
+    for (auto& output : outputs)
+        output.setSize (2, streamChunkSize);
+
+    juce::int64 readPosition = 0;
+    juce::int64 samplesWritten = 0;
+
+    while (samplesWritten < numToOutput)
+    {
+        const auto numToProcess = (int) juce::jmin<juce::int64> (streamChunkSize, numToOutput - samplesWritten + samplesToDrop);
+        const auto numToRead = (int) juce::jlimit<juce::int64> (0, numToProcess, reader.lengthInSamples - readPosition);
+
+        chunk.clear();
+
+        if (numToRead > 0)
+            reader.read (&chunk, 0, numToRead, readPosition, true, true);
+
+        readPosition += numToProcess;
+
+        for (int offset = 0; offset < numToProcess; offset += blockSize)
+        {
+            const int numSamples = juce::jmin (blockSize, numToProcess - offset);
+            juce::AudioBuffer<float> block (chunk.getArrayOfWritePointers(), 2, offset, numSamples);
+
+            front.processFrontEnd (block);
+            bank.process (block.getReadPointer (0), block.getReadPointer (1), numSamples, outputs, offset);
+        }
+
+        const auto firstSample = (int) juce::jmin<juce::int64> (samplesToDrop, numToProcess);
+        const int numToWrite = numToProcess - firstSample;
+        samplesToDrop -= firstSample;
+
+        for (size_t i = 0; i < writers.size() && numToWrite > 0; ++i)
+            if (! writers[i]->writeFromAudioSampleBuffer (outputs[i], firstSample, numToWrite))
+                return "Write failed";
+
+        samplesWritten += numToWrite;
+    }
+
+    return {};
+}
+
+//==============================================================================
+RenderStats OfflineRenderer::renderFile (const juce::File& input, const juce::File& output)
+{
+    return renderFile (settings, input, output);
+}
+
+RenderStats OfflineRenderer::renderFile (const RenderSettings& settingsToApply, const juce::File& input, const juce::File& output)
+{
+    RenderStats stats;
+    stats.input = input;
+    stats.output = output;
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (input));
+
+    if (reader == nullptr)
+    {
+        stats.error = "Unsupported or unreadable audio file";
+        return stats;
+    }
+
+    stats.sampleRate = reader->sampleRate;
+    stats.numSamples = reader->lengthInSamples;
+
+    auto processor = createProcessor (settingsToApply, reader->sampleRate, stats.error);
+
+    if (processor == nullptr)
+        return stats;
+
+    auto writer = createWriter (output, reader->sampleRate, settingsToApply.bitDepth, stats.error);
+
+    if (writer == nullptr)
+        return stats;
+
+    stats.error = stream (*processor, *reader, 0, 0, reader->lengthInSamples, *writer);
+
+    writer.reset();
+    processor->releaseResources();
+
+    stats.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    return stats;
+}
+
+RenderStats OfflineRenderer::renderFileSplit (const juce::File& input, const juce::File& output)
+{
+    RenderStats stats;
+    stats.input = input;
+    stats.output = output;
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (input));
+
+        if (reader == nullptr)
+        {
+            stats.error = "Unsupported or unreadable audio file";
+            return stats;
+        }
+
+        stats.sampleRate = reader->sampleRate;
+        stats.numSamples = reader->lengthInSamples;
+    }
+
+    stats.numSegments = getNumThreadsFor ((int) (stats.getAudioSeconds() / minSegmentSeconds));
+
+    if (stats.numSegments > 1)
+    {
+        const auto segmentLength = (stats.numSamples + stats.numSegments - 1) / stats.numSegments;
+
+        // Segments are kept at float resolution until they're joined
+        std::vector<std::unique_ptr<juce::TemporaryFile>> parts;
+        std::vector<juce::String> errors ((size_t) stats.numSegments);
+
+        for (int i = 0; i < stats.numSegments; ++i)
+            parts.push_back (std::make_unique<juce::TemporaryFile> (output.withFileExtension ("wav")));
+
+        {
+            JobBatch jobs (stats.numSegments);
+
+            for (int i = 0; i < stats.numSegments; ++i)
+            {
+                jobs.add ([this, &input, &stats, &parts, &errors, segmentLength, i]
+                {
+                    auto& error = errors[(size_t) i];
+                    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (input));
+                    auto processor = reader != nullptr ? createProcessor (settings, stats.sampleRate, error) : nullptr;
+
+                    if (processor == nullptr)
+                    {
+                        if (error.isEmpty())
+                            error = "Unreadable audio file";
+
+                        return;
+                    }
+
+                    auto writer = createWriter (parts[(size_t) i]->getFile(), stats.sampleRate, 32, error);
+
+                    if (writer == nullptr)
+                        return;
+
+                    const auto preRoll = (juce::int64) std::ceil ((settings.preRollSeconds + processor->getTailLengthSeconds())
+                                                                  * stats.sampleRate);
+                    const auto outputStart = segmentLength * i;
+                    const auto outputEnd = juce::jmin (stats.numSamples, outputStart + segmentLength);
+
+                    error = stream (*processor, *reader, juce::jmax<juce::int64> (0, outputStart - preRoll),
+                                    outputStart, outputEnd, *writer);
+                });
+            }
+
+            jobs.waitForAll();
+        }
+
+        for (auto& error : errors)
+        {
+            if (error.isNotEmpty())
+            {
+                stats.error = error;
+                return stats;
+            }
+        }
+
+        // Join the segments
+        auto writer = createWriter (output, stats.sampleRate, settings.bitDepth, stats.error);
+
+        if (writer == nullptr)
+            return stats;
+
+        for (auto& part : parts)
+        {
+            std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (part->getFile()));
+
+            if (reader == nullptr || ! writer->writeFromAudioReader (*reader, 0, -1))
+            {
+                stats.error = "Couldn't join the rendered segments";
+                return stats;
+            }
+        }
+    }
+    else
+    {
+        // Too short to be worth splitting
+        auto serial = renderFile (input, output);
+
+        if (! serial.succeeded())
+            return serial;
+    }
+
+    stats.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    if (settings.verify)
+    {
+        juce::TemporaryFile reference (output);
+        auto serial = renderFile (input, reference.getFile());
+
+        if (! serial.succeeded())
+        {
+            stats.error = "Serial reference render failed: " + serial.error;
+            return stats;
+        }
+
+        stats.differenceDb = measureDifferenceDb (output, reference.getFile());
+
+        if (! stats.differenceDb.has_value())
+            stats.error = "Couldn't compare with the serial render";
+        else if (*stats.differenceDb > settings.verifyToleranceDb)
+            stats.error = "Differs from the serial render by " + juce::String (*stats.differenceDb, 1)
+                          + " dBFS (tolerance " + juce::String (settings.verifyToleranceDb, 1) + " dBFS)";
+    }
+
+    return stats;
+}
+
+RenderStats OfflineRenderer::renderFileForListeners (const juce::File& input, const std::vector<ListenerPreset>& listeners)
+{
+    jassert (! listeners.empty());
+
+    RenderStats stats;
+    stats.input = input;
+    stats.output = settings.getOutputFileFor (input, listeners.front().name);
+    stats.numListeners = (int) listeners.size();
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor (input));
+
+    if (reader == nullptr)
+    {
+        stats.error = "Unsupported or unreadable audio file";
+        return stats;
+    }
+
+    stats.sampleRate = reader->sampleRate;
+    stats.numSamples = reader->lengthInSamples;
+
+    for (size_t first = 0; first < listeners.size(); first += maxListenersPerPass)
+    {
+        const auto last = juce::jmin (listeners.size(), first + (size_t) maxListenersPerPass);
+
+        // The shared headphone EQ and IR stages run on a processor with the base settings
+        auto front = createProcessor (settings, stats.sampleRate, stats.error);
+
+        if (front == nullptr)
+            return stats;
+
+        if (*front->parameters.getRawParameterValue ("bypass") > 0.5f)
+        {
+            stats.error = "A bypassed processor can't be rendered for several listeners";
+            return stats;
+        }
+
+        std::vector<ListenerBank::WDRCSettings> wdrcSettings;
+        std::vector<std::unique_ptr<juce::AudioFormatWriter>> writers;
+
+        for (auto i = first; i < last; ++i)
+        {
+            const auto& listener = listeners[i];
+
+            // Only the WDRC settings are used, so don't load this listener's copy of the shared stages
+            auto wdrcOnly = listener.settings;
+            wdrcOnly.headphoneName = {};
+            wdrcOnly.impulseResponses = {};
+
+            juce::String error;
+            auto processor = createProcessor (wdrcOnly, stats.sampleRate, error);
+
+            if (processor == nullptr)
+            {
+                stats.error = listener.name + ": " + error;
+                return stats;
+            }
+
+            wdrcSettings.push_back (processor->getWDRCSettings());
+
+            writers.push_back (createWriter (settings.getOutputFileFor (input, listener.name),
+                                             stats.sampleRate, settings.bitDepth, stats.error));
+
+            if (writers.back() == nullptr)
+                return stats;
+        }
+
+        ListenerBank bank (wdrcSettings, settings.blockSize);
+        stats.error = streamListeners (*front, bank, *reader, writers);
+
+        if (! stats.succeeded())
+            return stats;
+    }
+
+    stats.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    if (settings.verify)
+    {
+        for (auto& listener : listeners)
+        {
+            const auto output = settings.getOutputFileFor (input, listener.name);
+            juce::TemporaryFile reference (output);
+            auto serial = renderFile (listener.settings, input, reference.getFile());
+
+            if (! serial.succeeded())
+            {
+                stats.error = listener.name + ": serial reference render failed: " + serial.error;
+                return stats;
+            }
+
+            auto difference = measureDifferenceDb (output, reference.getFile());
+
+            if (! difference.has_value())
+            {
+                stats.error = listener.name + ": couldn't compare with the serial render";
+                return stats;
+            }
+
+            stats.differenceDb = juce::jmax (stats.differenceDb.value_or (-200.0), *difference);
+
+            if (*difference > settings.verifyToleranceDb)
+            {
+                stats.error = listener.name + " differs from the serial render by " + juce::String (*difference, 1)
+                              + " dBFS (tolerance " + juce::String (settings.verifyToleranceDb, 1) + " dBFS)";
+                return stats;
+            }
+        }
+    }
+
+    return stats;
+}
+
+//==============================================================================
+std::vector<RenderStats> OfflineRenderer::renderAll (const juce::Array<juce::File>& inputs,
+                                                     std::function<void (const RenderStats&)> onFileDone,
+                                                     const std::vector<ListenerPreset>& listeners)
+{
+    std::vector<RenderStats> results ((size_t) inputs.size());
+
+    if (settings.splitFiles)
+    {
+        for (int i = 0; i < inputs.size(); ++i)
+        {
+            results[(size_t) i] = renderFileSplit (inputs[i], settings.getOutputFileFor (inputs[i]));
+
+            if (onFileDone != nullptr)
+                onFileDone (results[(size_t) i]);
+        }
+
+        return results;
+    }
+
+    juce::CriticalSection callbackLock;
+    JobBatch jobs (getNumThreadsFor (inputs.size()));
+
+    for (int i = 0; i < inputs.size(); ++i)
+    {
+        jobs.add ([this, &inputs, &results, &callbackLock, &onFileDone, &listeners, i]
+        {
+            auto stats = listeners.empty() ? renderFile (inputs[i], settings.getOutputFileFor (inputs[i]))
+                                           : renderFileForListeners (inputs[i], listeners);
+
+            const juce::ScopedLock sl (callbackLock);
+
+            if (onFileDone != nullptr)
+                onFileDone (stats);
+
+            results[(size_t) i] = std::move (stats);
+        });
+    }
+
+    jobs.waitForAll();
+    return results;
+}
+
+//==============================================================================
+std::optional<double> OfflineRenderer::measureDifferenceDb (const juce::File& a, const juce::File& b)
+{
+    std::unique_ptr<juce::AudioFormatReader> readerA (formatManager.createReaderFor (a));
+    std::unique_ptr<juce::AudioFormatReader> readerB (formatManager.createReaderFor (b));
+
+    if (readerA == nullptr || readerB == nullptr)
+        return std::nullopt;
+
+    const auto numChannels = (int) juce::jmin (readerA->numChannels, readerB->numChannels);
+    const auto length = juce::jmin (readerA->lengthInSamples, readerB->lengthInSamples);
+
+    juce::AudioBuffer<float> bufferA (numChannels, streamChunkSize);
+    juce::AudioBuffer<float> bufferB (numChannels, streamChunkSize);
+    float peak = 0.0f;
+
+    for (juce::int64 position = 0; position < length; position += streamChunkSize)
+    {
+        const auto n = (int) juce::jmin<juce::int64> (streamChunkSize, length - position);
+
+        readerA->read (&bufferA, 0, n, position, true, true);
+        readerB->read (&bufferB, 0, n, position, true, true);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* x = bufferA.getReadPointer (ch);
+            const auto* y = bufferB.getReadPointer (ch);
+
+            for (int i = 0; i < n; ++i)
+                peak = juce::jmax (peak, std::abs (x[i] - y[i]));
+        }
+    }
+
+    return juce::Decibels::gainToDecibels ((double) peak, -200.0);
+}
@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+    Streams audio files through the EarFix processor
+
+    Each file gets its own processor instance, so files render independently
+    on as many threads as there are cores. Audio is read, processed and
+    written in chunks of streamChunkSize samples, so memory use doesn't grow
+    with file length. Outputs are always stereo (one channel per ear; mono
+    inputs feed both ears), the same length as the input, and aligned with it:
+    any latency the processor reports is trimmed from the start and flushed
+    out with silence at the end.
+
+    A single long file can instead be split into segments rendered in
+    parallel. The processor is recursive (crossover and headphone biquads,
+    WDRC envelopes and gain smoothing, convolution history), so each segment
+    starts on a fresh processor that first runs over a pre-roll of the
+    preceding audio: the settings' pre-roll plus the processor's tail. Its
+    state has then converged to the serial render's, to well below the
+    output's resolution, before the first kept sample. Segments go to
+    temporary float WAVs next to the output and are joined at the end.
+
+    A batch render produces one output per listener from a single pass over
+    the input. The headphone EQ, IRs and band split are shared; a
+    ListenerBank runs each listener's WDRC on the shared bands, matching
+    what that listener's own processor would output.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RenderSettings.h"
+#include "ListenerBank.h"
+
+//==============================================================================
+struct RenderStats
+{
+    juce::File input, output;
+    juce::String error;             // Empty on success
+
+    juce::int64 numSamples = 0;
+    double sampleRate = 0.0;
+    double renderSeconds = 0.0;     // Wall time, including decoding and encoding
+    int numSegments = 1;
+    int numListeners = 1;           // Outputs written from this input
+
+    // With --verify: peak difference from a serial render (worst listener in a batch), dBFS
+    std::optional<double> differenceDb;
+
+    bool succeeded() const { return error.isEmpty(); }
+    double getAudioSeconds() const { return sampleRate > 0.0 ? (double) numSamples / sampleRate : 0.0; }
+    double getRealtimeFactor() const { return renderSeconds > 0.0 ? getAudioSeconds() / renderSeconds : 0.0; }
+};
+
+//==============================================================================
+class OfflineRenderer
+{
+public:
+    explicit OfflineRenderer (const RenderSettings& settingsToUse);
+
+    /** Samples read, processed and written at a time. */
+    static constexpr int streamChunkSize = 32768;
+
+    /** Shortest segment a file is split into; keeps the pre-roll overhead small. */
+    static constexpr double minSegmentSeconds = 30.0;
+
+    /** Renders one file with its own processor. Safe to call from several threads at once. */
+    RenderStats renderFile (const juce::File& input, const juce::File& output);
+
+    /** Renders one file as parallel segments with state pre-roll, then joins them. */
+    RenderStats renderFileSplit (const juce::File& input, const juce::File& output);
+
+    /** Listeners rendered per pass over an input in a batch; bounds open files and memory. */
+    static constexpr int maxListenersPerPass = 64;
+
+    /** Renders one file for every listener, to settings.getOutputFileFor(input, name).
+        stats.output is the first listener's file.
+    */
+    RenderStats renderFileForListeners (const juce::File& input, const std::vector<ListenerPreset>& listeners);
+
+    /** Renders every input to settings.getOutputFileFor(input): files in parallel,
+        or one after another with each split across the threads if settings.splitFiles.
+        With a listeners file, each input is rendered for every listener instead.
+
+        onFileDone is called (one at a time) as each file finishes. Returns
+        the stats in input order.
+    */
+    std::vector<RenderStats> renderAll (const juce::Array<juce::File>& inputs,
+                                        std::function<void (const RenderStats&)> onFileDone,
+                                        const std::vector<ListenerPreset>& listeners = {});
+
+    /** Number of render threads for a batch of this size. */
+    int getNumThreadsFor (int numFiles) const;
+
+    /** Peak absolute sample difference between two audio files over their common
+        channels and length, in dBFS. Returns nullopt if either can't be read.
+    */
+    std::optional<double> measureDifferenceDb (const juce::File& a, const juce::File& b);
+
+private:
+    /** Creates a stereo processor with the settings applied, ready to play at sampleRate. */
+    std::unique_ptr<HearingCorrectionAUv2AudioProcessor> createProcessor (const RenderSettings& settingsToApply,
+                                                                          double sampleRate, juce::String& error) const;
+
+    RenderStats renderFile (const RenderSettings& settingsToApply, const juce::File& input, const juce::File& output);
+
+    std::unique_ptr<juce::AudioFormatWriter> createWriter (const juce::File& file, double sampleRate,
+                                                           int bitDepth, juce::String& error);
+
+    /** Streams the reader through the processor from readStart and writes the
+        latency-compensated output for [outputStart, outputEnd). Returns an error or an empty string.
+    */
+    juce::String stream (HearingCorrectionAUv2AudioProcessor& processor, juce::AudioFormatReader& reader,
+                         juce::int64 readStart, juce::int64 outputStart, juce::int64 outputEnd,
+                         juce::AudioFormatWriter& writer) const;
+
+    /** Like stream(), for a whole file: the front processor's headphone EQ and IR
+        stages feed the bank, and each bank output goes to its writer.
+    */
+    juce::String streamListeners (HearingCorrectionAUv2AudioProcessor& front, ListenerBank& bank,
+                                  juce::AudioFormatReader& reader,
+                                  std::vector<std::unique_ptr<juce::AudioFormatWriter>>& writers) const;
+
+    const RenderSettings& settings;
+    juce::AudioFormatManager formatManager;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineRenderer)
+};
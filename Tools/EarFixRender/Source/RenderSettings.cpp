@@ -0,0 +1,442 @@
+/*
+  ==============================================================================
+
+    RenderSettings.cpp
+    Processor and output settings for the offline renderer
+
+  ==============================================================================
+*/
+
+#include "RenderSettings.h"
+
+//==============================================================================
+namespace
+{
+    // Same ordering as the plugin's parameter IDs: right ear 01-06, left ear 07-12
+    constexpr int numAudiogramBands = HearingCorrectionAUv2AudioProcessor::numAudiogramBands;
+
+    const juce::String audioFileWildcard { "*.wav;*.flac;*.aif;*.aiff" };
+
+    bool parseNumber (const juce::String& text, float& result)
+    {
+        auto trimmed = text.trim();
+
+        if (trimmed.equalsIgnoreCase ("true"))  { result = 1.0f; return true; }
+        if (trimmed.equalsIgnoreCase ("false")) { result = 0.0f; return true; }
+
+        if (trimmed.isEmpty() || ! trimmed.containsOnly ("0123456789.-+eE"))
+            return false;
+
+        result = trimmed.getFloatValue();
+        return true;
+    }
+
+    bool parseNumber (const juce::var& value, float& result)
+    {
+        if (value.isString())
+            return parseNumber (value.toString(), result);
+
+        if (value.isInt() || value.isInt64() || value.isDouble() || value.isBool())
+        {
+            result = static_cast<float> (value);
+            return true;
+        }
+
+        return false;
+    }
+
+    juce::Result checkRange (const juce::String& name, int value, int minValue, int maxValue)
+    {
+        if (value < minValue || value > maxValue)
+            return juce::Result::fail (name + " must be between " + juce::String (minValue)
+                                       + " and " + juce::String (maxValue));
+
+        return juce::Result::ok();
+    }
+}
+
+//==============================================================================
+juce::Result RenderSettings::setModel (const juce::var& value)
+{
+    static const juce::StringArray names { "half-gain", "nal", "mosl", "nal-nl2", "mosl-loudness" };
+
+    int index = names.indexOf (value.toString().trim(), true);
+    float number = 0.0f;
+
+    if (index < 0 && parseNumber (value, number))
+        index = juce::roundToInt (number);
+
+    if (! juce::isPositiveAndBelow (index, names.size()))
+        return juce::Result::fail ("Unknown model '" + value.toString() + "' (expected half-gain, nal, mosl, nal-nl2 or mosl-loudness)");
+
+    parameters["modelSelect"] = static_cast<float> (index);
+    return juce::Result::ok();
+}
+
+juce::Result RenderSettings::setAudiogram (const juce::String& ear, const juce::var& values)
+{
+    juce::Array<juce::var> thresholds;
+
+    if (auto* array = values.getArray())
+        thresholds = *array;
+    else
+        for (auto& token : juce::StringArray::fromTokens (values.toString(), ",", {}))
+            thresholds.add (token);
+
+    if (thresholds.size() != numAudiogramBands)
+        return juce::Result::fail ("The " + ear + " audiogram needs " + juce::String (numAudiogramBands)
+                                   + " thresholds (250 Hz to 8 kHz)");
+
+    const int firstIndex = ear == "right" ? 1 : numAudiogramBands + 1;
+
+    for (int band = 0; band < numAudiogramBands; ++band)
+    {
+        float threshold = 0.0f;
+
+        if (! parseNumber (thresholds[band], threshold))
+            return juce::Result::fail ("Invalid " + ear + " audiogram threshold: " + thresholds[band].toString());
+
+        parameters["audiogram_" + juce::String (firstIndex + band).paddedLeft ('0', 2)] = threshold;
+    }
+
+    return juce::Result::ok();
+}
+
+juce::Result RenderSettings::setHeadphoneEQMode (const juce::String& name)
+{
+    static const juce::StringArray names { "parametric", "fir-min", "fir-linear" };
+    auto index = names.indexOf (name.trim(), true);
+
+    if (index < 0)
+        return juce::Result::fail ("Unknown headphone EQ mode '" + name + "' (expected parametric, fir-min or fir-linear)");
+
+    headphoneEQMode = static_cast<HeadphoneEQMode> (index);
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Result RenderSettings::loadPreset (const juce::File& presetFile)
+{
+    if (! presetFile.existsAsFile())
+        return juce::Result::fail ("Preset not found: " + presetFile.getFullPathName());
+
+    juce::var json;
+    auto parseResult = juce::JSON::parse (presetFile.loadFileAsString(), json);
+
+    if (parseResult.failed())
+        return juce::Result::fail (presetFile.getFileName() + ": " + parseResult.getErrorMessage());
+
+    auto result = mergePreset (json, presetFile.getParentDirectory());
+
+    return result.failed() ? juce::Result::fail (presetFile.getFileName() + ": " + result.getErrorMessage())
+                           : result;
+}
+
+juce::Result RenderSettings::mergePreset (const juce::var& json, const juce::File& folder)
+{
+    auto* obj = json.getDynamicObject();
+
+    if (obj == nullptr)
+        return juce::Result::fail ("expected a JSON object");
+
+    auto result = juce::Result::ok();
+
+    if (obj->hasProperty ("model"))
+        result = setModel (obj->getProperty ("model"));
+
+    if (auto* audiogram = obj->getProperty ("audiogram").getDynamicObject())
+        for (auto ear : { "right", "left" })
+            if (result.wasOk() && audiogram->hasProperty (ear))
+                result = setAudiogram (ear, audiogram->getProperty (ear));
+
+    if (auto* params = obj->getProperty ("parameters").getDynamicObject())
+    {
+        for (auto& property : params->getProperties())
+        {
+            float value = 0.0f;
+
+            if (parseNumber (property.value, value))
+                parameters[property.name.toString()] = value;
+            else if (result.wasOk())
+                result = juce::Result::fail ("Invalid value for parameter " + property.name.toString());
+        }
+    }
+
+    if (obj->hasProperty ("headphone"))
+        headphoneName = obj->getProperty ("headphone").toString();
+
+    if (result.wasOk() && obj->hasProperty ("headphoneEQMode"))
+        result = setHeadphoneEQMode (obj->getProperty ("headphoneEQMode").toString());
+
+    if (auto* irs = obj->getProperty ("impulseResponses").getDynamicObject())
+    {
+        if (irs->hasProperty ("left"))
+            impulseResponses[0] = folder.getChildFile (irs->getProperty ("left").toString());
+
+        if (irs->hasProperty ("right"))
+            impulseResponses[1] = folder.getChildFile (irs->getProperty ("right").toString());
+    }
+
+    if (obj->hasProperty ("format"))
+        outputFormat = obj->getProperty ("format").toString().toLowerCase();
+
+    if (obj->hasProperty ("bitDepth"))
+        bitDepth = static_cast<int> (obj->getProperty ("bitDepth"));
+
+    if (obj->hasProperty ("blockSize"))
+        blockSize = static_cast<int> (obj->getProperty ("blockSize"));
+
+    return result;
+}
+
+juce::Result RenderSettings::loadListeners (std::vector<ListenerPreset>& listeners) const
+{
+    if (! listenersFile.existsAsFile())
+        return juce::Result::fail ("Listeners file not found: " + listenersFile.getFullPathName());
+
+    juce::var json;
+    auto parseResult = juce::JSON::parse (listenersFile.loadFileAsString(), json);
+
+    if (parseResult.failed())
+        return juce::Result::fail (listenersFile.getFileName() + ": " + parseResult.getErrorMessage());
+
+    auto* entries = json.isArray() ? json.getArray() : json["listeners"].getArray();
+
+    if (entries == nullptr || entries->isEmpty())
+        return juce::Result::fail (listenersFile.getFileName() + ": expected a non-empty \"listeners\" array");
+
+    // These stages run once for the whole batch, so they can't differ per listener
+    static const juce::StringArray sharedKeys { "headphone", "headphoneEQMode", "impulseResponses" };
+    static const juce::StringArray sharedParameters { "bypass", "headphoneEQEnable" };
+
+    const auto folder = listenersFile.getParentDirectory();
+    juce::StringArray names;
+
+    for (int i = 0; i < entries->size(); ++i)
+    {
+        const auto& entry = entries->getReference (i);
+        const auto context = listenersFile.getFileName() + ", listener " + juce::String (i + 1) + ": ";
+
+        for (auto& key : sharedKeys)
+            if (entry.hasProperty (key))
+                return juce::Result::fail (context + "'" + key + "' is shared by all listeners; set it outside the listeners file");
+
+        if (auto* params = entry["parameters"].getDynamicObject())
+            for (auto& id : sharedParameters)
+                if (params->hasProperty (id))
+                    return juce::Result::fail (context + "'" + id + "' is shared by all listeners; set it outside the listeners file");
+
+        ListenerPreset listener { entry.getProperty ("name", "listener_" + juce::String (i + 1)).toString().trim(), *this };
+
+        if (names.contains (listener.name))
+            return juce::Result::fail (context + "duplicate name '" + listener.name + "'");
+
+        if (auto result = listener.settings.mergePreset (entry, folder); result.failed())
+            return juce::Result::fail (context + result.getErrorMessage());
+
+        names.add (listener.name);
+        listeners.push_back (std::move (listener));
+    }
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Result RenderSettings::parseArguments (juce::ArgumentList& args, juce::Array<juce::File>& inputFiles)
+{
+    const auto cwd = juce::File::getCurrentWorkingDirectory();
+    auto result = juce::Result::ok();
+
+    // The preset goes first so that every other flag overrides it
+    if (args.containsOption ("--preset"))
+        result = loadPreset (cwd.getChildFile (args.removeValueForOption ("--preset")));
+
+    if (result.wasOk() && args.containsOption ("--model"))
+        result = setModel (args.removeValueForOption ("--model"));
+
+    for (auto ear : { "right", "left" })
+    {
+        auto option = juce::String ("--") + ear;
+
+        if (result.wasOk() && args.containsOption (option))
+            result = setAudiogram (ear, args.removeValueForOption (option));
+    }
+
+    while (result.wasOk() && args.containsOption ("--set"))
+    {
+        auto assignment = args.removeValueForOption ("--set");
+        auto id = assignment.upToFirstOccurrenceOf ("=", false, false).trim();
+        float value = 0.0f;
+
+        if (id.isEmpty() || ! parseNumber (assignment.fromFirstOccurrenceOf ("=", false, false), value))
+            result = juce::Result::fail ("Expected --set <parameterID>=<value>, got '" + assignment + "'");
+        else
+            parameters[id] = value;
+    }
+
+    if (args.containsOption ("--headphone"))
+        headphoneName = args.removeValueForOption ("--headphone");
+
+    if (result.wasOk() && args.containsOption ("--headphone-mode"))
+        result = setHeadphoneEQMode (args.removeValueForOption ("--headphone-mode"));
+
+    if (args.containsOption ("--ir-left"))
+        impulseResponses[0] = cwd.getChildFile (args.removeValueForOption ("--ir-left"));
+
+    if (args.containsOption ("--ir-right"))
+        impulseResponses[1] = cwd.getChildFile (args.removeValueForOption ("--ir-right"));
+
+    if (args.containsOption ("--output-dir|-o"))
+        outputDirectory = cwd.getChildFile (args.removeValueForOption ("--output-dir|-o"));
+
+    if (args.containsOption ("--suffix"))
+        outputSuffix = args.removeValueForOption ("--suffix");
+
+    if (args.containsOption ("--format"))
+        outputFormat = args.removeValueForOption ("--format").toLowerCase();
+
+    if (args.containsOption ("--bits"))
+        bitDepth = args.removeValueForOption ("--bits").getIntValue();
+
+    if (args.containsOption ("--block-size"))
+        blockSize = args.removeValueForOption ("--block-size").getIntValue();
+
+    if (args.containsOption ("--jobs|-j"))
+        numThreads = args.removeValueForOption ("--jobs|-j").getIntValue();
+
+    if (args.removeOptionIfFound ("--split"))
+        splitFiles = true;
+
+    if (args.removeOptionIfFound ("--verify"))
+        verify = true;
+
+    if (args.containsOption ("--preroll"))
+        preRollSeconds = args.removeValueForOption ("--preroll").getDoubleValue();
+
+    if (args.containsOption ("--listeners"))
+        listenersFile = cwd.getChildFile (args.removeValueForOption ("--listeners"));
+
+    // Verification applies to split or batch renders; on its own it implies --split
+    if (verify && listenersFile == juce::File())
+        splitFiles = true;
+
+    if (result.failed())
+        return result;
+
+    // Validate the output settings
+    if (outputFormat.isNotEmpty() && ! juce::StringArray { "wav", "flac", "aiff" }.contains (outputFormat))
+        return juce::Result::fail ("Unknown output format '" + outputFormat + "' (expected wav, flac or aiff)");
+
+    if (bitDepth != 16 && bitDepth != 24 && bitDepth != 32)
+        return juce::Result::fail ("Bit depth must be 16, 24 or 32");
+
+    if (auto range = checkRange ("Block size", blockSize, 16, 8192); range.failed())
+        return range;
+
+    if (auto range = checkRange ("Job count", numThreads, 0, 256); range.failed())
+        return range;
+
+    if (preRollSeconds < 0.0 || preRollSeconds > 60.0)
+        return juce::Result::fail ("Pre-roll must be between 0 and 60 seconds");
+
+    if (listenersFile != juce::File() && splitFiles)
+        return juce::Result::fail ("--listeners can't be combined with --split");
+
+    // Whatever is left are the inputs
+    for (auto& arg : args.arguments)
+    {
+        if (arg.isOption())
+            return juce::Result::fail ("Unknown option: " + arg.text);
+
+        auto file = arg.resolveAsFile();
+
+        if (file.isDirectory())
+        {
+            auto children = file.findChildFiles (juce::File::findFiles, false, audioFileWildcard);
+            children.sort();
+            inputFiles.addArray (children);
+        }
+        else if (file.existsAsFile())
+        {
+            inputFiles.add (file);
+        }
+        else
+        {
+            return juce::Result::fail ("Input not found: " + arg.text);
+        }
+    }
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Result RenderSettings::applyTo (HearingCorrectionAUv2AudioProcessor& processor) const
+{
+    for (auto& [id, value] : parameters)
+    {
+        auto* parameter = processor.parameters.getParameter (id);
+
+        if (parameter == nullptr)
+            return juce::Result::fail ("Unknown parameter: " + id);
+
+        parameter->setValueNotifyingHost (parameter->convertTo0to1 (value));
+    }
+
+    processor.setHeadphoneEQMode (headphoneEQMode);
+
+    if (headphoneName.isNotEmpty())
+    {
+        processor.loadHeadphoneProfile (headphoneName);
+
+        if (processor.getCurrentHeadphoneName().isEmpty())
+            return juce::Result::fail ("Headphone profile not found: " + headphoneName);
+
+        // Naming a headphone implies correcting for it unless the enable is set explicitly
+        if (parameters.count ("headphoneEQEnable") == 0)
+            if (auto* enable = processor.parameters.getParameter ("headphoneEQEnable"))
+                enable->setValueNotifyingHost (1.0f);
+    }
+
+    for (auto ear : { UserIRStage::Ear::Left, UserIRStage::Ear::Right })
+    {
+        const auto& file = impulseResponses[(size_t) ear];
+
+        if (file != juce::File() && ! processor.loadUserImpulseResponse (ear, file))
+            return juce::Result::fail ("Impulse response not found: " + file.getFullPathName());
+    }
+
+    return juce::Result::ok();
+}
+
+juce::File RenderSettings::getOutputFileFor (const juce::File& inputFile, const juce::String& listenerName) const
+{
+    auto folder = outputDirectory != juce::File() ? outputDirectory : inputFile.getParentDirectory();
+    auto extension = outputFormat.isNotEmpty() ? "." + outputFormat : inputFile.getFileExtension();
+    auto suffix = listenerName.isNotEmpty() ? "_" + juce::File::createLegalFileName (listenerName) : outputSuffix;
+
+    return folder.getChildFile (inputFile.getFileNameWithoutExtension() + suffix + extension);
+}
+
+juce::String RenderSettings::getOptionsHelp()
+{
+    return "  --preset <file.json>          Load settings from a JSON preset (flags override it)\n"
+           "  --model <name>                half-gain, nal, mosl, nal-nl2 or mosl-loudness\n"
+           "  --right <t1,...,t6>           Right-ear thresholds in dB HL at 250, 500, 1k, 2k, 4k, 8k Hz\n"
+           "  --left <t1,...,t6>            Left-ear thresholds\n"
+           "  --set <id>=<value>            Set any plugin parameter by ID (repeatable)\n"
+           "  --headphone <name>            Headphone profile from the EarFix database\n"
+           "  --headphone-mode <mode>       parametric, fir-min or fir-linear\n"
+           "  --ir-left <file>              Measured IR for the left ear\n"
+           "  --ir-right <file>             Measured IR for the right ear\n"
+           "  --output-dir, -o <folder>     Where to write renders (default: next to each input)\n"
+           "  --suffix <text>               Appended to output names (default: _earfix)\n"
+           "  --format <wav|flac|aiff>      Output format (default: same as input)\n"
+           "  --bits <16|24|32>             Output bit depth (default: 24; 32 is float where supported)\n"
+           "  --block-size <n>              Processing block size (default: 512)\n"
+           "  --jobs, -j <n>                Files rendered in parallel (default: one per core)\n"
+           "  --split                       Render each file in parallel segments instead (for long files)\n"
+           "  --preroll <seconds>           Warm-up rendered before each segment (default: 2)\n"
+           "  --verify                      With --split or --listeners, also render each output on its own\n"
+           "                                and check the difference\n"
+           "  --listeners <file.json>       Render every input for each listener in the file at once\n";
+}
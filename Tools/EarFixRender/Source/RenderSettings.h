@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    RenderSettings.h
+    Processor and output settings for the offline renderer
+
+    Settings come from a JSON preset and/or command-line flags; flags given
+    after --preset override the preset. Processor settings are kept as plain
+    (denormalised) APVTS values by parameter ID, so anything the plugin
+    exposes can be set without the renderer knowing about it.
+
+    Preset format (every key optional):
+
+      {
+        "model": "mosl",                              // half-gain | nal | mosl | nal-nl2 | mosl-loudness | 0..4
+        "audiogram": { "right": [20, 25, 30, 40, 50, 60],   // dB HL at 250 Hz..8 kHz
+                       "left":  [15, 20, 30, 45, 55, 65] },
+        "parameters": { "correctionStrength": 75, "maxBoost": 30 },
+        "headphone": "Sennheiser HD 650",
+        "headphoneEQMode": "fir-min",                  // parametric | fir-min | fir-linear
+        "impulseResponses": { "left": "ir/left.wav", "right": "ir/right.wav" },
+        "format": "flac", "bitDepth": 24, "blockSize": 512
+      }
+
+    Relative IR paths are resolved against the preset's folder.
+
+    A listeners file (--listeners) renders each input for many listeners in
+    one pass. Each entry is merged over the base settings, and only what the
+    WDRC stage depends on (model, audiogram, other parameters) may vary; the
+    headphone EQ and IRs run once for everyone:
+
+      { "listeners": [ { "name": "anna", "model": "nal",
+                         "audiogram": { "right": [...], "left": [...] } },
+                       { "name": "ben", "parameters": { "correctionStrength": 50 } } ] }
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../../../Source/PluginProcessor.h"
+
+struct ListenerPreset;
+
+//==============================================================================
+struct RenderSettings
+{
+    //==========================================================================
+    // Processor state
+
+    /** Plain parameter values by APVTS parameter ID, applied in ID order. */
+    std::map<juce::String, float> parameters;
+
+    juce::String headphoneName;
+    HeadphoneEQMode headphoneEQMode = HeadphoneEQMode::Parametric;
+    std::array<juce::File, 2> impulseResponses;     // Left, right
+
+    //==========================================================================
+    // Rendering
+
+    juce::File outputDirectory;                     // Empty = next to each input
+    juce::String outputSuffix { "_earfix" };
+    juce::String outputFormat;                      // "wav", "flac" or empty = same as input
+    int bitDepth = 24;
+    int blockSize = 512;
+    int numThreads = 0;                             // 0 = one per core
+
+    // Splitting one long file across threads
+    bool splitFiles = false;                        // Render each file in parallel segments
+    double preRollSeconds = 2.0;                    // Warm-up before each segment, on top of the processor's tail
+
+    // Rendering one input for many listeners at once (JSON list of per-listener presets)
+    juce::File listenersFile;
+
+    // Checking split and batch renders against plain serial renders
+    bool verify = false;
+    double verifyToleranceDb = -80.0;               // Largest accepted difference, dBFS
+
+    //==========================================================================
+    /** Merges a JSON preset into these settings. */
+    juce::Result loadPreset (const juce::File& presetFile);
+
+    /** Merges an already parsed preset object; relative paths resolve against folder. */
+    juce::Result mergePreset (const juce::var& json, const juce::File& folder);
+
+    /** Reads listenersFile into one copy of these settings per listener. */
+    juce::Result loadListeners (std::vector<ListenerPreset>& listeners) const;
+
+    /** Consumes every recognised option from args (loading --preset first) and
+        returns the remaining arguments as input files; folders are expanded to
+        the audio files they contain.
+    */
+    juce::Result parseArguments (juce::ArgumentList& args, juce::Array<juce::File>& inputFiles);
+
+    /** Applies the processor state to a freshly constructed processor, before prepareToPlay(). */
+    juce::Result applyTo (HearingCorrectionAUv2AudioProcessor& processor) const;
+
+    /** Returns where the rendered version of an input file goes. For a batch
+        render the listener's name replaces the output suffix.
+    */
+    juce::File getOutputFileFor (const juce::File& inputFile, const juce::String& listenerName = {}) const;
+
+    /** Help text for the options parseArguments() understands. */
+    static juce::String getOptionsHelp();
+
+private:
+    juce::Result setModel (const juce::var& value);
+    juce::Result setAudiogram (const juce::String& ear, const juce::var& values);
+    juce::Result setHeadphoneEQMode (const juce::String& name);
+};
+
+//==============================================================================
+struct ListenerPreset
+{
+    juce::String name;              // Replaces the output suffix
+    RenderSettings settings;
+};
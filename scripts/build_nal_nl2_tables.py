@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""
+NAL-NL2-style Gain Table Builder
+
+Writes the prescription tables the NAL-NL2 model interpolates at run time:
+insertion gain over (experience, frequency, hearing loss, input level),
+stored as a compact little-endian binary resource.
+
+The gains follow the published behaviour of NAL-NL2 for a single band:
+little low-frequency gain, most gain at 2-4 kHz, compression ratios that
+grow with the degree of loss and are lower in the low frequencies, a
+compression threshold near 50 dB SPL, reduced gain for severe high-frequency
+losses, and less gain for new hearing aid users. To use licensed NAL-NL2
+targets instead, write them in the same layout.
+
+Usage:
+    python build_nal_nl2_tables.py                 # Writes Resources/NALNL2Tables.bin
+    python build_nal_nl2_tables.py --csv out.csv    # Also dumps the table for review
+
+Layout (little-endian):
+    char[4]   magic "ENL2"
+    uint16    version (1)
+    uint16    number of frequencies, losses, levels, experience levels
+    float32   frequencies (Hz), losses (dB HL), levels (dB SPL)
+    float32   compression threshold (dB SPL)
+    int16     gains in 0.01 dB, [experience][frequency][loss][level]
+"""
+
+import sys
+import math
+import struct
+import argparse
+from pathlib import Path
+
+FREQUENCIES = [250.0, 354.0, 500.0, 707.0, 1000.0, 1414.0, 2000.0, 2828.0, 4000.0, 5657.0, 8000.0]
+LOSSES = [float(loss) for loss in range(0, 125, 5)]
+LEVELS = [float(level) for level in range(40, 95, 5)]
+EXPERIENCE = ["new", "some", "experienced"]
+
+THRESHOLD_DB_SPL = 50.0
+MAX_GAIN_DB = 50.0
+
+# Proportion of the loss given as gain for a 65 dB SPL input, per frequency
+MID_LEVEL_GAIN_FACTORS = {250.0: 0.12, 500.0: 0.22, 1000.0: 0.34, 2000.0: 0.42, 4000.0: 0.40, 8000.0: 0.32}
+
+
+def interpolate_log_frequency(table, frequency):
+    points = sorted(table.items())
+    if frequency <= points[0][0]:
+        return points[0][1]
+    for (f0, v0), (f1, v1) in zip(points, points[1:]):
+        if frequency <= f1:
+            t = math.log2(frequency / f0) / math.log2(f1 / f0)
+            return v0 + t * (v1 - v0)
+    return points[-1][1]
+
+
+def compression_ratio(frequency, loss):
+    # Gentler in the low frequencies, up to 3:1 for severe high-frequency losses
+    per_db = 0.006 if frequency < 1000.0 else 0.012
+    return min(3.0, max(1.0, 1.0 + loss * per_db))
+
+
+def mid_level_gain(frequency, loss):
+    gain = interpolate_log_frequency(MID_LEVEL_GAIN_FACTORS, frequency) * loss
+
+    # Severe losses need proportionally more gain in the low and mid frequencies...
+    if loss > 60.0 and frequency <= 2000.0:
+        gain += 0.1 * (loss - 60.0)
+
+    # ...but little is gained by amplifying dead high-frequency regions
+    if loss > 70.0 and frequency >= 4000.0:
+        gain -= 0.2 * (loss - 70.0)
+
+    return max(0.0, gain)
+
+
+def experience_reduction(loss, experience):
+    # New users get up to 6 dB less for moderate and worse losses; some experience, half that
+    full = min(6.0, max(0.0, 0.15 * (loss - 10.0)))
+    return {"new": full, "some": 0.5 * full, "experienced": 0.0}[experience]
+
+
+def gain(experience, frequency, loss, level):
+    slope = 1.0 - 1.0 / compression_ratio(frequency, loss)
+    effective_level = max(level, THRESHOLD_DB_SPL)      # Linear below the threshold
+    g = mid_level_gain(frequency, loss) - (effective_level - 65.0) * slope
+    g -= experience_reduction(loss, experience)
+    return min(MAX_GAIN_DB, max(0.0, g))
+
+
+def build():
+    data = bytearray()
+    data += b"ENL2"
+    data += struct.pack("<HHHHH", 1, len(FREQUENCIES), len(LOSSES), len(LEVELS), len(EXPERIENCE))
+    data += struct.pack("<%df" % len(FREQUENCIES), *FREQUENCIES)
+    data += struct.pack("<%df" % len(LOSSES), *LOSSES)
+    data += struct.pack("<%df" % len(LEVELS), *LEVELS)
+    data += struct.pack("<f", THRESHOLD_DB_SPL)
+
+    for experience in EXPERIENCE:
+        for frequency in FREQUENCIES:
+            for loss in LOSSES:
+                for level in LEVELS:
+                    data += struct.pack("<h", int(round(gain(experience, frequency, loss, level) * 100.0)))
+
+    return bytes(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build the NAL-NL2-style gain tables")
+    parser.add_argument("--output", type=Path,
+                        default=Path(__file__).resolve().parent.parent / "Resources" / "NALNL2Tables.bin")
+    parser.add_argument("--csv", type=Path, help="Also write the gains as CSV")
+    args = parser.parse_args()
+
+    data = build()
+    args.output.parent.mkdir(parents=True, exist_ok=True)
+    args.output.write_bytes(data)
+    print(f"Wrote {args.output} ({len(data)} bytes)")
+
+    if args.csv:
+        with open(args.csv, "w") as f:
+            f.write("experience,frequency,loss,level,gain\n")
+            for experience in EXPERIENCE:
+                for frequency in FREQUENCIES:
+                    for loss in LOSSES:
+                        for level in LEVELS:
+                            f.write(f"{experience},{frequency:g},{loss:g},{level:g},"
+                                    f"{gain(experience, frequency, loss, level):.2f}\n")
+        print(f"Wrote {args.csv}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
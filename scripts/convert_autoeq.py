@@ -10,6 +10,7 @@ Usage:
     python convert_autoeq.py --top 100          # Only top 100 popular headphones
     python convert_autoeq.py --update           # Update existing database
     python convert_autoeq.py --local /path      # Convert from local AutoEq clone
+    python convert_autoeq.py --no-curves        # Parametric filters only (smaller files)
 
 Output: ~/Library/Application Support/EarFix/headphones/
 """
@@ -23,6 +24,8 @@ import urllib.request
 import zipfile
 import tempfile
 import shutil
+import csv
+import math
 from pathlib import Path
 from datetime import datetime
 
@@ -127,6 +130,78 @@ def parse_parametric_eq(filepath):
     }
 
 
+def parse_response_curve(eq_filepath):
+    """Read the raw AutoEq correction curve next to a ParametricEQ.txt file.
+
+    Prefers the full-resolution <name>.csv (frequency, raw, ..., equalization)
+    and falls back to "<name> GraphicEQ.txt". Returns (frequencies, raw, equalization)
+    with raw set to None when unavailable, or None if no curve is found. Rows without
+    a raw measurement have None in raw rather than a made-up 0 dB.
+    """
+    eq_path = Path(eq_filepath)
+    base_name = eq_path.name.replace(" ParametricEQ.txt", "")
+
+    csv_path = eq_path.with_name(f"{base_name}.csv")
+    if csv_path.exists():
+        try:
+            frequencies, raw, equalization = [], [], []
+            with open(csv_path, 'r', encoding='utf-8') as f:
+                for row in csv.DictReader(f):
+                    if row.get("frequency") and row.get("equalization"):
+                        frequencies.append(float(row["frequency"]))
+                        equalization.append(float(row["equalization"]))
+                        raw.append(float(row["raw"]) if row.get("raw") else None)
+            if frequencies:
+                # No raw column, or no value in it
+                if all(r is None for r in raw):
+                    raw = None
+                return frequencies, raw, equalization
+        except (OSError, ValueError) as e:
+            print(f"  Error reading {csv_path}: {e}")
+
+    graphic_path = eq_path.with_name(f"{base_name} GraphicEQ.txt")
+    if graphic_path.exists():
+        try:
+            with open(graphic_path, 'r', encoding='utf-8') as f:
+                content = f.read()
+            pairs = re.findall(r'(\d+\.?\d*)\s+(-?\d+\.?\d*)', content.split(":", 1)[-1])
+            if pairs:
+                return [float(fr) for fr, _ in pairs], None, [float(g) for _, g in pairs]
+        except (OSError, ValueError) as e:
+            print(f"  Error reading {graphic_path}: {e}")
+
+    return None
+
+
+def resample_curve(frequencies, gains, points_per_octave=24, low=20.0, high=20000.0):
+    """Resample a dB curve onto a log-spaced grid (linear interpolation in log frequency).
+
+    Points with a gain of None (missing measurements) are skipped and interpolated across.
+    """
+    pairs = sorted((f, g) for f, g in zip(frequencies, gains) if f > 0 and g is not None)
+    frequencies = [f for f, _ in pairs]
+    gains = [g for _, g in pairs]
+
+    num_points = int(round(math.log2(high / low) * points_per_octave)) + 1
+    grid = [low * 2 ** (i / points_per_octave) for i in range(num_points)]
+
+    resampled = []
+    j = 0
+    for f in grid:
+        if f <= frequencies[0]:
+            resampled.append(gains[0])
+            continue
+        if f >= frequencies[-1]:
+            resampled.append(gains[-1])
+            continue
+        while frequencies[j + 1] < f:
+            j += 1
+        t = math.log(f / frequencies[j]) / math.log(frequencies[j + 1] / frequencies[j])
+        resampled.append(gains[j] + t * (gains[j + 1] - gains[j]))
+
+    return [round(f, 2) for f in grid], [round(g, 2) for g in resampled]
+
+
 def find_headphone_files(autoeq_path):
     """Find all ParametricEQ.txt files in AutoEq directory."""
     headphones = []
@@ -188,7 +263,7 @@ def select_best_source(headphones_by_name):
     return selected
 
 
-def convert_headphone(hp_info, output_dir):
+def convert_headphone(hp_info, output_dir, include_curve=True):
     """Convert a single headphone EQ file to JSON."""
     eq_data = parse_parametric_eq(hp_info["file"])
     if not eq_data:
@@ -203,6 +278,16 @@ def convert_headphone(hp_info, output_dir):
         "filters": eq_data["filters"]
     }
 
+    # Raw correction curve at 1/24 octave for EarFix's FIR correction modes
+    if include_curve:
+        curve = parse_response_curve(hp_info["file"])
+        if curve:
+            frequencies, raw, equalization = curve
+            grid, equalization = resample_curve(frequencies, equalization)
+            output["curve"] = {"frequency": grid, "equalization": equalization}
+            if raw is not None:
+                output["curve"]["raw"] = resample_curve(frequencies, raw)[1]
+
     # Sanitize filename
     safe_name = re.sub(r'[<>:"/\\|?*]', '_', hp_info["name"])
     output_file = output_dir / f"{safe_name}.json"
@@ -276,6 +361,7 @@ def main():
     parser.add_argument("--popular-only", action="store_true", help="Only convert popular headphones")
     parser.add_argument("--output", type=str, help="Output directory (default: Application Support)")
     parser.add_argument("--list", action="store_true", help="List available headphones without converting")
+    parser.add_argument("--no-curves", action="store_true", help="Skip raw correction curves (FIR modes fall back to parametric)")
     args = parser.parse_args()
 
     output_dir = Path(args.output) if args.output else get_output_dir()
@@ -343,7 +429,7 @@ def main():
     print(f"\nConverting {len(selected)} headphones...")
     converted = []
     for name, hp in selected.items():
-        result = convert_headphone(hp, output_dir)
+        result = convert_headphone(hp, output_dir, include_curve=not args.no_curves)
         if result:
             converted.append(hp)
             print(f"  + {name}")